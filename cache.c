@@ -0,0 +1,361 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "generate.h"
+#include "cache.h"
+
+/**
+ * @brief      { cache_dir }
+ *
+ * @return     { the cache directory, or NULL when caching is off }
+ */
+
+static const char *cache_dir( void )
+{
+    const char *dir = getenv( "PNM_CACHE_DIR" );
+
+    return ( dir != NULL && dir[0] != '\0' ) ? dir : NULL;
+}
+
+/**
+ * @brief      { cache_hash } FNV-1a over the key and the generator version
+ *
+ * @return     { the 64 bit hash naming the entry }
+ */
+
+static unsigned long long cache_hash( const struct Cache_Key *key )
+{
+    char text[128];
+    unsigned long long hash = 14695981039346656037ULL;
+
+    snprintf( text, sizeof(text), "pnm v%d type %d %dx%d format %d variant %d", GENERATOR_VERSION,
+              key->type, key->width, key->height, key->format, key->variant );
+
+    for ( const char *c = text; *c != '\0'; c++ )
+    {
+        hash ^= (unsigned char) *c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief      { cache_path } builds the path of the entry for a key
+ *
+ * @return     { 0 on success, -1 when caching is off }
+ */
+
+static int cache_path( const struct Cache_Key *key, char *path, size_t size )
+{
+    const char *dir = cache_dir();
+
+    if ( dir == NULL )
+    {
+        return -1;
+    }
+    return snprintf( path, size, "%s/%016llx.pnm", dir, cache_hash( key ) ) < (int) size ? 0 : -1;
+}
+
+/**
+ * @brief      { copy_fd } copies length bytes between files, sharing extents where the filesystem can
+ *
+ * @return     { 0 on success, -1 on failure }
+ */
+
+static int copy_fd( int in, int out, off_t length )
+{
+    ssize_t copied;
+
+    // A reflink shares the extents copy-on-write (btrfs, xfs)
+    if ( ioctl( out, FICLONE, in ) == 0 )
+    {
+        return 0;
+    }
+
+    // copy_file_range stays in the kernel, and may still share extents
+    while ( length > 0 )
+    {
+        copied = copy_file_range( in, NULL, out, NULL, length, 0 );
+        if ( copied <= 0 )
+        {
+            break;
+        }
+        length -= copied;
+    }
+
+    // sendfile covers older kernels and filesystems copy_file_range refuses (EXDEV)
+    while ( length > 0 )
+    {
+        copied = sendfile( out, in, NULL, length );
+        if ( copied <= 0 )
+        {
+            return -1;
+        }
+        length -= copied;
+    }
+    return 0;
+}
+
+/**
+ * @brief      { copy_file } copies source to destination, which must not exist yet
+ *
+ * @return     { 0 on success, -1 on failure }
+ */
+
+static int copy_file( const char *source, const char *destination )
+{
+    struct stat info;
+    int in, out, result = -1;
+
+    in = open( source, O_RDONLY );
+    if ( in < 0 )
+    {
+        return -1;
+    }
+
+    // A fresh inode of the caller's own, writable as the umask allows
+    out = open( destination, O_WRONLY | O_CREAT | O_EXCL, 0666 );
+    if ( out >= 0 )
+    {
+        if ( fstat( in, &info ) == 0 && copy_fd( in, out, info.st_size ) == 0 )
+        {
+            result = 0;
+        }
+        if ( close( out ) != 0 )
+        {
+            result = -1;
+        }
+    }
+    close( in );
+    return result;
+}
+
+/**
+ * @brief      { cache_enabled }
+ *
+ * @return     { 1 if PNM_CACHE_DIR is set }
+ */
+
+int cache_enabled( void )
+{
+    return cache_dir() != NULL;
+}
+
+/**
+ * @brief      { cache_fetch } reflinks or copies the cached image to destination
+ *
+ *             Never a hard link, the destination is the caller's to rewrite and
+ *             must not share its inode with the entry.
+ *
+ * @return     { 0 on a hit, -1 on a miss }
+ */
+
+int cache_fetch( const struct Cache_Key *key, const char *destination )
+{
+    char path[PATH_MAX];
+
+    if ( cache_path( key, path, sizeof(path) ) != 0 || access( path, R_OK ) != 0 )
+    {
+        return -1;
+    }
+
+    // Replace the destination rather than write through it
+    if ( unlink( destination ) != 0 && errno != ENOENT )
+    {
+        return -1;
+    }
+    if ( copy_file( path, destination ) == 0 )
+    {
+        return 0;
+    }
+    unlink( destination );
+    return -1;
+}
+
+/**
+ * @brief      { cache_open } opens the cached image for reading
+ *
+ * @param      length  Set to the size of the image
+ *
+ * @return     { the file descriptor, -1 on a miss }
+ */
+
+int cache_open( const struct Cache_Key *key, off_t *length )
+{
+    char path[PATH_MAX];
+    struct stat info;
+    int fd;
+
+    if ( cache_path( key, path, sizeof(path) ) != 0 )
+    {
+        return -1;
+    }
+
+    fd = open( path, O_RDONLY );
+    if ( fd >= 0 && fstat( fd, &info ) != 0 )
+    {
+        close( fd );
+        return -1;
+    }
+    if ( fd >= 0 )
+    {
+        *length = info.st_size;
+    }
+    return fd;
+}
+
+/**
+ * @brief      { cache_send } sends an opened entry to fd without copying it through user space
+ *
+ * @return     { 0 on success, -1 on failure }
+ */
+
+int cache_send( int entry, int fd, off_t length )
+{
+    ssize_t sent;
+
+    while ( length > 0 )
+    {
+        sent = sendfile( fd, entry, NULL, length );
+        if ( sent < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( sent <= 0 )
+        {
+            return -1;
+        }
+        length -= sent;
+    }
+    return 0;
+}
+
+/**
+ * @brief      { begin_store } creates a temporary file in the cache directory
+ *
+ * @param      path       Set to the final path of the entry
+ * @param      temporary  Set to the path of the temporary file
+ *
+ * @return     { the temporary file descriptor, -1 on failure }
+ */
+
+static int begin_store( const struct Cache_Key *key, char *path, char *temporary )
+{
+    if ( cache_path( key, path, PATH_MAX ) != 0 )
+    {
+        return -1;
+    }
+    if ( mkdir( cache_dir(), 0755 ) != 0 && errno != EEXIST )
+    {
+        return -1;
+    }
+
+    snprintf( temporary, PATH_MAX, "%s.XXXXXX", path );
+    return mkstemp( temporary );
+}
+
+/**
+ * @brief      { finish_store } publishes the temporary file as a read only entry
+ *
+ *             The rename is atomic, so concurrent writers and readers (such as the
+ *             server's workers) only ever see whole entries.
+ *
+ * @return     { 0 on success, -1 on failure }
+ */
+
+static int finish_store( int fd, int result, const char *path, const char *temporary )
+{
+    if ( fchmod( fd, 0444 ) != 0 )
+    {
+        result = -1;
+    }
+    if ( close( fd ) != 0 )
+    {
+        result = -1;
+    }
+    if ( result == 0 && rename( temporary, path ) == 0 )
+    {
+        return 0;
+    }
+    unlink( temporary );
+    return -1;
+}
+
+/**
+ * @brief      { cache_store } stores a copy of the file at source
+ *
+ *             A copy rather than a link, so the entry never shares an inode with
+ *             a file the caller may go on to modify.
+ *
+ * @return     { 0 on success, -1 on failure }
+ */
+
+int cache_store( const struct Cache_Key *key, const char *source )
+{
+    char path[PATH_MAX], temporary[PATH_MAX];
+    struct stat info;
+    int in, out, result = -1;
+
+    out = begin_store( key, path, temporary );
+    if ( out < 0 )
+    {
+        return -1;
+    }
+
+    in = open( source, O_RDONLY );
+    if ( in >= 0 )
+    {
+        if ( fstat( in, &info ) == 0 && copy_fd( in, out, info.st_size ) == 0 )
+        {
+            result = 0;
+        }
+        close( in );
+    }
+    return finish_store( out, result, path, temporary );
+}
+
+/**
+ * @brief      { cache_store_buffer } stores an encoded image held in memory
+ *
+ * @return     { 0 on success, -1 on failure }
+ */
+
+int cache_store_buffer( const struct Cache_Key *key, const void *buffer, size_t length )
+{
+    char path[PATH_MAX], temporary[PATH_MAX];
+    const char *bytes = buffer;
+    ssize_t written;
+    int out, result = 0;
+
+    out = begin_store( key, path, temporary );
+    if ( out < 0 )
+    {
+        return -1;
+    }
+
+    while ( length > 0 )
+    {
+        written = write( out, bytes, length );
+        if ( written < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( written <= 0 )
+        {
+            result = -1;
+            break;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return finish_store( out, result, path, temporary );
+}
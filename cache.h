@@ -0,0 +1,49 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <sys/types.h>
+
+/*
+ * The output cache.
+ *
+ * Generated images are a pure function of their parameters, so when the
+ * PNM_CACHE_DIR environment variable names a directory every image written
+ * is also kept there, under a hash of the parameters and GENERATOR_VERSION.
+ * A later request for the same image is reflinked or copied into place
+ * instead of being drawn again.
+ *
+ * Entries are read only and never written after they are stored. Outputs
+ * never share an inode with an entry, a hit is a copy rather than a hard
+ * link, and libpnm replaces a file with other links rather than writing
+ * through it, so rewriting an output leaves the cache alone.
+ */
+
+// the parameters that determine an output file; variant 0 is the image itself,
+// 1 to 3 are the red, green and blue channel copies of a PPM
+struct Cache_Key
+{
+    int type;
+    int width;
+    int height;
+    int format;
+    int variant;
+};
+
+// returns 1 if PNM_CACHE_DIR is set
+int cache_enabled( void );
+
+// reflinks or copies the cached image to destination, returns 0 on a hit
+int cache_fetch( const struct Cache_Key *key, const char *destination );
+
+// opens the cached image for reading and sets length, returns -1 on a miss
+int cache_open( const struct Cache_Key *key, off_t *length );
+
+// sends length bytes of an entry opened with cache_open to fd (a pipe,
+// socket or file), returns 0 on success
+int cache_send( int entry, int fd, off_t length );
+
+// stores a copy of the file at source, or of a buffer, returns 0 on success
+int cache_store( const struct Cache_Key *key, const char *source );
+int cache_store_buffer( const struct Cache_Key *key, const void *buffer, size_t length );
+
+#endif /*_CACHE_H_*/
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "libpnm.h"
+#include "libpnm_metrics.h"
+#include "libpnm_rle.h"
+#include "compare.h"
+
+/*---------------------------------------------------*/
+/* THE NAMES OF THE CHANNELS IN THE OUTPUT, BY INDEX */
+/* INTO THE METRICS                                  */
+/*---------------------------------------------------*/
+static const char *colourChannels[] = { "red", "green", "blue", "all" };
+
+/*---------------------------------------------*/
+/* PRINTS THE METRICS OF ONE CHANNEL OF A PAIR */
+/*---------------------------------------------*/
+static void print_channel( const char *original, const char *reconstructed,
+                           const char *channel, const struct PNM_Metrics *metrics,
+                           int index )
+{
+    printf( "%s %s %s MSE %.6f PSNR %.4f dB max %d SSIM %.6f\n",
+            original, reconstructed, channel, metrics->mse[index],
+            metrics->psnr[index], metrics->maxError[index], metrics->ssim[index] );
+}
+
+/*---------------------------------------------------------*/
+/* LOADS A PGM, OR A PBM AS A PGM OF 0 AND 255, FROM A PNM */
+/* FILE OR A RUN LENGTH CONTAINER                          */
+/* (returns -1 if the file holds neither)                  */
+/*---------------------------------------------------------*/
+static int load_gray( struct PGM_Image *pgmImage, char *path )
+{
+    struct PBM_Image pbmImage;
+    int status;
+
+    if ( load_PGM_Image( pgmImage, path ) == 0 || load_PGM_Image_RLE( pgmImage, path ) == 0 )
+    {
+        return 0;
+    }
+    if ( load_PBM_Image( &pbmImage, path ) != 0 && load_PBM_Image_RLE( &pbmImage, path ) != 0 )
+    {
+        return -1;
+    }
+
+    status = copy_PBM_to_PGM( &pbmImage, pgmImage );
+    free_PBM_Image( &pbmImage );
+    return status;
+}
+
+/*-------------------------------------------------*/
+/* LOADS A PPM FROM A PNM FILE OR A RUN LENGTH     */
+/* CONTAINER (returns -1 if the file holds no PPM) */
+/*-------------------------------------------------*/
+static int load_colour( struct PPM_Image *ppmImage, char *path )
+{
+    if ( load_PPM_Image( ppmImage, path ) == 0 || load_PPM_Image_RLE( ppmImage, path ) == 0 )
+    {
+        return 0;
+    }
+    return -1;
+}
+
+/*-------------------------------------------------------*/
+/* COMPARES ONE PAIR OF IMAGES, AS PGM (A PBM COUNTING   */
+/* AS ONE) OR ELSE AS PPM (returns -1 if they cannot be) */
+/*-------------------------------------------------------*/
+static int compare_pair( char *original, char *reconstructed )
+{
+    struct PGM_Image pgmOriginal, pgmReconstructed;
+    struct PPM_Image ppmOriginal, ppmReconstructed;
+    struct PNM_Metrics metrics;
+    int status = -1;
+
+    if ( load_gray( &pgmOriginal, original ) == 0 )
+    {
+        if ( load_gray( &pgmReconstructed, reconstructed ) == 0 )
+        {
+            status = compare_PGM_Images( &pgmOriginal, &pgmReconstructed, &metrics );
+            if ( status == 0 )
+            {
+                print_channel( original, reconstructed, "gray", &metrics, 0 );
+            }
+            free_PGM_Image( &pgmReconstructed );
+        }
+        free_PGM_Image( &pgmOriginal );
+    }
+    else if ( load_colour( &ppmOriginal, original ) == 0 )
+    {
+        if ( load_colour( &ppmReconstructed, reconstructed ) == 0 )
+        {
+            status = compare_PPM_Images( &ppmOriginal, &ppmReconstructed, &metrics );
+            for ( int channel = 0; status == 0 && channel <= METRICS_ALL; channel++ )
+            {
+                print_channel( original, reconstructed, colourChannels[channel],
+                               &metrics, channel );
+            }
+            free_PPM_Image( &ppmReconstructed );
+        }
+        free_PPM_Image( &ppmOriginal );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot compare %s with %s\n", original, reconstructed );
+    }
+
+    return status;
+}
+
+/*------------------------------------------------------*/
+/* COMPARES EACH PAIR OF PATHS, THE ORIGINAL THEN ITS   */
+/* RECONSTRUCTION (returns the pairs that could not be) */
+/*------------------------------------------------------*/
+int run_compare( int count, char **paths )
+{
+    int failed = 0;
+
+    if ( count % 2 != 0 )
+    {
+        fprintf( stderr, "Cannot compare %s with nothing\n", paths[count - 1] );
+        failed++;
+        count--;
+    }
+
+    for ( int i = 0; i < count; i += 2 )
+    {
+        if ( compare_pair( paths[i], paths[i + 1] ) != 0 )
+        {
+            failed++;
+        }
+    }
+
+    return failed;
+}
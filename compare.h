@@ -0,0 +1,22 @@
+#ifndef _COMPARE_H_
+#define _COMPARE_H_
+
+/*
+ * The image comparison command.
+ *
+ * Each pair of paths names an original image and its reconstruction, both
+ * PGM (a PBM is compared as a PGM of 0 and 255) or both PPM of the same
+ * size, in any mix of ASCII, raw and run length containers. For every
+ * pair one line is printed per channel, and for a PPM one more for all the
+ * channels together:
+ *
+ *     original reconstructed channel MSE <mse> PSNR <psnr> dB max <error> SSIM <ssim>
+ *
+ * where channel is gray, red, green, blue or all (see libpnm_metrics.h).
+ */
+
+// compares count paths taken as pairs, returns the number of pairs that
+// could not be compared
+int run_compare( int count, char **paths );
+
+#endif /*_COMPARE_H_*/
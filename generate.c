@@ -0,0 +1,997 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_rle.h"
+#include "cache.h"
+#include "libpnm_profile.h"
+#include "generate.h"
+
+/**
+ * @brief      { find_arg_errors } checks the arguments against the validation rules
+ *             without printing anything
+ *
+ * @param[in]  type    The type
+ * @param[in]  width   The width
+ * @param[in]  height  The height
+ * @param[in]  format  The format
+ * @param      errors  Filled with why each failed rule failed (room for ARG_ERRORS)
+ *
+ * @return     { the number of rules that failed }
+ */
+
+static int find_arg_errors( int type, int width, int height, int format, const char **errors )
+{
+    int count = 0;
+
+    /* CHECK TYPE */
+
+    if ( type <= 0 || type > 3 )
+    {
+        errors[count++] = "image type code must be either 1, 2, or 3.";
+    }
+
+    /* CHECK WIDTH */
+
+    // If we have PBM or PGM format...
+    if ( type == 1 || type == 2 )
+    {
+        // Check if image width is at least 4 and is divisible by 4
+        if ( !(width % 4 == 0 && width / 4 >= 1 ) )
+        {
+            errors[count++] = "for pbm and pgm formats, image width must be at least 4 and a multiple of 4";
+        }
+    }
+    else if ( type == 3 )
+    {
+        // If we have PPM then we check that image width is at least 6 and divisible by 6
+        if ( !(width % 6 == 0 && width / 6 >= 1 ) )
+        {
+            errors[count++] = "for pbm and pgm formats, image width must be at least 6 and a multiple of 6";
+        }
+    }
+
+    /* CHECK HEIGHT */
+    // Check if image height is at least 4 and is divisble by 4
+    if ( !(height % 4 == 0 && height / 4 >= 1 ) )
+    {
+        errors[count++] = "for all formats, image height must be at least 4 and a multiple of 4";
+    }
+
+    /* CHECK FORMAT */
+
+    if ( format != 0 && format != 1 && format != RLE_FORMAT )
+    {
+        errors[count++] = "format must be either 0, for ASCII, 1, for raw, or 2, for run length compressed";
+    }
+
+    return count;
+}
+
+/**
+ * @brief      { check_args }
+ *
+ * @param[in]  type          The type
+ * @param[in]  width         The width
+ * @param[in]  height        The height
+ * @param      out_filename  The out filename
+ * @param[in]  format        The format
+ *
+ * @return     { returns integer 1 if validation fails, else 0 }
+ */
+
+int check_args(int type, int width, int height, char *out_filename, int format)
+{
+    const char *errors[ARG_ERRORS];
+    int count = find_arg_errors( type, width, height, format, errors );
+
+    if ( count > 0 )
+    {
+        for ( int i = 0; i < count; i++ )
+        {
+            printf( "Error: %s\n", errors[i] );
+        }
+        puts("One or more errors occurred while executing. Exiting...");
+        return 1;
+    }
+
+    return 0;
+
+}
+
+/**
+ * @brief      { args_error } validates the arguments without printing anything
+ *
+ * @return     { why the first failed rule failed, or NULL when the arguments are valid }
+ */
+
+const char *args_error( int type, int width, int height, int format )
+{
+    const char *errors[ARG_ERRORS];
+
+    return find_arg_errors( type, width, height, format, errors ) > 0 ? errors[0] : NULL;
+}
+
+/**
+ * @brief      { is_stdout }
+ *
+ * @param      out_filename  The out filename
+ *
+ * @return     { 1 if the image should be written to stdout ("-"), else 0 }
+ */
+
+static int is_stdout( char *out_filename )
+{
+    return strcmp(out_filename, "-") == 0;
+}
+
+/**
+ * @brief      { fetch_output } puts a cached image in place of out_filename, or sends it to stdout
+ *
+ * @return     { 0 on a hit, -1 on a miss or when caching is off }
+ */
+
+static int fetch_output( const struct Cache_Key *key, char *out_filename )
+{
+    off_t length;
+    int entry, result;
+
+    if ( !is_stdout( out_filename ) )
+    {
+        return cache_fetch( key, out_filename );
+    }
+
+    entry = cache_open( key, &length );
+    if ( entry < 0 )
+    {
+        return -1;
+    }
+    result = cache_send( entry, STDOUT_FILENO, length );
+    close( entry );
+    return result;
+}
+
+/**
+ * @brief      { store_output } keeps a copy of a freshly saved out_filename in the cache
+ */
+
+static void store_output( const struct Cache_Key *key, char *out_filename )
+{
+    if ( cache_enabled() && !is_stdout( out_filename ) )
+    {
+        cache_store( key, out_filename );
+    }
+}
+
+/**
+ * @brief      { open_mapped_output } creates and maps out_filename when it is a raw file
+ *
+ *             Raw images are drawn straight into the mapped file, with nothing
+ *             left to save.
+ *
+ * @return     { 0 when mapped, -1 when the image has to be saved as usual }
+ */
+
+static int open_mapped_output( struct PNM_Mapped_Image *mappedImage, char *out_filename, enum Format type,
+                               int width, int height, int format )
+{
+    if ( format != 1 || is_stdout( out_filename ) )
+    {
+        return -1;
+    }
+
+    return create_PNM_Mapped_Image( mappedImage, out_filename, type, width, height, MAX_GRAY );
+}
+
+/**
+ * @brief      { SAVE_IMAGE } saves a TYPE (PBM, PGM or PPM) image to out_filename or stdout
+ *             in any of the formats, with the save profiled under its libpnm name, and sets
+ *             result to 0 on success
+ */
+
+#define SAVE_IMAGE( TYPE, image, out_filename, format, result )                                                      \
+    do                                                                                                                \
+    {                                                                                                                 \
+        long long pixels_ = (long long) (image)->width * (image)->height;                                             \
+        int stdout_ = is_stdout( out_filename );                                                                      \
+                                                                                                                      \
+        if ( (format) == RLE_FORMAT && stdout_ )                                                                      \
+        {                                                                                                             \
+            PNM_PROFILE( "write_" #TYPE "_Image_RLE", pixels_,                                                        \
+                         (result) = write_##TYPE##_Image_RLE( (image), stdout ) );                                    \
+            if ( fflush( stdout ) != 0 )                                                                              \
+            {                                                                                                         \
+                (result) = -1;                                                                                        \
+            }                                                                                                         \
+        }                                                                                                             \
+        else if ( (format) == RLE_FORMAT )                                                                            \
+        {                                                                                                             \
+            PNM_PROFILE( "save_" #TYPE "_Image_RLE", pixels_,                                                         \
+                         (result) = save_##TYPE##_Image_RLE( (image), (out_filename) ) );                             \
+        }                                                                                                             \
+        else if ( stdout_ )                                                                                           \
+        {                                                                                                             \
+            PNM_PROFILE( "save_" #TYPE "_Image_fd", pixels_,                                                          \
+                         (result) = save_##TYPE##_Image_fd( (image), STDOUT_FILENO, (format) ) );                     \
+        }                                                                                                             \
+        else                                                                                                          \
+        {                                                                                                             \
+            PNM_PROFILE( "save_" #TYPE "_Image", pixels_,                                                             \
+                         (result) = save_##TYPE##_Image( (image), (out_filename), (format) ) );                       \
+        }                                                                                                             \
+        if ( (result) != 0 )                                                                                          \
+        {                                                                                                             \
+            fprintf( stderr, "Error: cannot write %s\n", stdout_ ? "to stdout" : (out_filename) );                  \
+        }                                                                                                             \
+    } while ( 0 )
+
+/**
+ * @brief      { save_pbm } saves to out_filename or stdout in any of the formats
+ *
+ * @return     { 0 on success, -1 (after saying so on stderr) on failure }
+ */
+
+static int save_pbm( struct PBM_Image *pbmImage, char *out_filename, int format )
+{
+    int result;
+
+    SAVE_IMAGE( PBM, pbmImage, out_filename, format, result );
+    return result;
+}
+
+/**
+ * @brief      { save_pgm } saves to out_filename or stdout in any of the formats
+ *
+ * @return     { 0 on success, -1 (after saying so on stderr) on failure }
+ */
+
+static int save_pgm( struct PGM_Image *pgmImage, char *out_filename, int format )
+{
+    int result;
+
+    SAVE_IMAGE( PGM, pgmImage, out_filename, format, result );
+    return result;
+}
+
+/**
+ * @brief      { save_ppm } saves to out_filename or stdout in any of the formats
+ *
+ * @return     { 0 on success, -1 (after saying so on stderr) on failure }
+ */
+
+static int save_ppm( struct PPM_Image *ppmImage, char *out_filename, int format )
+{
+    int result;
+
+    SAVE_IMAGE( PPM, ppmImage, out_filename, format, result );
+    return result;
+}
+
+/**
+ * @brief      { draw_pbm }
+ *
+ *             Draws the test pattern into an image that has already been
+ *             created, so a caller can reuse the same image between draws.
+ *
+ * @param      pbmImage      The portable bitmap image
+ *
+ * @return     { void }
+ */
+
+void draw_pbm( struct PBM_Image *pbmImage )
+{
+    int row, col;
+    int width = pbmImage->width;
+    int height = pbmImage->height;
+    int quarterWidth = width / 4;
+    int quarterHeight = height / 4;
+    int colour = 0;
+
+    // Determine if the image requested is height-long or width-long
+    int isWide = width >= height;
+    int strokeStart, strokeEnd, strokeLength;
+
+    strokeStart = 0;
+
+    // Construct the white rectangle making up 1/2 total width and 1/2 total height
+    for ( row = 0; row < pbmImage->height; row++ )
+    {
+        for ( col = 0; col < pbmImage->width; col++ )
+        {
+            if ( row >= quarterHeight && row < (quarterHeight * 3) && col >= quarterWidth && col < (quarterWidth * 3) )
+            {
+                colour = 0;
+            }
+            else
+            {
+                colour = 1;
+            }
+            pbmImage->image[row][col] = colour;
+        }
+    }
+
+    // If image is width-long
+    if ( isWide )
+    {
+        // then the length of our line stroke is equal to width/height
+        strokeLength = width / height;
+        strokeEnd = strokeLength;
+
+        // draw the line from one corner of the image to the other
+        // while also drawing the opposite line simoultaneously
+        for ( row = 0; row < pbmImage->height; row++ )
+        {
+            for ( col = 0; col < pbmImage->width; col++ )
+            {
+                if( col >= strokeStart && col < strokeEnd )
+                {
+                    pbmImage->image[row][col] = 1;
+                    pbmImage->image[row][width - col - 1] = 1;
+                }
+            }
+            strokeStart = strokeEnd;
+            strokeEnd += strokeLength;
+        }
+    }
+    else
+    {
+        // Else it is height-long and the stroke length is equal to height/width
+        strokeLength = height / width;
+        strokeEnd = strokeLength;
+
+        // draw the line from one corner of the image to the other
+        // while also drawing the opposite line simoultaneously
+        for ( col = 0; col < pbmImage->width; col++ )
+        {
+            for ( row = 0; row < pbmImage->height; row++ )
+            {
+                if ( row >= strokeStart && row < strokeEnd )
+                {
+                    pbmImage->image[row][col] = 1;
+                    pbmImage->image[height - row - 1][col] = 1;
+                }
+            }
+            strokeStart = strokeEnd;
+            strokeEnd += strokeLength;
+        }
+    }
+
+}
+
+/**
+ * @brief      { generate_pbm }
+ *
+ * @param      pbmImage      The portable bitmap image
+ * @param[in]  width         The width
+ * @param[in]  height        The height
+ * @param      out_filename  The out filename
+ * @param[in]  format        The format
+ *
+ * @return     { void }
+ */
+
+void generate_pbm( struct PBM_Image *pbmImage, int width, int height, char *out_filename, int format )
+{
+    long long pixels = (long long) width * height;
+    struct Cache_Key key = { 1, width, height, format, 0 };
+
+    if ( fetch_output( &key, out_filename ) == 0 )
+    {
+        return;
+    }
+
+    PNM_PROFILE( "create_PBM_Image", pixels, create_PBM_Image( pbmImage, width, height ) );
+
+    draw_pbm( pbmImage );
+
+    // Save image to disk and free memory
+    if ( save_pbm( pbmImage, out_filename, format ) == 0 )
+    {
+        store_output( &key, out_filename );
+    }
+    PNM_PROFILE( "free_PBM_Image", pixels, free_PBM_Image( pbmImage ) );
+
+}
+
+/**
+ * @brief      { draw_pgm }
+ *
+ *             Draws the test pattern into an image that has already been
+ *             created, so a caller can reuse the same image between draws.
+ *
+ * @param      pgmImage      The pgm image
+ *
+ * @return     { void }
+ */
+
+void draw_pgm( struct PGM_Image *pgmImage )
+{
+    int width = pgmImage->width;
+    int height = pgmImage->height;
+    int quarterWidth = width / 4;
+    int quarterHeight = height / 4;
+    int colour = 0;
+
+    // Determine if the image requested is height-long or width-long
+    int isWide = width >= height;
+
+    // Construct the white rectangle making up 1/2 total width and 1/2 total height
+    for ( int row = 0; row < pgmImage->height; row++ )
+    {
+        for ( int col = 0; col < pgmImage->width; col++ )
+        {
+            if ( row >= quarterHeight && row < (quarterHeight * 3) && col >= quarterWidth && col < (quarterWidth * 3) )
+            {
+                colour = MAX_GRAY;
+            }
+            else
+            {
+                colour = 0;
+            }
+            pgmImage->image[row][col] = colour;
+        }
+    }
+
+    // If image is width-long
+    if (isWide)
+    {
+
+        int vEdgeStart, vEdgeEnd, vEdgeLength;
+        float vShade, vGradient;
+
+        vEdgeStart = quarterWidth;                      // sliding start point of the gradient
+        vEdgeLength = width / height;                   // length of the iterative boundary of the gradient
+        vEdgeEnd = vEdgeStart + vEdgeLength;            // sliding end point of the gradient
+        vShade = (float) MAX_GRAY;                      // the shade of the current row/column
+        vGradient = (float) MAX_GRAY / quarterHeight;   // the amount by which the shade is incremented with each iteration
+
+        // Create the gradually darkening top/bottom triangles
+        for ( int row = quarterHeight; row < (quarterHeight * 2); row++ )
+        {
+            for ( int col = quarterWidth; col < (quarterWidth * 2); col++ )
+            {
+                if ( col >= vEdgeStart )
+                {
+                    pgmImage->image[row][width - col - 1] = vShade;
+                    pgmImage->image[height - row - 1][width - col - 1] = vShade;
+                    pgmImage->image[row][col] = vShade;
+                    pgmImage->image[height - row - 1][col] = vShade;
+                }
+            }
+            vShade -= vGradient;
+            vEdgeStart = vEdgeEnd;
+            vEdgeEnd += vEdgeLength;
+        }
+
+        float hEdgeStart, hEdgeEnd, fHeight, fWidth;
+        float hShade, hGradient, hEdgeLength;
+
+        fHeight = (float) height;                       // height to calculate the ratio between height/width
+        fWidth = (float) width;                         // height to calculate the ratio between height/width
+        hEdgeStart = quarterHeight;                     // sliding start point of the gradient
+        hEdgeLength = fHeight / fWidth;                 // length of the iterative boundary of the gradient
+        hEdgeEnd =  hEdgeStart + hEdgeLength;           // sliding end point of the gradient
+        hShade = (float) MAX_GRAY;                      // the shade of the current row/column
+        hGradient = (float) MAX_GRAY / quarterWidth;    // the amount by which the shade is incremented with each iteration
+
+        // Create the gradually darkening left/right triangles by applying
+        // the same transformation but transposed
+        for ( int col = quarterWidth; col < (quarterWidth * 2); col++ )
+        {
+            for ( int row = quarterHeight; row < (quarterHeight * 2); row++ )
+            {
+                if ( row >= (int) hEdgeStart )
+                {
+                    pgmImage->image[row][width - col - 1] = hShade;
+                    pgmImage->image[height - row - 1][width - col - 1] = hShade;
+                    pgmImage->image[row][col] = hShade;
+                    pgmImage->image[height - row - 1][col] = hShade;
+                }
+            }
+            hShade -= hGradient;
+            hEdgeStart = hEdgeEnd;
+            hEdgeEnd += hEdgeLength;
+        }
+    }
+    else
+    {
+        // Else if the image is width-long
+        int vEdgeStart, vEdgeEnd, vEdgeLength;
+        float vShade, vGradient;
+
+        vEdgeStart = quarterHeight;                             // sliding start point of the gradient
+        vEdgeLength = height / width;                           // length of the iterative boundary of the gradient
+        vEdgeEnd = vEdgeStart + vEdgeLength;                    // sliding end point of the gradient
+        vShade = (float) MAX_GRAY;                              // the shade of the current row/column
+        vGradient = (float) MAX_GRAY / quarterWidth;            // the amount by which the shade is incremented with each iteration
+
+        // Create the gradually darkening top/bottom triangles
+        for ( int col = quarterWidth; col < (quarterWidth * 2); col++ )
+        {
+            for ( int row = quarterHeight; row < (quarterHeight * 2); row++ )
+            {
+                if ( row >= vEdgeStart )
+                {
+                    pgmImage->image[row][width - col - 1] = vShade;
+                    pgmImage->image[height - row - 1][width - col - 1] = vShade;
+                    pgmImage->image[row][col] = vShade;
+                    pgmImage->image[height - row - 1][col] = vShade;
+                }
+            }
+            vShade -= vGradient;
+            vEdgeStart = vEdgeEnd;
+            vEdgeEnd += vEdgeLength;
+        }
+
+        float hEdgeStart, hEdgeEnd, fHeight, fWidth;
+        float hShade, hGradient, hEdgeLength;
+
+        fHeight = (float) height;                           // height to calculate the ratio between height/width
+        fWidth = (float) width;                             // height to calculate the ratio between height/width
+        hEdgeStart = quarterWidth;                          // sliding start point of the gradient
+        hEdgeLength = fWidth / fHeight;                     // length of the iterative boundary of the gradient
+        hEdgeEnd =  hEdgeStart + hEdgeLength;               // sliding end point of the gradient
+        hShade = (float) MAX_GRAY;                          // the shade of the current row/column
+        hGradient = (float) MAX_GRAY / quarterHeight;       // the amount by which the shade is incremented with each iteration
+
+        // Create the gradually darkening left/right triangles by applying
+        // the same transformation but transposed
+        for ( int row = quarterHeight; row < (quarterHeight * 2); row++ )
+        {
+            for ( int col = quarterWidth; col < (quarterWidth * 2); col++ )
+            {
+                if ( col >= (int) hEdgeStart )
+                {
+                    pgmImage->image[row][width - col - 1] = hShade;
+                    pgmImage->image[height - row - 1][width - col - 1] = hShade;
+                    pgmImage->image[row][col] = hShade;
+                    pgmImage->image[height - row - 1][col] = hShade;
+                }
+            }
+            hShade -= hGradient;
+            hEdgeStart = hEdgeEnd;
+            hEdgeEnd += hEdgeLength;
+        }
+    }
+
+}
+
+/**
+ * @brief      { generate_pgm }
+ *
+ * @param      pgmImage      The pgm image
+ * @param[in]  width         The width
+ * @param[in]  height        The height
+ * @param      out_filename  The out filename
+ * @param[in]  format        The format
+ *
+ * @return     { void }
+ */
+
+void generate_pgm( struct PGM_Image *pgmImage, int width, int height, char *out_filename, int format )
+{
+    long long pixels = (long long) width * height;
+    struct Cache_Key key = { 2, width, height, format, 0 };
+    struct PNM_Mapped_Image mappedImage;
+    int drawn = 0;
+
+    if ( fetch_output( &key, out_filename ) == 0 )
+    {
+        return;
+    }
+
+    // A raw file is drawn in place
+    if ( open_mapped_output( &mappedImage, out_filename, PGM, width, height, format ) == 0 )
+    {
+        if ( map_PGM_Image( &mappedImage, pgmImage ) == 0 )
+        {
+            draw_pgm( pgmImage );
+            free_PGM_Image( pgmImage );
+            drawn = 1;
+        }
+        if ( close_PNM_Mapped_Image( &mappedImage ) == 0 && drawn )
+        {
+            store_output( &key, out_filename );
+            return;
+        }
+    }
+
+    PNM_PROFILE( "create_PGM_Image", pixels, create_PGM_Image( pgmImage, width, height, MAX_GRAY ) );
+
+    draw_pgm( pgmImage );
+
+    if ( save_pgm( pgmImage, out_filename, format ) == 0 )
+    {
+        store_output( &key, out_filename );
+    }
+    PNM_PROFILE( "free_PGM_Image", pixels, free_PGM_Image( pgmImage ) );
+
+}
+
+/**
+ * @brief      { draw_ppm }
+ *
+ *             Draws the test pattern into an image that has already been
+ *             created, so a caller can reuse the same image between draws.
+ *
+ * @param      ppmImage      The ppm image
+ *
+ * @return     { void }
+ */
+
+void draw_ppm( struct PPM_Image *ppmImage )
+{
+
+    int width = ppmImage->width;
+    int height = ppmImage->height;
+
+    // Useful dimension values
+    int thirdWidth = width / 3;
+    int halfWidth = width / 2;
+    int halfHeight = height / 2;
+
+    // The amount by which the shades are incremented/decremented with each iteration
+    float gradient = (float) MAX_GRAY / halfHeight;
+
+    // initialize component shades
+    float rShade = 0;
+    float gShade = MAX_GRAY;
+    float bShade = 0;
+
+    float upShade = 0;
+    float downShade = MAX_GRAY;
+
+
+    // Colour Gradients on Upper Half
+    for ( int row = 0; row < halfHeight; row++ )
+    {
+        for ( int col = 0; col < thirdWidth; col++ )
+        {
+
+            // red gradient
+            ppmImage->image[row][col][0] = MAX_GRAY;
+            ppmImage->image[row][col][1] = rShade;
+            ppmImage->image[row][col][2] = rShade;
+
+            // green gradient
+            ppmImage->image[row][col + thirdWidth][0] = gShade;
+            ppmImage->image[row][col + thirdWidth][1] = MAX_GRAY;
+            ppmImage->image[row][col + thirdWidth][2] = gShade;
+
+            // blue gradient
+            ppmImage->image[row][col + (thirdWidth * 2)][0] = bShade;
+            ppmImage->image[row][col + (thirdWidth * 2)][1] = bShade;
+            ppmImage->image[row][col + (thirdWidth * 2)][2] = MAX_GRAY;
+
+        }
+        rShade += gradient;
+        gShade -= gradient;
+        bShade += gradient;
+    }
+
+    // Gray Gradients on Lower Half
+    for ( int row = halfHeight; row < height; row++ )
+    {
+        for ( int col = 0; col < halfWidth; col++ )
+        {
+
+            // black to white, top to bottom
+            ppmImage->image[row][col][0] = upShade;
+            ppmImage->image[row][col][1] = upShade;
+            ppmImage->image[row][col][2] = upShade;
+
+            // white to black, top to bottom
+            ppmImage->image[row][col + halfWidth][0] = downShade;
+            ppmImage->image[row][col + halfWidth][1] = downShade;
+            ppmImage->image[row][col + halfWidth][2] = downShade;
+
+        }
+        upShade += gradient;
+        downShade -= gradient;
+    }
+
+}
+
+/**
+ * @brief      { generate_ppm }
+ *
+ * @param      ppmImage      The ppm image
+ * @param[in]  width         The width
+ * @param[in]  height        The height
+ * @param      out_filename  The out filename
+ * @param[in]  format        The format
+ *
+ * @return     { void }
+ */
+
+void generate_ppm( struct PPM_Image *ppmImage, int width, int height, char *out_filename, int format )
+{
+
+    long long pixels = (long long) width * height;
+    struct PNM_Mapped_Image mappedImage;
+    int mapped = 0;
+    struct Cache_Key key = { 3, width, height, format, 0 };
+    struct Cache_Key redKey = { 3, width, height, format, 1 };
+    struct Cache_Key greenKey = { 3, width, height, format, 2 };
+    struct Cache_Key blueKey = { 3, width, height, format, 3 };
+
+    char pgm_red_filename[100];
+    strcpy(pgm_red_filename, "Red_PGM_Copy_From_");
+    strcat(pgm_red_filename, out_filename);
+
+    char pgm_green_filename[100];
+    strcpy(pgm_green_filename, "Green_PGM_Copy_From_");
+    strcat(pgm_green_filename, out_filename);
+
+    char pgm_blue_filename[100];
+    strcpy(pgm_blue_filename, "Blue_PGM_Copy_From_");
+    strcat(pgm_blue_filename, out_filename);
+
+    // A hit needs the channel copies too, stdout only takes the colour image
+    if ( is_stdout( out_filename ) ? fetch_output( &key, out_filename ) == 0 :
+         cache_fetch( &redKey, pgm_red_filename ) == 0 && cache_fetch( &greenKey, pgm_green_filename ) == 0 &&
+         cache_fetch( &blueKey, pgm_blue_filename ) == 0 && cache_fetch( &key, out_filename ) == 0 )
+    {
+        return;
+    }
+
+    // A raw file is drawn in place, and the channel copies are taken from it
+    if ( open_mapped_output( &mappedImage, out_filename, PPM, width, height, format ) == 0 )
+    {
+        mapped = map_PPM_Image( &mappedImage, ppmImage ) == 0;
+        if ( !mapped )
+        {
+            close_PNM_Mapped_Image( &mappedImage );
+        }
+    }
+
+    if ( !mapped )
+    {
+        PNM_PROFILE( "create_PPM_Image", pixels, create_PPM_Image( ppmImage, width, height, MAX_GRAY ) );
+    }
+
+    draw_ppm( ppmImage );
+
+    // Only the colour image itself goes to stdout, there is nowhere to put the channel copies
+    if ( is_stdout( out_filename ) )
+    {
+        save_ppm( ppmImage, out_filename, format );
+        PNM_PROFILE( "free_PPM_Image", pixels, free_PPM_Image( ppmImage ) );
+        return;
+    }
+
+    struct PGM_Image pgmImageRed, pgmImageGreen, pgmImageBlue;
+
+    // copy_PPM_to_PGM creates the channel images itself
+    PNM_PROFILE( "copy_PPM_to_PGM", pixels, copy_PPM_to_PGM( ppmImage, &pgmImageRed, 0) );
+    PNM_PROFILE( "copy_PPM_to_PGM", pixels, copy_PPM_to_PGM( ppmImage, &pgmImageGreen, 1) );
+    PNM_PROFILE( "copy_PPM_to_PGM", pixels, copy_PPM_to_PGM( ppmImage, &pgmImageBlue, 2) );
+
+    // Only the files that were written in full are kept in the cache
+    int redSaved = save_pgm( &pgmImageRed, pgm_red_filename, format ) == 0;
+    int greenSaved = save_pgm( &pgmImageGreen, pgm_green_filename, format ) == 0;
+    int blueSaved = save_pgm( &pgmImageBlue, pgm_blue_filename, format ) == 0;
+    int saved = mapped || save_ppm( ppmImage, out_filename, format ) == 0;
+
+    PNM_PROFILE( "free_PPM_Image", pixels, free_PPM_Image( ppmImage ) );
+    free_PGM_Image( &pgmImageRed );
+    free_PGM_Image( &pgmImageGreen );
+    free_PGM_Image( &pgmImageBlue );
+
+    if ( mapped && close_PNM_Mapped_Image( &mappedImage ) != 0 )
+    {
+        fprintf( stderr, "Error: cannot write %s\n", out_filename );
+        saved = 0;
+    }
+
+    if ( redSaved )
+    {
+        store_output( &redKey, pgm_red_filename );
+    }
+    if ( greenSaved )
+    {
+        store_output( &greenKey, pgm_green_filename );
+    }
+    if ( blueSaved )
+    {
+        store_output( &blueKey, pgm_blue_filename );
+    }
+    if ( saved )
+    {
+        store_output( &key, out_filename );
+    }
+
+}
+
+/**
+ * @brief      { one level of a pyramid }
+ *
+ *             rows holds the first sample of every row, of the image itself or of
+ *             the view of its mapped file when the level is raw.
+ */
+
+struct Pyramid_Level
+{
+    char filename[256];
+    int width, height;
+    struct PGM_Image pgmImage;
+    struct PPM_Image ppmImage;
+    struct PNM_Mapped_Image mappedImage;
+    int mapped;
+    unsigned char **rows;
+};
+
+/**
+ * @brief      { open_level } creates the image of a level, mapping its file when it is raw
+ *
+ * @return     { 0 on success, -1 if the image cannot be created }
+ */
+
+static int open_level( struct Pyramid_Level *level, int type, int format )
+{
+    level->rows = malloc( level->height * sizeof(unsigned char *) );
+    level->mapped = 0;
+
+    if ( level->rows == NULL )
+    {
+        return -1;
+    }
+
+    if ( open_mapped_output( &level->mappedImage, level->filename, type == 2 ? PGM : PPM,
+                             level->width, level->height, format ) == 0 )
+    {
+        level->mapped = ( type == 2 ? map_PGM_Image( &level->mappedImage, &level->pgmImage ) :
+                          map_PPM_Image( &level->mappedImage, &level->ppmImage ) ) == 0;
+        if ( !level->mapped )
+        {
+            close_PNM_Mapped_Image( &level->mappedImage );
+        }
+    }
+
+    if ( !level->mapped &&
+         ( type == 2 ? create_PGM_Image( &level->pgmImage, level->width, level->height, MAX_GRAY ) :
+           create_PPM_Image( &level->ppmImage, level->width, level->height, MAX_GRAY ) ) == -1 )
+    {
+        free( level->rows );
+        return -1;
+    }
+
+    for ( int row = 0; row < level->height; row++ )
+    {
+        level->rows[row] = type == 2 ? level->pgmImage.image[row] : level->ppmImage.image[row][0];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      { close_level } saves a level that is not mapped (if save is set) and frees it
+ */
+
+static void close_level( struct Pyramid_Level *level, int type, int format, int save )
+{
+    if ( type == 2 )
+    {
+        if ( save && !level->mapped )
+        {
+            save_pgm( &level->pgmImage, level->filename, format );
+        }
+        free_PGM_Image( &level->pgmImage );
+    }
+    else
+    {
+        if ( save && !level->mapped )
+        {
+            save_ppm( &level->ppmImage, level->filename, format );
+        }
+        free_PPM_Image( &level->ppmImage );
+    }
+
+    if ( level->mapped )
+    {
+        close_PNM_Mapped_Image( &level->mappedImage );
+    }
+    free( level->rows );
+}
+
+/**
+ * @brief      { cascade_row } passes a finished row of a level on to the levels below it
+ *
+ *             Every second row completes a row of the next level, which is passed
+ *             on in turn, so each level is finished (and its file written) as soon
+ *             as its last row is.
+ */
+
+static void cascade_row( struct Pyramid_Level *levels, int count, int level, int row, int type, int format )
+{
+    if ( level + 1 < count && row % 2 == 1 )
+    {
+        downscale_Row_2x( levels[level].rows[row - 1], levels[level].rows[row], levels[level + 1].rows[row / 2],
+                          levels[level + 1].width, type == 2 ? 1 : 3 );
+        cascade_row( levels, count, level + 1, row / 2, type, format );
+    }
+
+    if ( row == levels[level].height - 1 )
+    {
+        close_level( &levels[level], type, format, 1 );
+    }
+}
+
+/**
+ * @brief      { generate_pyramid }
+ *
+ *             Draws the test pattern once at width by height, then derives every
+ *             smaller level from it in a single pass down its rows, each level the
+ *             2x2 means of the one above it (see libpnm_resample.h), down to one
+ *             pixel across or down or until levels levels are made. Level k is
+ *             saved as out_prefix_W_H.pgm (or .ppm), W and H being its size.
+ *
+ * @param[in]  type        The type, 2 for pgm or 3 for ppm
+ * @param[in]  width       The width of the largest level
+ * @param[in]  height      The height of the largest level
+ * @param      out_prefix  The start of the level filenames
+ * @param[in]  format      The format
+ * @param[in]  levels      The most levels to make, 0 for all of them
+ *
+ * @return     { void }
+ */
+
+void generate_pyramid( int type, int width, int height, char *out_prefix, int format, int levels )
+{
+    struct Pyramid_Level pyramid[PYRAMID_MAX_LEVELS];
+    int count;
+
+    if ( type != 2 && type != 3 )
+    {
+        puts("Error: pyramids are made of pgm or ppm images, the type must be 2 or 3");
+        return;
+    }
+
+    if ( levels <= 0 || levels > PYRAMID_MAX_LEVELS )
+    {
+        levels = PYRAMID_MAX_LEVELS;
+    }
+
+    for ( count = 0; count < levels; count++ )
+    {
+        struct Pyramid_Level *level = &pyramid[count];
+
+        level->width = count == 0 ? width : pyramid[count - 1].width / 2;
+        level->height = count == 0 ? height : pyramid[count - 1].height / 2;
+        if ( level->width < 1 || level->height < 1 )
+        {
+            break;
+        }
+
+        snprintf( level->filename, sizeof(level->filename), "%s_%d_%d.%s", out_prefix,
+                  level->width, level->height, type == 2 ? "pgm" : "ppm" );
+
+        if ( open_level( level, type, format ) != 0 )
+        {
+            printf("Error: could not create %s\n", level->filename);
+            while ( count-- > 0 )
+            {
+                close_level( &pyramid[count], type, format, 0 );
+            }
+            return;
+        }
+    }
+
+    // The largest level is the only one drawn
+    if ( type == 2 )
+    {
+        draw_pgm( &pyramid[0].pgmImage );
+    }
+    else
+    {
+        draw_ppm( &pyramid[0].ppmImage );
+    }
+
+    for ( int row = 0; row < height; row++ )
+    {
+        cascade_row( pyramid, count, 0, row, type, format );
+    }
+
+}
@@ -0,0 +1,39 @@
+#include "libpnm.h"
+
+#ifndef _GENERATE_H_
+#define _GENERATE_H_
+
+#define MAX_GRAY 255
+
+// the format value that selects the run length container (0 is ASCII, 1 raw)
+#define RLE_FORMAT 2
+
+// bump whenever the drawn patterns change, so cached outputs are not reused
+#define GENERATOR_VERSION 1
+
+// the most levels of a pyramid, enough to halve any size down to one pixel
+#define PYRAMID_MAX_LEVELS 32
+
+// the most validation rules the arguments can fail at once
+#define ARG_ERRORS 4
+
+// validates the command line arguments, returns 1 on failure (and prints why)
+int check_args(int type, int width, int height, char *out_filename, int format);
+
+// validates the arguments without printing, returns why they are not valid or NULL
+const char *args_error( int type, int width, int height, int format );
+
+// draw the test patterns into already created images
+void draw_pbm( struct PBM_Image *pbmImage );
+void draw_pgm( struct PGM_Image *pgmImage );
+void draw_ppm( struct PPM_Image *ppmImage );
+
+// create, draw, save and free the test images
+void generate_pbm( struct PBM_Image *pbmImage, int width, int height, char *out_filename, int format );
+void generate_pgm( struct PGM_Image *pgmImage, int width, int height, char *out_filename, int format );
+void generate_ppm( struct PPM_Image *ppmImage, int width, int height, char *out_filename, int format );
+
+// draw the test pattern once and save it with every halving of it, in one pass
+void generate_pyramid( int type, int width, int height, char *out_prefix, int format, int levels );
+
+#endif /*_GENERATE_H_*/
@@ -1,4 +1,114 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <poll.h>
 #include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_histogram.h"
+#include "libpnm_rle.h"
+#include "libpnm_thread.h"
+
+// the alignment of pixel blocks (a page)
+# define PIXEL_ALIGNMENT 4096
+
+// the number of iovecs handed to the kernel at a time
+# define IOV_BATCH 64
+
+// the rows of an ASCII body formatted by one task, and the tasks formatted
+// (and held in memory) before they are written
+# define ASCII_BLOCK_ROWS 32
+# define ASCII_ROUND_BLOCKS 64
+
+// the most characters a sample takes in an ASCII body ("255 ")
+# define ASCII_SAMPLE_CHARS 4
+
+// the least an ASCII body is cut into when it is decoded in parallel
+# define ASCII_CHUNK_BYTES (1 << 20)
+
+/*--------------------------------------------------------------*/
+/* WAITS UNTIL A NON-BLOCKING fd TAKES MORE DATA AFTER A WRITE  */
+/* FAILED (returns 0 to try again, -1 if the failure stands)    */
+/*--------------------------------------------------------------*/
+static int wait_Writable(int fd)
+{ struct pollfd waiting;
+
+  if(errno == EINTR) return 0;
+  if(errno != EAGAIN && errno != EWOULDBLOCK) return - 1;
+
+  waiting.fd = fd;
+  waiting.events = POLLOUT;
+  while(poll(&waiting, 1, - 1) < 0)
+    if(errno != EINTR) return - 1;
+
+  return 0;
+}
+
+/*--------------------------------------------------------------*/
+/* WRITES A WHOLE BUFFER TO A FILE DESCRIPTOR                   */
+/*--------------------------------------------------------------*/
+static int write_Fully(int fd, const void * buffer, size_t length)
+{ // the bytes written by one call
+  ssize_t written;
+
+  while(length > 0)
+  { written = write(fd, buffer, length);
+    if(written < 0 && wait_Writable(fd) == 0) continue;
+    if(written <= 0) return -1;
+    buffer = (const char *)buffer + written;
+    length -= written;
+  }
+
+  return 0;
+}
+
+/*--------------------------------------------------------------*/
+/* GIVES A REGULAR FILE ABOUT TO BE WRITTEN AN INODE OF ITS OWN */
+/* AN OUTPUT MAY SHARE ITS INODE WITH OTHER NAMES (A HARD LINK, */
+/* SAY INTO A CACHE OF OUTPUTS), SO IT IS NEVER WRITTEN         */
+/* THROUGH: FOR WRITE A LINKED FILE IS UNLINKED SO A NEW ONE IS */
+/* CREATED, FOR UPDATE IT IS COPIED AND THE COPY RENAMED OVER   */
+/* IT (returns -1 on failure; a file with one name, or anything */
+/* that is not a regular file, is left alone)                   */
+/*--------------------------------------------------------------*/
+static int own_Inode(enum FileAction fileAction, char * fileName)
+{ // the file, and its copy
+  struct stat info; char copyName[PATH_MAX];
+  int in, out; ssize_t length; char buffer[1 << 16];
+
+  if(lstat(fileName, &info) != 0 || !S_ISREG(info.st_mode) ||
+     info.st_nlink < 2) return 0;
+
+  // a file about to be truncated only needs a name of its own
+  if(fileAction == WRITE) return (unlink(fileName) == 0) ? 0 : - 1;
+
+  if(snprintf(copyName, sizeof(copyName), "%s.XXXXXX", fileName) >=
+     (int)sizeof(copyName)) return - 1;
+  in = open(fileName, O_RDONLY);
+  out = (in < 0) ? - 1 : mkstemp(copyName);
+  if(out < 0)
+  { if(in >= 0) close(in);
+    return - 1;
+  }
+
+  while((length = read(in, buffer, sizeof(buffer))) > 0)
+    if(write_Fully(out, buffer, (size_t)length) != 0) break;
+  close(in);
+
+  // the copy keeps the permissions of the file it replaces
+  if(length != 0 || fchmod(out, info.st_mode & 07777) != 0 ||
+     close(out) != 0 || rename(copyName, fileName) != 0)
+  { unlink(copyName);
+    return - 1;
+  }
+
+  return 0;
+}
 
 /*--------------*/
 /* OPENS A FILE */
@@ -6,14 +116,511 @@
 
 FILE * fileOpener(enum FileAction fileAction, char * fileName)
 { 
-  FILE * filePointer;
+  FILE * filePointer = NULL;
+
+  // a file written or updated never writes through to another name
+  if(fileAction != READ && own_Inode(fileAction, fileName) != 0) return NULL;
     
   if(fileAction == READ) filePointer = fopen(fileName, "rb");
   if(fileAction == WRITE) filePointer = fopen(fileName, "wb");
+  if(fileAction == UPDATE) filePointer = fopen(fileName, "r+b");
 
   return filePointer; 
 }
 
+/*---------------------------------------------------------*/
+/* ALLOCATES A ZEROED, PAGE ALIGNED PIXEL BLOCK (plus one  */
+/* byte of slack so an empty image still gets a block)     */
+/*---------------------------------------------------------*/
+static unsigned char * alloc_Pixels(size_t length)
+{ void * pixels;
+
+  if(posix_memalign(&pixels, PIXEL_ALIGNMENT, length + 1) != 0) return NULL;
+  memset(pixels, 0, length + 1);
+
+  return (unsigned char *)pixels;
+}
+
+/*--------------------------------------------------------------*/
+/* WRITES height ROWS OF rowLength BYTES TO A FILE DESCRIPTOR   */
+/* WITH writev CALLS STRAIGHT FROM THE ROWS, MERGING ROWS THAT  */
+/* FOLLOW EACH OTHER IN MEMORY                                  */
+/*--------------------------------------------------------------*/
+static int write_Rows_fd(int fd, unsigned char * * rows, int height,
+                         size_t rowLength)
+{ // a batch of rows, rows that follow each other in memory are merged
+  struct iovec iov[IOV_BATCH]; int count, next, current;
+
+  // the bytes moved by one call
+  ssize_t moved; size_t step;
+
+  if(rowLength == 0) return 0;
+
+  for(next = 0; next < height; )
+  { // gather the next batch
+    count = 0;
+    while(next < height)
+    { if(count > 0 && (unsigned char *)iov[count - 1].iov_base + 
+                      iov[count - 1].iov_len == rows[next])
+        iov[count - 1].iov_len += rowLength;
+      else if(count < IOV_BATCH)
+      { iov[count].iov_base = rows[next];
+        iov[count].iov_len = rowLength;
+        count++;
+      }
+      else break;
+      next++;
+    }
+
+    // send it, continuing after partial transfers
+    current = 0;
+    while(current < count)
+    { moved = writev(fd, iov + current, count - current);
+      if(moved < 0 && wait_Writable(fd) == 0) continue;
+      if(moved <= 0) return -1;
+
+      // skip past what was sent
+      while(moved > 0)
+      { step = (size_t)moved < iov[current].iov_len ? 
+               (size_t)moved : iov[current].iov_len;
+        iov[current].iov_base = (unsigned char *)iov[current].iov_base + step;
+        iov[current].iov_len -= step;
+        moved -= step;
+        if(iov[current].iov_len == 0) current++;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*--------------------------------------------------------------*/
+/* OPENS A stdio STREAM ON A DUPLICATE OF fd, SO THAT fclose    */
+/* LEAVES fd ITSELF OPEN                                        */
+/*--------------------------------------------------------------*/
+static FILE * open_fd_Stream(int fd)
+{ // the duplicate
+  int copy = dup(fd);
+  FILE * stream;
+
+  if(copy < 0) return NULL;
+
+  stream = fdopen(copy, "wb");
+  if(stream == NULL) close(copy);
+
+  return stream;
+}
+
+/*--------------------------------------------------------------*/
+/* A ROUND OF ASCII BLOCKS BEING FORMATTED                      */
+/*--------------------------------------------------------------*/
+struct ASCII_Job
+{ // the rows, and the samples in each
+  unsigned char * * rows; int height; size_t rowSamples;
+
+  // the first block of the round, its text and the length of each
+  int firstBlock; char * * blocks; size_t * lengths;
+
+  // set by any block that fails
+  int failed;
+};
+
+/*--------------------------------------------------------------*/
+/* FORMATS A ROW OF SAMPLES AS "%d " EACH, RETURNS THE LENGTH   */
+/*--------------------------------------------------------------*/
+static size_t format_ASCII_Row(const unsigned char * samples, size_t count,
+                               char * text)
+{ // the start of the text, and a for loop variable
+  char * start = text; size_t sample;
+  unsigned int value;
+
+  for(sample = 0; sample < count; sample++)
+  { value = samples[sample];
+    if(value >= 100)
+    { *text++ = '0' + value / 100;
+      *text++ = '0' + value / 10 % 10;
+    }
+    else if(value >= 10) *text++ = '0' + value / 10;
+    *text++ = '0' + value % 10;
+    *text++ = ' ';
+  }
+
+  return text - start;
+}
+
+/*--------------------------------------------------------------*/
+/* FORMATS ONE BLOCK OF ROWS INTO ITS OWN BUFFER                */
+/*--------------------------------------------------------------*/
+static void format_ASCII_Block(void * context, int index)
+{ struct ASCII_Job * job = (struct ASCII_Job *)context;
+
+  // the rows of the block
+  int row = (job->firstBlock + index) * ASCII_BLOCK_ROWS;
+  int last = (row + ASCII_BLOCK_ROWS < job->height) ? 
+             row + ASCII_BLOCK_ROWS : job->height;
+
+  // the text of the block
+  size_t length = 0;
+  char * text = (char *)malloc(job->rowSamples * ASCII_SAMPLE_CHARS * 
+                               (last - row) + 1);
+
+  if(text == NULL)
+  { job->failed = 1;
+    return;
+  }
+
+  for(; row < last; row++)
+    length += format_ASCII_Row(job->rows[row], job->rowSamples, 
+                               text + length);
+
+  job->blocks[index] = text;
+  job->lengths[index] = length;
+}
+
+/*--------------------------------------------------------------*/
+/* WRITES THE ASCII BODY OF height ROWS OF rowSamples SAMPLES.  */
+/* ROUNDS OF BLOCKS OF ROWS ARE FORMATTED ON PARALLEL THREADS,  */
+/* EACH INTO ITS OWN BUFFER, THEN WRITTEN IN ORDER WITH writev  */
+/* (OR fwrite WHEN THE STREAM HAS NO FILE DESCRIPTOR).          */
+/*--------------------------------------------------------------*/
+static int write_ASCII_Rows(FILE * imageFilePointer, unsigned char * * rows,
+                            int height, size_t rowSamples)
+{ struct ASCII_Job job;
+  char * blocks[ASCII_ROUND_BLOCKS]; size_t lengths[ASCII_ROUND_BLOCKS];
+
+  // the blocks of the image, and of this round
+  int totalBlocks = (height + ASCII_BLOCK_ROWS - 1) / ASCII_BLOCK_ROWS;
+  int count, block;
+
+  // the output, and what is still to be written of it
+  int fd = fileno(imageFilePointer), status = 0;
+  struct iovec iov[ASCII_ROUND_BLOCKS]; int current; ssize_t moved;
+
+  job.rows = rows;
+  job.height = height;
+  job.rowSamples = rowSamples;
+  job.blocks = blocks;
+  job.lengths = lengths;
+  job.failed = 0;
+
+  // an empty body would be an empty (failing) writev
+  if(rowSamples == 0) return 0;
+
+  // the header may still be buffered
+  if(fd >= 0 && fflush(imageFilePointer) != 0) return - 1;
+
+  for(job.firstBlock = 0; job.firstBlock < totalBlocks && status == 0;
+      job.firstBlock += count)
+  { count = totalBlocks - job.firstBlock;
+    if(count > ASCII_ROUND_BLOCKS) count = ASCII_ROUND_BLOCKS;
+
+    memset(blocks, 0, sizeof(blocks));
+    run_Parallel(count, format_ASCII_Block, &job);
+    if(job.failed) status = - 1;
+
+    // write the blocks in order
+    for(block = 0; block < count && status == 0; block++)
+    { iov[block].iov_base = blocks[block];
+      iov[block].iov_len = lengths[block];
+      if(fd < 0 && fwrite(blocks[block], 1, lengths[block], imageFilePointer)
+                   != lengths[block]) status = - 1;
+    }
+
+    for(current = 0; fd >= 0 && status == 0 && current < count; )
+    { moved = writev(fd, iov + current, count - current);
+      if(moved < 0 && wait_Writable(fd) == 0) continue;
+      if(moved <= 0)
+      { status = - 1;
+        break;
+      }
+
+      // skip past what was written
+      while(current < count && (size_t)moved >= iov[current].iov_len)
+        moved -= iov[current++].iov_len;
+      if(current < count)
+      { iov[current].iov_base = (char *)iov[current].iov_base + moved;
+        iov[current].iov_len -= moved;
+      }
+    }
+
+    for(block = 0; block < count; block++) free(blocks[block]);
+  }
+
+  return status;
+}
+
+/*--------------------------------------------------------------*/
+/* WRITES THE RAW BODY OF height ROWS OF rowLength BYTES WITH   */
+/* write_Rows_fd (OR AN fwrite A ROW WHEN THE STREAM HAS NO     */
+/* FILE DESCRIPTOR)                                             */
+/*--------------------------------------------------------------*/
+static int write_Raw_Rows(FILE * imageFilePointer, unsigned char * * rows,
+                          int height, size_t rowLength)
+{ // the output, and the for loop variable
+  int fd = fileno(imageFilePointer), row;
+
+  // the header may still be buffered
+  if(fd >= 0)
+    return (fflush(imageFilePointer) == 0) ?
+           write_Rows_fd(fd, rows, height, rowLength) : - 1;
+
+  for(row = 0; row < height; row++)
+    if(fwrite(rows[row], 1, rowLength, imageFilePointer) != rowLength)
+      return - 1;
+
+  return 0;
+}
+
+/*--------------------------------------------------------------*/
+/* AN ASCII BODY BEING DECODED IN PARALLEL                      */
+/*--------------------------------------------------------------*/
+struct ASCII_Decode
+{ // the body, and where each chunk of it starts (chunks + 1 of them)
+  const char * body; size_t * starts; int chunks;
+
+  // the samples found in each chunk, then the first sample of each
+  size_t * counts;
+
+  // the rows and the samples in each, and whether a sample is one char
+  unsigned char * * rows; size_t rowSamples, total; bool bits;
+
+  // the histogram each chunk counts its samples into, or NULL
+  struct PNM_Histogram * histograms;
+
+  // set by a chunk holding anything but samples and white space
+  int irregular;
+};
+
+/*--------------------------------------------------------------*/
+/* TRUE FOR THE WHITE SPACE BETWEEN SAMPLES (P1 bodies, as read */
+/* by the serial loaders, do not treat '\r' as white space)     */
+/*--------------------------------------------------------------*/
+# define IS_ASCII_SPACE(c, bits) \
+  ((c) == ' ' || (c) == '\n' || (c) == '\t' || ((c) == '\r' && !(bits)))
+
+/*--------------------------------------------------------------*/
+/* COUNTS THE SAMPLES OF ONE CHUNK                              */
+/*--------------------------------------------------------------*/
+static void count_ASCII_Chunk(void * context, int index)
+{ struct ASCII_Decode * job = (struct ASCII_Decode *)context;
+
+  // the chunk, and the samples in it
+  const char * c = job->body + job->starts[index];
+  const char * end = job->body + job->starts[index + 1];
+  size_t count = 0; bool bits = job->bits;
+
+  while(c < end)
+  { if(IS_ASCII_SPACE(*c, bits)) c++;
+
+    // every other char of a P1 body is a sample
+    else if(bits)
+    { count++;
+      c++;
+    }
+
+    // a run of digits is a sample, anything else (a comment) is left
+    // to the serial loader
+    else if(*c >= '0' && *c <= '9')
+    { count++;
+      while(++c < end && *c >= '0' && *c <= '9');
+    }
+    else
+    { job->irregular = 1;
+      break;
+    }
+  }
+
+  job->counts[index] = count;
+}
+
+/*--------------------------------------------------------------*/
+/* DECODES THE SAMPLES OF ONE CHUNK INTO THE ROWS               */
+/*--------------------------------------------------------------*/
+static void decode_ASCII_Chunk(void * context, int index)
+{ struct ASCII_Decode * job = (struct ASCII_Decode *)context;
+
+  // the chunk, and the index of its first sample
+  const char * c = job->body + job->starts[index];
+  const char * end = job->body + job->starts[index + 1];
+  size_t sample = job->counts[index]; bool bits = job->bits;
+
+  // the row that sample falls in, where it goes and the room left
+  size_t row = sample / job->rowSamples;
+  unsigned char * pixel = job->rows[row] + sample % job->rowSamples;
+  size_t left = job->rowSamples - sample % job->rowSamples;
+
+  // the samples still to decode, and the value of one
+  size_t wanted = job->total - sample; unsigned int value;
+
+  // the samples decoded into the row so far, and the channel of the first
+  unsigned char * run = pixel;
+  int channel = (job->histograms != NULL) ? 
+                (sample % job->rowSamples) % job->histograms->channels : 0;
+
+  while(c < end && wanted > 0)
+  { if(IS_ASCII_SPACE(*c, bits))
+    { c++;
+      continue;
+    }
+
+    if(bits) value = *c++ - '0';
+    else
+      for(value = 0; c < end && *c >= '0' && *c <= '9'; c++)
+        value = value * 10 + (*c - '0');
+
+    *pixel++ = (unsigned char)value;
+    wanted--;
+    if(--left == 0 && wanted > 0)
+    { // count the row while it is still in the cache
+      if(job->histograms != NULL)
+        count_PNM_Histogram_Samples(&job->histograms[index], run, 
+                                    pixel - run, channel);
+      pixel = run = job->rows[++row];
+      left = job->rowSamples;
+      channel = 0;
+    }
+  }
+
+  if(job->histograms != NULL)
+    count_PNM_Histogram_Samples(&job->histograms[index], run, pixel - run, 
+                                channel);
+}
+
+/*--------------------------------------------------------------*/
+/* DECODES THE ASCII BODY OF height ROWS OF rowSamples SAMPLES  */
+/* FROM THE CURRENT POSITION OF A FILE. THE BODY IS MAPPED AND  */
+/* CUT AT WHITE SPACE INTO CHUNKS, THE SAMPLES OF THE CHUNKS    */
+/* ARE COUNTED IN PARALLEL, A PREFIX SUM GIVES THE FIRST SAMPLE */
+/* OF EACH, THEN THE CHUNKS ARE DECODED IN PARALLEL.            */
+/*                                                              */
+/* RETURNS -1, HAVING READ NOTHING, WHEN THE SERIAL LOADER MUST */
+/* BE USED INSTEAD: THE FILE CANNOT BE MAPPED (A PIPE), OR THE  */
+/* BODY HOLDS COMMENTS OR TOO FEW SAMPLES.                      */
+/*                                                              */
+/* WITH A histogram, EACH CHUNK COUNTS ITS SAMPLES AS IT        */
+/* DECODES THEM AND THE CHUNKS ARE MERGED INTO IT IN ORDER.     */
+/*--------------------------------------------------------------*/
+static int read_ASCII_Rows(FILE * imageFilePointer, unsigned char * * rows,
+                           int height, size_t rowSamples, bool bits,
+                           struct PNM_Histogram * histogram)
+{ struct ASCII_Decode job;
+  struct stat info;
+
+  // the mapped file, and where the body starts in it
+  char * map; long offset = ftell(imageFilePointer);
+  size_t length, sample, count; int chunk, used, status = - 1;
+
+  if(height <= 0 || rowSamples == 0 || offset < 0) return - 1;
+  if(fstat(fileno(imageFilePointer), &info) != 0 || !S_ISREG(info.st_mode) ||
+     info.st_size <= offset) return - 1;
+
+  map = (char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, 
+                     fileno(imageFilePointer), 0);
+  if(map == MAP_FAILED) return - 1;
+  madvise(map, info.st_size, MADV_WILLNEED);
+
+  job.body = map + offset;
+  length = info.st_size - offset;
+  job.chunks = length / ASCII_CHUNK_BYTES + 1;
+  job.rows = rows;
+  job.rowSamples = rowSamples;
+  job.total = rowSamples * height;
+  job.bits = bits;
+  job.irregular = 0;
+  job.starts = (size_t *)malloc((job.chunks + 1) * sizeof(size_t));
+  job.counts = (size_t *)malloc(job.chunks * sizeof(size_t));
+  job.histograms = NULL;
+  if(histogram != NULL)
+  { job.histograms = (struct PNM_Histogram *)
+                     malloc(job.chunks * sizeof(struct PNM_Histogram));
+    for(chunk = 0; job.histograms != NULL && chunk < job.chunks; chunk++)
+      clear_PNM_Histogram(&job.histograms[chunk], histogram->channels);
+  }
+
+  if(job.starts != NULL && job.counts != NULL && 
+     (histogram == NULL || job.histograms != NULL))
+  { // cut the body evenly, moving each cut on to white space so no
+    // sample is split (any char is a whole P1 sample)
+    job.starts[0] = 0;
+    job.starts[job.chunks] = length;
+    for(chunk = 1; chunk < job.chunks; chunk++)
+    { job.starts[chunk] = length / job.chunks * chunk;
+      if(job.starts[chunk] < job.starts[chunk - 1])
+        job.starts[chunk] = job.starts[chunk - 1];
+      while(!bits && job.starts[chunk] < length && 
+            !IS_ASCII_SPACE(job.body[job.starts[chunk]], false))
+        job.starts[chunk]++;
+    }
+
+    run_Parallel(job.chunks, count_ASCII_Chunk, &job);
+
+    // the first sample of each chunk, and the chunks that hold any of the
+    // image (what follows its last sample is left alone)
+    for(chunk = 0, sample = 0; chunk < job.chunks; chunk++)
+    { count = job.counts[chunk];
+      job.counts[chunk] = sample;
+      sample += count;
+    }
+    for(used = 0; used < job.chunks && job.counts[used] < job.total; used++);
+
+    if(!job.irregular && sample >= job.total)
+    { run_Parallel(used, decode_ASCII_Chunk, &job);
+      for(chunk = 0; histogram != NULL && chunk < job.chunks; chunk++)
+        merge_PNM_Histograms(histogram, &job.histograms[chunk]);
+      status = 0;
+    }
+  }
+
+  free(job.starts);
+  free(job.counts);
+  free(job.histograms);
+  munmap(map, info.st_size);
+
+  return status;
+}
+
+/*--------------------------------------------------------------*/
+/* THE ROWS OF AN IMAGE BEING COPIED INTO A MAPPED FILE         */
+/*--------------------------------------------------------------*/
+struct Mapped_Copy
+{ // the rows, their width, and whether they are packed on the way
+  unsigned char * * rows; int width; size_t rowBytes; bool pack;
+};
+
+/*--------------------------------------------------------------*/
+/* COPIES ONE ROW INTO THE MAPPED FILE                          */
+/*--------------------------------------------------------------*/
+static void copy_Mapped_Row(void * context, unsigned char * row, int index)
+{ struct Mapped_Copy * copy = (struct Mapped_Copy *)context;
+
+  if(copy->pack) pack_PBM_Row(copy->rows[index], row, copy->width);
+  else memcpy(row, copy->rows[index], copy->rowBytes);
+}
+
+/*--------------------------------------------------------------*/
+/* SAVES A RAW IMAGE BY COPYING ITS ROWS (PACKING UNPACKED PBM  */
+/* ROWS) INTO A MAPPED FILE ON PARALLEL THREADS. RETURNS -1     */
+/* WHEN THE FILE CANNOT BE MAPPED, SO IT IS WRITTEN THROUGH A   */
+/* STREAM INSTEAD.                                              */
+/*--------------------------------------------------------------*/
+static int save_Mapped_Rows(char * fileName, enum Format format, 
+                            int width, int height, int maxGrayValue,
+                            unsigned char * * rows, bool pack)
+{ struct PNM_Mapped_Image mappedImage;
+  struct Mapped_Copy copy;
+
+  if(create_PNM_Mapped_Image(&mappedImage, fileName, format, width, height,
+                             maxGrayValue) != 0) return - 1;
+
+  copy.rows = rows;
+  copy.width = width;
+  copy.rowBytes = mappedImage.rowBytes;
+  copy.pack = pack;
+  fill_PNM_Mapped_Image(&mappedImage, copy_Mapped_Row, &copy);
+
+  return close_PNM_Mapped_Image(&mappedImage);
+}
+
 /*-------------------------------------------------------------*/
 /* GETS AN INTEGER FROM FILE SKIPPING WHITE SPACE AND COMMENTS */
 /*-------------------------------------------------------------*/
@@ -82,7 +689,7 @@ int load_PBM_Image(struct PBM_Image * pbmImage, char * fileName)
   /*----------------------*/
 
   // to read from file
-  char c; bool raw = true; int bitCount;
+  char c; bool raw = true; int width, height;
 
   // forl oop variables
   int row, col;
@@ -107,41 +714,25 @@ int load_PBM_Image(struct PBM_Image * pbmImage, char * fileName)
   if(c == '4') raw = true; else raw = false;
 
   // get the width and height of the image
-  pbmImage->width = geti(imageFilePointer); 
-  pbmImage->height = geti(imageFilePointer);
-  if(pbmImage->width < 0 || pbmImage->height < 0)
-  { fclose(imageFilePointer);
-    return - 1;
-  }
+  width = geti(imageFilePointer); 
+  height = geti(imageFilePointer);
 
-  // allocate memory for a COLUMN
-  pbmImage->image = (unsigned char * *) 
-                    calloc(pbmImage->height, sizeof(char *));
-  if(pbmImage->image == (unsigned char * *)0)
+  // allocate the image
+  if(create_PBM_Image(pbmImage, width, height) == -1)
   { fclose(imageFilePointer);
     return - 1;
   }
 
-  // allocate memory for the ROWS
-  for(row = 0; row < pbmImage->height; row++) 
-  { pbmImage->image[row] = (unsigned char *) 
-                         calloc(pbmImage->width, sizeof(char));
-    if(pbmImage->image[row] == (unsigned char *)0)
-    { fclose(imageFilePointer);
-      return - 1;
-    }
-  }
-
   /*-------------------*/
   /* READ IN THE IMAGE */
   /*-------------------*/
 
-  bitCount = 0;
-
   /*--------------*/
   /* ASCII FORMAT */
   /*--------------*/
-  if(!raw)
+  if(!raw && read_ASCII_Rows(imageFilePointer, pbmImage->image, 
+                             pbmImage->height, (size_t)pbmImage->width, 
+                             true, NULL) != 0)
     for(row = 0; row < pbmImage->height; row++)
       for(col = 0; col < pbmImage->width; col++) 
       { c = fgetc(imageFilePointer);
@@ -153,17 +744,29 @@ int load_PBM_Image(struct PBM_Image * pbmImage, char * fileName)
   /* RAW FORMAT */
   /*------------*/
   if(raw)
+  { // every row starts on a byte boundary, so read a packed row at a time
+    unsigned char * packed = (unsigned char *)
+                             calloc(PBM_ROW_BYTES(pbmImage->width) + 1, 1);
+    if(packed == (unsigned char *)0)
+    { fclose(imageFilePointer);
+      return - 1;
+    }
+
     for(row = 0; row < pbmImage->height; row++)
-      for(col = 0; col < pbmImage->width; col++)
-      { // every 8 bits, read in another character
-        if(bitCount == 0)
-        { c = fgetc(imageFilePointer);
-          bitCount = 8;
-        }
+    { if(fread(packed, 1, PBM_ROW_BYTES(pbmImage->width), imageFilePointer)
+         != (size_t)PBM_ROW_BYTES(pbmImage->width)) break;
+      unpack_PBM_Row(packed, pbmImage->image[row], pbmImage->width);
+    }
 
-        // get a bit from c
-        pbmImage->image[row][col] = (c >> --bitCount) & 1;
-      }
+    free(packed);
+
+    // a truncated body
+    if(row < pbmImage->height)
+    { free_PBM_Image(pbmImage);
+      fclose(imageFilePointer);
+      return - 1;
+    }
+  }
 
   // success
 
@@ -177,7 +780,7 @@ int load_PBM_Image(struct PBM_Image * pbmImage, char * fileName)
 /*-------------------------------------------------*/
 int create_PBM_Image(struct PBM_Image * pbmImage, int width, int height)
 { // for loop variable
-  int row;
+  int row; unsigned char * pixels;
 
   // initialize the width and height of the image
   pbmImage->width = width; pbmImage->height = height;
@@ -185,16 +788,20 @@ int create_PBM_Image(struct PBM_Image * pbmImage, int width, int height)
 
   // allocate memory for a COLUMN
   pbmImage->image = (unsigned char * *)
-                    calloc(pbmImage->height, sizeof(char *));
+                    calloc(pbmImage->height + 1, sizeof(char *));
   if(pbmImage->image == (unsigned char * *)0) return -1;
 
-  // allocate memory for the ROWS
-  for(row = 0; row < pbmImage->height; row++) 
-  { pbmImage->image[row] = (unsigned char *)
-                         calloc(pbmImage->width, sizeof(char));
-    if(pbmImage->image[row] == (unsigned char *)0) return -1;
+  // allocate memory for the ROWS as one contiguous, page aligned block
+  pixels = alloc_Pixels((size_t)pbmImage->width * pbmImage->height);
+  if(pixels == (unsigned char *)0)
+  { free(pbmImage->image);
+    return -1;
   }
 
+  for(row = 0; row < pbmImage->height; row++) 
+    pbmImage->image[row] = pixels + (size_t)row * pbmImage->width;
+  pbmImage->image[pbmImage->height] = pixels;
+
   // success
   return 0; 
 }
@@ -203,32 +810,24 @@ int create_PBM_Image(struct PBM_Image * pbmImage, int width, int height)
 /* FREES MEMORY CONSUMED BY A PBM IMAGE */
 /*--------------------------------------*/
 void free_PBM_Image(struct PBM_Image * pbmImage)
-{ // free the ROWS
-  int row;
-  for(row = 0; row < pbmImage->height; row++) 
-    free(pbmImage->image[row]);
+{ // free the ROWS, the block start is kept after the last row
+  free(pbmImage->image[pbmImage->height]);
  
   // free the COLUMN
   free(pbmImage->image);
 }
 
-/*-----------------------------*/
-/* SAVES THE PBM IMAGE TO FILE */
-/*-----------------------------*/
-int save_PBM_Image(struct PBM_Image * pbmImage, char * fileName, bool raw)
+/*--------------------------------------*/
+/* WRITES THE PBM IMAGE TO AN OPEN FILE */
+/*--------------------------------------*/
+int write_PBM_Image(struct PBM_Image * pbmImage,
+                    FILE * imageFilePointer, bool raw)
 { /*----------------------*/
   /* VARIABLE DECLARATION */
   /*----------------------*/
 
   // for loop variables
-  int row, col;
-
-  // for writing raw bits to file
-  unsigned char c; int bitCount;
-
-  // the file to save to
-  FILE * imageFilePointer = fileOpener(WRITE, fileName);
-  if(imageFilePointer == NULL) return - 1;
+  int row;
 
   // write the header
   if(!raw) 
@@ -244,50 +843,118 @@ int save_PBM_Image(struct PBM_Image * pbmImage, char * fileName, bool raw)
   /* ASCII FORMAT */
   /*--------------*/
   if(!raw)
-    for(row = 0; row < pbmImage->height; row++)
-      for(col = 0; col < pbmImage->width; col++)
-        fprintf(imageFilePointer, "%d ", pbmImage->image[row][col]);
+    return write_ASCII_Rows(imageFilePointer, pbmImage->image, 
+                            pbmImage->height, (size_t)pbmImage->width);
 
   /*------------*/
   /* RAW FORMAT */
   /*------------*/
   if(raw)
+  { // pack a row at a time, the last byte of each row is zero padded
+    unsigned char * packed = (unsigned char *)
+                             calloc(PBM_ROW_BYTES(pbmImage->width) + 1, 1);
+    if(packed == (unsigned char *)0) return - 1;
+
     for(row = 0; row < pbmImage->height; row++)
-    { // reset the char
-      c = 0; bitCount = 0;
+    { pack_PBM_Row(pbmImage->image[row], packed, pbmImage->width);
+      fwrite(packed, 1, PBM_ROW_BYTES(pbmImage->width), imageFilePointer);
+    }
 
-      for(col = 0; col < pbmImage->width; col++)
-      { if(pbmImage->image[row][col] == 1) c += (1 << (7 - bitCount));
-        if(++bitCount == 8) 
-        { fputc(c, imageFilePointer); 
-          c = 0; bitCount = 0; 
-        } 
-      }
+    free(packed);
+  }
 
-      // send the last few bits
-      if(bitCount != 0 && raw) fputc(c, imageFilePointer); 
-     }
+  return 0; 
+}
 
-  fclose(imageFilePointer);
+/*-----------------------------*/
+/* SAVES THE PBM IMAGE TO FILE */
+/*-----------------------------*/
+int save_PBM_Image(struct PBM_Image * pbmImage,
+                   char * fileName, bool raw)
+{ // the result of the write
+  int status;
 
-  return 0; 
+  // the file to save to
+  FILE * imageFilePointer;
+
+  // raw rows are packed straight into the mapped file
+  if(raw && save_Mapped_Rows(fileName, PBM, pbmImage->width, 
+                             pbmImage->height, 0, pbmImage->image, 
+                             true) == 0) return 0;
+
+  imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PBM_Image(pbmImage, imageFilePointer, raw);
+
+  if(fclose(imageFilePointer) != 0) return - 1;
+
+  return status;
 }
 
-/*------------------------------------------------------*/
-/* THE PGM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
-/*------------------------------------------------------*/
-int load_PGM_Image(struct PGM_Image * pgmImage, char * fileName)
+/*------------------------------------------*/
+/* SAVES THE PBM IMAGE TO A FILE DESCRIPTOR */
+/*------------------------------------------*/
+int save_PBM_Image_fd(struct PBM_Image * pbmImage,
+                      int fd, bool raw)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // the stream for the ascii format
+  FILE * stream;
+
+  // the image packed into raw rows
+  struct PBM_Packed_Image packed; int row, status;
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw)
+  { stream = open_fd_Stream(fd);
+    if(stream == NULL) return - 1;
+
+    if(write_PBM_Image(pbmImage, stream, raw) != 0)
+    { fclose(stream);
+      return - 1;
+    }
+
+    return fclose(stream) == 0 ? 0 : - 1;
+  }
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  if(create_PBM_Packed_Image(&packed, pbmImage->width, pbmImage->height) == -1)
+    return - 1;
+
+  for(row = 0; row < pbmImage->height; row++)
+    pack_PBM_Row(pbmImage->image[row], packed.image[row], pbmImage->width);
+
+  status = save_PBM_Packed_Image_fd(&packed, fd, raw);
+  free_PBM_Packed_Image(&packed);
+
+  return status;
+}
+
+/*-------------------------------------------------------------*/
+/* THE PACKED PBM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
+/*-------------------------------------------------------------*/
+int load_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage, char * fileName)
 { /*----------------------*/
   /* VARIABLE DECLARATION */
   /*----------------------*/
 
   // to read from file
-  char c; bool raw;
+  char c; bool raw; int width, height;
 
   // for loop variables
   int row, col;
 
-  // open the file forreading
+  // a row of unpacked pixels for the ascii format
+  unsigned char * pixels;
+
+  // open the file for reading
   FILE * imageFilePointer = fileOpener(READ, fileName);
   if(imageFilePointer == NULL) return -1;
 
@@ -297,46 +964,25 @@ int load_PGM_Image(struct PGM_Image * pgmImage, char * fileName)
     return - 1;
   }
 
-  // make sure the second char is either a 2 or 5
+  // make sure the second char is either a 1 or 4
   c = fgetc(imageFilePointer);
-  if(c != '2' && c != '5')
+  if(c != '1' && c != '4')
   { fclose(imageFilePointer);
     return - 1;
   }
 
-  if(c == '5') raw = true; else raw = false;
-
-  // get the width, height and max gray value of the image
-  pgmImage->width = geti(imageFilePointer); 
-  pgmImage->height = geti(imageFilePointer);
-  pgmImage->maxGrayValue = geti(imageFilePointer);
-  
-  if(pgmImage->width < 0 || pgmImage->height < 0 || 
-      pgmImage->maxGrayValue < 0)
-  { fclose(imageFilePointer);
-    return - 1;
-  }
+  if(c == '4') raw = true; else raw = false;
 
-  if(pgmImage->maxGrayValue > 255) pgmImage->maxGrayValue = 255;
+  // get the width and height of the image
+  width = geti(imageFilePointer); 
+  height = geti(imageFilePointer);
 
-  // allocate memory for a COLUMN
-  pgmImage->image = (unsigned char * *) 
-                    calloc(pgmImage->height, sizeof(char *));
-  if(pgmImage->image == (unsigned char * *)0)
+  // allocate the image
+  if(create_PBM_Packed_Image(pbmImage, width, height) == -1)
   { fclose(imageFilePointer);
     return - 1;
   }
 
-  // allocate memory for the ROWS
-  for(row = 0; row < pgmImage->height; row++)
-  { pgmImage->image[row] = (unsigned char *) 
-                         calloc(pgmImage->width, sizeof(char));
-    if(pgmImage->image[row] == (unsigned char *)0)
-    { fclose(imageFilePointer);
-      return - 1;
-    }
-  }
-
   /*-------------------*/
   /* READ IN THE IMAGE */
   /*-------------------*/
@@ -345,17 +991,41 @@ int load_PGM_Image(struct PGM_Image * pgmImage, char * fileName)
   /* ASCII FORMAT */
   /*--------------*/
   if(!raw)
-    for(row = 0; row < pgmImage->height; row++)
-      for(col = 0; col < pgmImage->width; col++)
-        pgmImage->image[row][col] = geti(imageFilePointer);
+  { pixels = (unsigned char *) calloc((size_t)width * height + 1, sizeof(char));
+    if(pixels == (unsigned char *)0)
+    { free_PBM_Packed_Image(pbmImage);
+      fclose(imageFilePointer);
+      return - 1;
+    }
+
+    // the whole body can be decoded in parallel, one row at a time can not
+    if(read_ASCII_Rows(imageFilePointer, &pixels, 1, (size_t)width * height, 
+                       true, NULL) == 0)
+      for(row = 0; row < height; row++)
+        pack_PBM_Row(pixels + (size_t)row * width, pbmImage->image[row], width);
+    else
+      for(row = 0; row < height; row++)
+      { for(col = 0; col < width; col++) 
+        { c = fgetc(imageFilePointer);
+          while ((c == '\n') || (c == ' ') || (c == '\t')) c = fgetc(imageFilePointer);
+          pixels[col] = c  - '0'; 
+        }
+        pack_PBM_Row(pixels, pbmImage->image[row], width);
+      }
+
+    free(pixels);
+  }
 
   /*------------*/
   /* RAW FORMAT */
   /*------------*/
-  if(raw)
-    for(row = 0; row < pgmImage->height; row++)
-      for(col = 0; col < pgmImage->width; col++)
-        pgmImage->image[row][col] = getc(imageFilePointer);
+  if(raw && fread(pbmImage->image[0], 1, (size_t)pbmImage->rowBytes * height,
+                  imageFilePointer) != (size_t)pbmImage->rowBytes * height)
+  { // a truncated body
+    free_PBM_Packed_Image(pbmImage);
+    fclose(imageFilePointer);
+    return - 1;
+  }
 
   // success
   fclose(imageFilePointer);
@@ -363,37 +1033,300 @@ int load_PGM_Image(struct PGM_Image * pgmImage, char * fileName)
   return 0; 
 }
 
-/*-------------------------------------------------*/
-/* THE PGM 'CONSTRUCTOR' WHICH CREATES A NEW IMAGE */
-/*-------------------------------------------------*/
-int create_PGM_Image(struct PGM_Image * pgmImage, 
-                     int width, int height, int maxGrayValue)
-{ // for loop variables
-  int row;
+/*--------------------------------------------------------*/
+/* THE PACKED PBM 'CONSTRUCTOR' WHICH CREATES A NEW IMAGE */
+/*--------------------------------------------------------*/
+int create_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage,
+                            int width, int height)
+{ // for loop variable
+  int row; unsigned char * pixels;
 
-  // initialize the width, height and max gray value of the image
-  pgmImage->width = width; 
-  pgmImage->height = height;
-  pgmImage->maxGrayValue = maxGrayValue;
-  
-  if(pgmImage->width<0 || pgmImage->height<0 || pgmImage->maxGrayValue<0) 
-    return - 1;
+  // initialize the width and height of the image
+  pbmImage->width = width; pbmImage->height = height;
+  if(pbmImage->width < 0 || pbmImage->height < 0) return - 1;
+  pbmImage->rowBytes = PBM_ROW_BYTES(width);
+
+  // allocate memory for a COLUMN
+  pbmImage->image = (unsigned char * *)
+                    calloc(pbmImage->height + 1, sizeof(char *));
+  if(pbmImage->image == (unsigned char * *)0) return -1;
+
+  // allocate memory for the packed ROWS as one contiguous, page aligned block
+  pixels = alloc_Pixels((size_t)pbmImage->rowBytes * pbmImage->height);
+  if(pixels == (unsigned char *)0)
+  { free(pbmImage->image);
+    return -1;
+  }
+
+  for(row = 0; row < pbmImage->height; row++) 
+    pbmImage->image[row] = pixels + (size_t)row * pbmImage->rowBytes;
+  pbmImage->image[pbmImage->height] = pixels;
+
+  // success
+  return 0; 
+}
+
+/*---------------------------------------------*/
+/* FREES MEMORY CONSUMED BY A PACKED PBM IMAGE */
+/*---------------------------------------------*/
+void free_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage)
+{ // free the ROWS, the block start is kept after the last row
+  free(pbmImage->image[pbmImage->height]);
+ 
+  // free the COLUMN
+  free(pbmImage->image);
+}
+
+/*---------------------------------------------*/
+/* WRITES THE PACKED PBM IMAGE TO AN OPEN FILE */
+/*---------------------------------------------*/
+int write_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage,
+                           FILE * imageFilePointer, bool raw)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // for loop variables
+  int row, col;
+
+  // write the header
+  if(!raw) 
+    fprintf(imageFilePointer, "P1\n%d %d\n", pbmImage->width, pbmImage->height);
+  else 
+    fprintf(imageFilePointer, "P4\n%d %d\n", pbmImage->width, pbmImage->height);
+
+  /*-----------------*/
+  /* WRITE THE IMAGE */
+  /*-----------------*/
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw)
+    for(row = 0; row < pbmImage->height; row++)
+      for(col = 0; col < pbmImage->width; col++)
+        fprintf(imageFilePointer, "%d ", 
+                (pbmImage->image[row][col >> 3] >> (7 - (col & 7))) & 1);
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  if(raw)
+    // a row at a time, as the rows of a view (or of a mapped image) are not
+    // one block of their own
+    for(row = 0; row < pbmImage->height; row++)
+      if(fwrite(pbmImage->image[row], 1, (size_t)pbmImage->rowBytes,
+                imageFilePointer) != (size_t)pbmImage->rowBytes) return - 1;
+
+  return 0; 
+}
+
+/*------------------------------------*/
+/* SAVES THE PACKED PBM IMAGE TO FILE */
+/*------------------------------------*/
+int save_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage,
+                          char * fileName, bool raw)
+{ // the result of the write
+  int status;
+
+  // the file to save to
+  FILE * imageFilePointer;
+
+  // raw rows are copied straight into the mapped file
+  if(raw && save_Mapped_Rows(fileName, PBM, pbmImage->width, 
+                             pbmImage->height, 0, pbmImage->image, 
+                             false) == 0) return 0;
+
+  imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PBM_Packed_Image(pbmImage, imageFilePointer, raw);
+
+  if(fclose(imageFilePointer) != 0) return - 1;
+
+  return status;
+}
+
+/*-------------------------------------------------*/
+/* SAVES THE PACKED PBM IMAGE TO A FILE DESCRIPTOR */
+/*-------------------------------------------------*/
+int save_PBM_Packed_Image_fd(struct PBM_Packed_Image * pbmImage,
+                             int fd, bool raw)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // the header of a raw image
+  char header[64]; int length;
+
+  // the stream for the ascii format
+  FILE * stream;
+
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw)
+  { stream = open_fd_Stream(fd);
+    if(stream == NULL) return - 1;
+
+    if(write_PBM_Packed_Image(pbmImage, stream, raw) != 0)
+    { fclose(stream);
+      return - 1;
+    }
+
+    return fclose(stream) == 0 ? 0 : - 1;
+  }
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  length = snprintf(header, sizeof(header), "P4\n%d %d\n",
+                    pbmImage->width, pbmImage->height);
+  if(write_Fully(fd, header, length) != 0) return - 1;
+
+  return write_Rows_fd(fd, pbmImage->image, pbmImage->height,
+                       (size_t)pbmImage->rowBytes);
+}
+
+/*------------------------------------------------------*/
+/* LOADS A PGM IMAGE FROM FILE, COUNTING EACH ROW INTO  */
+/* THE HISTOGRAM AS IT IS DECODED WHEN THERE IS ONE     */
+/*------------------------------------------------------*/
+static int load_PGM(struct PGM_Image * pgmImage, char * fileName,
+                    struct PNM_Histogram * histogram)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // to read from file
+  char c; bool raw; int width, height, maxGrayValue;
+
+  // for loop variables
+  int row, col;
+
+  // open the file forreading
+  FILE * imageFilePointer = fileOpener(READ, fileName);
+  if(imageFilePointer == NULL) return -1;
+
+  // make sure the first char is P
+  if(fgetc(imageFilePointer) != 'P')
+  { fclose(imageFilePointer);
+    return - 1;
+  }
+
+  // make sure the second char is either a 2 or 5
+  c = fgetc(imageFilePointer);
+  if(c != '2' && c != '5')
+  { fclose(imageFilePointer);
+    return - 1;
+  }
+
+  if(c == '5') raw = true; else raw = false;
+
+  // get the width, height and max gray value of the image
+  width = geti(imageFilePointer); 
+  height = geti(imageFilePointer);
+  maxGrayValue = geti(imageFilePointer);
+
+  // allocate the image
+  if(create_PGM_Image(pgmImage, width, height, maxGrayValue) == -1)
+  { fclose(imageFilePointer);
+    return - 1;
+  }
+
+  /*-------------------*/
+  /* READ IN THE IMAGE */
+  /*-------------------*/
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw && read_ASCII_Rows(imageFilePointer, pgmImage->image, 
+                             pgmImage->height, (size_t)pgmImage->width, 
+                             false, histogram) != 0)
+    for(row = 0; row < pgmImage->height; row++)
+    { for(col = 0; col < pgmImage->width; col++)
+        pgmImage->image[row][col] = geti(imageFilePointer);
+      if(histogram != NULL)
+        count_PNM_Histogram_Samples(histogram, pgmImage->image[row], 
+                                    (size_t)pgmImage->width, 0);
+    }
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  if(raw)
+    for(row = 0; row < pgmImage->height; row++)
+    { for(col = 0; col < pgmImage->width; col++)
+        pgmImage->image[row][col] = getc(imageFilePointer);
+      if(histogram != NULL)
+        count_PNM_Histogram_Samples(histogram, pgmImage->image[row], 
+                                    (size_t)pgmImage->width, 0);
+    }
+
+  // success
+  fclose(imageFilePointer);
+
+  return 0; 
+}
+
+/*------------------------------------------------------*/
+/* THE PGM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
+/*------------------------------------------------------*/
+int load_PGM_Image(struct PGM_Image * pgmImage, char * fileName)
+{ return load_PGM(pgmImage, fileName, NULL);
+}
+
+/*------------------------------------------------------*/
+/* THE PGM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
+/* AND COMPUTES ITS HISTOGRAM ON THE WAY                */
+/*------------------------------------------------------*/
+int load_PGM_Image_With_Histogram(struct PGM_Image * pgmImage, 
+                                  char * fileName, 
+                                  struct PNM_Histogram * histogram)
+{ clear_PNM_Histogram(histogram, 1);
+  if(load_PGM(pgmImage, fileName, histogram) != 0) return - 1;
+  finish_PNM_Histogram(histogram);
+
+  return 0;
+}
+
+/*-------------------------------------------------*/
+/* THE PGM 'CONSTRUCTOR' WHICH CREATES A NEW IMAGE */
+/*-------------------------------------------------*/
+int create_PGM_Image(struct PGM_Image * pgmImage, 
+                     int width, int height, int maxGrayValue)
+{ // for loop variables
+  int row; unsigned char * pixels;
+
+  // initialize the width, height and max gray value of the image
+  pgmImage->width = width; 
+  pgmImage->height = height;
+  pgmImage->maxGrayValue = maxGrayValue;
+  
+  if(pgmImage->width<0 || pgmImage->height<0 || pgmImage->maxGrayValue<0) 
+    return - 1;
 
   if(pgmImage->maxGrayValue > 255) 
     pgmImage->maxGrayValue = 255;
 
   // allocate memory for a COLUMN
   pgmImage->image = (unsigned char * *)
-                    calloc(pgmImage->height, sizeof(char *));
+                    calloc(pgmImage->height + 1, sizeof(char *));
 
   if(pgmImage->image == (unsigned char * *)0) return -1;
 
-  // allocate memory for the ROWS
+  // allocate memory for the ROWS as one contiguous, page aligned block
+  pixels = alloc_Pixels((size_t)pgmImage->width * pgmImage->height);
+  if(pixels == (unsigned char *)0)
+  { free(pgmImage->image);
+    return -1;
+  }
+
   for(row = 0; row < pgmImage->height; row++)
-  { pgmImage->image[row] = (unsigned char *)
-                         calloc(pgmImage->width, sizeof(char));
-    if(pgmImage->image[row] == (unsigned char *)0) return -1;
-  } 
+    pgmImage->image[row] = pixels + (size_t)row * pgmImage->width;
+  pgmImage->image[pgmImage->height] = pixels;
 
   // success
   return 0;
@@ -403,31 +1336,51 @@ int create_PGM_Image(struct PGM_Image * pgmImage,
 /* FREES MEMORY CONSUMED BY A PGM IMAGE */
 /*--------------------------------------*/
 void free_PGM_Image(struct PGM_Image * pgmImage)
-{ // free the ROWS
-  int row;
-  for(row = 0; row < pgmImage->height; row++)
-    free(pgmImage->image[row]);
+{ // free the ROWS, the block start is kept after the last row
+  free(pgmImage->image[pgmImage->height]);
 
   // free the COLUMN
   free(pgmImage->image); 
 }
 
-/*-----------------------------*/
-/* SAVES THE PGM IMAGE TO FILE */
-/*-----------------------------*/
-int save_PGM_Image(struct PGM_Image * pgmImage, char * fileName, bool raw)
-{ /*----------------------*/
-  /* VARIABLE DECLARATION */
-  /*----------------------*/
+/*-----------------------------------------------------------*/
+/* THE PGM 'CONSTRUCTOR' WHICH CREATES A VIEW OF A REGION OF  */
+/* ANOTHER IMAGE, SHARING ITS PIXELS                          */
+/*-----------------------------------------------------------*/
+int create_PGM_View(struct PGM_Image * pgmImage, struct PGM_Image * view,
+                    int left, int top, int width, int height)
+{ // for loop variables
+  int row;
 
-  // for loop variables
-  int row, col;
+  // the region must lie inside the image
+  if(left < 0 || top < 0 || width < 0 || height < 0 ||
+     left + width > pgmImage->width || top + height > pgmImage->height)
+    return - 1;
 
-  // the file to save to
-  FILE * imageFilePointer = fileOpener(WRITE, fileName);
-  if(imageFilePointer == NULL) return - 1;
+  view->width = width;
+  view->height = height;
+  view->maxGrayValue = pgmImage->maxGrayValue;
 
-  // write the header
+  // allocate memory for a COLUMN, the ROWS are the parent's
+  view->image = (unsigned char * *)calloc(height + 1, sizeof(char *));
+  if(view->image == (unsigned char * *)0) return -1;
+
+  for(row = 0; row < height; row++)
+    view->image[row] = pgmImage->image[top + row] + left;
+
+  // no block of its own to free
+  view->image[height] = (unsigned char *)0;
+
+  // success
+  return 0;
+}
+
+/*--------------------------------------*/
+/* WRITES THE PGM IMAGE TO AN OPEN FILE */
+/*--------------------------------------*/
+int write_PGM_Image(struct PGM_Image * pgmImage,
+                    FILE * imageFilePointer, bool raw)
+{ // write the header
   if(!raw) 
     fprintf(imageFilePointer, "P2\n%d %d\n%d\n",
             pgmImage->width, pgmImage->height, pgmImage->maxGrayValue);
@@ -443,236 +1396,1020 @@ int save_PGM_Image(struct PGM_Image * pgmImage, char * fileName, bool raw)
   /* ASCII FORMAT */
   /*--------------*/
   if(!raw)
-    for(row = 0; row < pgmImage->height; row++)
-      for(col = 0; col < pgmImage->width; col++)
-        fprintf(imageFilePointer, "%d ", pgmImage->image[row][col]);
+    return write_ASCII_Rows(imageFilePointer, pgmImage->image, 
+                            pgmImage->height, (size_t)pgmImage->width);
 
   /*------------*/
   /* RAW FORMAT */
   /*------------*/
-  if(raw)
-    for(row = 0; row < pgmImage->height; row++)
-      for(col = 0; col < pgmImage->width; col++)
-        fputc(pgmImage->image[row][col], imageFilePointer);
+  return write_Raw_Rows(imageFilePointer, pgmImage->image,
+                        pgmImage->height, (size_t)pgmImage->width);
+}
 
-  fclose(imageFilePointer);
+/*-----------------------------*/
+/* SAVES THE PGM IMAGE TO FILE */
+/*-----------------------------*/
+int save_PGM_Image(struct PGM_Image * pgmImage,
+                   char * fileName, bool raw)
+{ // the result of the write
+  int status;
+
+  // the file to save to
+  FILE * imageFilePointer;
+
+  // raw rows are copied straight into the mapped file
+  if(raw && save_Mapped_Rows(fileName, PGM, pgmImage->width, 
+                             pgmImage->height, pgmImage->maxGrayValue, 
+                             pgmImage->image, false) == 0) return 0;
+
+  imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PGM_Image(pgmImage, imageFilePointer, raw);
+
+  if(fclose(imageFilePointer) != 0) return - 1;
+
+  return status;
+}
+
+/*------------------------------------------*/
+/* SAVES THE PGM IMAGE TO A FILE DESCRIPTOR */
+/*------------------------------------------*/
+int save_PGM_Image_fd(struct PGM_Image * pgmImage,
+                      int fd, bool raw)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // the header of a raw image
+  char header[64]; int length;
+
+  // the stream for the ascii format
+  FILE * stream;
+
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw)
+  { stream = open_fd_Stream(fd);
+    if(stream == NULL) return - 1;
+
+    if(write_PGM_Image(pgmImage, stream, raw) != 0)
+    { fclose(stream);
+      return - 1;
+    }
+
+    return fclose(stream) == 0 ? 0 : - 1;
+  }
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  length = snprintf(header, sizeof(header), "P5\n%d %d\n%d\n",
+                    pgmImage->width, pgmImage->height, pgmImage->maxGrayValue);
+  if(write_Fully(fd, header, length) != 0) return - 1;
+
+  return write_Rows_fd(fd, pgmImage->image, pgmImage->height,
+                       (size_t)pgmImage->width);
+}
+
+/*------------------------------------------------------*/
+/* LOADS A PPM IMAGE FROM FILE, COUNTING EACH ROW INTO  */
+/* THE HISTOGRAM AS IT IS DECODED WHEN THERE IS ONE     */
+/*------------------------------------------------------*/
+static int load_PPM(struct PPM_Image * ppmImage, char * fileName,
+                    struct PNM_Histogram * histogram)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // to read from file
+  char c; bool raw; int width, height, maxGrayValue;
+
+  // for loop variables
+  int row, col; enum Color color;
+
+  // the rows of the ascii body
+  unsigned char * * rows;
+
+  // open the file forreading
+  FILE * imageFilePointer = fileOpener(READ, fileName);
+  if(imageFilePointer == NULL)
+  { return - 1;
+  }
+
+  // make sure the first char is P
+  if(fgetc(imageFilePointer) != 'P')
+  { fclose(imageFilePointer);
+    return - 1;
+  }
+
+  // make sure the second char is either a 3 or 6
+  c = fgetc(imageFilePointer);
+  if(c != '3' && c != '6')
+  { fclose(imageFilePointer);
+    return - 1;
+  }
+
+  if(c == '6') raw = true; else raw = false;
+
+  // get the width, height and max gray value of the image
+  width = geti(imageFilePointer); 
+  height = geti(imageFilePointer);
+  maxGrayValue = geti(imageFilePointer);
+
+  // allocate the image
+  if(create_PPM_Image(ppmImage, width, height, maxGrayValue) == -1)
+  { fclose(imageFilePointer);
+    return - 1;
+  }
+
+  /*-------------------*/
+  /* READ IN THE IMAGE */
+  /*-------------------*/
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw)
+  { // the RGB triples of each row follow each other
+    rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+    if(rows == (unsigned char * *)0)
+    { free_PPM_Image(ppmImage);
+      fclose(imageFilePointer);
+      return - 1;
+    }
+
+    for(row = 0; row < ppmImage->height; row++)
+      rows[row] = ppmImage->image[row][0];
+
+    if(read_ASCII_Rows(imageFilePointer, rows, ppmImage->height, 
+                       (size_t)ppmImage->width * 3, false, histogram) != 0)
+      for(row = 0; row < ppmImage->height; row++)
+      { for(col = 0; col < ppmImage->width; col++)
+          for(color = RED; color <= BLUE; color++)
+            ppmImage->image[row][col][color] = geti(imageFilePointer);
+        if(histogram != NULL)
+          count_PNM_Histogram_Samples(histogram, rows[row], 
+                                      (size_t)ppmImage->width * 3, RED);
+      }
+
+    free(rows);
+  }
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  if(raw)
+    for(row = 0; row < ppmImage->height; row++)
+    { for(col = 0; col < ppmImage->width; col++)
+        for(color = RED; color <= BLUE; color++)
+          ppmImage->image[row][col][color] = getc(imageFilePointer);
+      if(histogram != NULL && ppmImage->width > 0)
+        count_PNM_Histogram_Samples(histogram, ppmImage->image[row][0], 
+                                    (size_t)ppmImage->width * 3, RED);
+    }
+
+  // success
+  fclose(imageFilePointer);
+
+  return 0; 
+}
+
+/*------------------------------------------------------*/
+/* THE PPM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
+/*------------------------------------------------------*/
+int load_PPM_Image(struct PPM_Image * ppmImage, char * fileName)
+{ return load_PPM(ppmImage, fileName, NULL);
+}
+
+/*------------------------------------------------------*/
+/* THE PPM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
+/* AND COMPUTES ITS HISTOGRAM ON THE WAY                */
+/*------------------------------------------------------*/
+int load_PPM_Image_With_Histogram(struct PPM_Image * ppmImage, 
+                                  char * fileName, 
+                                  struct PNM_Histogram * histogram)
+{ clear_PNM_Histogram(histogram, 3);
+  if(load_PPM(ppmImage, fileName, histogram) != 0) return - 1;
+  finish_PNM_Histogram(histogram);
+
+  return 0;
+}
+
+/*-------------------------------------------------*/
+/* THE PPM 'CONSTRUCTOR' WHICH CREATES A NEW IMAGE */
+/*-------------------------------------------------*/
+int create_PPM_Image(struct PPM_Image * ppmImage,
+                     int width, int height, int maxGrayValue)
+{ // for loop variables
+  int row, col;
+
+  // the pixel storage
+  unsigned char * * pixelPointers; unsigned char * pixels;
+  size_t pixelCount = (size_t)(width < 0 ? 0 : width) * 
+                      (size_t)(height < 0 ? 0 : height);
+
+  // get the width, height and max gray value of the image
+  ppmImage->width = width; 
+  ppmImage->height = height; 
+  ppmImage->maxGrayValue = maxGrayValue;
+  
+  if(ppmImage->width < 0 || ppmImage->height < 0 || ppmImage->maxGrayValue < 0)
+    return - 1;
+
+  if(ppmImage->maxGrayValue > 255) ppmImage->maxGrayValue = 255;
+
+  // allocate memory for a COLUMN
+  ppmImage->image = (unsigned char * * *)
+                    calloc(ppmImage->height + 1, sizeof(char * *));
+  if(ppmImage->image == (unsigned char * * *)0) return -1;
+
+  // allocate memory for the ROWS as one contiguous block of pixel pointers,
+  // the start of the pixel block is kept after the last pixel pointer
+  pixelPointers = (unsigned char * *)
+                  calloc(pixelCount + 1, sizeof(char *));
+  if(pixelPointers == (unsigned char * *)0)
+  { free(ppmImage->image);
+    return -1;
+  }
+
+  // allocate memory for the pixels as one contiguous, page aligned block of 
+  // RGB triples
+  pixels = alloc_Pixels(3 * pixelCount);
+  if(pixels == (unsigned char *)0)
+  { free(pixelPointers);
+    free(ppmImage->image);
+    return -1;
+  }
+
+  for(row = 0; row < ppmImage->height; row++)
+  { ppmImage->image[row] = pixelPointers + (size_t)row * ppmImage->width;
+    for(col = 0; col < ppmImage->width; col++)
+      ppmImage->image[row][col] = 
+        pixels + 3 * ((size_t)row * ppmImage->width + col);
+  }
+  pixelPointers[pixelCount] = pixels;
+  ppmImage->image[ppmImage->height] = pixelPointers;
+  
+  // success
+  return 0; 
+}
+
+/*--------------------------------------*/
+/* FREES MEMORY CONSUMED BY A PPM IMAGE */
+/*--------------------------------------*/
+void free_PPM_Image(struct PPM_Image * ppmImage)
+{ // the pixel pointers are kept after the last row
+  unsigned char * * pixelPointers = ppmImage->image[ppmImage->height];
+
+  // free the pixels and the ROWS
+  if(pixelPointers != (unsigned char * *)0)
+  { free(pixelPointers[(size_t)ppmImage->width * ppmImage->height]);
+    free(pixelPointers);
+  }
+
+  // free the COLUMN
+  free(ppmImage->image);
+}
+
+/*-----------------------------------------------------------*/
+/* THE PPM 'CONSTRUCTOR' WHICH CREATES A VIEW OF A REGION OF  */
+/* ANOTHER IMAGE, SHARING ITS PIXELS                          */
+/*-----------------------------------------------------------*/
+int create_PPM_View(struct PPM_Image * ppmImage, struct PPM_Image * view,
+                    int left, int top, int width, int height)
+{ // for loop variables
+  int row;
+
+  // the region must lie inside the image
+  if(left < 0 || top < 0 || width < 0 || height < 0 ||
+     left + width > ppmImage->width || top + height > ppmImage->height)
+    return - 1;
+
+  view->width = width;
+  view->height = height;
+  view->maxGrayValue = ppmImage->maxGrayValue;
+
+  // allocate memory for a COLUMN, the ROWS point into the parent's pixel
+  // pointers, which already lead to its pixels
+  view->image = (unsigned char * * *)calloc(height + 1, sizeof(char * *));
+  if(view->image == (unsigned char * * *)0) return -1;
+
+  for(row = 0; row < height; row++)
+    view->image[row] = ppmImage->image[top + row] + left;
+
+  // no pixel pointers or pixels of its own to free
+  view->image[height] = (unsigned char * *)0;
+
+  // success
+  return 0;
+}
+
+/*--------------------------------------*/
+/* WRITES THE PPM IMAGE TO AN OPEN FILE */
+/*--------------------------------------*/
+int write_PPM_Image(struct PPM_Image * ppmImage,
+                    FILE * imageFilePointer, bool raw)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // for loop variable
+  int row;
+
+  // the rows of the body, and the result
+  unsigned char * * rows; int status;
+
+  // write the header
+  if(!raw)
+    fprintf(imageFilePointer, "P3\n%d %d\n%d\n",
+            ppmImage->width, ppmImage->height, ppmImage->maxGrayValue);
+  else
+    fprintf(imageFilePointer, "P6\n%d %d\n%d\n",
+            ppmImage->width, ppmImage->height, ppmImage->maxGrayValue);
+
+  /*-----------------*/
+  /* WRITE THE IMAGE */
+  /*-----------------*/
+
+  // the RGB triples of each row follow each other
+  rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+  if(rows == (unsigned char * *)0) return - 1;
+
+  for(row = 0; row < ppmImage->height; row++)
+    rows[row] = ppmImage->image[row][0];
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw)
+    status = write_ASCII_Rows(imageFilePointer, rows, ppmImage->height, 
+                              (size_t)ppmImage->width * 3);
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  else
+    status = write_Raw_Rows(imageFilePointer, rows, ppmImage->height,
+                            (size_t)ppmImage->width * 3);
+
+  free(rows);
+
+  return status;
+}
+
+/*-----------------------------*/
+/* SAVES THE PPM IMAGE TO FILE */
+/*-----------------------------*/
+int save_PPM_Image(struct PPM_Image * ppmImage,
+                   char * fileName, bool raw)
+{ // the result of the write
+  int status;
+
+  // the file to save to
+  FILE * imageFilePointer;
+
+  // the first sample of every row
+  unsigned char * * rows; int row;
+
+  // raw rows are copied straight into the mapped file
+  if(raw)
+  { rows = (unsigned char * *) calloc(ppmImage->height + 1, sizeof(char *));
+    if(rows == (unsigned char * *)0) return - 1;
+
+    for(row = 0; row < ppmImage->height; row++)
+      rows[row] = ppmImage->image[row][0];
+
+    status = save_Mapped_Rows(fileName, PPM, ppmImage->width, 
+                              ppmImage->height, ppmImage->maxGrayValue, 
+                              rows, false);
+    free(rows);
+    if(status == 0) return 0;
+  }
+
+  imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PPM_Image(ppmImage, imageFilePointer, raw);
+
+  if(fclose(imageFilePointer) != 0) return - 1;
+
+  return status;
+}
+
+/*------------------------------------------*/
+/* SAVES THE PPM IMAGE TO A FILE DESCRIPTOR */
+/*------------------------------------------*/
+int save_PPM_Image_fd(struct PPM_Image * ppmImage,
+                      int fd, bool raw)
+{ /*----------------------*/
+  /* VARIABLE DECLARATION */
+  /*----------------------*/
+
+  // the header of a raw image
+  char header[64]; int length;
+
+  // the stream for the ascii format
+  FILE * stream;
+
+  // the first sample of every row
+  unsigned char * * rows; int row, status;
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  if(!raw)
+  { stream = open_fd_Stream(fd);
+    if(stream == NULL) return - 1;
+
+    if(write_PPM_Image(ppmImage, stream, raw) != 0)
+    { fclose(stream);
+      return - 1;
+    }
+
+    return fclose(stream) == 0 ? 0 : - 1;
+  }
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  length = snprintf(header, sizeof(header), "P6\n%d %d\n%d\n",
+                    ppmImage->width, ppmImage->height, ppmImage->maxGrayValue);
+  if(write_Fully(fd, header, length) != 0) return - 1;
+
+  rows = (unsigned char * *) calloc(ppmImage->height + 1, sizeof(char *));
+  if(rows == (unsigned char * *)0) return - 1;
+
+  for(row = 0; row < ppmImage->height; row++)
+    rows[row] = ppmImage->image[row][0];
+
+  status = write_Rows_fd(fd, rows, ppmImage->height, 
+                         (size_t)ppmImage->width * 3);
+  free(rows);
+
+  return status;
+}
+
+/*-------------------------------------------------------------*/
+/* OPENS A RUN LENGTH CONTAINER LAZILY, READING ITS HEADER AND */
+/* ROW INDEX (the file has been opened by open_PNM_Lazy_Image) */
+/*-------------------------------------------------------------*/
+static int open_RLE_Lazy_Image(struct PNM_Lazy_Image * lazyImage)
+{ struct RLE_Header header;
+
+  if(fseek(lazyImage->imageFilePointer, 0, SEEK_SET) != 0 ||
+     read_RLE_Header(lazyImage->imageFilePointer, &header) != 0 ||
+     header.format == PBM)
+  { close_PNM_Lazy_Image(lazyImage);
+    return - 1;
+  }
+
+  lazyImage->width = header.width;
+  lazyImage->height = header.height;
+  lazyImage->maxGrayValue = header.maxGrayValue;
+  lazyImage->format = header.format;
+  lazyImage->channels = (header.format == PGM) ? 1 : 3;
+  lazyImage->rle = true;
+
+  lazyImage->rows = (unsigned char * *)
+                    calloc(lazyImage->height + 1, sizeof(char *));
+  lazyImage->rowIndex = (long *)calloc(lazyImage->height + 1, sizeof(long));
+  if(lazyImage->rows == NULL || lazyImage->rowIndex == NULL ||
+     read_RLE_Offsets(lazyImage->imageFilePointer, lazyImage->rowIndex,
+                      lazyImage->height) != 0)
+  { close_PNM_Lazy_Image(lazyImage);
+    return - 1;
+  }
+
+  // success
+  return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* CREATES A RAW IMAGE FILE OF THE FORMAT AND SIZE GIVEN AND   */
+/* MAPS IT FOR WRITING                                         */
+/*-------------------------------------------------------------*/
+int create_PNM_Mapped_Image(struct PNM_Mapped_Image * mappedImage,
+                            char * fileName, enum Format format,
+                            int width, int height, int maxGrayValue)
+{ // the header, and the file being mapped
+  char header[64]; int headerLength; struct stat info;
+
+  // for loop variable
+  int row;
+
+  if(width < 0 || height < 0 || format < PBM || format > PPM) return - 1;
+  if(maxGrayValue > 255) maxGrayValue = 255;
+
+  mappedImage->width = width;
+  mappedImage->height = height;
+  mappedImage->maxGrayValue = maxGrayValue;
+  mappedImage->format = format;
+  mappedImage->rowBytes = (format == PBM) ? (size_t)PBM_ROW_BYTES(width) :
+                          (size_t)width * (format == PPM ? 3 : 1);
+
+  // the same headers as the stream writers
+  if(format == PBM) 
+    headerLength = snprintf(header, sizeof(header), "P4\n%d %d\n", 
+                            width, height);
+  else
+    headerLength = snprintf(header, sizeof(header), "P%d\n%d %d\n%d\n", 
+                            format + 3, width, height, maxGrayValue);
+  mappedImage->length = headerLength + mappedImage->rowBytes * height;
+
+  // only a regular file can be sized and mapped, anything else (a pipe,
+  // a device) is not even opened
+  if(stat(fileName, &info) == 0 && !S_ISREG(info.st_mode)) return - 1;
+
+  // a linked file is replaced, never written through
+  if(own_Inode(WRITE, fileName) != 0) return - 1;
+  mappedImage->fd = open(fileName, O_RDWR | O_CREAT, 0666);
+  if(mappedImage->fd < 0) return - 1;
+
+  if(fstat(mappedImage->fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+     ftruncate(mappedImage->fd, 0) != 0 || 
+     ftruncate(mappedImage->fd, mappedImage->length) != 0)
+  { close(mappedImage->fd);
+    return - 1;
+  }
+
+  // reserve the blocks now, so that a full disk fails here rather than
+  // as a fault while the pixels are written
+  if(fallocate(mappedImage->fd, 0, 0, mappedImage->length) != 0 && 
+     errno != EOPNOTSUPP)
+  { close(mappedImage->fd);
+    return - 1;
+  }
+
+  mappedImage->map = (unsigned char *)mmap(NULL, mappedImage->length, 
+                                           PROT_READ | PROT_WRITE, 
+                                           MAP_SHARED, mappedImage->fd, 0);
+  if(mappedImage->map == (unsigned char *)MAP_FAILED)
+  { close(mappedImage->fd);
+    return - 1;
+  }
+
+  mappedImage->rows = (unsigned char * *)calloc(height + 1, sizeof(char *));
+  if(mappedImage->rows == (unsigned char * *)0)
+  { munmap(mappedImage->map, mappedImage->length);
+    close(mappedImage->fd);
+    return - 1;
+  }
+
+  memcpy(mappedImage->map, header, headerLength);
+  for(row = 0; row < height; row++)
+    mappedImage->rows[row] = mappedImage->map + headerLength + 
+                             (size_t)row * mappedImage->rowBytes;
+
+  // success
+  return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* CREATES A PACKED PBM VIEW OF THE BODY OF A MAPPED IMAGE     */
+/*-------------------------------------------------------------*/
+int map_PBM_Packed_Image(struct PNM_Mapped_Image * mappedImage,
+                         struct PBM_Packed_Image * view)
+{ // for loop variable
+  int row;
+
+  if(mappedImage->format != PBM) return - 1;
+
+  view->width = mappedImage->width;
+  view->height = mappedImage->height;
+  view->rowBytes = (int)mappedImage->rowBytes;
+
+  // the ROWS are the rows of the file, with no block of their own to free
+  view->image = (unsigned char * *)calloc(view->height + 1, sizeof(char *));
+  if(view->image == (unsigned char * *)0) return - 1;
+
+  for(row = 0; row < view->height; row++)
+    view->image[row] = mappedImage->rows[row];
+
+  // success
+  return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* CREATES A PGM VIEW OF THE BODY OF A MAPPED IMAGE            */
+/*-------------------------------------------------------------*/
+int map_PGM_Image(struct PNM_Mapped_Image * mappedImage,
+                  struct PGM_Image * view)
+{ // for loop variable
+  int row;
+
+  if(mappedImage->format != PGM) return - 1;
+
+  view->width = mappedImage->width;
+  view->height = mappedImage->height;
+  view->maxGrayValue = mappedImage->maxGrayValue;
+
+  // the ROWS are the rows of the file, with no block of their own to free
+  view->image = (unsigned char * *)calloc(view->height + 1, sizeof(char *));
+  if(view->image == (unsigned char * *)0) return - 1;
+
+  for(row = 0; row < view->height; row++)
+    view->image[row] = mappedImage->rows[row];
+
+  // success
+  return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* CREATES A PPM VIEW OF THE BODY OF A MAPPED IMAGE            */
+/*-------------------------------------------------------------*/
+int map_PPM_Image(struct PNM_Mapped_Image * mappedImage,
+                  struct PPM_Image * view)
+{ // for loop variables
+  int row, col;
+
+  // the pointers to the pixels in the file
+  unsigned char * * pixelPointers;
+  size_t pixelCount = (size_t)mappedImage->width * mappedImage->height;
+
+  if(mappedImage->format != PPM) return - 1;
+
+  view->width = mappedImage->width;
+  view->height = mappedImage->height;
+  view->maxGrayValue = mappedImage->maxGrayValue;
+
+  view->image = (unsigned char * * *)calloc(view->height + 1, 
+                                            sizeof(char * *));
+  if(view->image == (unsigned char * * *)0) return - 1;
+
+  // the pixel pointers are freed with the view, the pixel block slot
+  // after them stays NULL as the pixels belong to the file
+  pixelPointers = (unsigned char * *)calloc(pixelCount + 1, sizeof(char *));
+  if(pixelPointers == (unsigned char * *)0)
+  { free(view->image);
+    return - 1;
+  }
+
+  for(row = 0; row < view->height; row++)
+  { view->image[row] = pixelPointers + (size_t)row * view->width;
+    for(col = 0; col < view->width; col++)
+      view->image[row][col] = mappedImage->rows[row] + 3 * col;
+  }
+  view->image[view->height] = pixelPointers;
+
+  // success
+  return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* A FILL OF A MAPPED IMAGE SHARED BY ITS THREADS              */
+/*-------------------------------------------------------------*/
+struct Mapped_Fill
+{ // the image, and what fills a row of it
+  struct PNM_Mapped_Image * mappedImage;
+  void (*fill)(void * context, unsigned char * row, int index);
+  void * context;
+};
+
+/*-------------------------------------------------------------*/
+/* FILLS ONE STRIPE OF ROWS OF A MAPPED IMAGE                  */
+/*-------------------------------------------------------------*/
+static void fill_Mapped_Stripe(void * context, int stripe)
+{ struct Mapped_Fill * job = (struct Mapped_Fill *)context;
+
+  // the rows of the stripe
+  int row = stripe * MAPPED_STRIPE_ROWS;
+  int last = (row + MAPPED_STRIPE_ROWS < job->mappedImage->height) ?
+             row + MAPPED_STRIPE_ROWS : job->mappedImage->height;
+
+  for(; row < last; row++)
+    job->fill(job->context, job->mappedImage->rows[row], row);
+}
 
-  return 0;
+/*-------------------------------------------------------------*/
+/* FILLS EVERY ROW OF A MAPPED IMAGE ON PARALLEL THREADS       */
+/*-------------------------------------------------------------*/
+void fill_PNM_Mapped_Image(struct PNM_Mapped_Image * mappedImage,
+                           void (*fill)(void * context, unsigned char * row,
+                                        int index),
+                           void * context)
+{ struct Mapped_Fill job;
+
+  job.mappedImage = mappedImage;
+  job.fill = fill;
+  job.context = context;
+
+  run_Parallel((mappedImage->height + MAPPED_STRIPE_ROWS - 1) / 
+               MAPPED_STRIPE_ROWS, fill_Mapped_Stripe, &job);
 }
 
-/*------------------------------------------------------*/
-/* THE PPM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
-/*------------------------------------------------------*/
-int load_PPM_Image(struct PPM_Image * ppmImage, char * fileName)
-{ /*----------------------*/
-  /* VARIABLE DECLARATION */
-  /*----------------------*/
+/*-------------------------------------------------------------*/
+/* UNMAPS AND CLOSES A MAPPED IMAGE                            */
+/*-------------------------------------------------------------*/
+int close_PNM_Mapped_Image(struct PNM_Mapped_Image * mappedImage)
+{ // the result of closing the file
+  int status = 0;
 
-  // to read from file
-  char c; bool raw;
+  if(munmap(mappedImage->map, mappedImage->length) != 0) status = - 1;
+  if(close(mappedImage->fd) != 0) status = - 1;
+  free(mappedImage->rows);
 
-  // for loop variables
-  int row, col; enum Color color;
+  return status;
+}
 
-  // open the file forreading
-  FILE * imageFilePointer = fileOpener(READ, fileName);
-  if(imageFilePointer == NULL)
-  { return - 1;
-  }
+/*-------------------------------------------------------------*/
+/* OPENS A PGM OR PPM IMAGE LAZILY, FOR READING OR UPDATE      */
+/*-------------------------------------------------------------*/
+static int open_Lazy_Image(struct PNM_Lazy_Image * lazyImage, char * fileName,
+                           enum FileAction fileAction)
+{ // to read from file
+  int c;
 
-  // make sure the first char is P
-  if(fgetc(imageFilePointer) != 'P')
-  { fclose(imageFilePointer);
+  memset(lazyImage, 0, sizeof(*lazyImage));
+
+  // open the file
+  lazyImage->imageFilePointer = fileOpener(fileAction, fileName);
+  if(lazyImage->imageFilePointer == NULL) return - 1;
+
+  // make sure the magic number is P2, P3, P5 or P6
+  if(fgetc(lazyImage->imageFilePointer) != 'P')
+  { close_PNM_Lazy_Image(lazyImage);
     return - 1;
   }
 
-  // make sure the second char is either a 3 or 6
-  c = fgetc(imageFilePointer);
-  if(c != '3' && c != '6')
-  { fclose(imageFilePointer);
+  c = fgetc(lazyImage->imageFilePointer);
+  if(c == 'R') return open_RLE_Lazy_Image(lazyImage);
+  if(c != '2' && c != '3' && c != '5' && c != '6')
+  { close_PNM_Lazy_Image(lazyImage);
     return - 1;
   }
 
-  if(c == '6') raw = true; else raw = false;
+  lazyImage->format = (c == '2' || c == '5') ? PGM : PPM;
+  lazyImage->channels = (lazyImage->format == PGM) ? 1 : 3;
+  lazyImage->raw = (c == '5' || c == '6');
 
   // get the width, height and max gray value of the image
-  ppmImage->width = geti(imageFilePointer); 
-  ppmImage->height = geti(imageFilePointer);
-  ppmImage->maxGrayValue = geti(imageFilePointer);
-  
-  if(ppmImage->width < 0 || ppmImage->height < 0 || 
-      ppmImage->maxGrayValue < 0)
-  { fclose(imageFilePointer);
+  lazyImage->width = geti(lazyImage->imageFilePointer);
+  lazyImage->height = geti(lazyImage->imageFilePointer);
+  lazyImage->maxGrayValue = geti(lazyImage->imageFilePointer);
+
+  if(lazyImage->width < 0 || lazyImage->height < 0 || 
+     lazyImage->maxGrayValue < 0)
+  { close_PNM_Lazy_Image(lazyImage);
     return - 1;
   }
 
-  if(ppmImage->maxGrayValue > 255) ppmImage->maxGrayValue = 255;
+  if(lazyImage->maxGrayValue > 255) lazyImage->maxGrayValue = 255;
 
-  // allocate memory for a COLUMN
-  ppmImage->image = (unsigned char * * *)
-                     calloc(ppmImage->height, sizeof(char * *));
-  if(ppmImage->image == (unsigned char * * *)0)
-  { fclose(imageFilePointer);
+  // the body starts right after the whitespace that ends the header
+  lazyImage->bodyOffset = ftell(lazyImage->imageFilePointer);
+  lazyImage->scanOffset = lazyImage->bodyOffset;
+
+  // the row table and index are small, the pixels wait for the first row
+  lazyImage->rows = (unsigned char * *)
+                    calloc(lazyImage->height + 1, sizeof(char *));
+  lazyImage->rowIndex = (long *)
+    calloc(lazyImage->height / LAZY_ROW_INDEX_STRIDE + 1, sizeof(long));
+  if(lazyImage->rows == NULL || lazyImage->rowIndex == NULL)
+  { close_PNM_Lazy_Image(lazyImage);
     return - 1;
   }
 
-  // allocate memory for the ROWS
-  for(row = 0; row < ppmImage->height; row++) 
-  { ppmImage->image[row] = (unsigned char * *) 
-                         calloc(ppmImage->width, sizeof(char *));
-    if(ppmImage->image[row] == (unsigned char * *)0)
-    { fclose(imageFilePointer);
-      return - 1;
+  // success
+  return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* OPENS A PGM OR PPM IMAGE LAZILY, READING ONLY ITS HEADER    */
+/*-------------------------------------------------------------*/
+int open_PNM_Lazy_Image(struct PNM_Lazy_Image * lazyImage, char * fileName)
+{ return open_Lazy_Image(lazyImage, fileName, READ);
+}
+
+/*-------------------------------------------------------------*/
+/* SKIPS count ASCII VALUES (AND ANY COMMENTS BETWEEN THEM)    */
+/* WITHOUT CONVERTING THEM                                      */
+/*-------------------------------------------------------------*/
+static int skip_Values(FILE * filePointer, long count)
+{ // to read in data from file
+  int c;
+
+  while(count > 0)
+  { c = getc(filePointer);
+    if(c == EOF) return -1;
+
+    // a digit starts a value, which runs to the next non digit
+    if(c >= '0' && c <= '9')
+    { do c = getc(filePointer); while(c >= '0' && c <= '9');
+      count--;
     }
+
+    // skip comments
+    if(c == '#')
+      do c = getc(filePointer); while(c != '\n' && c != '\r' && c != EOF);
   }
 
-  // allocate memory for the pixels
-  for(row = 0; row < ppmImage->height; row++)
-    for(col = 0; col < ppmImage->width; col++)
-    { ppmImage->image[row][col] = (unsigned char *) calloc(3, sizeof(char));
-      if(ppmImage->image[row][col] == (unsigned char *)0)
-      { fclose(imageFilePointer);
-        return - 1;
-      }
+  return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* GETS A ROW OF A LAZY IMAGE, DECODING IT ON FIRST ACCESS     */
+/*-------------------------------------------------------------*/
+unsigned char * get_PNM_Lazy_Row(struct PNM_Lazy_Image * lazyImage, int row)
+{ // the samples in a row
+  size_t rowLength = (size_t)lazyImage->width * lazyImage->channels;
+
+  // the row to start scanning from, and for loop variables
+  int from, value; size_t sample;
+
+  // the encoded row of a run length container
+  unsigned char * encoded; size_t encodedLength; long used;
+
+  FILE * filePointer = lazyImage->imageFilePointer;
+
+  if(row < 0 || row >= lazyImage->height) return NULL;
+  if(lazyImage->rows[row] != NULL) return lazyImage->rows[row];
+
+  // allocate the pixels for the whole image on first use, the pages of
+  // rows never asked for are never touched
+  if(lazyImage->pixels == NULL)
+  { lazyImage->pixels = (unsigned char *)
+                        calloc(rowLength * lazyImage->height + 1, 1);
+    if(lazyImage->pixels == NULL) return NULL;
+  }
+
+  /*----------------------*/
+  /* RUN LENGTH CONTAINER */
+  /*----------------------*/
+  if(lazyImage->rle)
+  { // every row is at an indexed offset and decodes on its own
+    encoded = (unsigned char *)
+              malloc(RLE_ROW_BOUND(lazyImage->width, lazyImage->channels));
+    if(encoded == NULL) return NULL;
+
+    used = -1;
+    if(fseek(filePointer, lazyImage->rowIndex[row], SEEK_SET) == 0)
+    { encodedLength = fread(encoded, 1, 
+        RLE_ROW_BOUND(lazyImage->width, lazyImage->channels), filePointer);
+      used = decode_RLE_Row(encoded, encodedLength, 
+                            lazyImage->pixels + rowLength * row,
+                            lazyImage->width, lazyImage->channels);
     }
+    free(encoded);
+    if(used < 0) return NULL;
+  }
 
-  /*-------------------*/
-  /* READ IN THE IMAGE */
-  /*-------------------*/
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  else if(lazyImage->raw)
+  { // every row is at a known offset
+    if(fseek(filePointer, lazyImage->bodyOffset + (long)(rowLength * row), 
+             SEEK_SET) != 0) return NULL;
+    if(fread(lazyImage->pixels + rowLength * row, 1, rowLength, filePointer) 
+       != rowLength) return NULL;
+  }
 
   /*--------------*/
   /* ASCII FORMAT */
   /*--------------*/
-  if(!raw)
-    for(row = 0; row < ppmImage->height; row++)
-      for(col = 0; col < ppmImage->width; col++)
-        for(color = RED; color <= BLUE; color++)
-          ppmImage->image[row][col][color] = geti(imageFilePointer);
+  else
+  { // start from the nearest indexed row before row, or from the furthest
+    // row scanned so far, indexing the rows passed on the way
+    if(row < lazyImage->scannedRows)
+    { from = row - row % LAZY_ROW_INDEX_STRIDE;
+      if(fseek(filePointer, lazyImage->rowIndex[from / LAZY_ROW_INDEX_STRIDE],
+               SEEK_SET) != 0) return NULL;
+    }
+    else
+    { from = lazyImage->scannedRows;
+      if(fseek(filePointer, lazyImage->scanOffset, SEEK_SET) != 0) return NULL;
+    }
 
-  /*------------*/
-  /* RAW FORMAT */
-  /*------------*/
-  if(raw)
-    for(row = 0; row < ppmImage->height; row++)
-      for(col = 0; col < ppmImage->width; col++)
-        for(color = RED; color <= BLUE; color++)
-          ppmImage->image[row][col][color] = getc(imageFilePointer);
+    for(; from < row; from++)
+    { if(from % LAZY_ROW_INDEX_STRIDE == 0)
+        lazyImage->rowIndex[from / LAZY_ROW_INDEX_STRIDE] = ftell(filePointer);
+      if(skip_Values(filePointer, (long)rowLength) != 0) return NULL;
+    }
 
-  // success
-  fclose(imageFilePointer);
+    if(row % LAZY_ROW_INDEX_STRIDE == 0)
+      lazyImage->rowIndex[row / LAZY_ROW_INDEX_STRIDE] = ftell(filePointer);
 
-  return 0; 
-}
+    for(sample = 0; sample < rowLength; sample++)
+    { value = geti(filePointer);
+      if(value < 0) return NULL;
+      lazyImage->pixels[rowLength * row + sample] = value;
+    }
 
-/*-------------------------------------------------*/
-/* THE PPM 'CONSTRUCTOR' WHICH CREATES A NEW IMAGE */
-/*-------------------------------------------------*/
-int create_PPM_Image(struct PPM_Image * ppmImage,
-                     int width, int height, int maxGrayValue)
-{ // for loop variables
-  int row, col;
+    if(row >= lazyImage->scannedRows)
+    { lazyImage->scannedRows = row + 1;
+      lazyImage->scanOffset = ftell(filePointer);
+    }
+  }
 
-  // get the width, height and max gray value of the image
-  ppmImage->width = width; 
-  ppmImage->height = height; 
-  ppmImage->maxGrayValue = maxGrayValue;
-  
-  if(ppmImage->width < 0 || ppmImage->height < 0 || ppmImage->maxGrayValue < 0)
-    return - 1;
+  lazyImage->rows[row] = lazyImage->pixels + rowLength * row;
+  return lazyImage->rows[row];
+}
 
-  if(ppmImage->maxGrayValue > 255) ppmImage->maxGrayValue = 255;
+/*-----------------------------------------------------------*/
+/* CLOSES A LAZY IMAGE AND FREES THE ROWS DECODED FROM IT    */
+/*-----------------------------------------------------------*/
+void close_PNM_Lazy_Image(struct PNM_Lazy_Image * lazyImage)
+{ // write back the rows still dirty
+  if(lazyImage->dirtyRows != NULL) flush_PNM_Lazy_Image(lazyImage);
+
+  if(lazyImage->imageFilePointer != NULL) fclose(lazyImage->imageFilePointer);
+  free(lazyImage->pixels);
+  free(lazyImage->rows);
+  free(lazyImage->rowIndex);
+  free(lazyImage->dirtyRows);
+  memset(lazyImage, 0, sizeof(*lazyImage));
+}
 
-  // allocate memory for a COLUMN
-  ppmImage->image = (unsigned char * * *)
-                    calloc(ppmImage->height, sizeof(char * *));
-  if(ppmImage->image == (unsigned char * * *)0) return -1;
+/*-------------------------------------------------------------*/
+/* OPENS A RAW PGM OR PPM IMAGE LAZILY FOR UPDATE              */
+/*-------------------------------------------------------------*/
+int open_PNM_Lazy_Image_for_Update(struct PNM_Lazy_Image * lazyImage,
+                                   char * fileName)
+{ if(open_Lazy_Image(lazyImage, fileName, UPDATE) != 0) return - 1;
 
-  // allocate memory for the ROWS
-  for(row = 0; row < ppmImage->height; row++) 
-  { ppmImage->image[row] = (unsigned char * *) 
-                         calloc(ppmImage->width, sizeof(char *));
-    if(ppmImage->image[row] == (unsigned char * *)0) return -1; 
+  // only a raw body has every row at a fixed offset and length
+  if(!lazyImage->raw || lazyImage->rle)
+  { close_PNM_Lazy_Image(lazyImage);
+    return - 1;
+  }
+
+  lazyImage->dirtyRows = (unsigned char *)
+                         calloc(lazyImage->height / 8 + 1, 1);
+  if(lazyImage->dirtyRows == NULL)
+  { close_PNM_Lazy_Image(lazyImage);
+    return - 1;
   }
 
-  // allocate memory for the pixels
-  for(row = 0; row < ppmImage->height; row++)
-    for(col = 0; col < ppmImage->width; col++)
-    { ppmImage->image[row][col] = (unsigned char *) calloc(3, sizeof(char));
-      if(ppmImage->image[row][col] == (unsigned char *)0) return -1; 
-    } 
-  
   // success
-  return 0; 
+  return 0;
 }
 
-/*--------------------------------------*/
-/* FREES MEMORY CONSUMED BY A PPM IMAGE */
-/*--------------------------------------*/
-void free_PPM_Image(struct PPM_Image * ppmImage)
-{ // forl oop variables
-  int row, col;
-
-  // free the pixels
-  for(row = 0; row < ppmImage->height; row++)
-     for(col = 0; col < ppmImage->width; col++)
-        free(ppmImage->image[row][col]);
+/*-------------------------------------------------------------*/
+/* MARKS A ROW OF AN IMAGE OPENED FOR UPDATE AS CHANGED        */
+/*-------------------------------------------------------------*/
+int mark_PNM_Lazy_Row_Dirty(struct PNM_Lazy_Image * lazyImage, int row)
+{ if(lazyImage->dirtyRows == NULL || row < 0 || row >= lazyImage->height ||
+     lazyImage->rows[row] == NULL) return - 1;
 
-  // free the ROWS
-  for(row = 0; row < ppmImage->height; row++)
-     free(ppmImage->image[row]);
+  lazyImage->dirtyRows[row / 8] |= 1 << (row % 8);
 
-  // free the COLUMN
-  free(ppmImage->image);
+  return 0;
 }
 
-/*-----------------------------*/
-/* SAVES THE PPM IMAGE TO FILE */
-/*-----------------------------*/
-int save_PPM_Image(struct PPM_Image * ppmImage, char * fileName, bool raw)
-{ /*----------------------*/
-  /* VARIABLE DECLARATION */
-  /*----------------------*/
-
-  // forl oop variables
-  int row, col; enum Color color;
+/*-------------------------------------------------------------*/
+/* WRITES THE DIRTY ROWS BACK TO THE FILE AND CLEARS THEM      */
+/*-------------------------------------------------------------*/
+int flush_PNM_Lazy_Image(struct PNM_Lazy_Image * lazyImage)
+{ // the bytes in a row
+  size_t rowLength = (size_t)lazyImage->width * lazyImage->channels;
 
-  // the file to save to
-  FILE * imageFilePointer = fileOpener(WRITE, fileName);
-  if(imageFilePointer == NULL) return - 1;
+  // the first and last rows of a run of dirty rows
+  int row, last;
 
-  // write the header
-  if(!raw)
-    fprintf(imageFilePointer, "P3\n%d %d\n%d\n",
-            ppmImage->width, ppmImage->height, ppmImage->maxGrayValue);
-  else
-    fprintf(imageFilePointer, "P6\n%d %d\n%d\n",
-            ppmImage->width, ppmImage->height, ppmImage->maxGrayValue);
+  // the part of the run still to be written
+  unsigned char * bytes; size_t length; off_t offset; ssize_t written;
 
-  /*-----------------*/
-  /* WRITE THE IMAGE */
-  /*-----------------*/
+  if(lazyImage->dirtyRows == NULL) return - 1;
 
-  /*--------------*/
-  /* ASCII FORMAT */
-  /*--------------*/
-  if(!raw)
-    for(row = 0; row < ppmImage->height; row++)
-      for(col = 0; col < ppmImage->width; col++)
-        for(color = RED; color <= BLUE; color++)
-          fprintf(imageFilePointer, "%d ", ppmImage->image[row][col][color]);
+  for(row = 0; row < lazyImage->height; row = last)
+  { // skip clean bytes of the bitmap whole
+    if(row % 8 == 0 && lazyImage->dirtyRows[row / 8] == 0)
+    { last = row + 8;
+      continue;
+    }
+    if(!(lazyImage->dirtyRows[row / 8] & (1 << (row % 8))))
+    { last = row + 1;
+      continue;
+    }
 
-  /*------------*/
-  /* RAW FORMAT */
-  /*------------*/
-  if(raw)
-    for(row = 0; row < ppmImage->height; row++)
-      for(col = 0; col < ppmImage->width; col++)
-        for(color = RED; color <= BLUE; color++)
-          fputc(ppmImage->image[row][col][color], imageFilePointer);
+    // adjacent dirty rows are adjacent in memory and in the file
+    last = row + 1;
+    while(last < lazyImage->height && 
+          (lazyImage->dirtyRows[last / 8] & (1 << (last % 8)))) last++;
+
+    bytes = lazyImage->rows[row];
+    length = rowLength * (last - row);
+    offset = (off_t)lazyImage->bodyOffset + (off_t)(rowLength * row);
+    while(length > 0)
+    { written = pwrite(fileno(lazyImage->imageFilePointer), bytes, length, 
+                       offset);
+      if(written < 0 && errno == EINTR) continue;
+      if(written <= 0) return - 1;
+      bytes += written;
+      length -= written;
+      offset += written;
+    }
 
-  fclose(imageFilePointer);
+    // the run is clean again
+    for(; row < last; row++)
+      lazyImage->dirtyRows[row / 8] &= ~(1 << (row % 8));
+  }
 
-  return 0; 
+  // success
+  return 0;
 }
 
 /*-----------------------------------*/
@@ -680,7 +2417,7 @@ int save_PPM_Image(struct PPM_Image * ppmImage, char * fileName, bool raw)
 /*-----------------------------------*/
 int copy_PBM_to_PGM(struct PBM_Image * pbmImage, struct PGM_Image * pgmImage)
 { // for loop variables
-  int row, col;
+  int row;
 
   // initialize the pgm image
   if(create_PGM_Image(pgmImage, pbmImage->width, 
@@ -688,11 +2425,8 @@ int copy_PBM_to_PGM(struct PBM_Image * pbmImage, struct PGM_Image * pgmImage)
 
   // copy the values
   for(row = 0; row < pbmImage->height; row++)
-    for(col = 0; col < pbmImage->width; col++)
-      if(pbmImage->image[row][col] == WHITE)
-        pgmImage->image[row][col] = 255;
-      else 
-        pgmImage->image[row][col] = 0;
+    expand_PBM_Row(pbmImage->image[row], pgmImage->image[row], 
+                   1, pbmImage->width);
 
   // success
   return 0; 
@@ -703,7 +2437,7 @@ int copy_PBM_to_PGM(struct PBM_Image * pbmImage, struct PGM_Image * pgmImage)
 /*-----------------------------------*/
 int copy_PBM_to_PPM(struct PBM_Image * pbmImage, struct PPM_Image * ppmImage) 
 { // for loop variables
-  int row, col; enum Color color;
+  int row;
 
   // initialize the pgm image
   if(create_PPM_Image(ppmImage, pbmImage->width, 
@@ -711,12 +2445,8 @@ int copy_PBM_to_PPM(struct PBM_Image * pbmImage, struct PPM_Image * ppmImage)
 
   // copy the values
   for(row = 0; row < pbmImage->height; row++)
-    for(col = 0; col < pbmImage->width; col++)
-      for(color = RED; color <= BLUE; color++)
-        if(pbmImage->image[row][col] == WHITE)
-           ppmImage->image[row][col][color] = 255;
-        else
-           ppmImage->image[row][col][color] = 0;
+    expand_PBM_Row(pbmImage->image[row], ppmImage->image[row][0], 
+                   3, pbmImage->width);
   
   // success
   return 0;
@@ -727,7 +2457,7 @@ int copy_PBM_to_PPM(struct PBM_Image * pbmImage, struct PPM_Image * ppmImage)
 /*-----------------------------------*/
 int copy_PGM_to_PBM(struct PGM_Image * pgmImage, struct PBM_Image * pbmImage)
 { // for loop variables
-  int row, col;
+  int row;
 
   // initialize the pgm image
   if(create_PBM_Image(pbmImage, pgmImage->width, pgmImage->height) == -1)
@@ -735,11 +2465,96 @@ int copy_PGM_to_PBM(struct PGM_Image * pgmImage, struct PBM_Image * pbmImage)
 
   // copy the values
   for(row = 0; row < pgmImage->height; row++)
-    for(col = 0; col < pgmImage->width; col++)
-      if(pgmImage->image[row][col] >= (pgmImage->maxGrayValue / 2))
-        pbmImage->image[row][col] = WHITE;
-      else
-        pbmImage->image[row][col] = BLACK;
+    threshold_Row(pgmImage->image[row], 1, pbmImage->image[row],
+                  pgmImage->width, pgmImage->maxGrayValue / 2);
+
+  // success
+  return 0; 
+}
+
+/*------------------------------------------*/
+/* COPIES A PGM IMAGE TO A PACKED PBM IMAGE */
+/*------------------------------------------*/
+int copy_PGM_to_PBM_Packed(struct PGM_Image * pgmImage,
+                           struct PBM_Packed_Image * pbmImage)
+{ // for loop variables
+  int row;
+
+  // initialize the packed pbm image
+  if(create_PBM_Packed_Image(pbmImage, pgmImage->width, 
+                             pgmImage->height) == -1)
+    return -1;
+
+  // threshold straight into the packed bits
+  for(row = 0; row < pgmImage->height; row++)
+    threshold_Row_Packed(pgmImage->image[row], 1, pbmImage->image[row],
+                         pgmImage->width, pgmImage->maxGrayValue / 2);
+
+  // success
+  return 0; 
+}
+
+/*------------------------------------------*/
+/* COPIES A PPM IMAGE TO A PACKED PBM IMAGE */
+/*------------------------------------------*/
+int copy_PPM_to_PBM_Packed(struct PPM_Image * ppmImage,
+                           struct PBM_Packed_Image * pbmImage, 
+                           enum Color color)
+{ // for loop variables
+  int row;
+
+  // initialize the packed pbm image
+  if(create_PBM_Packed_Image(pbmImage, ppmImage->width, 
+                             ppmImage->height) == -1)
+    return -1;
+
+  // threshold straight into the packed bits
+  for(row = 0; row < ppmImage->height; row++)
+    threshold_Row_Packed(ppmImage->image[row][0] + color, 3, 
+                         pbmImage->image[row],
+                         ppmImage->width, ppmImage->maxGrayValue / 2);
+
+  // success
+  return 0; 
+}
+
+/*------------------------------------------*/
+/* COPIES A PACKED PBM IMAGE TO A PGM IMAGE */
+/*------------------------------------------*/
+int copy_PBM_Packed_to_PGM(struct PBM_Packed_Image * pbmImage,
+                           struct PGM_Image * pgmImage)
+{ // for loop variables
+  int row;
+
+  // initialize the pgm image
+  if(create_PGM_Image(pgmImage, pbmImage->width, 
+                      pbmImage->height, MAX_GRAY_VALUE) == -1) return -1;
+
+  // expand the bits
+  for(row = 0; row < pbmImage->height; row++)
+    expand_Packed_Row(pbmImage->image[row], pgmImage->image[row], 
+                      1, pbmImage->width);
+
+  // success
+  return 0; 
+}
+
+/*------------------------------------------*/
+/* COPIES A PACKED PBM IMAGE TO A PPM IMAGE */
+/*------------------------------------------*/
+int copy_PBM_Packed_to_PPM(struct PBM_Packed_Image * pbmImage,
+                           struct PPM_Image * ppmImage)
+{ // for loop variables
+  int row;
+
+  // initialize the ppm image
+  if(create_PPM_Image(ppmImage, pbmImage->width, 
+                      pbmImage->height, MAX_GRAY_VALUE) == -1) return -1;
+
+  // expand the bits
+  for(row = 0; row < pbmImage->height; row++)
+    expand_Packed_Row(pbmImage->image[row], ppmImage->image[row][0], 
+                      3, pbmImage->width);
 
   // success
   return 0; 
@@ -809,7 +2624,7 @@ int copy_PGM_to_PPM(struct PGM_Image * pgmImage, struct PPM_Image * ppmImage)
 int copy_PPM_to_PBM(struct PPM_Image * ppmImage, 
                     struct PBM_Image * pbmImage, enum Color color)
 { // for loop variables
-  int row, col;
+  int row;
 
   // initialize the pgm image
   if(create_PBM_Image(pbmImage, ppmImage->width, ppmImage->height) == -1)
@@ -817,11 +2632,8 @@ int copy_PPM_to_PBM(struct PPM_Image * ppmImage,
 
   // copy the values
   for(row = 0; row < ppmImage->height; row++)
-    for(col = 0; col < ppmImage->width; col++)
-      if(ppmImage->image[row][col][color] >= (ppmImage->maxGrayValue / 2))
-        pbmImage->image[row][col] = WHITE;
-      else
-        pbmImage->image[row][col] = BLACK;
+    threshold_Row(ppmImage->image[row][0] + color, 3, pbmImage->image[row],
+                  ppmImage->width, ppmImage->maxGrayValue / 2);
 
   // success
   return 0; 
@@ -22,6 +22,18 @@ enum Color {RED = 0, GREEN, BLUE};
 // the three pnm formats
 enum Format {PBM = 1, PGM, PPM};
 
+/*-------------------------------------------------------------------*/
+/* THE PIXELS OF AN IMAGE ARE ALLOCATED AS ONE CONTIGUOUS BLOCK, ROW  */
+/* AFTER ROW, SO image[row] POINTS AT width CONSECUTIVE PIXELS (AND    */
+/* FOR PPM image[row][0] AT 3 * width CONSECUTIVE SAMPLES). THE SLOT   */
+/* image[height] HOLDS THE BLOCK SO THAT IT CAN BE FREED.              */
+/*                                                                    */
+/* A VIEW IS AN IMAGE WHOSE ROWS POINT INTO A REGION OF ANOTHER ONE    */
+/* (THE PARENT'S ROWS ARE ITS STRIDE), WITH image[height] LEFT NULL SO */
+/* THAT FREEING IT ONLY RELEASES ITS ROW TABLE. VIEWS ARE ACCEPTED     */
+/* EVERYWHERE AN IMAGE IS, AND MUST BE FREED BEFORE THEIR PARENT.      */
+/*-------------------------------------------------------------------*/
+
 /*-------------*/
 /* A PBM IMAGE */
 /*-------------*/
@@ -33,6 +45,21 @@ struct PBM_Image
   unsigned char * * image;
 };
 
+/*-----------------------------------------------------------*/
+/* A PBM IMAGE STORED AS PACKED BITS, ONE RAW (P4) ROW EACH  */
+/* (bit 7 of a byte is the leftmost pixel, set bits BLACK)   */
+/*-----------------------------------------------------------*/
+struct PBM_Packed_Image
+{ // the image dimensions
+  int width, height;
+
+  // the number of bytes in a packed row
+  int rowBytes;
+
+  // the 2D image of packed rows
+  unsigned char * * image;
+};
+
 /*-------------*/
 /* A PGM IMAGE */
 /*-------------*/
@@ -61,11 +88,79 @@ struct PPM_Image
   unsigned char * * * image;
 };
 
+/*-----------------------------------------------------------------*/
+/* A PGM OR PPM IMAGE OPENED LAZILY: ONLY THE HEADER IS READ WHEN   */
+/* IT IS OPENED, EACH ROW IS DECODED THE FIRST TIME IT IS ASKED FOR */
+/* (rows[row] IS NULL UNTIL THEN, AND HOLDS width * channels        */
+/* SAMPLES AFTER, RGB TRIPLES FOR PPM). RUN LENGTH CONTAINERS (SEE  */
+/* libpnm_rle.h) ARE OPENED THE SAME WAY, THROUGH THEIR ROW INDEX.  */
+/*                                                                 */
+/* A RAW IMAGE OPENED FOR UPDATE ALSO KEEPS A BITMAP OF THE ROWS    */
+/* CHANGED IN MEMORY; FLUSHING WRITES BACK ONLY THOSE ROWS, EACH    */
+/* RUN OF ADJACENT ONES WITH A SINGLE pwrite AT ITS OFFSET.         */
+/*-----------------------------------------------------------------*/
+struct PNM_Lazy_Image
+{ // the image dimensions
+  int width, height;
+
+  // the max gray value of the image
+  int maxGrayValue;
+
+  // PGM or PPM, the samples per pixel (1 or 3), whether the body is raw
+  // or a run length container
+  enum Format format; int channels; bool raw, rle;
+
+  // the open file and the offset of the first row in it
+  FILE * imageFilePointer; long bodyOffset;
+
+  // the decoded rows, and the block they live in (allocated on first use)
+  unsigned char * * rows; unsigned char * pixels;
+
+  // ASCII: the offset of every LAZY_ROW_INDEX_STRIDE'th row, known for
+  // the rows before scannedRows, and the offset of row scannedRows
+  // (a run length container has the offset of every row in rowIndex)
+  long * rowIndex; int scannedRows; long scanOffset;
+
+  // the rows changed since the last flush, a bit each (NULL unless the
+  // image was opened for update)
+  unsigned char * dirtyRows;
+};
+
+// the rows between entries of the ASCII row offset index
+# define LAZY_ROW_INDEX_STRIDE 16
+
+/*-----------------------------------------------------------------*/
+/* A RAW (P4, P5 OR P6) IMAGE FILE MAPPED FOR WRITING. THE FILE IS  */
+/* SIZED AND ITS HEADER WRITTEN WHEN IT IS CREATED, AND rows[row]   */
+/* POINTS AT THE rowBytes BYTES OF ROW row IN THE MAPPED BODY       */
+/* (PACKED BITS FOR PBM, RGB TRIPLES FOR PPM), SO PIXELS ARE        */
+/* WRITTEN STRAIGHT INTO THE FILE. ROWS NOT WRITTEN ARE ZERO.       */
+/*-----------------------------------------------------------------*/
+struct PNM_Mapped_Image
+{ // the image dimensions
+  int width, height;
+
+  // the max gray value of the image (unused for PBM)
+  int maxGrayValue;
+
+  // the format, and the bytes in a row of the body
+  enum Format format; size_t rowBytes;
+
+  // the open file, the mapping of all of it and its length
+  int fd; unsigned char * map; size_t length;
+
+  // the rows of the body
+  unsigned char * * rows;
+};
+
+// the rows filled by one task of fill_PNM_Mapped_Image
+# define MAPPED_STRIPE_ROWS 64
+
 /*--------------*/
 /* OPENS A FILE */
 /*--------------*/
 
-enum FileAction {READ, WRITE};
+enum FileAction {READ, WRITE, UPDATE};
 
 FILE * fileOpener(enum FileAction fileAction, char * fileName);
 
@@ -89,11 +184,57 @@ int create_PBM_Image(struct PBM_Image * pbmImage, int width, int height);
 /*--------------------------------------*/
 void free_PBM_Image(struct PBM_Image * pbmImage);
 
+/*--------------------------------------*/
+/* WRITES THE PBM IMAGE TO AN OPEN FILE */
+/*--------------------------------------*/
+int write_PBM_Image(struct PBM_Image * pbmImage,
+                    FILE * imageFilePointer, bool raw);
+
 /*-----------------------------*/
 /* SAVES THE PBM IMAGE TO FILE */
 /*-----------------------------*/
 int save_PBM_Image(struct PBM_Image * pbmImage, char * fileName, bool raw);
 
+/*------------------------------------------*/
+/* SAVES THE PBM IMAGE TO A FILE DESCRIPTOR */
+/*------------------------------------------*/
+int save_PBM_Image_fd(struct PBM_Image * pbmImage,
+                      int fd, bool raw);
+
+/*-------------------------------------------------------------*/
+/* THE PACKED PBM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
+/*-------------------------------------------------------------*/
+int load_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage, char * fileName);
+
+/*--------------------------------------------------------*/
+/* THE PACKED PBM 'CONSTRUCTOR' WHICH CREATES A NEW IMAGE */
+/*--------------------------------------------------------*/
+int create_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage,
+                            int width, int height);
+
+/*---------------------------------------------*/
+/* FREES MEMORY CONSUMED BY A PACKED PBM IMAGE */
+/*---------------------------------------------*/
+void free_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage);
+
+/*---------------------------------------------*/
+/* WRITES THE PACKED PBM IMAGE TO AN OPEN FILE */
+/*---------------------------------------------*/
+int write_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage,
+                           FILE * imageFilePointer, bool raw);
+
+/*------------------------------------*/
+/* SAVES THE PACKED PBM IMAGE TO FILE */
+/*------------------------------------*/
+int save_PBM_Packed_Image(struct PBM_Packed_Image * pbmImage,
+                          char * fileName, bool raw);
+
+/*-------------------------------------------------*/
+/* SAVES THE PACKED PBM IMAGE TO A FILE DESCRIPTOR */
+/*-------------------------------------------------*/
+int save_PBM_Packed_Image_fd(struct PBM_Packed_Image * pbmImage,
+                             int fd, bool raw);
+
 /*------------------------------------------------------*/
 /* THE PGM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
 /*------------------------------------------------------*/
@@ -110,11 +251,31 @@ int create_PGM_Image(struct PGM_Image * pgmImage,
 /*--------------------------------------*/
 void free_PGM_Image(struct PGM_Image * pgmImage);
 
+/*-----------------------------------------------------------*/
+/* THE PGM 'CONSTRUCTOR' WHICH CREATES A VIEW OF THE width BY */
+/* height REGION OF pgmImage AT (left, top), SHARING PIXELS   */
+/* (free it with free_PGM_Image)                              */
+/*-----------------------------------------------------------*/
+int create_PGM_View(struct PGM_Image * pgmImage, struct PGM_Image * view,
+                    int left, int top, int width, int height);
+
+/*--------------------------------------*/
+/* WRITES THE PGM IMAGE TO AN OPEN FILE */
+/*--------------------------------------*/
+int write_PGM_Image(struct PGM_Image * pgmImage,
+                    FILE * imageFilePointer, bool raw);
+
 /*-----------------------------*/
 /* SAVES THE PGM IMAGE TO FILE */
 /*-----------------------------*/
 int save_PGM_Image(struct PGM_Image * pgmImage, char * fileName, bool raw);
 
+/*------------------------------------------*/
+/* SAVES THE PGM IMAGE TO A FILE DESCRIPTOR */
+/*------------------------------------------*/
+int save_PGM_Image_fd(struct PGM_Image * pgmImage,
+                      int fd, bool raw);
+
 /*------------------------------------------------------*/
 /* THE PPM 'CONSTRUCTOR' WHICH LOADS AN IMAGE FROM FILE */
 /*------------------------------------------------------*/
@@ -131,11 +292,103 @@ int create_PPM_Image(struct PPM_Image * ppmImage,
 /*--------------------------------------*/
 void free_PPM_Image(struct PPM_Image * ppmImage);
 
+/*-----------------------------------------------------------*/
+/* THE PPM 'CONSTRUCTOR' WHICH CREATES A VIEW OF THE width BY */
+/* height REGION OF ppmImage AT (left, top), SHARING PIXELS   */
+/* (free it with free_PPM_Image)                              */
+/*-----------------------------------------------------------*/
+int create_PPM_View(struct PPM_Image * ppmImage, struct PPM_Image * view,
+                    int left, int top, int width, int height);
+
+/*--------------------------------------*/
+/* WRITES THE PPM IMAGE TO AN OPEN FILE */
+/*--------------------------------------*/
+int write_PPM_Image(struct PPM_Image * ppmImage,
+                    FILE * imageFilePointer, bool raw);
+
 /*-----------------------------*/
 /* SAVES THE PPM IMAGE TO FILE */
 /*-----------------------------*/
 int save_PPM_Image(struct PPM_Image * ppmImage, char * fileName, bool raw);
 
+/*------------------------------------------*/
+/* SAVES THE PPM IMAGE TO A FILE DESCRIPTOR */
+/*------------------------------------------*/
+int save_PPM_Image_fd(struct PPM_Image * ppmImage,
+                      int fd, bool raw);
+
+/*-------------------------------------------------------------*/
+/* OPENS A PGM OR PPM IMAGE LAZILY, READING ONLY ITS HEADER    */
+/*-------------------------------------------------------------*/
+int open_PNM_Lazy_Image(struct PNM_Lazy_Image * lazyImage, char * fileName);
+
+/*-------------------------------------------------------------*/
+/* GETS A ROW OF A LAZY IMAGE, DECODING IT ON FIRST ACCESS     */
+/* (returns NULL if the row cannot be read)                    */
+/*-------------------------------------------------------------*/
+unsigned char * get_PNM_Lazy_Row(struct PNM_Lazy_Image * lazyImage, int row);
+
+/*-----------------------------------------------------------*/
+/* CLOSES A LAZY IMAGE AND FREES THE ROWS DECODED FROM IT    */
+/*-----------------------------------------------------------*/
+void close_PNM_Lazy_Image(struct PNM_Lazy_Image * lazyImage);
+
+/*-------------------------------------------------------------*/
+/* OPENS A RAW PGM OR PPM IMAGE LAZILY FOR UPDATE: ROWS ARE    */
+/* CHANGED IN PLACE IN THE BUFFER get_PNM_Lazy_Row RETURNS,    */
+/* MARKED DIRTY, AND WRITTEN BACK BY FLUSHING OR CLOSING       */
+/*-------------------------------------------------------------*/
+int open_PNM_Lazy_Image_for_Update(struct PNM_Lazy_Image * lazyImage,
+                                   char * fileName);
+
+/*-------------------------------------------------------------*/
+/* MARKS A ROW OF AN IMAGE OPENED FOR UPDATE AS CHANGED        */
+/* (the row must have been got with get_PNM_Lazy_Row)          */
+/*-------------------------------------------------------------*/
+int mark_PNM_Lazy_Row_Dirty(struct PNM_Lazy_Image * lazyImage, int row);
+
+/*-------------------------------------------------------------*/
+/* WRITES THE DIRTY ROWS BACK TO THE FILE AND CLEARS THEM      */
+/* (close_PNM_Lazy_Image flushes too, but cannot report errors)*/
+/*-------------------------------------------------------------*/
+int flush_PNM_Lazy_Image(struct PNM_Lazy_Image * lazyImage);
+
+/*-------------------------------------------------------------*/
+/* CREATES A RAW IMAGE FILE OF THE FORMAT AND SIZE GIVEN AND   */
+/* MAPS IT FOR WRITING (fails, leaving the caller to write it  */
+/* through a stream, when fileName is not a regular file)      */
+/*-------------------------------------------------------------*/
+int create_PNM_Mapped_Image(struct PNM_Mapped_Image * mappedImage,
+                            char * fileName, enum Format format,
+                            int width, int height, int maxGrayValue);
+
+/*-------------------------------------------------------------*/
+/* CREATES A VIEW OF THE BODY OF A MAPPED IMAGE OF THE SAME    */
+/* FORMAT, SO THAT GENERATORS AND CONVERTERS WRITE INTO THE    */
+/* FILE (free it with the image's free function before the     */
+/* mapped image is closed)                                     */
+/*-------------------------------------------------------------*/
+int map_PBM_Packed_Image(struct PNM_Mapped_Image * mappedImage,
+                         struct PBM_Packed_Image * view);
+int map_PGM_Image(struct PNM_Mapped_Image * mappedImage,
+                  struct PGM_Image * view);
+int map_PPM_Image(struct PNM_Mapped_Image * mappedImage,
+                  struct PPM_Image * view);
+
+/*-------------------------------------------------------------*/
+/* CALLS fill(context, mappedImage->rows[row], row) FOR EVERY  */
+/* ROW, STRIPES OF MAPPED_STRIPE_ROWS ROWS ON PARALLEL THREADS */
+/*-------------------------------------------------------------*/
+void fill_PNM_Mapped_Image(struct PNM_Mapped_Image * mappedImage,
+                           void (*fill)(void * context, unsigned char * row,
+                                        int index),
+                           void * context);
+
+/*-------------------------------------------------------------*/
+/* UNMAPS AND CLOSES A MAPPED IMAGE                            */
+/*-------------------------------------------------------------*/
+int close_PNM_Mapped_Image(struct PNM_Mapped_Image * mappedImage);
+
 /*-----------------------------------*/
 /* COPIES A PBM IMAGE TO A PGM IMAGE */
 /*-----------------------------------*/
@@ -151,6 +404,31 @@ int copy_PBM_to_PPM(struct PBM_Image * pbmImage, struct PPM_Image * ppmImage);
 /*-----------------------------------*/
 int copy_PGM_to_PBM(struct PGM_Image * pgmImage, struct PBM_Image * pbmImage);
 
+/*------------------------------------------*/
+/* COPIES A PGM IMAGE TO A PACKED PBM IMAGE */
+/*------------------------------------------*/
+int copy_PGM_to_PBM_Packed(struct PGM_Image * pgmImage,
+                           struct PBM_Packed_Image * pbmImage);
+
+/*------------------------------------------*/
+/* COPIES A PPM IMAGE TO A PACKED PBM IMAGE */
+/*------------------------------------------*/
+int copy_PPM_to_PBM_Packed(struct PPM_Image * ppmImage,
+                           struct PBM_Packed_Image * pbmImage,
+                           enum Color color);
+
+/*------------------------------------------*/
+/* COPIES A PACKED PBM IMAGE TO A PGM IMAGE */
+/*------------------------------------------*/
+int copy_PBM_Packed_to_PGM(struct PBM_Packed_Image * pbmImage,
+                           struct PGM_Image * pgmImage);
+
+/*------------------------------------------*/
+/* COPIES A PACKED PBM IMAGE TO A PPM IMAGE */
+/*------------------------------------------*/
+int copy_PBM_Packed_to_PPM(struct PBM_Packed_Image * pbmImage,
+                           struct PPM_Image * ppmImage);
+
 /*-----------------------------------*/
 /* COPIES 3 PGM IMAGES TO A PPM IMAGE */
 /*-----------------------------------*/
@@ -0,0 +1,224 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <sched.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_dither.h"
+#include "libpnm_thread.h"
+
+// the room on either side of an error row for the shares that fall off it
+# define DITHER_PAD 1
+
+/*-----------------------------------------------*/
+/* AN IMAGE BEING DITHERED                       */
+/*-----------------------------------------------*/
+struct Dither_Job
+{ // the gray rows, their size, and the output rows (bytes or packed bits)
+  unsigned char * * gray; int width, height; unsigned char * * out;
+  bool packed;
+
+  // the way it is dithered, and the white value and threshold
+  enum Dither_Mode mode; int white, threshold;
+
+  // the ring of error rows, and the pixels each row has finished
+  int * errors; size_t errorStride; int * progress;
+};
+
+/*-----------------------------------------------*/
+/* THE ERRORS STILL TO BE ADDED TO A ROW         */
+/*-----------------------------------------------*/
+static int * get_Error_Row(struct Dither_Job * job, int row)
+{ return job->errors + (size_t)(row % DITHER_RING_ROWS) * job->errorStride +
+         DITHER_PAD;
+}
+
+/*-----------------------------------------------*/
+/* FLOYD-STEINBERG DITHERS THE PIXELS first TO   */
+/* last OF A ROW INTO pixels (carry is the error */
+/* passed right along the row)                   */
+/*-----------------------------------------------*/
+static void dither_Block_Floyd_Steinberg(struct Dither_Job * job, int row,
+                                         int first, int last,
+                                         unsigned char * pixels, int * carry)
+{ // the errors of this row and the next, and the gray row
+  int * errors = get_Error_Row(job, row);
+  int * below = get_Error_Row(job, row + 1);
+  const unsigned char * gray = job->gray[row];
+
+  // the value of a pixel, its error and the shares of it
+  int x, value, error, right, downLeft, down;
+
+  for(x = first; x < last; x++)
+  { value = gray[x] + errors[x] + *carry;
+
+    // the error row is ready for the row DITHER_RING_ROWS further down
+    errors[x] = 0;
+
+    *pixels = (unsigned char)(value < job->threshold);
+    error = *pixels++ ? value : value - job->white;
+
+    right = error * 7 / 16;
+    downLeft = error * 3 / 16;
+    down = error * 5 / 16;
+
+    *carry = right;
+    below[x - 1] += downLeft;
+    below[x] += down;
+    below[x + 1] += error - right - downLeft - down;
+  }
+}
+
+/*-----------------------------------------------*/
+/* ATKINSON DITHERS THE PIXELS first TO last OF  */
+/* A ROW INTO pixels (carry holds the errors     */
+/* passed one and two pixels right)              */
+/*-----------------------------------------------*/
+static void dither_Block_Atkinson(struct Dither_Job * job, int row,
+                                  int first, int last,
+                                  unsigned char * pixels, int * carry)
+{ // the errors of this row and the two below it, and the gray row
+  int * errors = get_Error_Row(job, row);
+  int * below = get_Error_Row(job, row + 1);
+  int * twoBelow = get_Error_Row(job, row + 2);
+  const unsigned char * gray = job->gray[row];
+
+  // the value of a pixel and each of the six shares of its error
+  int x, value, share;
+
+  for(x = first; x < last; x++)
+  { value = gray[x] + errors[x] + carry[0];
+    errors[x] = 0;
+
+    *pixels = (unsigned char)(value < job->threshold);
+    share = (*pixels++ ? value : value - job->white) / 8;
+
+    carry[0] = carry[1] + share;
+    carry[1] = share;
+    below[x - 1] += share;
+    below[x] += share;
+    below[x + 1] += share;
+    twoBelow[x] += share;
+  }
+}
+
+/*-----------------------------------------------*/
+/* DITHERS ONE ROW, BLOCK BY BLOCK BEHIND THE    */
+/* ROW ABOVE                                     */
+/*-----------------------------------------------*/
+static void dither_Row(void * context, int row)
+{ struct Dither_Job * job = (struct Dither_Job *)context;
+
+  // the block, the pixels the row above must have finished first
+  int first, last, needed;
+
+  // the errors passed along the row, and the pixels of a block
+  int carry[2] = {0, 0}; unsigned char block[DITHER_BLOCK], * pixels;
+
+  // the pads collect the shares that fall off the row and are never read;
+  // they are cleared once the row above is past them so they cannot grow
+  // without bound
+  int * errors = get_Error_Row(job, row);
+
+  for(first = 0; first < job->width; first = last)
+  { last = (first + DITHER_BLOCK < job->width) ? first + DITHER_BLOCK :
+                                                 job->width;
+
+    // the rows are handed out in order, so the row above is always being
+    // dithered by another thread (or is finished)
+    needed = (last + DITHER_LAG < job->width) ? last + DITHER_LAG :
+                                                job->width;
+    if(row > 0)
+      while(__atomic_load_n(&job->progress[row - 1], __ATOMIC_ACQUIRE) <
+            needed)
+        sched_yield();
+
+    if(first == 0) errors[- 1] = 0;
+    if(last == job->width) errors[job->width] = 0;
+
+    pixels = job->packed ? block : job->out[row] + first;
+    if(job->mode == DITHER_ATKINSON)
+      dither_Block_Atkinson(job, row, first, last, pixels, carry);
+    else
+      dither_Block_Floyd_Steinberg(job, row, first, last, pixels, carry);
+
+    if(job->packed) pack_PBM_Row(block, job->out[row] + first / 8,
+                                 last - first);
+
+    __atomic_store_n(&job->progress[row], last, __ATOMIC_RELEASE);
+  }
+}
+
+/*-----------------------------------------------*/
+/* DITHERS THE ROWS OF A GRAY IMAGE INTO THE     */
+/* ROWS OF A PBM IMAGE                           */
+/*-----------------------------------------------*/
+static int dither_Rows(struct PGM_Image * pgmImage, unsigned char * * out,
+                       bool packed, enum Dither_Mode mode)
+{ struct Dither_Job job;
+
+  job.gray = pgmImage->image;
+  job.width = pgmImage->width;
+  job.height = pgmImage->height;
+  job.out = out;
+  job.packed = packed;
+  job.mode = mode;
+  job.white = pgmImage->maxGrayValue;
+  job.threshold = pgmImage->maxGrayValue / 2;
+  job.errorStride = (size_t)job.width + 2 * DITHER_PAD;
+  job.errors = (int *)calloc(DITHER_RING_ROWS * job.errorStride, sizeof(int));
+  job.progress = (int *)calloc((size_t)job.height + 1, sizeof(int));
+
+  if(job.errors == NULL || job.progress == NULL)
+  { free(job.errors);
+    free(job.progress);
+    return - 1;
+  }
+
+  run_Parallel(job.height, dither_Row, &job);
+
+  free(job.errors);
+  free(job.progress);
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* DITHERS A PGM IMAGE INTO A NEW PBM IMAGE                      */
+/*---------------------------------------------------------------*/
+int dither_PGM_to_PBM(struct PGM_Image * pgmImage,
+                      struct PBM_Image * pbmImage, enum Dither_Mode mode)
+{ if(mode == DITHER_THRESHOLD) return copy_PGM_to_PBM(pgmImage, pbmImage);
+
+  if(create_PBM_Image(pbmImage, pgmImage->width, pgmImage->height) == -1)
+    return - 1;
+
+  if(dither_Rows(pgmImage, pbmImage->image, false, mode) != 0)
+  { free_PBM_Image(pbmImage);
+    return - 1;
+  }
+
+  // success
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* DITHERS A PGM IMAGE STRAIGHT INTO A NEW PACKED PBM IMAGE      */
+/*---------------------------------------------------------------*/
+int dither_PGM_to_PBM_Packed(struct PGM_Image * pgmImage,
+                             struct PBM_Packed_Image * pbmImage,
+                             enum Dither_Mode mode)
+{ if(mode == DITHER_THRESHOLD)
+    return copy_PGM_to_PBM_Packed(pgmImage, pbmImage);
+
+  if(create_PBM_Packed_Image(pbmImage, pgmImage->width,
+                             pgmImage->height) == -1)
+    return - 1;
+
+  if(dither_Rows(pgmImage, pbmImage->image, true, mode) != 0)
+  { free_PBM_Packed_Image(pbmImage);
+    return - 1;
+  }
+
+  // success
+  return 0;
+}
@@ -0,0 +1,60 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_DITHER_H_
+#define _PNM_DITHER_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* ERROR DIFFUSION DITHERING OF PGM IMAGES INTO PBM IMAGES            */
+/*                                                                    */
+/* A pixel is black when its gray value plus the error diffused into  */
+/* it is below maxGrayValue / 2 (the threshold of copy_PGM_to_PBM),   */
+/* and the difference from black (0) or white (maxGrayValue) is       */
+/* passed on to the pixels not yet visited:                           */
+/*                                                                    */
+/*   Floyd-Steinberg       x 7          Atkinson        x 1 1         */
+/*     (/16)           3 5 1              (/8)      1 1 1             */
+/*                                                    1               */
+/*                                                                    */
+/* (Atkinson diffuses only 6/8 of the error). The errors are integers */
+/* and the Floyd-Steinberg shares add up to the whole error, so the   */
+/* result does not depend on the thread count.                        */
+/*                                                                    */
+/* Rows are dithered on parallel threads as a wavefront: a row works  */
+/* through blocks of DITHER_BLOCK pixels and starts a block once the  */
+/* row above is DITHER_LAG pixels past its end, which is as far as    */
+/* the errors of the row above reach. The errors still to be added to */
+/* a row are kept in a ring of DITHER_RING_ROWS rows.                 */
+/*--------------------------------------------------------------------*/
+
+// the pixels a row dithers between checks on the row above (a multiple
+// of 8, so packed bytes are not shared), and how far ahead that row must be
+# define DITHER_BLOCK 64
+# define DITHER_LAG 2
+
+// the rows of error kept, the row being dithered and the two below it
+# define DITHER_RING_ROWS 3
+
+/*---------------------------------------------------------------*/
+/* THE WAYS A GRAY IMAGE IS TURNED BLACK AND WHITE               */
+/*---------------------------------------------------------------*/
+enum Dither_Mode {DITHER_THRESHOLD = 0, DITHER_FLOYD_STEINBERG,
+                  DITHER_ATKINSON};
+
+/*---------------------------------------------------------------*/
+/* DITHERS A PGM IMAGE INTO A NEW PBM IMAGE                      */
+/* (DITHER_THRESHOLD is the same as copy_PGM_to_PBM)             */
+/*---------------------------------------------------------------*/
+int dither_PGM_to_PBM(struct PGM_Image * pgmImage,
+                      struct PBM_Image * pbmImage, enum Dither_Mode mode);
+
+/*---------------------------------------------------------------*/
+/* DITHERS A PGM IMAGE STRAIGHT INTO A NEW PACKED PBM IMAGE      */
+/* (DITHER_THRESHOLD is the same as copy_PGM_to_PBM_Packed)      */
+/*---------------------------------------------------------------*/
+int dither_PGM_to_PBM_Packed(struct PGM_Image * pgmImage,
+                             struct PBM_Packed_Image * pbmImage,
+                             enum Dither_Mode mode);
+#endif /*_PNM_DITHER_H_*/
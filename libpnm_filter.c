@@ -0,0 +1,335 @@
+#include <string.h>
+#include <math.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_filter.h"
+#include "libpnm_thread.h"
+
+/*-----------------------------------------------*/
+/* AN IMAGE BEING FILTERED                       */
+/*-----------------------------------------------*/
+struct Filter_Job
+{ // the first sample of every row of the image and of the filtered image
+  unsigned char * * rows; unsigned char * * filteredRows;
+
+  // the size of the image, the samples per pixel and the max value
+  int width, height, channels, maxValue;
+
+  // the kernels and the border mode
+  struct PNM_Filter_Kernel * horizontal, * vertical; enum Border_Mode border;
+
+  // the tiles across and down
+  int tilesAcross, tilesDown;
+
+  // set by a tile that cannot get its scratch memory
+  int failed;
+};
+
+/*-----------------------------------------------*/
+/* TURNS KERNEL WEIGHTS INTO FIXED POINT, THE    */
+/* CENTRE TAKING THE ROUNDING ERROR OF THE SUM   */
+/*-----------------------------------------------*/
+static int quantize_Kernel(struct PNM_Filter_Kernel * kernel,
+                           const double * weights, int taps)
+{ // for loop variable, the fixed point weights and their sums
+  int k; long fixed[FILTER_MAX_TAPS], quantized = 0, gain = 0;
+  double sum = 0;
+
+  // one in fixed point
+  const double one = 1 << FILTER_WEIGHT_BITS;
+
+  if(taps < 1 || taps > FILTER_MAX_TAPS || taps % 2 == 0) return - 1;
+
+  for(k = 0; k < taps; k++)
+  { if(!(fabs(weights[k]) <= FILTER_MAX_GAIN)) return - 1;
+    fixed[k] = lround(weights[k] * one);
+    quantized += fixed[k];
+    sum += weights[k];
+  }
+  fixed[taps / 2] += lround(sum * one) - quantized;
+
+  // every weight must fit a short, and all of them the gain
+  for(k = 0; k < taps; k++)
+  { if(fixed[k] < -32768 || fixed[k] > 32767) return - 1;
+    gain += labs(fixed[k]);
+  }
+  if(gain > FILTER_MAX_GAIN * (1L << FILTER_WEIGHT_BITS)) return - 1;
+
+  for(k = 0; k < taps; k++) kernel->weights[k] = (short)fixed[k];
+  kernel->taps = taps;
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* MAKES A BOX KERNEL                                            */
+/*---------------------------------------------------------------*/
+int make_Box_Kernel(struct PNM_Filter_Kernel * kernel, int radius)
+{ // the weights, and for loop variable
+  double weights[FILTER_MAX_TAPS]; int k;
+
+  if(radius < 0 || 2 * radius + 1 > FILTER_MAX_TAPS) return - 1;
+
+  for(k = 0; k < 2 * radius + 1; k++) weights[k] = 1.0 / (2 * radius + 1);
+
+  return quantize_Kernel(kernel, weights, 2 * radius + 1);
+}
+
+/*---------------------------------------------------------------*/
+/* MAKES A GAUSSIAN KERNEL                                       */
+/*---------------------------------------------------------------*/
+int make_Gaussian_Kernel(struct PNM_Filter_Kernel * kernel, double sigma)
+{ // the weights, their sum, and for loop variable
+  double weights[FILTER_MAX_TAPS], sum = 0; int k;
+
+  // the taps reach 3 sigma either side
+  int radius;
+
+  if(!(sigma > 0) || 3 * sigma > FILTER_MAX_TAPS / 2) return - 1;
+  radius = (int)ceil(3 * sigma);
+
+  for(k = - radius; k <= radius; k++)
+  { weights[k + radius] = exp(- (double)k * k / (2 * sigma * sigma));
+    sum += weights[k + radius];
+  }
+  for(k = 0; k < 2 * radius + 1; k++) weights[k] /= sum;
+
+  return quantize_Kernel(kernel, weights, 2 * radius + 1);
+}
+
+/*---------------------------------------------------------------*/
+/* MAKES A KERNEL FROM ANY WEIGHTS                               */
+/*---------------------------------------------------------------*/
+int make_Custom_Kernel(struct PNM_Filter_Kernel * kernel,
+                       const double * weights, int taps)
+{ return quantize_Kernel(kernel, weights, taps);
+}
+
+/*-----------------------------------------------*/
+/* MAPS AN INDEX BEYOND AN EDGE TO THE ONE THE   */
+/* BORDER MODE TAKES ITS SAMPLE FROM (-1 FOR 0)  */
+/*-----------------------------------------------*/
+static int border_Index(int index, int count, enum Border_Mode border)
+{ // the length after which a mirrored index repeats
+  int period;
+
+  if(index >= 0 && index < count) return index;
+
+  switch(border)
+  { case BORDER_CLAMP:
+      return index < 0 ? 0 : count - 1;
+
+    case BORDER_WRAP:
+      index %= count;
+      return index < 0 ? index + count : index;
+
+    case BORDER_MIRROR:
+      if(count == 1) return 0;
+      period = 2 * (count - 1);
+      index %= period;
+      if(index < 0) index += period;
+      return index < count ? index : period - index;
+
+    default:
+      return - 1;
+  }
+}
+
+/*-----------------------------------------------*/
+/* COPIES samples SAMPLES OF A ROW FROM first,   */
+/* WITH margin SAMPLES OF BORDER EITHER SIDE     */
+/*-----------------------------------------------*/
+static void pad_Row(struct Filter_Job * job, const unsigned char * row,
+                    int first, int samples, int margin,
+                    unsigned char * padded)
+{ // the samples of the row, and the part of the padded row inside it
+  int rowSamples = job->width * job->channels;
+  int inFirst = (first - margin > 0) ? first - margin : 0;
+  int inLast = (first + samples + margin < rowSamples) ?
+               first + samples + margin : rowSamples;
+
+  // a sample beyond the edge, its pixel and channel, and loop variable
+  int sample, pixel, channel, i;
+
+  memcpy(padded + inFirst - (first - margin), row + inFirst,
+         inLast - inFirst);
+
+  for(i = 0; i < samples + 2 * margin; i++)
+  { sample = first - margin + i;
+    if(sample >= inFirst && sample < inLast) continue;
+
+    // pixels before the row have negative indices
+    pixel = (sample >= 0) ? sample / job->channels :
+            - ((- sample + job->channels - 1) / job->channels);
+    channel = sample - pixel * job->channels;
+    pixel = border_Index(pixel, job->width, job->border);
+    padded[i] = (pixel < 0) ? 0 : row[pixel * job->channels + channel];
+  }
+}
+
+/*-----------------------------------------------*/
+/* FILTERS ONE TILE, KEEPING THE ROWS OF THE     */
+/* FIRST PASS IN A RING AS TALL AS THE VERTICAL  */
+/* KERNEL                                        */
+/*-----------------------------------------------*/
+static void filter_Tile(void * context, int index)
+{ struct Filter_Job * job = (struct Filter_Job *)context;
+
+  // the rows and samples of the tile
+  int top = index / job->tilesAcross * FILTER_TILE_ROWS;
+  int bottom = (top + FILTER_TILE_ROWS < job->height) ?
+               top + FILTER_TILE_ROWS : job->height;
+  int first = index % job->tilesAcross * FILTER_TILE_SAMPLES;
+  int samples = (first + FILTER_TILE_SAMPLES < job->width * job->channels) ?
+                FILTER_TILE_SAMPLES : job->width * job->channels - first;
+
+  // the radii of the kernels, the left border in samples
+  int taps = job->vertical->taps, radius = taps / 2;
+  int margin = job->horizontal->taps / 2 * job->channels;
+
+  // a row of the image including those beyond the edges, the image row it
+  // is taken from, and for loop variable
+  int row, source, k;
+
+  // the scratch rows
+  unsigned char * padded = (unsigned char *)malloc(samples + 2 * margin);
+  short * ring = (short *)malloc((size_t)taps * samples * sizeof(short));
+  const short * window[FILTER_MAX_TAPS];
+
+  if(padded == NULL || ring == NULL)
+  { job->failed = 1;
+    free(padded);
+    free(ring);
+    return;
+  }
+
+  for(row = top - radius; row < bottom + radius; row++)
+  { // the first pass of the row goes into the ring
+    short * filtered = ring + (size_t)((row - top + radius) % taps) * samples;
+
+    source = border_Index(row, job->height, job->border);
+    if(source < 0) memset(filtered, 0, samples * sizeof(short));
+    else
+    { pad_Row(job, job->rows[source], first, samples, margin, padded);
+      filter_Row_Horizontal(padded, filtered, samples,
+                            job->horizontal->weights, job->horizontal->taps,
+                            job->channels);
+    }
+
+    // then the row radius above it has all the rows of its window
+    if(row - radius >= top)
+    { for(k = 0; k < taps; k++)
+        window[k] = ring + (size_t)((row - radius - top + k) % taps) * samples;
+
+      filter_Row_Vertical(window, job->filteredRows[row - radius] + first,
+                          samples, job->vertical->weights, taps,
+                          job->maxValue);
+    }
+  }
+
+  free(padded);
+  free(ring);
+}
+
+/*-----------------------------------------------*/
+/* FILTERS THE ROWS OF AN IMAGE, TILE BY TILE IN */
+/* PARALLEL                                      */
+/*-----------------------------------------------*/
+static int filter_Rows(struct Filter_Job * job)
+{ // the samples of a row
+  int rowSamples = job->width * job->channels;
+
+  if(job->horizontal->taps < 1 || job->horizontal->taps > FILTER_MAX_TAPS ||
+     job->horizontal->taps % 2 == 0 || job->vertical->taps < 1 ||
+     job->vertical->taps > FILTER_MAX_TAPS || job->vertical->taps % 2 == 0)
+    return - 1;
+
+  job->tilesAcross = (rowSamples + FILTER_TILE_SAMPLES - 1) /
+                     FILTER_TILE_SAMPLES;
+  job->tilesDown = (job->height + FILTER_TILE_ROWS - 1) / FILTER_TILE_ROWS;
+  job->failed = 0;
+
+  run_Parallel(job->tilesAcross * job->tilesDown, filter_Tile, job);
+
+  return job->failed ? - 1 : 0;
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS A PGM IMAGE INTO A NEW IMAGE                          */
+/*---------------------------------------------------------------*/
+int filter_PGM_Image(struct PGM_Image * pgmImage,
+                     struct PGM_Image * filteredImage,
+                     struct PNM_Filter_Kernel * horizontal,
+                     struct PNM_Filter_Kernel * vertical,
+                     enum Border_Mode border)
+{ struct Filter_Job job;
+
+  if(create_PGM_Image(filteredImage, pgmImage->width, pgmImage->height,
+                      pgmImage->maxGrayValue) == -1)
+    return - 1;
+
+  job.rows = pgmImage->image;
+  job.filteredRows = filteredImage->image;
+  job.width = pgmImage->width;
+  job.height = pgmImage->height;
+  job.channels = 1;
+  job.maxValue = filteredImage->maxGrayValue;
+  job.horizontal = horizontal;
+  job.vertical = vertical;
+  job.border = border;
+
+  if(filter_Rows(&job) != 0)
+  { free_PGM_Image(filteredImage);
+    return - 1;
+  }
+
+  // success
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS A PPM IMAGE INTO A NEW IMAGE                          */
+/*---------------------------------------------------------------*/
+int filter_PPM_Image(struct PPM_Image * ppmImage,
+                     struct PPM_Image * filteredImage,
+                     struct PNM_Filter_Kernel * horizontal,
+                     struct PNM_Filter_Kernel * vertical,
+                     enum Border_Mode border)
+{ struct Filter_Job job;
+
+  // for loop variable, and the result
+  int row, status = - 1;
+
+  if(create_PPM_Image(filteredImage, ppmImage->width, ppmImage->height,
+                      ppmImage->maxGrayValue) == -1)
+    return - 1;
+
+  // the RGB triples of each row follow each other
+  job.rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+  job.filteredRows = (unsigned char * *)calloc(ppmImage->height + 1,
+                                               sizeof(char *));
+
+  if(job.rows != NULL && job.filteredRows != NULL)
+  { for(row = 0; row < ppmImage->height; row++)
+    { job.rows[row] = ppmImage->image[row][0];
+      job.filteredRows[row] = filteredImage->image[row][0];
+    }
+
+    job.width = ppmImage->width;
+    job.height = ppmImage->height;
+    job.channels = 3;
+    job.maxValue = filteredImage->maxGrayValue;
+    job.horizontal = horizontal;
+    job.vertical = vertical;
+    job.border = border;
+
+    status = filter_Rows(&job);
+  }
+
+  free(job.rows);
+  free(job.filteredRows);
+
+  if(status != 0) free_PPM_Image(filteredImage);
+
+  return status;
+}
@@ -0,0 +1,80 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_FILTER_H_
+#define _PNM_FILTER_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* SEPARABLE FILTERS FOR PGM AND PPM IMAGES                           */
+/*                                                                    */
+/* An image is filtered along its rows with one kernel and down its   */
+/* columns with another (each channel of a PPM on its own). Kernels   */
+/* have an odd number of taps centred on the sample, with weights in  */
+/* 14 bit fixed point; the pass along the rows keeps 6 fractional     */
+/* bits for the pass down the columns, and both are SIMD kernels (see */
+/* filter_Row_Horizontal in libpnm_kernels.h). Samples beyond the     */
+/* edges are taken from the image as the border mode says:            */
+/*                                                                    */
+/*   BORDER_CLAMP   the edge sample repeats            aaa|abcd|ddd   */
+/*   BORDER_MIRROR  reflected about the edge sample    dcb|abcd|cba   */
+/*   BORDER_WRAP    the opposite edge continues        bcd|abcd|abc   */
+/*   BORDER_ZERO    0                                  000|abcd|000   */
+/*                                                                    */
+/* The image is cut into tiles of FILTER_TILE_ROWS rows by            */
+/* FILTER_TILE_SAMPLES samples which are filtered on parallel         */
+/* threads. A tile keeps only the last few rows of the first pass, in */
+/* a ring as tall as the vertical kernel, so the intermediate image   */
+/* never exists as a whole.                                           */
+/*--------------------------------------------------------------------*/
+
+// the most taps of a kernel (a radius of 31), and the largest sum of the
+// absolute weights (so the fixed point sums cannot overflow)
+# define FILTER_MAX_TAPS 63
+# define FILTER_MAX_GAIN 3
+
+// the tiles filtered by one thread (the width is a multiple of 3 so a
+// tile of a PPM holds whole pixels)
+# define FILTER_TILE_ROWS 64
+# define FILTER_TILE_SAMPLES 1536
+
+/*---------------------------------------------------------------*/
+/* WHERE THE SAMPLES BEYOND THE EDGES COME FROM                  */
+/*---------------------------------------------------------------*/
+enum Border_Mode {BORDER_CLAMP = 0, BORDER_MIRROR, BORDER_WRAP, BORDER_ZERO};
+
+/*---------------------------------------------------------------*/
+/* A ONE DIMENSIONAL KERNEL                                      */
+/*---------------------------------------------------------------*/
+struct PNM_Filter_Kernel
+{ // the number of taps (odd), and their weights in 14 bit fixed point
+  int taps; short weights[FILTER_MAX_TAPS];
+};
+
+/*---------------------------------------------------------------*/
+/* MAKES A KERNEL (returns -1 if it would be too large)          */
+/*                                                               */
+/* a box of 2 radius + 1 equal taps, a Gaussian of 2 ceil(3      */
+/* sigma) + 1 taps, or any odd number of weights (not normalized,*/
+/* the fixed point weights add up to the rounded sum of weights) */
+/*---------------------------------------------------------------*/
+int make_Box_Kernel(struct PNM_Filter_Kernel * kernel, int radius);
+int make_Gaussian_Kernel(struct PNM_Filter_Kernel * kernel, double sigma);
+int make_Custom_Kernel(struct PNM_Filter_Kernel * kernel,
+                       const double * weights, int taps);
+
+/*---------------------------------------------------------------*/
+/* FILTERS AN IMAGE INTO A NEW IMAGE OF THE SAME SIZE            */
+/*---------------------------------------------------------------*/
+int filter_PGM_Image(struct PGM_Image * pgmImage,
+                     struct PGM_Image * filteredImage,
+                     struct PNM_Filter_Kernel * horizontal,
+                     struct PNM_Filter_Kernel * vertical,
+                     enum Border_Mode border);
+int filter_PPM_Image(struct PPM_Image * ppmImage,
+                     struct PPM_Image * filteredImage,
+                     struct PNM_Filter_Kernel * horizontal,
+                     struct PNM_Filter_Kernel * vertical,
+                     enum Border_Mode border);
+#endif /*_PNM_FILTER_H_*/
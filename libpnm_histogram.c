@@ -0,0 +1,254 @@
+#include <string.h>
+#include "libpnm.h"
+#include "libpnm_histogram.h"
+#include "libpnm_thread.h"
+
+/*-----------------------------------------------*/
+/* AN IMAGE HAVING ITS HISTOGRAM COUNTED         */
+/*-----------------------------------------------*/
+struct Histogram_Job
+{ // the rows of a PGM, or else of a PPM, and their samples
+  unsigned char * * grayRows; unsigned char * * * colourRows;
+  int height; size_t rowSamples;
+
+  // the stripes of rows, each counted into its own histogram
+  int stripes; struct PNM_Histogram * parts;
+};
+
+/*-----------------------------------------------*/
+/* ADDS THE BANKS INTO THE COUNTS AND EMPTIES    */
+/* THEM                                          */
+/*-----------------------------------------------*/
+static void flush_Banks(struct PNM_Histogram * histogram)
+{ // for loop variables
+  int bank, channel, value;
+
+  for(bank = 0; bank < HISTOGRAM_BANKS; bank++)
+    for(channel = 0; channel < histogram->channels; channel++)
+      for(value = 0; value < 256; value++)
+        histogram->counts[channel][value] +=
+          histogram->banks[bank][channel][value];
+
+  memset(histogram->banks, 0, sizeof(histogram->banks));
+  histogram->pending = 0;
+}
+
+/*-----------------------------------------------*/
+/* COUNTS GRAY SAMPLES, EACH OF FOUR IN A ROW    */
+/* INTO ITS OWN BANK                             */
+/*-----------------------------------------------*/
+static void count_Gray(unsigned int banks[][3][256],
+                       const unsigned char * samples, size_t count)
+{ // for loop variable
+  size_t i = 0;
+
+  for(; i + HISTOGRAM_BANKS <= count; i += HISTOGRAM_BANKS)
+  { banks[0][0][samples[i]]++;
+    banks[1][0][samples[i + 1]]++;
+    banks[2][0][samples[i + 2]]++;
+    banks[3][0][samples[i + 3]]++;
+  }
+
+  for(; i < count; i++) banks[0][0][samples[i]]++;
+}
+
+/*-----------------------------------------------*/
+/* COUNTS RGB SAMPLES, THE CHANNELS OF EACH OF   */
+/* FOUR PIXELS IN A ROW INTO ITS OWN BANK        */
+/*-----------------------------------------------*/
+static void count_Colour(unsigned int banks[][3][256],
+                         const unsigned char * samples, size_t count,
+                         int channel)
+{ // for loop variable
+  size_t i = 0;
+
+  // the samples before the first whole pixel
+  for(; i < count && channel != RED; i++, channel = (channel + 1) % 3)
+    banks[0][channel][samples[i]]++;
+
+  for(; i + 3 * HISTOGRAM_BANKS <= count; i += 3 * HISTOGRAM_BANKS)
+  { banks[0][RED][samples[i]]++;
+    banks[0][GREEN][samples[i + 1]]++;
+    banks[0][BLUE][samples[i + 2]]++;
+    banks[1][RED][samples[i + 3]]++;
+    banks[1][GREEN][samples[i + 4]]++;
+    banks[1][BLUE][samples[i + 5]]++;
+    banks[2][RED][samples[i + 6]]++;
+    banks[2][GREEN][samples[i + 7]]++;
+    banks[2][BLUE][samples[i + 8]]++;
+    banks[3][RED][samples[i + 9]]++;
+    banks[3][GREEN][samples[i + 10]]++;
+    banks[3][BLUE][samples[i + 11]]++;
+  }
+
+  for(channel = RED; i < count; i++, channel = (channel + 1) % 3)
+    banks[0][channel][samples[i]]++;
+}
+
+/*---------------------------------------------------------------*/
+/* EMPTIES A HISTOGRAM OF channels CHANNELS                      */
+/*---------------------------------------------------------------*/
+void clear_PNM_Histogram(struct PNM_Histogram * histogram, int channels)
+{ memset(histogram, 0, sizeof(struct PNM_Histogram));
+  histogram->channels = channels;
+}
+
+/*---------------------------------------------------------------*/
+/* COUNTS A RUN OF INTERLEAVED SAMPLES                           */
+/*---------------------------------------------------------------*/
+void count_PNM_Histogram_Samples(struct PNM_Histogram * histogram,
+                                 const unsigned char * samples,
+                                 size_t count, int channel)
+{ // the samples counted before the banks are flushed
+  size_t piece;
+
+  while(count > 0)
+  { piece = HISTOGRAM_FLUSH_SAMPLES - histogram->pending;
+    if(piece > count) piece = count;
+
+    if(histogram->channels == 1) count_Gray(histogram->banks, samples, piece);
+    else
+    { count_Colour(histogram->banks, samples, piece, channel);
+      channel = (channel + piece) % 3;
+    }
+
+    histogram->pending += piece;
+    samples += piece;
+    count -= piece;
+
+    if(histogram->pending == HISTOGRAM_FLUSH_SAMPLES) flush_Banks(histogram);
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS THE COUNTS OF part (WHICH IS FLUSHED) TO A HISTOGRAM     */
+/*---------------------------------------------------------------*/
+void merge_PNM_Histograms(struct PNM_Histogram * histogram,
+                          struct PNM_Histogram * part)
+{ // for loop variables
+  int channel, value;
+
+  flush_Banks(part);
+
+  for(channel = 0; channel < histogram->channels; channel++)
+    for(value = 0; value < 256; value++)
+      histogram->counts[channel][value] += part->counts[channel][value];
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS UP THE BANKS AND SETS THE STATISTICS OF EACH CHANNEL     */
+/*---------------------------------------------------------------*/
+void finish_PNM_Histogram(struct PNM_Histogram * histogram)
+{ // for loop variables
+  int channel, value;
+
+  // the sums of the samples and of their squares
+  unsigned long long sum, squares; double mean;
+
+  flush_Banks(histogram);
+
+  histogram->samples = 0;
+  for(value = 0; value < 256; value++)
+    histogram->samples += histogram->counts[0][value];
+
+  for(channel = 0; channel < histogram->channels; channel++)
+  { histogram->min[channel] = histogram->max[channel] = 0;
+    histogram->mean[channel] = histogram->variance[channel] = 0;
+    if(histogram->samples == 0) continue;
+
+    sum = squares = 0;
+    for(value = 0; value < 256; value++)
+    { sum += histogram->counts[channel][value] * value;
+      squares += histogram->counts[channel][value] * value * value;
+    }
+
+    for(value = 0; histogram->counts[channel][value] == 0; value++);
+    histogram->min[channel] = value;
+    for(value = 255; histogram->counts[channel][value] == 0; value--);
+    histogram->max[channel] = value;
+
+    mean = (double)sum / histogram->samples;
+    histogram->mean[channel] = mean;
+    histogram->variance[channel] =
+      (double)squares / histogram->samples - mean * mean;
+  }
+}
+
+/*-----------------------------------------------*/
+/* COUNTS ONE STRIPE OF ROWS INTO ITS HISTOGRAM  */
+/*-----------------------------------------------*/
+static void count_Stripe(void * context, int index)
+{ struct Histogram_Job * job = (struct Histogram_Job *)context;
+
+  // the rows of the stripe
+  int row = (int)((long long)job->height * index / job->stripes);
+  int last = (int)((long long)job->height * (index + 1) / job->stripes);
+
+  for(; row < last; row++)
+    count_PNM_Histogram_Samples(&job->parts[index], job->grayRows != NULL ?
+                                job->grayRows[row] : job->colourRows[row][0],
+                                job->rowSamples, 0);
+}
+
+/*-----------------------------------------------*/
+/* COUNTS THE STRIPES OF AN IMAGE IN PARALLEL    */
+/* AND MERGES THEM                               */
+/*-----------------------------------------------*/
+static int compute_Histogram(struct Histogram_Job * job, int channels,
+                             struct PNM_Histogram * histogram)
+{ // for loop variable
+  int stripe;
+
+  // a stripe per thread, of at least a row
+  job->stripes = get_Thread_Count();
+  if(job->stripes > job->height) job->stripes = job->height;
+  if(job->stripes < 1) job->stripes = 1;
+
+  job->parts = (struct PNM_Histogram *)
+               malloc(job->stripes * sizeof(struct PNM_Histogram));
+  if(job->parts == NULL) return - 1;
+
+  for(stripe = 0; stripe < job->stripes; stripe++)
+    clear_PNM_Histogram(&job->parts[stripe], channels);
+
+  run_Parallel(job->stripes, count_Stripe, job);
+
+  clear_PNM_Histogram(histogram, channels);
+  for(stripe = 0; stripe < job->stripes; stripe++)
+    merge_PNM_Histograms(histogram, &job->parts[stripe]);
+  finish_PNM_Histogram(histogram);
+
+  free(job->parts);
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* COMPUTES THE HISTOGRAM AND STATISTICS OF A PGM IMAGE          */
+/*---------------------------------------------------------------*/
+int compute_PGM_Histogram(struct PGM_Image * pgmImage,
+                          struct PNM_Histogram * histogram)
+{ struct Histogram_Job job;
+
+  job.grayRows = pgmImage->image;
+  job.colourRows = NULL;
+  job.height = pgmImage->height;
+  job.rowSamples = (size_t)pgmImage->width;
+
+  return compute_Histogram(&job, 1, histogram);
+}
+
+/*---------------------------------------------------------------*/
+/* COMPUTES THE HISTOGRAM AND STATISTICS OF A PPM IMAGE          */
+/*---------------------------------------------------------------*/
+int compute_PPM_Histogram(struct PPM_Image * ppmImage,
+                          struct PNM_Histogram * histogram)
+{ struct Histogram_Job job;
+
+  job.grayRows = NULL;
+  job.colourRows = ppmImage->image;
+  job.height = ppmImage->height;
+  job.rowSamples = (size_t)ppmImage->width * 3;
+
+  return compute_Histogram(&job, 3, histogram);
+}
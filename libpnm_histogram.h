@@ -0,0 +1,83 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_HISTOGRAM_H_
+#define _PNM_HISTOGRAM_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* HISTOGRAMS AND SAMPLE STATISTICS OF PGM AND PPM IMAGES             */
+/*                                                                    */
+/* One pass over the samples counts a 256 bin histogram per channel   */
+/* (gray, or RED, GREEN and BLUE); the min, max, mean and variance    */
+/* are then read off the histogram rather than from the samples.      */
+/*                                                                    */
+/* Consecutive samples are counted into HISTOGRAM_BANKS separate      */
+/* banks of 32 bit counters, so a run of equal samples does not make  */
+/* every increment wait for the store of the one before; the banks    */
+/* are added into the 64 bit counts when the histogram is finished    */
+/* (or before a bank could overflow). compute_PGM/PPM_Histogram give  */
+/* every thread its own histogram over a stripe of rows and merge     */
+/* them at the end. The load_*_With_Histogram loaders count each row  */
+/* as it is decoded, so the statistics cost no second pass over the   */
+/* image.                                                             */
+/*--------------------------------------------------------------------*/
+
+// the counter banks used in turn by consecutive samples (or pixels)
+# define HISTOGRAM_BANKS 4
+
+// the samples counted into the banks before they are added up
+# define HISTOGRAM_FLUSH_SAMPLES (1u << 30)
+
+/*---------------------------------------------------------------*/
+/* THE HISTOGRAM AND STATISTICS OF AN IMAGE                      */
+/*---------------------------------------------------------------*/
+struct PNM_Histogram
+{ // the channels counted, 1 for PGM or 3 for PPM (RED, GREEN, BLUE)
+  int channels;
+
+  // the samples of each value in each channel, and the samples per channel
+  unsigned long long counts[3][256]; unsigned long long samples;
+
+  // per channel, set by finish_PNM_Histogram (all 0 for an empty image)
+  int min[3], max[3]; double mean[3], variance[3];
+
+  // the banked counters not yet added to counts, and the samples in them
+  unsigned int banks[HISTOGRAM_BANKS][3][256]; unsigned int pending;
+};
+
+/*---------------------------------------------------------------*/
+/* COMPUTES THE HISTOGRAM AND STATISTICS OF AN IMAGE             */
+/* (the stripes of rows are counted in parallel)                 */
+/*---------------------------------------------------------------*/
+int compute_PGM_Histogram(struct PGM_Image * pgmImage,
+                          struct PNM_Histogram * histogram);
+int compute_PPM_Histogram(struct PPM_Image * ppmImage,
+                          struct PNM_Histogram * histogram);
+
+/*---------------------------------------------------------------*/
+/* THE 'CONSTRUCTORS' WHICH LOAD AN IMAGE AND COMPUTE ITS        */
+/* HISTOGRAM WHILE DECODING IT (defined in libpnm.c)             */
+/*---------------------------------------------------------------*/
+int load_PGM_Image_With_Histogram(struct PGM_Image * pgmImage,
+                                  char * fileName,
+                                  struct PNM_Histogram * histogram);
+int load_PPM_Image_With_Histogram(struct PPM_Image * ppmImage,
+                                  char * fileName,
+                                  struct PNM_Histogram * histogram);
+
+/*---------------------------------------------------------------*/
+/* BUILDING A HISTOGRAM PIECE BY PIECE: clear it, count runs of  */
+/* interleaved samples (channel is that of the first sample),    */
+/* merge histograms counted separately, then finish it to add up */
+/* the banks and set the statistics                              */
+/*---------------------------------------------------------------*/
+void clear_PNM_Histogram(struct PNM_Histogram * histogram, int channels);
+void count_PNM_Histogram_Samples(struct PNM_Histogram * histogram,
+                                 const unsigned char * samples,
+                                 size_t count, int channel);
+void merge_PNM_Histograms(struct PNM_Histogram * histogram,
+                          struct PNM_Histogram * part);
+void finish_PNM_Histogram(struct PNM_Histogram * histogram);
+#endif /*_PNM_HISTOGRAM_H_*/
@@ -0,0 +1,163 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "libpnm.h"
+#include "libpnm_ingest.h"
+#include "libpnm_thread.h"
+
+/*-----------------------------------------------*/
+/* A LIST OF FILES BEING LOADED                  */
+/*-----------------------------------------------*/
+struct Ingest_Job
+{ // the files, and whether the images are handed over in their order
+  char * * fileNames; int count; bool ordered;
+
+  // the callback and its argument
+  void (*callback)(void * context, struct PNM_Ingested_Image * image);
+  void * context;
+
+  // the images loaded but not yet handed over in order, and whether each
+  // is loaded (NULL unless ordered)
+  struct PNM_Ingested_Image * images; bool * loaded;
+
+  // the first image not yet handed over in order, and the files that
+  // could not be loaded
+  int delivered, failed;
+
+  // guards the above and the callback, and signals delivered moving on
+  pthread_mutex_t lock; pthread_cond_t moved;
+};
+
+/*-----------------------------------------------*/
+/* ASKS THE KERNEL TO START READING A FILE INTO  */
+/* THE PAGE CACHE (the reads go on once the file */
+/* is closed)                                    */
+/*-----------------------------------------------*/
+static void read_Ahead(char * fileName)
+{ int fd = open(fileName, O_RDONLY);
+
+  if(fd < 0) return;
+
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  close(fd);
+}
+
+/*-----------------------------------------------*/
+/* LOADS A FILE OF WHICHEVER FORMAT IT HOLDS     */
+/*-----------------------------------------------*/
+static int load_Image(struct PNM_Ingested_Image * image)
+{ // the file, and the magic number
+  FILE * imageFilePointer = fileOpener(READ, image->fileName);
+  int magic;
+
+  if(imageFilePointer == NULL) return - 1;
+
+  magic = (fgetc(imageFilePointer) == 'P') ? fgetc(imageFilePointer) : EOF;
+  fclose(imageFilePointer);
+
+  // P1 to P3 are ASCII, P4 to P6 the same formats raw
+  if(magic < '1' || magic > '6') return - 1;
+  image->format = (enum Format)(PBM + (magic - '1') % 3);
+
+  if(image->format == PBM)
+    return load_PBM_Image(&image->pbmImage, image->fileName);
+  if(image->format == PGM)
+    return load_PGM_Image(&image->pgmImage, image->fileName);
+
+  return load_PPM_Image(&image->ppmImage, image->fileName);
+}
+
+/*-----------------------------------------------*/
+/* LOADS ONE FILE OF THE LIST AND HANDS IT OVER  */
+/* (files are taken in the order of the list)    */
+/*-----------------------------------------------*/
+static void ingest_File(void * context, int index)
+{ struct Ingest_Job * job = (struct Ingest_Job *)context;
+  struct PNM_Ingested_Image image;
+
+  // keep the disk reading ahead of the workers
+  if(index + INGEST_READAHEAD_FILES < job->count)
+    read_Ahead(job->fileNames[index + INGEST_READAHEAD_FILES]);
+
+  // in order, wait while too many images are held
+  if(job->ordered)
+  { pthread_mutex_lock(&job->lock);
+    while(index >= job->delivered + INGEST_WINDOW_FILES)
+      pthread_cond_wait(&job->moved, &job->lock);
+    pthread_mutex_unlock(&job->lock);
+  }
+
+  memset(&image, 0, sizeof(struct PNM_Ingested_Image));
+  image.fileName = job->fileNames[index];
+  image.index = index;
+  image.status = (load_Image(&image) == 0) ? 0 : - 1;
+
+  pthread_mutex_lock(&job->lock);
+  if(image.status != 0) job->failed++;
+
+  if(!job->ordered) job->callback(job->context, &image);
+  else
+  { // hand over every image from the first not yet handed over that is
+    // now loaded
+    job->images[index] = image;
+    job->loaded[index] = true;
+    while(job->delivered < job->count && job->loaded[job->delivered])
+      job->callback(job->context, &job->images[job->delivered++]);
+    pthread_cond_broadcast(&job->moved);
+  }
+
+  pthread_mutex_unlock(&job->lock);
+}
+
+/*---------------------------------------------------------------*/
+/* LOADS A LIST OF FILES                                         */
+/*---------------------------------------------------------------*/
+int ingest_PNM_Files(char * * fileNames, int count, bool ordered,
+                     void (*callback)(void * context,
+                                      struct PNM_Ingested_Image * image),
+                     void * context)
+{ struct Ingest_Job job;
+
+  // for loop variable
+  int index;
+
+  if(count < 0 || callback == NULL) return - 1;
+
+  job.fileNames = fileNames;
+  job.count = count;
+  job.ordered = ordered;
+  job.callback = callback;
+  job.context = context;
+  job.images = NULL;
+  job.loaded = NULL;
+  job.delivered = job.failed = 0;
+
+  if(ordered)
+  { job.images = (struct PNM_Ingested_Image *)
+                 calloc(count + 1, sizeof(struct PNM_Ingested_Image));
+    job.loaded = (bool *)calloc(count + 1, sizeof(bool));
+    if(job.images == NULL || job.loaded == NULL)
+    { free(job.images);
+      free(job.loaded);
+      return - 1;
+    }
+  }
+
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.moved, NULL);
+
+  // the first files are read ahead before any worker starts
+  for(index = 0; index < count && index < INGEST_READAHEAD_FILES; index++)
+    read_Ahead(fileNames[index]);
+
+  run_Parallel(count, ingest_File, &job);
+
+  pthread_mutex_destroy(&job.lock);
+  pthread_cond_destroy(&job.moved);
+  free(job.images);
+  free(job.loaded);
+
+  return job.failed;
+}
@@ -0,0 +1,58 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_INGEST_H_
+#define _PNM_INGEST_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* LOADING MANY IMAGE FILES AT ONCE                                   */
+/*                                                                    */
+/* A list of PBM, PGM or PPM files is loaded by one worker per CPU    */
+/* (see libpnm_thread.h), each taking the next file of the list. As   */
+/* a worker takes a file it asks the kernel, with posix_fadvise, to   */
+/* start reading the file INGEST_READAHEAD_FILES further on, so the   */
+/* disk is kept busy ahead of the decoding and the files are in the   */
+/* page cache by the time they are loaded.                            */
+/*                                                                    */
+/* Every image is handed to a callback once it is loaded, either as   */
+/* soon as it is (any order) or in the order of the list. In order,   */
+/* workers do not get more than INGEST_WINDOW_FILES ahead of the      */
+/* first image not yet handed over, which bounds the images held.     */
+/* The callback is called on the worker threads, one call at a time. */
+/*--------------------------------------------------------------------*/
+
+// the files read ahead of the one being taken, and the most taken past
+// the first not yet handed over in order
+# define INGEST_READAHEAD_FILES 8
+# define INGEST_WINDOW_FILES 64
+
+/*-----------------------------------------------------------------*/
+/* AN IMAGE LOADED FROM THE LIST                                    */
+/*-----------------------------------------------------------------*/
+struct PNM_Ingested_Image
+{ // the file, and its position in the list
+  char * fileName; int index;
+
+  // 0 once loaded, -1 if the file could not be
+  int status;
+
+  // the format of the file, and the image of that format
+  enum Format format;
+  struct PBM_Image pbmImage; struct PGM_Image pgmImage;
+  struct PPM_Image ppmImage;
+};
+
+/*---------------------------------------------------------------*/
+/* LOADS count FILES, HANDING EACH IMAGE TO                      */
+/* callback(context, image), IN THE ORDER OF THE LIST IF ordered */
+/* (the callback takes over a loaded image and frees it once     */
+/* done with; returns the files that could not be loaded, or -1  */
+/* if the loading could not start)                               */
+/*---------------------------------------------------------------*/
+int ingest_PNM_Files(char * * fileNames, int count, bool ordered,
+                     void (*callback)(void * context,
+                                      struct PNM_Ingested_Image * image),
+                     void * context);
+#endif /*_PNM_INGEST_H_*/
@@ -0,0 +1,420 @@
+#include <string.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+
+/*---------------------------------------------------------------*/
+/* PACKS A ROW OF 0/1 PIXELS INTO MSB FIRST BITS FOR A RAW PBM   */
+/*---------------------------------------------------------------*/
+void pack_PBM_Row_Scalar(const unsigned char * row, unsigned char * packed,
+                         int width)
+{ // for loop variables
+  int col = 0, bitCount;
+
+  // the byte being built from the trailing pixels
+  unsigned char c;
+
+  /*---------------------------*/
+  /* 8 PIXELS PER ITERATION    */
+  /*---------------------------*/
+  for(; col + 8 <= width; col += 8)
+    *packed++ = (unsigned char)
+                ( ((row[col]     == 1) << 7) | ((row[col + 1] == 1) << 6)
+                | ((row[col + 2] == 1) << 5) | ((row[col + 3] == 1) << 4)
+                | ((row[col + 4] == 1) << 3) | ((row[col + 5] == 1) << 2)
+                | ((row[col + 6] == 1) << 1) |  (row[col + 7] == 1));
+
+  // send the last few bits, zero padded
+  if(col < width)
+  { c = 0;
+    for(bitCount = 0; col < width; col++, bitCount++)
+      if(row[col] == 1) c |= (unsigned char)(1 << (7 - bitCount));
+    *packed = c;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* UNPACKS MSB FIRST BITS OF A RAW PBM ROW INTO 0/1 PIXELS       */
+/*---------------------------------------------------------------*/
+void unpack_PBM_Row_Scalar(const unsigned char * packed, unsigned char * row,
+                           int width)
+{ // for loop variables
+  int col = 0, bitCount;
+
+  /*---------------------------*/
+  /* 1 BYTE PER ITERATION      */
+  /*---------------------------*/
+  for(; col + 8 <= width; col += 8, packed++)
+    for(bitCount = 0; bitCount < 8; bitCount++)
+      row[col + bitCount] = (*packed >> (7 - bitCount)) & 1;
+
+  // the last few bits of the row
+  for(bitCount = 0; col < width; col++, bitCount++)
+    row[col] = (*packed >> (7 - bitCount)) & 1;
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS EVERY stride-TH SAMPLE OF src INTO A ROW OF PIXELS */
+/*---------------------------------------------------------------*/
+void threshold_Row_Scalar(const unsigned char * src, int stride,
+                          unsigned char * row, int width, int threshold)
+{ // for loop variable
+  int col;
+
+  // BLACK is 1 so the comparison is the pixel
+  for(col = 0; col < width; col++)
+    row[col] = (unsigned char)(src[(size_t)col * stride] < threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS EVERY stride-TH SAMPLE OF src STRAIGHT INTO THE    */
+/* PACKED BITS OF A RAW PBM ROW                                  */
+/*---------------------------------------------------------------*/
+void threshold_Row_Packed_Scalar(const unsigned char * src, int stride,
+                                 unsigned char * packed, int width, 
+                                 int threshold)
+{ // for loop variables
+  int col = 0, bitCount;
+
+  // the byte being built
+  unsigned char c;
+
+  /*---------------------------*/
+  /* 8 PIXELS PER ITERATION    */
+  /*---------------------------*/
+  for(; col + 8 <= width; col += 8)
+  { c = 0;
+    for(bitCount = 0; bitCount < 8; bitCount++)
+      c |= (unsigned char)
+           ((src[(size_t)(col + bitCount) * stride] < threshold) 
+            << (7 - bitCount));
+    *packed++ = c;
+  }
+
+  // send the last few bits, zero padded
+  if(col < width)
+  { c = 0;
+    for(bitCount = 0; col < width; col++, bitCount++)
+      c |= (unsigned char)
+           ((src[(size_t)col * stride] < threshold) << (7 - bitCount));
+    *packed = c;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS A ROW OF PBM PIXELS INTO channels SAMPLES PER PIXEL   */
+/*---------------------------------------------------------------*/
+void expand_PBM_Row_Scalar(const unsigned char * row, unsigned char * dst,
+                           int channels, int width)
+{ // for loop variables
+  int col, channel;
+
+  // the sample for the current pixel
+  unsigned char sample;
+
+  // 0 - 1 is 255 without a branch
+  for(col = 0; col < width; col++)
+  { sample = (unsigned char)(0 - (row[col] == WHITE));
+    for(channel = 0; channel < channels; channel++)
+      dst[(size_t)col * channels + channel] = sample;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS THE PACKED BITS OF A RAW PBM ROW INTO channels        */
+/* SAMPLES PER PIXEL                                             */
+/*---------------------------------------------------------------*/
+void expand_Packed_Row_Scalar(const unsigned char * packed, 
+                              unsigned char * dst, int channels, int width)
+{ // for loop variables
+  int col, channel;
+
+  // the sample for the current pixel
+  unsigned char sample;
+
+  // a clear bit minus 1 is 255 without a branch
+  for(col = 0; col < width; col++)
+  { sample = (unsigned char)(((packed[col >> 3] >> (7 - (col & 7))) & 1) - 1);
+    for(channel = 0; channel < channels; channel++)
+      dst[(size_t)col * channels + channel] = sample;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS THE SQUARED DIFFERENCES OF TWO ROWS OF SAMPLES AND       */
+/* RAISES THE LARGEST DIFFERENCE                                 */
+/*---------------------------------------------------------------*/
+void error_Row_Scalar(const unsigned char * a, const unsigned char * b,
+                      int width, unsigned long long * squares, 
+                      int * maxError)
+{ // for loop variable
+  int col;
+
+  // the difference of a sample, and the sum for the row
+  int difference; unsigned long long sum = 0;
+
+  for(col = 0; col < width; col++)
+  { difference = a[col] > b[col] ? a[col] - b[col] : b[col] - a[col];
+    sum += (unsigned int)(difference * difference);
+    if(difference > *maxError) *maxError = difference;
+  }
+
+  *squares += sum;
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS a, b, a*a, b*b AND a*b OF EVERY COLUMN TO THE SUMS       */
+/*---------------------------------------------------------------*/
+void accumulate_SSIM_Row_Scalar(const unsigned char * a, 
+                                const unsigned char * b, int width, 
+                                unsigned int * sums)
+{ // for loop variable
+  int col;
+
+  for(col = 0; col < width; col++)
+  { sums[col]             += a[col];
+    sums[width + col]     += b[col];
+    sums[2 * width + col] += a[col] * a[col];
+    sums[3 * width + col] += b[col] * b[col];
+    sums[4 * width + col] += a[col] * b[col];
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS samples SAMPLES ALONG A ROW INTO Q6                   */
+/*---------------------------------------------------------------*/
+void filter_Row_Horizontal_Scalar(const unsigned char * src, short * dst,
+                                  int samples, const short * weights,
+                                  int taps, int step)
+{ // for loop variables
+  int x, k;
+
+  // the Q14 sum of a sample
+  int sum;
+
+  for(x = 0; x < samples; x++)
+  { sum = 0;
+    for(k = 0; k < taps; k++)
+      sum += src[x + k * step] * weights[k];
+
+    // round to Q6 (the shift is arithmetic, as in the SIMD kernels)
+    sum = (sum + (1 << (FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS - 1))) >>
+          (FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS);
+    dst[x] = (short)(sum < -32768 ? -32768 : (sum > 32767 ? 32767 : sum));
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS DOWN taps ROWS OF Q6 SAMPLES                          */
+/*---------------------------------------------------------------*/
+void filter_Row_Vertical_Scalar(const short * const * rows,
+                                unsigned char * dst, int samples,
+                                const short * weights, int taps,
+                                int maxValue)
+{ // for loop variables
+  int x, k;
+
+  // the Q20 sum of a sample
+  int sum;
+
+  for(x = 0; x < samples; x++)
+  { sum = 0;
+    for(k = 0; k < taps; k++)
+      sum += rows[k][x] * weights[k];
+
+    sum = (sum + (1 << (FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS - 1))) >>
+          (FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS);
+    if(sum < 0) sum = 0;
+    if(sum > 255) sum = 255;
+    dst[x] = (unsigned char)(sum > maxValue ? maxValue : sum);
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* HALVES TWO ROWS INTO ONE                                      */
+/*---------------------------------------------------------------*/
+void downscale_Row_2x_Scalar(const unsigned char * top,
+                             const unsigned char * bottom,
+                             unsigned char * dst, int width, int channels)
+{ // for loop variables
+  int x, c;
+
+  // the first sample of the left pixel of a 2x2
+  size_t i;
+
+  for(x = 0; x < width; x++)
+    for(c = 0; c < channels; c++)
+    { i = (size_t)2 * x * channels + c;
+      dst[(size_t)x * channels + c] =
+        (unsigned char)((top[i] + top[i + channels] + bottom[i] +
+                         bottom[i + channels] + 2) >> 2);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+/* RUNTIME DISPATCH                                                   */
+/*--------------------------------------------------------------------*/
+
+// the dispatch table, scalar until select_Kernels runs
+struct PNM_Kernels pnmKernels =
+{ pack_PBM_Row_Scalar, unpack_PBM_Row_Scalar, 
+  threshold_Row_Scalar, threshold_Row_Packed_Scalar,
+  expand_PBM_Row_Scalar, expand_Packed_Row_Scalar,
+  error_Row_Scalar, accumulate_SSIM_Row_Scalar,
+  filter_Row_Horizontal_Scalar, filter_Row_Vertical_Scalar,
+  downscale_Row_2x_Scalar
+};
+
+// the level the table is dispatched to
+static enum SIMD_Level currentLevel = SIMD_SCALAR;
+
+// the names accepted by PNM_SIMD, indexed by level
+static const char * levelNames[] = 
+  {"scalar", "sse2", "sse4.1", "avx2", "avx512bw"};
+
+/*--------------------------------------------------------------*/
+/* GETS THE HIGHEST LEVEL THE RUNNING CPU SUPPORTS              */
+/*--------------------------------------------------------------*/
+enum SIMD_Level detect_SIMD_Level(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+
+  if(__builtin_cpu_supports("avx512bw")) return SIMD_AVX512BW;
+  if(__builtin_cpu_supports("avx2"))     return SIMD_AVX2;
+  if(__builtin_cpu_supports("sse4.1") && 
+     __builtin_cpu_supports("ssse3"))    return SIMD_SSE41;
+  if(__builtin_cpu_supports("sse2"))     return SIMD_SSE2;
+#endif
+
+  return SIMD_SCALAR;
+}
+
+/*--------------------------------------------------------------*/
+/* REDISPATCHES THE KERNELS TO A LEVEL                          */
+/*--------------------------------------------------------------*/
+enum SIMD_Level set_SIMD_Level(enum SIMD_Level level)
+{ // the table being built
+  struct PNM_Kernels kernels =
+  { pack_PBM_Row_Scalar, unpack_PBM_Row_Scalar, 
+    threshold_Row_Scalar, threshold_Row_Packed_Scalar,
+    expand_PBM_Row_Scalar, expand_Packed_Row_Scalar,
+    error_Row_Scalar, accumulate_SSIM_Row_Scalar,
+    filter_Row_Horizontal_Scalar, filter_Row_Vertical_Scalar,
+    downscale_Row_2x_Scalar
+  };
+
+  // never go past what the CPU can run
+  enum SIMD_Level supported = detect_SIMD_Level();
+  if(level > supported) level = supported;
+  if(level < SIMD_SCALAR) level = SIMD_SCALAR;
+
+  // each level replaces the kernels it speeds up
+#if defined(__x86_64__) || defined(__i386__)
+  if(level >= SIMD_SSE2)     init_Kernels_SSE2(&kernels);
+  if(level >= SIMD_SSE41)    init_Kernels_SSE41(&kernels);
+  if(level >= SIMD_AVX2)     init_Kernels_AVX2(&kernels);
+  if(level >= SIMD_AVX512BW) init_Kernels_AVX512BW(&kernels);
+#endif
+
+  pnmKernels = kernels;
+  currentLevel = level;
+
+  return level;
+}
+
+/*--------------------------------------------------------------*/
+/* GETS THE LEVEL THE KERNELS ARE CURRENTLY DISPATCHED TO       */
+/*--------------------------------------------------------------*/
+enum SIMD_Level get_SIMD_Level(void)
+{ return currentLevel;
+}
+
+/*--------------------------------------------------------------*/
+/* GETS THE NAME OF A LEVEL, AS ACCEPTED BY PNM_SIMD            */
+/*--------------------------------------------------------------*/
+const char * SIMD_Level_Name(enum SIMD_Level level)
+{ if(level < SIMD_SCALAR || level > SIMD_AVX512BW) return "unknown";
+  return levelNames[level];
+}
+
+/*--------------------------------------------------------------*/
+/* PICKS THE KERNELS WHEN THE PROGRAM IS LOADED                 */
+/*--------------------------------------------------------------*/
+__attribute__((constructor))
+static void select_Kernels(void)
+{ // for loop variable
+  int level;
+
+  // an optional cap from the environment
+  const char * forced = getenv("PNM_SIMD");
+
+  if(forced != NULL)
+    for(level = SIMD_SCALAR; level <= SIMD_AVX512BW; level++)
+      if(strcmp(forced, levelNames[level]) == 0)
+      { set_SIMD_Level((enum SIMD_Level)level);
+        return;
+      }
+
+  set_SIMD_Level(SIMD_AVX512BW);
+}
+
+/*--------------------------------------------------------------*/
+/* THE KERNELS, THROUGH THE DISPATCH TABLE                      */
+/*--------------------------------------------------------------*/
+void pack_PBM_Row(const unsigned char * row, unsigned char * packed,
+                  int width)
+{ pnmKernels.pack_PBM_Row(row, packed, width);
+}
+
+void unpack_PBM_Row(const unsigned char * packed, unsigned char * row,
+                    int width)
+{ pnmKernels.unpack_PBM_Row(packed, row, width);
+}
+
+void threshold_Row(const unsigned char * src, int stride,
+                   unsigned char * row, int width, int threshold)
+{ pnmKernels.threshold_Row(src, stride, row, width, threshold);
+}
+
+void threshold_Row_Packed(const unsigned char * src, int stride,
+                          unsigned char * packed, int width, int threshold)
+{ pnmKernels.threshold_Row_Packed(src, stride, packed, width, threshold);
+}
+
+void expand_PBM_Row(const unsigned char * row, unsigned char * dst,
+                    int channels, int width)
+{ pnmKernels.expand_PBM_Row(row, dst, channels, width);
+}
+
+void expand_Packed_Row(const unsigned char * packed, unsigned char * dst,
+                       int channels, int width)
+{ pnmKernels.expand_Packed_Row(packed, dst, channels, width);
+}
+
+void error_Row(const unsigned char * a, const unsigned char * b, int width,
+               unsigned long long * squares, int * maxError)
+{ pnmKernels.error_Row(a, b, width, squares, maxError);
+}
+
+void accumulate_SSIM_Row(const unsigned char * a, const unsigned char * b,
+                         int width, unsigned int * sums)
+{ pnmKernels.accumulate_SSIM_Row(a, b, width, sums);
+}
+
+void filter_Row_Horizontal(const unsigned char * src, short * dst,
+                           int samples, const short * weights, int taps,
+                           int step)
+{ pnmKernels.filter_Row_Horizontal(src, dst, samples, weights, taps, step);
+}
+
+void filter_Row_Vertical(const short * const * rows, unsigned char * dst,
+                         int samples, const short * weights, int taps,
+                         int maxValue)
+{ pnmKernels.filter_Row_Vertical(rows, dst, samples, weights, taps, maxValue);
+}
+
+void downscale_Row_2x(const unsigned char * top,
+                      const unsigned char * bottom, unsigned char * dst,
+                      int width, int channels)
+{ pnmKernels.downscale_Row_2x(top, bottom, dst, width, channels);
+}
@@ -0,0 +1,200 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_KERNELS_H_
+#define _PNM_KERNELS_H_
+
+/*--------------------------------------------------------------------*/
+/* ROW KERNELS SHARED BY THE LOADERS, SAVERS AND CONVERTERS IN LIBPNM */
+/*--------------------------------------------------------------------*/
+
+// number of bytes a raw (P4) pbm row of the given width occupies
+# define PBM_ROW_BYTES(width) (((width) + 7) / 8)
+
+/*---------------------------------------------------------------*/
+/* PACKS A ROW OF 0/1 PIXELS INTO MSB FIRST BITS FOR A RAW PBM   */
+/* (pixels equal to 1 become set bits, the last byte is padded)  */
+/*---------------------------------------------------------------*/
+void pack_PBM_Row(const unsigned char * row, unsigned char * packed,
+                  int width);
+
+/*---------------------------------------------------------------*/
+/* UNPACKS MSB FIRST BITS OF A RAW PBM ROW INTO 0/1 PIXELS       */
+/*---------------------------------------------------------------*/
+void unpack_PBM_Row(const unsigned char * packed, unsigned char * row,
+                    int width);
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS EVERY stride-TH SAMPLE OF src INTO A ROW OF PIXELS */
+/* (samples >= threshold become WHITE, the others BLACK)         */
+/*---------------------------------------------------------------*/
+void threshold_Row(const unsigned char * src, int stride,
+                   unsigned char * row, int width, int threshold);
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS EVERY stride-TH SAMPLE OF src STRAIGHT INTO THE    */
+/* PACKED BITS OF A RAW PBM ROW (BLACK pixels become set bits)   */
+/*---------------------------------------------------------------*/
+void threshold_Row_Packed(const unsigned char * src, int stride,
+                          unsigned char * packed, int width, int threshold);
+
+/*---------------------------------------------------------------*/
+/* EXPANDS A ROW OF PBM PIXELS INTO channels SAMPLES PER PIXEL   */
+/* (WHITE becomes 255, everything else 0)                        */
+/*---------------------------------------------------------------*/
+void expand_PBM_Row(const unsigned char * row, unsigned char * dst,
+                    int channels, int width);
+
+/*---------------------------------------------------------------*/
+/* EXPANDS THE PACKED BITS OF A RAW PBM ROW INTO channels        */
+/* SAMPLES PER PIXEL (clear bits become 255, set bits 0)         */
+/*---------------------------------------------------------------*/
+void expand_Packed_Row(const unsigned char * packed, unsigned char * dst,
+                       int channels, int width);
+
+/*---------------------------------------------------------------*/
+/* ADDS THE SQUARED DIFFERENCES OF TWO ROWS OF SAMPLES TO        */
+/* *squares AND RAISES *maxError TO THEIR LARGEST DIFFERENCE     */
+/*---------------------------------------------------------------*/
+void error_Row(const unsigned char * a, const unsigned char * b, int width,
+               unsigned long long * squares, int * maxError);
+
+/*---------------------------------------------------------------*/
+/* ADDS a, b, a*a, b*b AND a*b OF EVERY COLUMN OF TWO ROWS TO    */
+/* FIVE ARRAYS OF width COLUMN SUMS, ONE AFTER THE OTHER IN sums */
+/* (the structural similarity windows are summed from them)      */
+/*---------------------------------------------------------------*/
+void accumulate_SSIM_Row(const unsigned char * a, const unsigned char * b,
+                         int width, unsigned int * sums);
+
+// the fixed point scale of filter weights (Q14) and of the intermediate
+// samples between the two passes of a separable filter (Q6)
+# define FILTER_WEIGHT_BITS 14
+# define FILTER_SAMPLE_BITS 6
+
+/*---------------------------------------------------------------*/
+/* FILTERS samples SAMPLES ALONG A ROW: dst[x] IS THE SUM OF     */
+/* src[x + k * step] * weights[k] FOR k BELOW taps, ROUNDED TO   */
+/* Q6 AND SATURATED TO A short (src holds the left border)       */
+/*---------------------------------------------------------------*/
+void filter_Row_Horizontal(const unsigned char * src, short * dst,
+                           int samples, const short * weights, int taps,
+                           int step);
+
+/*---------------------------------------------------------------*/
+/* FILTERS DOWN taps ROWS OF Q6 SAMPLES: dst[x] IS THE SUM OF    */
+/* rows[k][x] * weights[k], ROUNDED AND CLAMPED TO 0..maxValue   */
+/*---------------------------------------------------------------*/
+void filter_Row_Vertical(const short * const * rows, unsigned char * dst,
+                         int samples, const short * weights, int taps,
+                         int maxValue);
+
+/*---------------------------------------------------------------*/
+/* HALVES TWO ROWS OF 2 width PIXELS OF channels SAMPLES INTO    */
+/* width PIXELS, EACH THE ROUNDED MEAN OF THE 2x2 ABOVE IT       */
+/*---------------------------------------------------------------*/
+void downscale_Row_2x(const unsigned char * top,
+                      const unsigned char * bottom, unsigned char * dst,
+                      int width, int channels);
+
+/*--------------------------------------------------------------------*/
+/* RUNTIME DISPATCH                                                   */
+/*                                                                    */
+/* Every kernel above calls through pnmKernels, which is filled in    */
+/* when the program is loaded with the best implementation the CPU    */
+/* supports. Setting PNM_SIMD to scalar, sse2, sse4.1, avx2 or        */
+/* avx512bw caps the level, e.g. to test the narrower paths.          */
+/*--------------------------------------------------------------------*/
+
+// the instruction set levels, each one implies the ones before it
+enum SIMD_Level {SIMD_SCALAR = 0, SIMD_SSE2, SIMD_SSE41, SIMD_AVX2,
+                 SIMD_AVX512BW};
+
+// the dispatch table
+struct PNM_Kernels
+{ void (* pack_PBM_Row)(const unsigned char *, unsigned char *, int);
+  void (* unpack_PBM_Row)(const unsigned char *, unsigned char *, int);
+  void (* threshold_Row)(const unsigned char *, int, 
+                         unsigned char *, int, int);
+  void (* threshold_Row_Packed)(const unsigned char *, int, 
+                                unsigned char *, int, int);
+  void (* expand_PBM_Row)(const unsigned char *, unsigned char *, int, int);
+  void (* expand_Packed_Row)(const unsigned char *, unsigned char *, 
+                             int, int);
+  void (* error_Row)(const unsigned char *, const unsigned char *, int,
+                     unsigned long long *, int *);
+  void (* accumulate_SSIM_Row)(const unsigned char *, const unsigned char *,
+                               int, unsigned int *);
+  void (* filter_Row_Horizontal)(const unsigned char *, short *, int,
+                                 const short *, int, int);
+  void (* filter_Row_Vertical)(const short * const *, unsigned char *, int,
+                               const short *, int, int);
+  void (* downscale_Row_2x)(const unsigned char *, const unsigned char *,
+                            unsigned char *, int, int);
+};
+
+extern struct PNM_Kernels pnmKernels;
+
+/*--------------------------------------------------------------*/
+/* GETS THE LEVEL THE KERNELS ARE CURRENTLY DISPATCHED TO       */
+/*--------------------------------------------------------------*/
+enum SIMD_Level get_SIMD_Level(void);
+
+/*--------------------------------------------------------------*/
+/* GETS THE HIGHEST LEVEL THE RUNNING CPU SUPPORTS              */
+/*--------------------------------------------------------------*/
+enum SIMD_Level detect_SIMD_Level(void);
+
+/*--------------------------------------------------------------*/
+/* REDISPATCHES THE KERNELS TO A LEVEL, CAPPED AT WHAT THE CPU  */
+/* SUPPORTS (returns the level actually selected)               */
+/*--------------------------------------------------------------*/
+enum SIMD_Level set_SIMD_Level(enum SIMD_Level level);
+
+/*--------------------------------------------------------------*/
+/* GETS THE NAME OF A LEVEL, AS ACCEPTED BY PNM_SIMD            */
+/*--------------------------------------------------------------*/
+const char * SIMD_Level_Name(enum SIMD_Level level);
+
+/*--------------------------------------------------------------*/
+/* THE SCALAR KERNELS, WHICH THE WIDER ONES FALL BACK TO        */
+/*--------------------------------------------------------------*/
+void pack_PBM_Row_Scalar(const unsigned char * row, unsigned char * packed,
+                         int width);
+void unpack_PBM_Row_Scalar(const unsigned char * packed, unsigned char * row,
+                           int width);
+void threshold_Row_Scalar(const unsigned char * src, int stride,
+                          unsigned char * row, int width, int threshold);
+void threshold_Row_Packed_Scalar(const unsigned char * src, int stride,
+                                 unsigned char * packed, int width, 
+                                 int threshold);
+void expand_PBM_Row_Scalar(const unsigned char * row, unsigned char * dst,
+                           int channels, int width);
+void expand_Packed_Row_Scalar(const unsigned char * packed, 
+                              unsigned char * dst, int channels, int width);
+void error_Row_Scalar(const unsigned char * a, const unsigned char * b,
+                      int width, unsigned long long * squares, 
+                      int * maxError);
+void accumulate_SSIM_Row_Scalar(const unsigned char * a, 
+                                const unsigned char * b, int width, 
+                                unsigned int * sums);
+void filter_Row_Horizontal_Scalar(const unsigned char * src, short * dst,
+                                  int samples, const short * weights,
+                                  int taps, int step);
+void filter_Row_Vertical_Scalar(const short * const * rows,
+                                unsigned char * dst, int samples,
+                                const short * weights, int taps,
+                                int maxValue);
+void downscale_Row_2x_Scalar(const unsigned char * top,
+                             const unsigned char * bottom,
+                             unsigned char * dst, int width, int channels);
+
+/*--------------------------------------------------------------*/
+/* FILLS THE TABLE WITH A LEVEL'S KERNELS (libpnm_kernels_x86.c) */
+/* (each level only replaces the kernels it speeds up)           */
+/*--------------------------------------------------------------*/
+void init_Kernels_SSE2(struct PNM_Kernels * kernels);
+void init_Kernels_SSE41(struct PNM_Kernels * kernels);
+void init_Kernels_AVX2(struct PNM_Kernels * kernels);
+void init_Kernels_AVX512BW(struct PNM_Kernels * kernels);
+#endif /*_PNM_KERNELS_H_*/
@@ -0,0 +1,1365 @@
+#include <string.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+
+/*--------------------------------------------------------------------*/
+/* THE x86 SIMD KERNELS                                               */
+/*                                                                    */
+/* Every function is compiled for its own instruction set with a      */
+/* target attribute, so this file builds with the plain CFLAG and the */
+/* dispatcher in libpnm_kernels.c only calls what the CPU can run.    */
+/* A kernel handles the whole blocks it is good at and hands the tail */
+/* (or a stride it has no special case for) to the level below it.   */
+/*--------------------------------------------------------------------*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+# define TARGET_SSE2     __attribute__((target("sse2")))
+# define TARGET_SSE41    __attribute__((target("sse2,ssse3,sse4.1")))
+# define TARGET_AVX2     __attribute__((target("sse2,ssse3,sse4.1,avx,avx2")))
+# define TARGET_AVX512BW __attribute__((target("sse2,ssse3,sse4.1,avx,avx2,avx512f,avx512bw")))
+
+/*====================================================================*/
+/* SSE2                                                               */
+/*====================================================================*/
+
+/*---------------------------------------------------------------*/
+/* PACKS A ROW OF 0/1 PIXELS, 16 PIXELS (2 BYTES) PER ITERATION  */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void pack_PBM_Row_SSE2(const unsigned char * row,
+                              unsigned char * packed, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i ones = _mm_set1_epi8(1);
+
+  for(; col + 16 <= width; col += 16)
+  { __m128i v = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(row + col)),
+                               ones);
+    int mask;
+
+    // reverse the pixels within each group of 8 so that the first pixel
+    // ends up in the most significant bit of the movemask byte
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+    mask = _mm_movemask_epi8(v);
+    packed[col >> 3]       = (unsigned char)(mask & 0xff);
+    packed[(col >> 3) + 1] = (unsigned char)(mask >> 8);
+  }
+
+  // the rest starts on a byte boundary
+  pack_PBM_Row_Scalar(row + col, packed + (col >> 3), width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* UNPACKS A RAW PBM ROW, 2 BYTES (16 PIXELS) PER ITERATION      */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void unpack_PBM_Row_SSE2(const unsigned char * packed,
+                                unsigned char * row, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char)128,
+                                    1, 2, 4, 8, 16, 32, 64, (char)128);
+  const __m128i ones = _mm_set1_epi8(1);
+
+  for(; col + 16 <= width; col += 16)
+  { // broadcast byte 0 into the low 8 lanes and byte 1 into the high 8
+    __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)packed[col >> 3]),
+                                   _mm_set1_epi8((char)packed[(col >> 3) + 1]));
+
+    // lane i is 1 when its bit is set
+    v = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, bits), bits), ones);
+    _mm_storeu_si128((__m128i *)(row + col), v);
+  }
+
+  unpack_PBM_Row_Scalar(packed + (col >> 3), row + col, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS GRAY SAMPLES, 16 PIXELS PER ITERATION              */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void threshold_Row_SSE2(const unsigned char * src, int stride,
+                               unsigned char * row, int width, int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i t = _mm_set1_epi8((char)threshold);
+  const __m128i ones = _mm_set1_epi8(1);
+
+  if(stride == 1)
+    for(; col + 16 <= width; col += 16)
+    { __m128i v = _mm_loadu_si128((const __m128i *)(src + col));
+
+      // v >= t exactly when max(v, t) == v, those pixels are WHITE (0)
+      v = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, t), v), ones);
+      _mm_storeu_si128((__m128i *)(row + col), v);
+    }
+
+  threshold_Row_Scalar(src + (size_t)col * stride, stride,
+                       row + col, width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS GRAY SAMPLES INTO PACKED BITS, 16 PIXELS AT A TIME */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void threshold_Row_Packed_SSE2(const unsigned char * src, int stride,
+                                      unsigned char * packed, int width,
+                                      int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i t = _mm_set1_epi8((char)threshold);
+
+  if(stride == 1)
+    for(; col + 16 <= width; col += 16)
+    { __m128i v = _mm_loadu_si128((const __m128i *)(src + col));
+      int mask;
+
+      // all ones where the sample is WHITE
+      v = _mm_cmpeq_epi8(_mm_max_epu8(v, t), v);
+
+      // reverse each group of 8 as in pack_PBM_Row_SSE2
+      v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+      v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+      // set bits are BLACK
+      mask = ~_mm_movemask_epi8(v);
+      packed[col >> 3]       = (unsigned char)(mask & 0xff);
+      packed[(col >> 3) + 1] = (unsigned char)((mask >> 8) & 0xff);
+    }
+
+  threshold_Row_Packed_Scalar(src + (size_t)col * stride, stride,
+                              packed + (col >> 3), width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PBM PIXELS TO GRAY SAMPLES, 16 PIXELS PER ITERATION   */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void expand_PBM_Row_SSE2(const unsigned char * row,
+                                unsigned char * dst, int channels, int width)
+{ // for loop variable
+  int col = 0;
+
+  // WHITE pixels compare to all ones, which is exactly 255
+  if(channels == 1)
+    for(; col + 16 <= width; col += 16)
+      _mm_storeu_si128((__m128i *)(dst + col),
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(row + col)),
+                       _mm_set1_epi8(WHITE)));
+
+  expand_PBM_Row_Scalar(row + col, dst + (size_t)col * channels,
+                        channels, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PACKED BITS TO GRAY SAMPLES, 16 PIXELS PER ITERATION  */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void expand_Packed_Row_SSE2(const unsigned char * packed,
+                                   unsigned char * dst,
+                                   int channels, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char)128,
+                                    1, 2, 4, 8, 16, 32, 64, (char)128);
+
+  if(channels == 1)
+    for(; col + 16 <= width; col += 16)
+    { __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)packed[col >> 3]),
+                                     _mm_set1_epi8((char)packed[(col >> 3) + 1]));
+
+      // lane i is 255 when its bit is clear
+      v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), _mm_setzero_si128());
+      _mm_storeu_si128((__m128i *)(dst + col), v);
+    }
+
+  expand_Packed_Row_Scalar(packed + (col >> 3), dst + (size_t)col * channels,
+                           channels, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* GETS THE LARGEST OF 16 BYTES                                  */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static int max_Bytes_SSE2(__m128i v)
+{ v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+  v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+  v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+  v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+
+  return _mm_cvtsi128_si32(v) & 0xff;
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS SQUARED DIFFERENCES, 16 SAMPLES PER ITERATION            */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void error_Row_SSE2(const unsigned char * a, const unsigned char * b,
+                           int width, unsigned long long * squares, 
+                           int * maxError)
+{ // for loop variables
+  int col = 0, block;
+
+  // the 32 bit lanes of a block, and the largest difference
+  unsigned int lanes[4]; __m128i total, largest = _mm_setzero_si128();
+
+  const __m128i zero = _mm_setzero_si128();
+
+  while(col + 16 <= width)
+  { // a lane gains at most 4 * 255 * 255 per iteration, so the lanes are
+    // added up every 4096 iterations before they can overflow
+    total = _mm_setzero_si128();
+    for(block = 0; block < 4096 && col + 16 <= width; block++, col += 16)
+    { __m128i va = _mm_loadu_si128((const __m128i *)(a + col));
+      __m128i vb = _mm_loadu_si128((const __m128i *)(b + col));
+      __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+      __m128i lo = _mm_unpacklo_epi8(d, zero), hi = _mm_unpackhi_epi8(d, zero);
+
+      largest = _mm_max_epu8(largest, d);
+      total = _mm_add_epi32(total, _mm_add_epi32(_mm_madd_epi16(lo, lo),
+                                                 _mm_madd_epi16(hi, hi)));
+    }
+
+    _mm_storeu_si128((__m128i *)lanes, total);
+    *squares += (unsigned long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+
+  block = max_Bytes_SSE2(largest);
+  if(block > *maxError) *maxError = block;
+
+  error_Row_Scalar(a + col, b + col, width - col, squares, maxError);
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS 8 UNSIGNED 16 BIT LANES TO 8 COLUMN SUMS                 */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void add_Columns_SSE2(unsigned int * sums, __m128i v)
+{ const __m128i zero = _mm_setzero_si128();
+
+  _mm_storeu_si128((__m128i *)sums, 
+    _mm_add_epi32(_mm_loadu_si128((const __m128i *)sums), 
+                  _mm_unpacklo_epi16(v, zero)));
+  _mm_storeu_si128((__m128i *)(sums + 4), 
+    _mm_add_epi32(_mm_loadu_si128((const __m128i *)(sums + 4)), 
+                  _mm_unpackhi_epi16(v, zero)));
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS THE SSIM COLUMN SUMS, 8 COLUMNS PER ITERATION            */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void accumulate_SSIM_Row_SSE2(const unsigned char * a,
+                                     const unsigned char * b, int width, 
+                                     unsigned int * sums)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i zero = _mm_setzero_si128();
+
+  // the products of two samples fit 16 unsigned bits
+  for(; col + 8 <= width; col += 8)
+  { __m128i va = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(a + col)),
+                                   zero);
+    __m128i vb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(b + col)),
+                                   zero);
+
+    add_Columns_SSE2(sums + col, va);
+    add_Columns_SSE2(sums + width + col, vb);
+    add_Columns_SSE2(sums + 2 * width + col, _mm_mullo_epi16(va, va));
+    add_Columns_SSE2(sums + 3 * width + col, _mm_mullo_epi16(vb, vb));
+    add_Columns_SSE2(sums + 4 * width + col, _mm_mullo_epi16(va, vb));
+  }
+
+  // the five arrays are spaced by the whole width, so the rest is summed
+  // here rather than handed to the level below
+  for(; col < width; col++)
+  { sums[col]             += a[col];
+    sums[width + col]     += b[col];
+    sums[2 * width + col] += a[col] * a[col];
+    sums[3 * width + col] += b[col] * b[col];
+    sums[4 * width + col] += a[col] * b[col];
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* PUTS TWO FILTER WEIGHTS IN THE 16 BIT HALVES OF A 32 BIT LANE */
+/* (pmaddwd then multiplies and adds two taps at once)           */
+/*---------------------------------------------------------------*/
+static int pair_Weights(short first, short second)
+{ return (int)((unsigned short)first | 
+               ((unsigned int)(unsigned short)second << 16));
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS ALONG A ROW, 8 SAMPLES PER ITERATION                  */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void filter_Row_Horizontal_SSE2(const unsigned char * src, short * dst,
+                                       int samples, const short * weights,
+                                       int taps, int step)
+{ // for loop variables
+  int x = 0, k;
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = 
+    _mm_set1_epi32(1 << (FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS - 1));
+
+  for(; x + 8 <= samples; x += 8)
+  { __m128i lo = round, hi = round;
+
+    // two taps at a time, the samples of one interleaved with the other's
+    for(k = 0; k < taps; k += 2)
+    { const unsigned char * s = src + x + k * step;
+      __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)s), zero);
+      __m128i b = zero, w;
+
+      if(k + 1 < taps)
+      { b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + step)),
+                              zero);
+        w = _mm_set1_epi32(pair_Weights(weights[k], weights[k + 1]));
+      }
+      else w = _mm_set1_epi32(pair_Weights(weights[k], 0));
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+    }
+
+    lo = _mm_srai_epi32(lo, FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS);
+    hi = _mm_srai_epi32(hi, FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS);
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_packs_epi32(lo, hi));
+  }
+
+  filter_Row_Horizontal_Scalar(src + x, dst + x, samples - x, weights, taps,
+                               step);
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS DOWN ROWS, 8 SAMPLES PER ITERATION                    */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void filter_Row_Vertical_SSE2(const short * const * rows,
+                                     unsigned char * dst, int samples,
+                                     const short * weights, int taps,
+                                     int maxValue)
+{ // for loop variables
+  int x = 0, k;
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = 
+    _mm_set1_epi32(1 << (FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS - 1));
+  const __m128i most = _mm_set1_epi8((char)maxValue);
+
+  // the rows cannot be offset for a narrower kernel to finish the row, so
+  // the last vector overlaps the one before it instead
+  if(samples < 8)
+  { filter_Row_Vertical_Scalar(rows, dst, samples, weights, taps, maxValue);
+    return;
+  }
+
+  for(; x < samples; x += 8)
+  { __m128i lo = round, hi = round, v;
+
+    if(x + 8 > samples) x = samples - 8;
+
+    for(k = 0; k < taps; k += 2)
+    { __m128i a = _mm_loadu_si128((const __m128i *)(rows[k] + x));
+      __m128i b = zero, w;
+
+      if(k + 1 < taps)
+      { b = _mm_loadu_si128((const __m128i *)(rows[k + 1] + x));
+        w = _mm_set1_epi32(pair_Weights(weights[k], weights[k + 1]));
+      }
+      else w = _mm_set1_epi32(pair_Weights(weights[k], 0));
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+    }
+
+    // saturating packs clamp to 0..255, then to the max value
+    v = _mm_packs_epi32(
+          _mm_srai_epi32(lo, FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS),
+          _mm_srai_epi32(hi, FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS));
+    v = _mm_min_epu8(_mm_packus_epi16(v, v), most);
+    _mm_storel_epi64((__m128i *)(dst + x), v);
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS THE PAIRS OF BYTES OF TWO ROWS INTO 16 BIT LANES (EACH   */
+/* LANE IS THE SUM OF A 2x2 OF GRAY PIXELS)                      */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static __m128i add_Pairs_SSE2(__m128i top, __m128i bottom)
+{ const __m128i low = _mm_set1_epi16(0x00ff);
+
+  return _mm_add_epi16(_mm_add_epi16(_mm_and_si128(top, low),
+                                     _mm_srli_epi16(top, 8)),
+                       _mm_add_epi16(_mm_and_si128(bottom, low),
+                                     _mm_srli_epi16(bottom, 8)));
+}
+
+/*---------------------------------------------------------------*/
+/* HALVES TWO GRAY ROWS, 16 PIXELS PER ITERATION                 */
+/*---------------------------------------------------------------*/
+TARGET_SSE2
+static void downscale_Row_2x_SSE2(const unsigned char * top,
+                                  const unsigned char * bottom,
+                                  unsigned char * dst, int width,
+                                  int channels)
+{ // for loop variable
+  int x = 0;
+
+  const __m128i two = _mm_set1_epi16(2);
+
+  if(channels != 1)
+  { downscale_Row_2x_Scalar(top, bottom, dst, width, channels);
+    return;
+  }
+
+  for(; x + 16 <= width; x += 16)
+  { __m128i lo = add_Pairs_SSE2(
+                   _mm_loadu_si128((const __m128i *)(top + 2 * x)),
+                   _mm_loadu_si128((const __m128i *)(bottom + 2 * x)));
+    __m128i hi = add_Pairs_SSE2(
+                   _mm_loadu_si128((const __m128i *)(top + 2 * x + 16)),
+                   _mm_loadu_si128((const __m128i *)(bottom + 2 * x + 16)));
+
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+  }
+
+  downscale_Row_2x_Scalar(top + 2 * x, bottom + 2 * x, dst + x, width - x, 1);
+}
+
+/*---------------------------------------------------------------*/
+/* FILLS THE TABLE WITH THE SSE2 KERNELS                         */
+/*---------------------------------------------------------------*/
+void init_Kernels_SSE2(struct PNM_Kernels * kernels)
+{ kernels->pack_PBM_Row         = pack_PBM_Row_SSE2;
+  kernels->unpack_PBM_Row       = unpack_PBM_Row_SSE2;
+  kernels->threshold_Row        = threshold_Row_SSE2;
+  kernels->threshold_Row_Packed = threshold_Row_Packed_SSE2;
+  kernels->expand_PBM_Row       = expand_PBM_Row_SSE2;
+  kernels->expand_Packed_Row    = expand_Packed_Row_SSE2;
+  kernels->error_Row            = error_Row_SSE2;
+  kernels->accumulate_SSIM_Row  = accumulate_SSIM_Row_SSE2;
+  kernels->filter_Row_Horizontal = filter_Row_Horizontal_SSE2;
+  kernels->filter_Row_Vertical  = filter_Row_Vertical_SSE2;
+  kernels->downscale_Row_2x     = downscale_Row_2x_SSE2;
+}
+
+/*====================================================================*/
+/* SSE4.1 (WITH SSSE3 BYTE SHUFFLES)                                  */
+/*====================================================================*/
+
+/*---------------------------------------------------------------*/
+/* BUILDS THE pshufb MASKS WHICH GATHER EVERY 3RD BYTE OF 48     */
+/* INTO 16 LANES (gather) OR SPREAD 16 LANES INTO 48 (spread)    */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void build_Shuffle_Masks(__m128i gather[3], __m128i spread[3])
+{ // for loop variables
+  int part, lane;
+
+  // the masks as bytes, -128 zeroes a lane
+  char g[3][16], s[3][16];
+
+  for(part = 0; part < 3; part++)
+    for(lane = 0; lane < 16; lane++)
+    { g[part][lane] = (char)((3 * lane) / 16 == part ? (3 * lane) % 16 : -128);
+      s[part][lane] = (char)((16 * part + lane) / 3);
+    }
+
+  for(part = 0; part < 3; part++)
+  { gather[part] = _mm_loadu_si128((const __m128i *)g[part]);
+    spread[part] = _mm_loadu_si128((const __m128i *)s[part]);
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* GATHERS 16 SAMPLES 3 BYTES APART                              */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static __m128i gather_3(const unsigned char * src, const __m128i gather[3])
+{ return _mm_or_si128(
+           _mm_or_si128(
+             _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src),
+                              gather[0]),
+             _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 16)),
+                              gather[1])),
+           _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 32)),
+                            gather[2]));
+}
+
+/*---------------------------------------------------------------*/
+/* PACKS A ROW OF 0/1 PIXELS WITH A pshufb BIT ORDER REVERSAL    */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void pack_PBM_Row_SSE41(const unsigned char * row,
+                               unsigned char * packed, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i ones = _mm_set1_epi8(1);
+  const __m128i reverse = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+                                        15, 14, 13, 12, 11, 10, 9, 8);
+
+  for(; col + 16 <= width; col += 16)
+  { __m128i v = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(row + col)),
+                               ones);
+    int mask = _mm_movemask_epi8(_mm_shuffle_epi8(v, reverse));
+
+    packed[col >> 3]       = (unsigned char)(mask & 0xff);
+    packed[(col >> 3) + 1] = (unsigned char)(mask >> 8);
+  }
+
+  pack_PBM_Row_Scalar(row + col, packed + (col >> 3), width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS ONE CHANNEL OF RGB SAMPLES, 16 PIXELS PER ITERATION */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void threshold_Row_SSE41(const unsigned char * src, int stride,
+                                unsigned char * row, int width,
+                                int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i t = _mm_set1_epi8((char)threshold);
+  const __m128i ones = _mm_set1_epi8(1);
+  __m128i gather[3], spread[3];
+
+  if(stride != 3)
+  { threshold_Row_SSE2(src, stride, row, width, threshold);
+    return;
+  }
+
+  build_Shuffle_Masks(gather, spread);
+
+  // the 48 byte loads must not pass the last sample of the row
+  for(; col + 17 <= width; col += 16)
+  { __m128i v = gather_3(src + (size_t)col * 3, gather);
+
+    v = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, t), v), ones);
+    _mm_storeu_si128((__m128i *)(row + col), v);
+  }
+
+  threshold_Row_Scalar(src + (size_t)col * 3, 3,
+                       row + col, width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS ONE CHANNEL OF RGB SAMPLES INTO PACKED BITS        */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void threshold_Row_Packed_SSE41(const unsigned char * src, int stride,
+                                       unsigned char * packed, int width,
+                                       int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m128i t = _mm_set1_epi8((char)threshold);
+  const __m128i reverse = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+                                        15, 14, 13, 12, 11, 10, 9, 8);
+  __m128i gather[3], spread[3];
+
+  if(stride != 3)
+  { threshold_Row_Packed_SSE2(src, stride, packed, width, threshold);
+    return;
+  }
+
+  build_Shuffle_Masks(gather, spread);
+
+  for(; col + 17 <= width; col += 16)
+  { __m128i v = gather_3(src + (size_t)col * 3, gather);
+
+    // set bits are BLACK
+    int mask = ~_mm_movemask_epi8(
+                 _mm_shuffle_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, t), v),
+                                  reverse));
+    packed[col >> 3]       = (unsigned char)(mask & 0xff);
+    packed[(col >> 3) + 1] = (unsigned char)((mask >> 8) & 0xff);
+  }
+
+  threshold_Row_Packed_Scalar(src + (size_t)col * 3, 3,
+                              packed + (col >> 3), width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PBM PIXELS TO RGB SAMPLES, 16 PIXELS PER ITERATION    */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void expand_PBM_Row_SSE41(const unsigned char * row,
+                                 unsigned char * dst, int channels, int width)
+{ // for loop variables
+  int col = 0, part;
+
+  __m128i gather[3], spread[3];
+
+  if(channels != 3)
+  { expand_PBM_Row_SSE2(row, dst, channels, width);
+    return;
+  }
+
+  build_Shuffle_Masks(gather, spread);
+
+  for(; col + 16 <= width; col += 16)
+  { __m128i v = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(row + col)),
+                               _mm_set1_epi8(WHITE));
+
+    for(part = 0; part < 3; part++)
+      _mm_storeu_si128((__m128i *)(dst + (size_t)col * 3 + 16 * part),
+                       _mm_shuffle_epi8(v, spread[part]));
+  }
+
+  expand_PBM_Row_Scalar(row + col, dst + (size_t)col * 3, 3, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PACKED BITS TO RGB SAMPLES, 16 PIXELS PER ITERATION   */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void expand_Packed_Row_SSE41(const unsigned char * packed,
+                                    unsigned char * dst,
+                                    int channels, int width)
+{ // for loop variables
+  int col = 0, part;
+
+  const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char)128,
+                                    1, 2, 4, 8, 16, 32, 64, (char)128);
+  __m128i gather[3], spread[3];
+
+  if(channels != 3)
+  { expand_Packed_Row_SSE2(packed, dst, channels, width);
+    return;
+  }
+
+  build_Shuffle_Masks(gather, spread);
+
+  for(; col + 16 <= width; col += 16)
+  { __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)packed[col >> 3]),
+                                   _mm_set1_epi8((char)packed[(col >> 3) + 1]));
+    v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), _mm_setzero_si128());
+
+    for(part = 0; part < 3; part++)
+      _mm_storeu_si128((__m128i *)(dst + (size_t)col * 3 + 16 * part),
+                       _mm_shuffle_epi8(v, spread[part]));
+  }
+
+  expand_Packed_Row_Scalar(packed + (col >> 3), dst + (size_t)col * 3,
+                           3, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS THE EVEN AND ODD PIXELS OF 8 RGB PIXELS INTO THE 16 BIT  */
+/* LANES OF lo (SAMPLES 0-7 OF THE 4 PAIRS) AND hi (8-11)        */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void add_RGB_Pairs_SSE41(const unsigned char * row,
+                                const __m128i masks[4],
+                                __m128i * lo, __m128i * hi)
+{ // the first 16 bytes and the last 8 of the 24
+  __m128i first = _mm_loadu_si128((const __m128i *)row);
+  __m128i second = _mm_loadl_epi64((const __m128i *)(row + 16));
+
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i even = _mm_or_si128(_mm_shuffle_epi8(first, masks[0]),
+                              _mm_shuffle_epi8(second, masks[1]));
+  __m128i odd = _mm_or_si128(_mm_shuffle_epi8(first, masks[2]),
+                             _mm_shuffle_epi8(second, masks[3]));
+
+  *lo = _mm_add_epi16(*lo, _mm_add_epi16(_mm_unpacklo_epi8(even, zero),
+                                         _mm_unpacklo_epi8(odd, zero)));
+  *hi = _mm_add_epi16(*hi, _mm_add_epi16(_mm_unpackhi_epi8(even, zero),
+                                         _mm_unpackhi_epi8(odd, zero)));
+}
+
+/*---------------------------------------------------------------*/
+/* HALVES TWO RGB ROWS, 4 PIXELS PER ITERATION                   */
+/*---------------------------------------------------------------*/
+TARGET_SSE41
+static void downscale_Row_2x_SSE41(const unsigned char * top,
+                                   const unsigned char * bottom,
+                                   unsigned char * dst, int width,
+                                   int channels)
+{ // for loop variable
+  int x = 0;
+
+  // gather the even pixels of 8 from the first and the second load, then
+  // the odd pixels, into lanes 0-11 (-128 zeroes a lane)
+  const __m128i masks[4] =
+  { _mm_setr_epi8(0, 1, 2, 6, 7, 8, 12, 13, 14, -128, -128, -128,
+                  -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128,
+                  2, 3, 4, -128, -128, -128, -128),
+    _mm_setr_epi8(3, 4, 5, 9, 10, 11, 15, -128, -128, -128, -128, -128,
+                  -128, -128, -128, -128),
+    _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, 0, 1,
+                  5, 6, 7, -128, -128, -128, -128) };
+  const __m128i two = _mm_set1_epi16(2);
+
+  if(channels != 3)
+  { downscale_Row_2x_SSE2(top, bottom, dst, width, channels);
+    return;
+  }
+
+  // the 12 samples are stored as 16, so 2 pixels must follow them
+  for(; x + 6 <= width; x += 4)
+  { __m128i lo = two, hi = two;
+
+    add_RGB_Pairs_SSE41(top + (size_t)6 * x, masks, &lo, &hi);
+    add_RGB_Pairs_SSE41(bottom + (size_t)6 * x, masks, &lo, &hi);
+    _mm_storeu_si128((__m128i *)(dst + (size_t)3 * x),
+                     _mm_packus_epi16(_mm_srli_epi16(lo, 2),
+                                      _mm_srli_epi16(hi, 2)));
+  }
+
+  downscale_Row_2x_Scalar(top + (size_t)6 * x, bottom + (size_t)6 * x,
+                          dst + (size_t)3 * x, width - x, 3);
+}
+
+/*---------------------------------------------------------------*/
+/* FILLS THE TABLE WITH THE SSE4.1 KERNELS                       */
+/*---------------------------------------------------------------*/
+void init_Kernels_SSE41(struct PNM_Kernels * kernels)
+{ kernels->pack_PBM_Row         = pack_PBM_Row_SSE41;
+  kernels->threshold_Row        = threshold_Row_SSE41;
+  kernels->threshold_Row_Packed = threshold_Row_Packed_SSE41;
+  kernels->expand_PBM_Row       = expand_PBM_Row_SSE41;
+  kernels->expand_Packed_Row    = expand_Packed_Row_SSE41;
+  kernels->downscale_Row_2x     = downscale_Row_2x_SSE41;
+}
+
+/*====================================================================*/
+/* AVX2                                                               */
+/*====================================================================*/
+
+/*---------------------------------------------------------------*/
+/* PACKS A ROW OF 0/1 PIXELS, 32 PIXELS (4 BYTES) PER ITERATION  */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void pack_PBM_Row_AVX2(const unsigned char * row,
+                              unsigned char * packed, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m256i ones = _mm256_set1_epi8(1);
+  const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+                                           15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0,
+                                           15, 14, 13, 12, 11, 10, 9, 8);
+
+  for(; col + 32 <= width; col += 32)
+  { __m256i v = _mm256_cmpeq_epi8(
+                  _mm256_loadu_si256((const __m256i *)(row + col)), ones);
+    unsigned int mask = (unsigned int)
+                        _mm256_movemask_epi8(_mm256_shuffle_epi8(v, reverse));
+
+    // byte 0 of the mask holds pixels 0 to 7
+    memcpy(packed + (col >> 3), &mask, 4);
+  }
+
+  pack_PBM_Row_SSE41(row + col, packed + (col >> 3), width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* UNPACKS A RAW PBM ROW, 4 BYTES (32 PIXELS) PER ITERATION      */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void unpack_PBM_Row_AVX2(const unsigned char * packed,
+                                unsigned char * row, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m256i bits = _mm256_setr_epi8(
+          (char)128, 64, 32, 16, 8, 4, 2, 1, (char)128, 64, 32, 16, 8, 4, 2, 1,
+          (char)128, 64, 32, 16, 8, 4, 2, 1, (char)128, 64, 32, 16, 8, 4, 2, 1);
+  const __m256i broadcast = _mm256_setr_epi8(
+          0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+          2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+  const __m256i ones = _mm256_set1_epi8(1);
+
+  for(; col + 32 <= width; col += 32)
+  { int word; __m256i v;
+
+    // every byte lands in the 8 lanes of its pixels
+    memcpy(&word, packed + (col >> 3), 4);
+    v = _mm256_shuffle_epi8(_mm256_set1_epi32(word), broadcast);
+
+    v = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits),
+                         ones);
+    _mm256_storeu_si256((__m256i *)(row + col), v);
+  }
+
+  unpack_PBM_Row_SSE2(packed + (col >> 3), row + col, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS GRAY SAMPLES, 32 PIXELS PER ITERATION              */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void threshold_Row_AVX2(const unsigned char * src, int stride,
+                               unsigned char * row, int width, int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m256i t = _mm256_set1_epi8((char)threshold);
+  const __m256i ones = _mm256_set1_epi8(1);
+
+  if(stride != 1)
+  { threshold_Row_SSE41(src, stride, row, width, threshold);
+    return;
+  }
+
+  for(; col + 32 <= width; col += 32)
+  { __m256i v = _mm256_loadu_si256((const __m256i *)(src + col));
+
+    v = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v),
+                            ones);
+    _mm256_storeu_si256((__m256i *)(row + col), v);
+  }
+
+  threshold_Row_SSE2(src + col, 1, row + col, width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS GRAY SAMPLES INTO PACKED BITS, 32 PIXELS AT A TIME */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void threshold_Row_Packed_AVX2(const unsigned char * src, int stride,
+                                      unsigned char * packed, int width,
+                                      int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m256i t = _mm256_set1_epi8((char)threshold);
+  const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+                                           15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0,
+                                           15, 14, 13, 12, 11, 10, 9, 8);
+
+  if(stride != 1)
+  { threshold_Row_Packed_SSE41(src, stride, packed, width, threshold);
+    return;
+  }
+
+  for(; col + 32 <= width; col += 32)
+  { __m256i v = _mm256_loadu_si256((const __m256i *)(src + col));
+
+    // set bits are BLACK
+    unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(
+                          _mm256_shuffle_epi8(
+                            _mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v),
+                            reverse));
+    memcpy(packed + (col >> 3), &mask, 4);
+  }
+
+  threshold_Row_Packed_SSE2(src + col, 1, packed + (col >> 3),
+                            width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PBM PIXELS TO GRAY SAMPLES, 32 PIXELS PER ITERATION   */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void expand_PBM_Row_AVX2(const unsigned char * row,
+                                unsigned char * dst, int channels, int width)
+{ // for loop variable
+  int col = 0;
+
+  if(channels != 1)
+  { expand_PBM_Row_SSE41(row, dst, channels, width);
+    return;
+  }
+
+  for(; col + 32 <= width; col += 32)
+    _mm256_storeu_si256((__m256i *)(dst + col),
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(row + col)),
+                        _mm256_set1_epi8(WHITE)));
+
+  expand_PBM_Row_SSE2(row + col, dst + col, 1, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PACKED BITS TO GRAY SAMPLES, 32 PIXELS PER ITERATION  */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void expand_Packed_Row_AVX2(const unsigned char * packed,
+                                   unsigned char * dst,
+                                   int channels, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m256i bits = _mm256_setr_epi8(
+          (char)128, 64, 32, 16, 8, 4, 2, 1, (char)128, 64, 32, 16, 8, 4, 2, 1,
+          (char)128, 64, 32, 16, 8, 4, 2, 1, (char)128, 64, 32, 16, 8, 4, 2, 1);
+  const __m256i broadcast = _mm256_setr_epi8(
+          0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+          2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+
+  if(channels != 1)
+  { expand_Packed_Row_SSE41(packed, dst, channels, width);
+    return;
+  }
+
+  for(; col + 32 <= width; col += 32)
+  { int word; __m256i v;
+
+    memcpy(&word, packed + (col >> 3), 4);
+    v = _mm256_shuffle_epi8(_mm256_set1_epi32(word), broadcast);
+
+    // lane i is 255 when its bit is clear
+    v = _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), _mm256_setzero_si256());
+    _mm256_storeu_si256((__m256i *)(dst + col), v);
+  }
+
+  expand_Packed_Row_SSE2(packed + (col >> 3), dst + col, 1, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS SQUARED DIFFERENCES, 32 SAMPLES PER ITERATION            */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void error_Row_AVX2(const unsigned char * a, const unsigned char * b,
+                           int width, unsigned long long * squares, 
+                           int * maxError)
+{ // for loop variables
+  int col = 0, block, lane;
+
+  // the 32 bit lanes of a block, and the largest difference
+  unsigned int lanes[8]; __m256i total, largest = _mm256_setzero_si256();
+
+  const __m256i zero = _mm256_setzero_si256();
+
+  while(col + 32 <= width)
+  { // as for SSE2, the lanes are added up before they can overflow
+    total = _mm256_setzero_si256();
+    for(block = 0; block < 4096 && col + 32 <= width; block++, col += 32)
+    { __m256i va = _mm256_loadu_si256((const __m256i *)(a + col));
+      __m256i vb = _mm256_loadu_si256((const __m256i *)(b + col));
+      __m256i d = _mm256_or_si256(_mm256_subs_epu8(va, vb), 
+                                  _mm256_subs_epu8(vb, va));
+      __m256i lo = _mm256_unpacklo_epi8(d, zero);
+      __m256i hi = _mm256_unpackhi_epi8(d, zero);
+
+      largest = _mm256_max_epu8(largest, d);
+      total = _mm256_add_epi32(total, 
+                               _mm256_add_epi32(_mm256_madd_epi16(lo, lo),
+                                                _mm256_madd_epi16(hi, hi)));
+    }
+
+    _mm256_storeu_si256((__m256i *)lanes, total);
+    for(lane = 0; lane < 8; lane++) *squares += lanes[lane];
+  }
+
+  error_Row_SSE2(a + col, b + col, width - col, squares, maxError);
+
+  lane = max_Bytes_SSE2(_mm_max_epu8(_mm256_castsi256_si128(largest),
+                                     _mm256_extracti128_si256(largest, 1)));
+  if(lane > *maxError) *maxError = lane;
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS 16 UNSIGNED 16 BIT LANES TO 16 COLUMN SUMS               */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void add_Columns_AVX2(unsigned int * sums, __m256i v)
+{ _mm256_storeu_si256((__m256i *)sums, 
+    _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)sums), 
+                     _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v))));
+  _mm256_storeu_si256((__m256i *)(sums + 8), 
+    _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(sums + 8)), 
+                     _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1))));
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS THE SSIM COLUMN SUMS, 16 COLUMNS PER ITERATION           */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void accumulate_SSIM_Row_AVX2(const unsigned char * a,
+                                     const unsigned char * b, int width, 
+                                     unsigned int * sums)
+{ // for loop variable
+  int col = 0;
+
+  for(; col + 16 <= width; col += 16)
+  { __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)
+                                                      (a + col)));
+    __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)
+                                                      (b + col)));
+
+    add_Columns_AVX2(sums + col, va);
+    add_Columns_AVX2(sums + width + col, vb);
+    add_Columns_AVX2(sums + 2 * width + col, _mm256_mullo_epi16(va, va));
+    add_Columns_AVX2(sums + 3 * width + col, _mm256_mullo_epi16(vb, vb));
+    add_Columns_AVX2(sums + 4 * width + col, _mm256_mullo_epi16(va, vb));
+  }
+
+  // the rest, as for SSE2
+  for(; col < width; col++)
+  { sums[col]             += a[col];
+    sums[width + col]     += b[col];
+    sums[2 * width + col] += a[col] * a[col];
+    sums[3 * width + col] += b[col] * b[col];
+    sums[4 * width + col] += a[col] * b[col];
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS ALONG A ROW, 16 SAMPLES PER ITERATION                 */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void filter_Row_Horizontal_AVX2(const unsigned char * src, short * dst,
+                                       int samples, const short * weights,
+                                       int taps, int step)
+{ // for loop variables
+  int x = 0, k;
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i round = 
+    _mm256_set1_epi32(1 << (FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS - 1));
+
+  for(; x + 16 <= samples; x += 16)
+  { __m256i lo = round, hi = round;
+
+    // the unpacks work within 128 bit lanes, and so does the pack below,
+    // which puts the samples back in order
+    for(k = 0; k < taps; k += 2)
+    { const unsigned char * s = src + x + k * step;
+      __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)s));
+      __m256i b = zero, w;
+
+      if(k + 1 < taps)
+      { b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)
+                                                 (s + step)));
+        w = _mm256_set1_epi32(pair_Weights(weights[k], weights[k + 1]));
+      }
+      else w = _mm256_set1_epi32(pair_Weights(weights[k], 0));
+
+      lo = _mm256_add_epi32(lo, 
+                            _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+      hi = _mm256_add_epi32(hi, 
+                            _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+    }
+
+    lo = _mm256_srai_epi32(lo, FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS);
+    hi = _mm256_srai_epi32(hi, FILTER_WEIGHT_BITS - FILTER_SAMPLE_BITS);
+    _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packs_epi32(lo, hi));
+  }
+
+  filter_Row_Horizontal_SSE2(src + x, dst + x, samples - x, weights, taps,
+                             step);
+}
+
+/*---------------------------------------------------------------*/
+/* FILTERS DOWN ROWS, 16 SAMPLES PER ITERATION                   */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void filter_Row_Vertical_AVX2(const short * const * rows,
+                                     unsigned char * dst, int samples,
+                                     const short * weights, int taps,
+                                     int maxValue)
+{ // for loop variables
+  int x = 0, k;
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i round = 
+    _mm256_set1_epi32(1 << (FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS - 1));
+  const __m128i most = _mm_set1_epi8((char)maxValue);
+
+  // the last vector overlaps the one before it, as for SSE2
+  if(samples < 16)
+  { filter_Row_Vertical_SSE2(rows, dst, samples, weights, taps, maxValue);
+    return;
+  }
+
+  for(; x < samples; x += 16)
+  { __m256i lo = round, hi = round, v;
+
+    if(x + 16 > samples) x = samples - 16;
+
+    for(k = 0; k < taps; k += 2)
+    { __m256i a = _mm256_loadu_si256((const __m256i *)(rows[k] + x));
+      __m256i b = zero, w;
+
+      if(k + 1 < taps)
+      { b = _mm256_loadu_si256((const __m256i *)(rows[k + 1] + x));
+        w = _mm256_set1_epi32(pair_Weights(weights[k], weights[k + 1]));
+      }
+      else w = _mm256_set1_epi32(pair_Weights(weights[k], 0));
+
+      lo = _mm256_add_epi32(lo, 
+                            _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+      hi = _mm256_add_epi32(hi, 
+                            _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+    }
+
+    // the byte pack leaves samples 0-7 in the first quadword and 8-15 in
+    // the third, which the permute brings together
+    v = _mm256_packs_epi32(
+          _mm256_srai_epi32(lo, FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS),
+          _mm256_srai_epi32(hi, FILTER_WEIGHT_BITS + FILTER_SAMPLE_BITS));
+    v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 
+                                 _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128((__m128i *)(dst + x), 
+                     _mm_min_epu8(_mm256_castsi256_si128(v), most));
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS THE PAIRS OF BYTES OF TWO ROWS, AS FOR SSE2              */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static __m256i add_Pairs_AVX2(__m256i top, __m256i bottom)
+{ const __m256i low = _mm256_set1_epi16(0x00ff);
+
+  return _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(top, low),
+                                           _mm256_srli_epi16(top, 8)),
+                          _mm256_add_epi16(_mm256_and_si256(bottom, low),
+                                           _mm256_srli_epi16(bottom, 8)));
+}
+
+/*---------------------------------------------------------------*/
+/* HALVES TWO GRAY ROWS, 32 PIXELS PER ITERATION                 */
+/*---------------------------------------------------------------*/
+TARGET_AVX2
+static void downscale_Row_2x_AVX2(const unsigned char * top,
+                                  const unsigned char * bottom,
+                                  unsigned char * dst, int width,
+                                  int channels)
+{ // for loop variable
+  int x = 0;
+
+  const __m256i two = _mm256_set1_epi16(2);
+
+  if(channels != 1)
+  { downscale_Row_2x_SSE41(top, bottom, dst, width, channels);
+    return;
+  }
+
+  for(; x + 32 <= width; x += 32)
+  { __m256i lo = add_Pairs_AVX2(
+                   _mm256_loadu_si256((const __m256i *)(top + 2 * x)),
+                   _mm256_loadu_si256((const __m256i *)(bottom + 2 * x)));
+    __m256i hi = add_Pairs_AVX2(
+                   _mm256_loadu_si256((const __m256i *)(top + 2 * x + 32)),
+                   _mm256_loadu_si256((const __m256i *)(bottom + 2 * x + 32)));
+
+    // the pack interleaves the halves of lo and hi, the permute puts
+    // them back in order
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, two), 2);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, two), 2);
+    _mm256_storeu_si256((__m256i *)(dst + x),
+                        _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi),
+                                                 _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+
+  downscale_Row_2x_SSE2(top + 2 * x, bottom + 2 * x, dst + x, width - x, 1);
+}
+
+/*---------------------------------------------------------------*/
+/* FILLS THE TABLE WITH THE AVX2 KERNELS                         */
+/*---------------------------------------------------------------*/
+void init_Kernels_AVX2(struct PNM_Kernels * kernels)
+{ kernels->pack_PBM_Row         = pack_PBM_Row_AVX2;
+  kernels->unpack_PBM_Row       = unpack_PBM_Row_AVX2;
+  kernels->threshold_Row        = threshold_Row_AVX2;
+  kernels->threshold_Row_Packed = threshold_Row_Packed_AVX2;
+  kernels->expand_PBM_Row       = expand_PBM_Row_AVX2;
+  kernels->expand_Packed_Row    = expand_Packed_Row_AVX2;
+  kernels->error_Row            = error_Row_AVX2;
+  kernels->accumulate_SSIM_Row  = accumulate_SSIM_Row_AVX2;
+  kernels->filter_Row_Horizontal = filter_Row_Horizontal_AVX2;
+  kernels->filter_Row_Vertical  = filter_Row_Vertical_AVX2;
+  kernels->downscale_Row_2x     = downscale_Row_2x_AVX2;
+}
+
+/*====================================================================*/
+/* AVX-512BW                                                          */
+/*====================================================================*/
+
+/*---------------------------------------------------------------*/
+/* REVERSES THE BYTES WITHIN EVERY GROUP OF 8                    */
+/*---------------------------------------------------------------*/
+TARGET_AVX512BW
+static __m512i reverse_Groups_Of_8(__m512i v)
+{ return _mm512_shuffle_epi8(v,
+           _mm512_broadcast_i32x4(_mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+                                                15, 14, 13, 12, 11, 10, 9, 8)));
+}
+
+/*---------------------------------------------------------------*/
+/* PACKS A ROW OF 0/1 PIXELS, 64 PIXELS (8 BYTES) PER ITERATION  */
+/*---------------------------------------------------------------*/
+TARGET_AVX512BW
+static void pack_PBM_Row_AVX512BW(const unsigned char * row,
+                                  unsigned char * packed, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m512i ones = _mm512_set1_epi8(1);
+
+  for(; col + 64 <= width; col += 64)
+  { __mmask64 mask = _mm512_cmpeq_epi8_mask(
+                       reverse_Groups_Of_8(_mm512_loadu_si512(row + col)),
+                       ones);
+    memcpy(packed + (col >> 3), &mask, 8);
+  }
+
+  pack_PBM_Row_AVX2(row + col, packed + (col >> 3), width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* UNPACKS A RAW PBM ROW, 8 BYTES (64 PIXELS) PER ITERATION      */
+/*---------------------------------------------------------------*/
+TARGET_AVX512BW
+static void unpack_PBM_Row_AVX512BW(const unsigned char * packed,
+                                    unsigned char * row, int width)
+{ // for loop variable
+  int col = 0;
+
+  const __m512i ones = _mm512_set1_epi8(1);
+
+  for(; col + 64 <= width; col += 64)
+  { __mmask64 mask;
+
+    // lane 8j + k gets bit k of byte j, the pixel order wants bit 7 - k
+    memcpy(&mask, packed + (col >> 3), 8);
+    _mm512_storeu_si512(row + col,
+      _mm512_and_si512(reverse_Groups_Of_8(_mm512_movm_epi8(mask)), ones));
+  }
+
+  unpack_PBM_Row_AVX2(packed + (col >> 3), row + col, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS GRAY SAMPLES, 64 PIXELS PER ITERATION              */
+/*---------------------------------------------------------------*/
+TARGET_AVX512BW
+static void threshold_Row_AVX512BW(const unsigned char * src, int stride,
+                                   unsigned char * row, int width,
+                                   int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m512i t = _mm512_set1_epi8((char)threshold);
+  const __m512i ones = _mm512_set1_epi8(1);
+
+  if(stride != 1)
+  { threshold_Row_AVX2(src, stride, row, width, threshold);
+    return;
+  }
+
+  for(; col + 64 <= width; col += 64)
+    _mm512_storeu_si512(row + col,
+      _mm512_maskz_mov_epi8(
+        _mm512_cmplt_epu8_mask(_mm512_loadu_si512(src + col), t), ones));
+
+  threshold_Row_AVX2(src + col, 1, row + col, width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* THRESHOLDS GRAY SAMPLES INTO PACKED BITS, 64 PIXELS AT A TIME */
+/*---------------------------------------------------------------*/
+TARGET_AVX512BW
+static void threshold_Row_Packed_AVX512BW(const unsigned char * src,
+                                          int stride, unsigned char * packed,
+                                          int width, int threshold)
+{ // for loop variable
+  int col = 0;
+
+  const __m512i t = _mm512_set1_epi8((char)threshold);
+
+  if(stride != 1)
+  { threshold_Row_Packed_AVX2(src, stride, packed, width, threshold);
+    return;
+  }
+
+  for(; col + 64 <= width; col += 64)
+  { __mmask64 mask = _mm512_cmplt_epu8_mask(
+                       reverse_Groups_Of_8(_mm512_loadu_si512(src + col)), t);
+    memcpy(packed + (col >> 3), &mask, 8);
+  }
+
+  threshold_Row_Packed_AVX2(src + col, 1, packed + (col >> 3),
+                            width - col, threshold);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PBM PIXELS TO GRAY SAMPLES, 64 PIXELS PER ITERATION   */
+/*---------------------------------------------------------------*/
+TARGET_AVX512BW
+static void expand_PBM_Row_AVX512BW(const unsigned char * row,
+                                    unsigned char * dst,
+                                    int channels, int width)
+{ // for loop variable
+  int col = 0;
+
+  if(channels != 1)
+  { expand_PBM_Row_AVX2(row, dst, channels, width);
+    return;
+  }
+
+  for(; col + 64 <= width; col += 64)
+    _mm512_storeu_si512(dst + col,
+      _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(_mm512_loadu_si512(row + col),
+                                              _mm512_set1_epi8(WHITE))));
+
+  expand_PBM_Row_AVX2(row + col, dst + col, 1, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS PACKED BITS TO GRAY SAMPLES, 64 PIXELS PER ITERATION  */
+/*---------------------------------------------------------------*/
+TARGET_AVX512BW
+static void expand_Packed_Row_AVX512BW(const unsigned char * packed,
+                                       unsigned char * dst,
+                                       int channels, int width)
+{ // for loop variable
+  int col = 0;
+
+  if(channels != 1)
+  { expand_Packed_Row_AVX2(packed, dst, channels, width);
+    return;
+  }
+
+  for(; col + 64 <= width; col += 64)
+  { __mmask64 mask;
+
+    // clear bits are WHITE
+    memcpy(&mask, packed + (col >> 3), 8);
+    _mm512_storeu_si512(dst + col,
+                        reverse_Groups_Of_8(_mm512_movm_epi8(~mask)));
+  }
+
+  expand_Packed_Row_AVX2(packed + (col >> 3), dst + col, 1, width - col);
+}
+
+/*---------------------------------------------------------------*/
+/* FILLS THE TABLE WITH THE AVX-512BW KERNELS                    */
+/*---------------------------------------------------------------*/
+void init_Kernels_AVX512BW(struct PNM_Kernels * kernels)
+{ kernels->pack_PBM_Row         = pack_PBM_Row_AVX512BW;
+  kernels->unpack_PBM_Row       = unpack_PBM_Row_AVX512BW;
+  kernels->threshold_Row        = threshold_Row_AVX512BW;
+  kernels->threshold_Row_Packed = threshold_Row_Packed_AVX512BW;
+  kernels->expand_PBM_Row       = expand_PBM_Row_AVX512BW;
+  kernels->expand_Packed_Row    = expand_Packed_Row_AVX512BW;
+}
+
+#endif /* __x86_64__ || __i386__ */
@@ -0,0 +1,772 @@
+#include <string.h>
+#include <limits.h>
+#include "libpnm.h"
+#include "libpnm_lossless.h"
+#include "libpnm_thread.h"
+
+// the activity contexts of the regular mode
+# define CONTEXTS 8
+
+// statistics are halved after this many samples, so they keep adapting
+# define RESET 64
+
+// quotients this long are escaped to the raw value
+# define QUOTIENT_LIMIT 24
+
+// the raw bits of an escaped run length
+# define RUN_BITS 32
+
+// the most bytes a sample can take (a run code and an escaped sample)
+# define SAMPLE_BOUND 12
+
+/*-----------------------------------------------*/
+/* THE STATISTICS OF ONE ADAPTIVE GOLOMB CODE    */
+/*-----------------------------------------------*/
+struct Golomb_Code
+{ // the sum of the coded values, and how many there were
+  long long sum; int count;
+};
+
+/*-----------------------------------------------*/
+/* THE CODER STATE OF ONE PLANE IN A STRIPE      */
+/*-----------------------------------------------*/
+struct Plane_Coder
+{ // the lowest sample, the number of sample values (a power of 2) and
+  // the bits to write one
+  int low, range, bits;
+
+  // the regular mode codes, one per context, and the run mode code
+  struct Golomb_Code regular[CONTEXTS], run;
+};
+
+/*-----------------------------------------------*/
+/* A BIT STREAM, MOST SIGNIFICANT BIT FIRST      */
+/*-----------------------------------------------*/
+struct Bit_Stream
+{ // the bytes and how many are written or may be read
+  unsigned char * data; size_t length;
+
+  // the read position, and whether a read ran past the end
+  size_t position; int overrun;
+
+  // the bits waiting to be written or read, and how many
+  unsigned long long bits; int count;
+};
+
+/*-----------------------------------------------*/
+/* AN IMAGE BEING ENCODED OR DECODED             */
+/*-----------------------------------------------*/
+struct Lossless_Job
+{ // the rows (PPM rows are RGB triples), and the pixel geometry
+  unsigned char * * rows; int width, height, pixelBytes;
+
+  // whether PPM planes are Y, U, V
+  bool colourTransform;
+
+  // the rows in a stripe, and the number of stripes
+  int stripeRows, stripes;
+
+  // encoding: the bit stream of every stripe
+  unsigned char * * stripeData; size_t * stripeLength;
+
+  // decoding: the whole file and the offset of every stripe in it
+  const unsigned char * file; unsigned long long * offsets;
+
+  // set by any stripe that fails
+  int failed;
+};
+
+/*---------------------------------------------------------------*/
+/* STORES AND LOADS LITTLE ENDIAN NUMBERS                        */
+/*---------------------------------------------------------------*/
+static void put_Little(unsigned char * bytes, unsigned long long value,
+                       int count)
+{ int byte;
+
+  for(byte = 0; byte < count; byte++) bytes[byte] = value >> (8 * byte);
+}
+
+static unsigned long long get_Little(const unsigned char * bytes, int count)
+{ unsigned long long value = 0; int byte;
+
+  for(byte = count - 1; byte >= 0; byte--) value = (value << 8) | bytes[byte];
+
+  return value;
+}
+
+/*---------------------------------------------------------------*/
+/* WRITES THE LOW count BITS OF value (count <= 32)              */
+/*---------------------------------------------------------------*/
+static void put_Bits(struct Bit_Stream * stream, unsigned long long value,
+                     int count)
+{ stream->bits = (stream->bits << count) | value;
+  stream->count += count;
+
+  while(stream->count >= 8)
+  { stream->count -= 8;
+    stream->data[stream->length++] = stream->bits >> stream->count;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* READS count BITS (count <= 32), ZEROS PAST THE END            */
+/*---------------------------------------------------------------*/
+static unsigned long long get_Bits(struct Bit_Stream * stream, int count)
+{ while(stream->count < count)
+  { stream->bits <<= 8;
+    if(stream->position < stream->length)
+      stream->bits |= stream->data[stream->position++];
+    else
+      stream->overrun = 1;
+    stream->count += 8;
+  }
+
+  stream->count -= count;
+  return (stream->bits >> stream->count) & ((1ULL << count) - 1);
+}
+
+/*---------------------------------------------------------------*/
+/* THE GOLOMB-RICE PARAMETER FOR THE MEAN SO FAR                 */
+/*---------------------------------------------------------------*/
+static int golomb_Parameter(const struct Golomb_Code * code)
+{ int k = 0;
+
+  while(k < 24 && ((long long)code->count << k) < code->sum) k++;
+
+  return k;
+}
+
+/*---------------------------------------------------------------*/
+/* ADDS A CODED VALUE TO THE STATISTICS                          */
+/*---------------------------------------------------------------*/
+static void golomb_Update(struct Golomb_Code * code, unsigned int value)
+{ code->sum += value;
+  if(++code->count >= RESET)
+  { code->sum = (code->sum + 1) >> 1;
+    code->count >>= 1;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* CODES A VALUE: A UNARY QUOTIENT AND k REMAINDER BITS, OR THE  */
+/* ESCAPE AND rawBits OF THE VALUE WHEN THE QUOTIENT IS TOO LONG */
+/*---------------------------------------------------------------*/
+static void put_Golomb(struct Bit_Stream * stream, struct Golomb_Code * code,
+                       unsigned int value, int rawBits)
+{ int k = golomb_Parameter(code);
+  unsigned int quotient = value >> k;
+
+  if(quotient < QUOTIENT_LIMIT)
+  { put_Bits(stream, 1, quotient + 1);
+    put_Bits(stream, value & ((1U << k) - 1), k);
+  }
+  else
+  { put_Bits(stream, 0, QUOTIENT_LIMIT);
+    put_Bits(stream, value, rawBits);
+  }
+
+  golomb_Update(code, value);
+}
+
+static unsigned int get_Golomb(struct Bit_Stream * stream,
+                               struct Golomb_Code * code, int rawBits)
+{ int k = golomb_Parameter(code);
+  unsigned int quotient = 0, value;
+
+  while(quotient < QUOTIENT_LIMIT && get_Bits(stream, 1) == 0) quotient++;
+
+  if(quotient < QUOTIENT_LIMIT)
+    value = (quotient << k) | (unsigned int)get_Bits(stream, k);
+  else
+    value = (unsigned int)get_Bits(stream, rawBits);
+
+  golomb_Update(code, value);
+  return value;
+}
+
+/*---------------------------------------------------------------*/
+/* SETS UP THE CODER OF A PLANE OF range VALUES FROM low         */
+/*---------------------------------------------------------------*/
+static void init_Plane_Coder(struct Plane_Coder * coder, int low, int range)
+{ int context;
+
+  coder->low = low;
+  coder->range = range;
+  coder->bits = 0;
+  while((1 << coder->bits) < range) coder->bits++;
+
+  for(context = 0; context < CONTEXTS; context++)
+  { coder->regular[context].sum = 4;
+    coder->regular[context].count = 1;
+  }
+  coder->run.sum = 4;
+  coder->run.count = 1;
+}
+
+/*---------------------------------------------------------------*/
+/* THE NEIGHBOURS OF SAMPLE col, THE MED PREDICTION AND THE      */
+/* ACTIVITY CONTEXT (0 ONLY WHERE a, b AND c ARE EQUAL)          */
+/*---------------------------------------------------------------*/
+static int predict(const int * row, const int * above, int col,
+                   int * left, int * context)
+{ // left, upper and upper left, standing in for each other at the edges
+  int a, b, c, activity;
+
+  if(col > 0) a = row[col - 1];
+  else a = (above != NULL) ? above[0] : 0;
+  b = (above != NULL) ? above[col] : a;
+  c = (above != NULL && col > 0) ? above[col - 1] : b;
+
+  activity = abs(a - c) + abs(b - c);
+  if(activity == 0) *context = 0;
+  else if(activity <= 2) *context = 1;
+  else if(activity <= 6) *context = 2;
+  else if(activity <= 14) *context = 3;
+  else if(activity <= 30) *context = 4;
+  else if(activity <= 62) *context = 5;
+  else if(activity <= 126) *context = 6;
+  else *context = 7;
+
+  *left = a;
+
+  // the median edge detector
+  if(c >= (a > b ? a : b)) return a < b ? a : b;
+  if(c <= (a < b ? a : b)) return a > b ? a : b;
+  return a + b - c;
+}
+
+/*---------------------------------------------------------------*/
+/* CODES ONE SAMPLE IN THE REGULAR MODE                          */
+/*---------------------------------------------------------------*/
+static void put_Sample(struct Bit_Stream * stream, struct Plane_Coder * coder,
+                       int context, int sample, int prediction)
+{ // the residual, reduced to the range of the plane, and mapped to >= 0
+  int half = coder->range >> 1;
+  int residual = ((sample - prediction + half) & (coder->range - 1)) - half;
+  unsigned int value = residual >= 0 ? 2 * residual : -2 * residual - 1;
+
+  put_Golomb(stream, &coder->regular[context], value, coder->bits);
+}
+
+static int get_Sample(struct Bit_Stream * stream, struct Plane_Coder * coder,
+                      int context, int prediction)
+{ unsigned int value = get_Golomb(stream, &coder->regular[context],
+                                  coder->bits);
+  int residual = (value & 1) ? -(int)((value + 1) >> 1) : (int)(value >> 1);
+
+  return coder->low +
+         ((prediction + residual - coder->low) & (coder->range - 1));
+}
+
+/*---------------------------------------------------------------*/
+/* ENCODES A ROW OF A PLANE (above is NULL on a stripe's first)  */
+/*---------------------------------------------------------------*/
+static void encode_Plane_Row(struct Bit_Stream * stream,
+                             struct Plane_Coder * coder,
+                             const int * row, const int * above, int width)
+{ int col = 0, run, prediction, left, context;
+
+  while(col < width)
+  { prediction = predict(row, above, col, &left, &context);
+
+    // a flat neighbourhood codes the run of samples equal to the left one,
+    // and the sample that ends it (if any) in the regular mode
+    if(context == 0)
+    { run = 0;
+      while(col + run < width && row[col + run] == left) run++;
+      put_Golomb(stream, &coder->run, run, RUN_BITS);
+      col += run;
+      if(col == width) break;
+      prediction = predict(row, above, col, &left, &context);
+    }
+
+    put_Sample(stream, coder, context, row[col], prediction);
+    col++;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* DECODES A ROW OF A PLANE                                      */
+/*---------------------------------------------------------------*/
+static int decode_Plane_Row(struct Bit_Stream * stream,
+                            struct Plane_Coder * coder,
+                            int * row, const int * above, int width)
+{ int col = 0, prediction, left, context;
+  unsigned int run;
+
+  while(col < width)
+  { prediction = predict(row, above, col, &left, &context);
+
+    if(context == 0)
+    { run = get_Golomb(stream, &coder->run, RUN_BITS);
+      if(run > (unsigned int)(width - col)) return - 1;
+      for(; run > 0; run--) row[col++] = left;
+      if(col == width) break;
+      prediction = predict(row, above, col, &left, &context);
+    }
+
+    row[col] = get_Sample(stream, coder, context, prediction);
+    col++;
+  }
+
+  return stream->overrun ? - 1 : 0;
+}
+
+/*---------------------------------------------------------------*/
+/* FLOOR OF x / 4 FOR NEGATIVE x TOO                             */
+/*---------------------------------------------------------------*/
+static int floor_Quarter(int x)
+{ return x >= 0 ? x / 4 : -((3 - x) / 4);
+}
+
+/*---------------------------------------------------------------*/
+/* SPLITS AN IMAGE ROW INTO ITS PLANES                           */
+/*---------------------------------------------------------------*/
+static void split_Row(const struct Lossless_Job * job,
+                      const unsigned char * pixels, int * planes[3])
+{ int col, r, g, b;
+
+  for(col = 0; col < job->width; col++)
+    if(job->pixelBytes == 1) planes[0][col] = pixels[col];
+    else
+    { r = pixels[3 * col];
+      g = pixels[3 * col + 1];
+      b = pixels[3 * col + 2];
+      if(job->colourTransform)
+      { planes[0][col] = floor_Quarter(r + 2 * g + b);
+        planes[1][col] = b - g;
+        planes[2][col] = r - g;
+      }
+      else
+      { planes[0][col] = r;
+        planes[1][col] = g;
+        planes[2][col] = b;
+      }
+    }
+}
+
+/*---------------------------------------------------------------*/
+/* JOINS THE PLANES OF A ROW BACK INTO IMAGE PIXELS              */
+/*---------------------------------------------------------------*/
+static void join_Row(const struct Lossless_Job * job, int * planes[3],
+                     unsigned char * pixels)
+{ int col, g;
+
+  for(col = 0; col < job->width; col++)
+    if(job->pixelBytes == 1) pixels[col] = planes[0][col];
+    else if(job->colourTransform)
+    { g = planes[0][col] - floor_Quarter(planes[1][col] + planes[2][col]);
+      pixels[3 * col] = planes[2][col] + g;
+      pixels[3 * col + 1] = g;
+      pixels[3 * col + 2] = planes[1][col] + g;
+    }
+    else
+    { pixels[3 * col] = planes[0][col];
+      pixels[3 * col + 1] = planes[1][col];
+      pixels[3 * col + 2] = planes[2][col];
+    }
+}
+
+/*---------------------------------------------------------------*/
+/* SETS UP THE PLANE CODERS AND TWO ROWS OF EVERY PLANE          */
+/*---------------------------------------------------------------*/
+static int * init_Stripe(const struct Lossless_Job * job,
+                         struct Plane_Coder coders[3],
+                         int * rows[3], int * aboves[3])
+{ int planes = job->pixelBytes, plane;
+  int * samples = (int *)malloc(sizeof(int) * 2 * planes *
+                                ((size_t)job->width + 1));
+
+  if(samples == NULL) return NULL;
+
+  for(plane = 0; plane < planes; plane++)
+  { rows[plane] = samples + (size_t)2 * plane * (job->width + 1);
+    aboves[plane] = rows[plane] + job->width + 1;
+
+    // chroma differences take values from -255 to 255
+    if(job->colourTransform && plane > 0)
+      init_Plane_Coder(&coders[plane], -256, 512);
+    else
+      init_Plane_Coder(&coders[plane], 0, 256);
+  }
+
+  return samples;
+}
+
+/*---------------------------------------------------------------*/
+/* ENCODES ONE STRIPE OF ROWS                                    */
+/*---------------------------------------------------------------*/
+static void encode_Stripe(void * context, int stripe)
+{ struct Lossless_Job * job = (struct Lossless_Job *)context;
+
+  // the rows of the stripe
+  int first = stripe * job->stripeRows, row, plane;
+  int last = (first + job->stripeRows < job->height) ?
+             first + job->stripeRows : job->height;
+
+  struct Plane_Coder coders[3]; int * rows[3], * aboves[3], * swap;
+  struct Bit_Stream stream;
+  int * samples = init_Stripe(job, coders, rows, aboves);
+
+  memset(&stream, 0, sizeof(stream));
+  stream.data = (unsigned char *)malloc((size_t)SAMPLE_BOUND * job->width *
+                                        job->pixelBytes * (last - first) + 16);
+  if(samples == NULL || stream.data == NULL)
+  { free(samples);
+    free(stream.data);
+    job->failed = 1;
+    return;
+  }
+
+  for(row = first; row < last; row++)
+  { split_Row(job, job->rows[row], rows);
+    for(plane = 0; plane < job->pixelBytes; plane++)
+    { encode_Plane_Row(&stream, &coders[plane], rows[plane],
+                       row > first ? aboves[plane] : NULL, job->width);
+
+      // this row is above the next one
+      swap = aboves[plane];
+      aboves[plane] = rows[plane];
+      rows[plane] = swap;
+    }
+  }
+
+  // pad the last byte
+  if(stream.count > 0) put_Bits(&stream, 0, 8 - stream.count);
+
+  free(samples);
+  job->stripeData[stripe] = stream.data;
+  job->stripeLength[stripe] = stream.length;
+}
+
+/*---------------------------------------------------------------*/
+/* DECODES ONE STRIPE OF ROWS                                    */
+/*---------------------------------------------------------------*/
+static void decode_Stripe(void * context, int stripe)
+{ struct Lossless_Job * job = (struct Lossless_Job *)context;
+
+  int first = stripe * job->stripeRows, row, plane;
+  int last = (first + job->stripeRows < job->height) ?
+             first + job->stripeRows : job->height;
+
+  struct Plane_Coder coders[3]; int * rows[3], * aboves[3], * swap;
+  struct Bit_Stream stream;
+  int * samples = init_Stripe(job, coders, rows, aboves);
+
+  if(samples == NULL)
+  { job->failed = 1;
+    return;
+  }
+
+  memset(&stream, 0, sizeof(stream));
+  stream.data = (unsigned char *)job->file + job->offsets[stripe];
+  stream.length = job->offsets[stripe + 1] - job->offsets[stripe];
+
+  for(row = first; row < last; row++)
+  { for(plane = 0; plane < job->pixelBytes; plane++)
+      if(decode_Plane_Row(&stream, &coders[plane], rows[plane],
+                          row > first ? aboves[plane] : NULL,
+                          job->width) != 0)
+      { free(samples);
+        job->failed = 1;
+        return;
+      }
+
+    join_Row(job, rows, job->rows[row]);
+
+    for(plane = 0; plane < job->pixelBytes; plane++)
+    { swap = aboves[plane];
+      aboves[plane] = rows[plane];
+      rows[plane] = swap;
+    }
+  }
+
+  free(samples);
+}
+
+/*---------------------------------------------------------------*/
+/* WRITES ROWS LOSSLESSLY CODED TO AN OPEN FILE                  */
+/*---------------------------------------------------------------*/
+static int write_Lossless(FILE * imageFilePointer, enum Format format,
+                          int width, int height, int maxGrayValue,
+                          unsigned char * * rows, bool colourTransform)
+{ struct Lossless_Job job;
+
+  // the header and the stripe offsets
+  unsigned char header[LOSSLESS_HEADER_BYTES] = {0};
+  unsigned char * index; unsigned long long offset;
+
+  // for loop variable, and the result
+  int stripe, status = 0;
+
+  memset(&job, 0, sizeof(job));
+  job.rows = rows;
+  job.width = width;
+  job.height = height;
+  job.pixelBytes = (format == PPM) ? 3 : 1;
+  job.colourTransform = (format == PPM) && colourTransform;
+  job.stripeRows = LOSSLESS_STRIPE_ROWS;
+  job.stripes = (height + LOSSLESS_STRIPE_ROWS - 1) / LOSSLESS_STRIPE_ROWS;
+
+  job.stripeData = (unsigned char * *)
+                   calloc(job.stripes + 1, sizeof(unsigned char *));
+  job.stripeLength = (size_t *)calloc(job.stripes + 1, sizeof(size_t));
+  index = (unsigned char *)malloc(((size_t)job.stripes + 1) * 8);
+
+  if(job.stripeData == NULL || job.stripeLength == NULL || index == NULL)
+    status = - 1;
+
+  // code the stripes
+  if(status == 0)
+  { run_Parallel(job.stripes, encode_Stripe, &job);
+    if(job.failed) status = - 1;
+  }
+
+  if(status == 0)
+  { // lay the stripes out one after the other
+    offset = LOSSLESS_HEADER_BYTES + ((unsigned long long)job.stripes + 1) * 8;
+    for(stripe = 0; stripe <= job.stripes; stripe++)
+    { put_Little(index + (size_t)stripe * 8, offset, 8);
+      if(stripe < job.stripes) offset += job.stripeLength[stripe];
+    }
+
+    memcpy(header, LOSSLESS_MAGIC, 4);
+    header[4] = LOSSLESS_VERSION;
+    header[5] = format;
+    header[6] = job.colourTransform ? LOSSLESS_COLOUR_TRANSFORM : 0;
+    put_Little(header + 8, width, 4);
+    put_Little(header + 12, height, 4);
+    put_Little(header + 16, maxGrayValue, 4);
+    put_Little(header + 20, job.stripeRows, 4);
+    put_Little(header + 24, job.stripes, 4);
+
+    fwrite(header, 1, LOSSLESS_HEADER_BYTES, imageFilePointer);
+    fwrite(index, 1, ((size_t)job.stripes + 1) * 8, imageFilePointer);
+    for(stripe = 0; stripe < job.stripes; stripe++)
+      fwrite(job.stripeData[stripe], 1, job.stripeLength[stripe],
+             imageFilePointer);
+
+    if(ferror(imageFilePointer)) status = - 1;
+  }
+
+  if(job.stripeData != NULL)
+    for(stripe = 0; stripe < job.stripes; stripe++)
+      free(job.stripeData[stripe]);
+  free(job.stripeData);
+  free(job.stripeLength);
+  free(index);
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* READS A WHOLE CODED FILE, CHECKS ITS HEADER AND STRIPE        */
+/* OFFSETS AND SETS UP THE JOB THAT DECODES IT                   */
+/*---------------------------------------------------------------*/
+static unsigned char * read_Lossless_File(char * fileName, enum Format format,
+                                          int * maxGrayValue,
+                                          struct Lossless_Job * job)
+{ // the whole file
+  unsigned char * file = NULL; long length;
+
+  // the header fields, and a for loop variable
+  unsigned long long width, height, stripeRows, stripes; int stripe;
+
+  FILE * imageFilePointer = fileOpener(READ, fileName);
+  if(imageFilePointer == NULL) return NULL;
+
+  if(fseek(imageFilePointer, 0, SEEK_END) == 0 &&
+     (length = ftell(imageFilePointer)) >= LOSSLESS_HEADER_BYTES &&
+     fseek(imageFilePointer, 0, SEEK_SET) == 0)
+  { file = (unsigned char *)malloc(length);
+    if(file != NULL &&
+       fread(file, 1, length, imageFilePointer) != (size_t)length)
+    { free(file);
+      file = NULL;
+    }
+  }
+  fclose(imageFilePointer);
+
+  if(file == NULL) return NULL;
+
+  width = get_Little(file + 8, 4);
+  height = get_Little(file + 12, 4);
+  *maxGrayValue = (int)get_Little(file + 16, 4);
+  stripeRows = get_Little(file + 20, 4);
+  stripes = get_Little(file + 24, 4);
+
+  // check the header, and that the stripes cover the image
+  if(memcmp(file, LOSSLESS_MAGIC, 4) != 0 || file[4] != LOSSLESS_VERSION ||
+     file[5] != format || width > INT_MAX || height > INT_MAX ||
+     *maxGrayValue > 255 || stripeRows == 0 || stripeRows > INT_MAX ||
+     stripes != (height + stripeRows - 1) / stripeRows ||
+     (unsigned long long)(length - LOSSLESS_HEADER_BYTES) / 8 < stripes + 1)
+  { free(file);
+    return NULL;
+  }
+
+  memset(job, 0, sizeof(*job));
+  job->width = (int)width;
+  job->height = (int)height;
+  job->pixelBytes = (format == PPM) ? 3 : 1;
+  job->colourTransform = (file[6] & LOSSLESS_COLOUR_TRANSFORM) != 0;
+  job->stripeRows = (int)stripeRows;
+  job->stripes = (int)stripes;
+  job->file = file;
+
+  job->offsets = (unsigned long long *)
+                 calloc(stripes + 1, sizeof(unsigned long long));
+  if(job->offsets == NULL)
+  { free(file);
+    return NULL;
+  }
+
+  // the stripes must follow each other inside the file
+  for(stripe = 0; stripe <= job->stripes; stripe++)
+  { job->offsets[stripe] =
+      get_Little(file + LOSSLESS_HEADER_BYTES + (size_t)stripe * 8, 8);
+    if(job->offsets[stripe] > (unsigned long long)length ||
+       (stripe > 0 && job->offsets[stripe] < job->offsets[stripe - 1]))
+    { free(job->offsets);
+      free(file);
+      return NULL;
+    }
+  }
+
+  return file;
+}
+
+/*---------------------------------------------------------------*/
+/* DECODES THE STRIPES OF A READ FILE IN PARALLEL AND RELEASES   */
+/* IT                                                            */
+/*---------------------------------------------------------------*/
+static int decode_Lossless_File(unsigned char * file,
+                                struct Lossless_Job * job)
+{ run_Parallel(job->stripes, decode_Stripe, job);
+
+  free(job->offsets);
+  free(file);
+
+  return job->failed ? - 1 : 0;
+}
+
+/*---------------------------------------------------------------*/
+/* WRITES AN IMAGE LOSSLESSLY CODED TO AN OPEN FILE              */
+/*---------------------------------------------------------------*/
+int write_PGM_Image_Lossless(struct PGM_Image * pgmImage,
+                             FILE * imageFilePointer)
+{ return write_Lossless(imageFilePointer, PGM, pgmImage->width,
+                        pgmImage->height, pgmImage->maxGrayValue,
+                        pgmImage->image, false);
+}
+
+int write_PPM_Image_Lossless(struct PPM_Image * ppmImage,
+                             FILE * imageFilePointer, bool colourTransform)
+{ // the RGB triples of each row follow each other
+  unsigned char * * rows; int row, status;
+
+  rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+  if(rows == (unsigned char * *)0) return - 1;
+
+  for(row = 0; row < ppmImage->height; row++)
+    rows[row] = ppmImage->image[row][0];
+
+  status = write_Lossless(imageFilePointer, PPM, ppmImage->width,
+                          ppmImage->height, ppmImage->maxGrayValue, rows,
+                          colourTransform);
+  free(rows);
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* SAVES AN IMAGE LOSSLESSLY CODED TO FILE                       */
+/*---------------------------------------------------------------*/
+int save_PGM_Image_Lossless(struct PGM_Image * pgmImage, char * fileName)
+{ int status;
+
+  FILE * imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PGM_Image_Lossless(pgmImage, imageFilePointer);
+  if(fclose(imageFilePointer) != 0) status = - 1;
+
+  return status;
+}
+
+int save_PPM_Image_Lossless(struct PPM_Image * ppmImage, char * fileName,
+                            bool colourTransform)
+{ int status;
+
+  FILE * imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PPM_Image_Lossless(ppmImage, imageFilePointer,
+                                    colourTransform);
+  if(fclose(imageFilePointer) != 0) status = - 1;
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* THE 'CONSTRUCTORS' WHICH LOAD A LOSSLESSLY CODED IMAGE        */
+/*---------------------------------------------------------------*/
+int load_PGM_Image_Lossless(struct PGM_Image * pgmImage, char * fileName)
+{ struct Lossless_Job job; int maxGrayValue;
+  unsigned char * file = read_Lossless_File(fileName, PGM, &maxGrayValue,
+                                            &job);
+
+  if(file == NULL) return - 1;
+
+  if(create_PGM_Image(pgmImage, job.width, job.height, maxGrayValue) == -1)
+  { free(job.offsets);
+    free(file);
+    return - 1;
+  }
+
+  job.rows = pgmImage->image;
+  if(decode_Lossless_File(file, &job) != 0)
+  { free_PGM_Image(pgmImage);
+    return - 1;
+  }
+
+  return 0;
+}
+
+int load_PPM_Image_Lossless(struct PPM_Image * ppmImage, char * fileName)
+{ struct Lossless_Job job; int maxGrayValue;
+  unsigned char * * rows; int row, status;
+  unsigned char * file = read_Lossless_File(fileName, PPM, &maxGrayValue,
+                                            &job);
+
+  if(file == NULL) return - 1;
+
+  if(create_PPM_Image(ppmImage, job.width, job.height, maxGrayValue) == -1)
+  { free(job.offsets);
+    free(file);
+    return - 1;
+  }
+
+  // decode straight into the RGB triples of each row
+  rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+  if(rows == (unsigned char * *)0)
+  { free(job.offsets);
+    free(file);
+    free_PPM_Image(ppmImage);
+    return - 1;
+  }
+
+  for(row = 0; row < ppmImage->height; row++)
+    rows[row] = ppmImage->image[row][0];
+
+  job.rows = rows;
+  status = decode_Lossless_File(file, &job);
+  free(rows);
+
+  if(status != 0)
+  { free_PPM_Image(ppmImage);
+    return - 1;
+  }
+
+  return 0;
+}
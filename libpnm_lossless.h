@@ -0,0 +1,70 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_LOSSLESS_H_
+#define _PNM_LOSSLESS_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* A LOSSLESS PREDICTIVE CODEC FOR PGM AND PPM IMAGES                 */
+/*                                                                    */
+/* Each sample is predicted from its left, upper and upper left       */
+/* neighbours with the LOCO-I median edge detector, and the residual  */
+/* is coded with an adaptive Golomb-Rice code whose parameter follows */
+/* the mean residual in one of 8 contexts of local activity. Where    */
+/* the neighbourhood is flat the coder switches to run mode and codes */
+/* the length of the run of samples equal to the left one instead.    */
+/*                                                                    */
+/* PPM images are coded as three planes, either R, G and B or, with   */
+/* the reversible colour transform, Y = (R + 2G + B) / 4, U = B - G,  */
+/* V = R - G (exactly invertible in integers).                        */
+/*                                                                    */
+/* The image is cut into stripes of LOSSLESS_STRIPE_ROWS rows that    */
+/* are coded independently (predictors and statistics restart), so    */
+/* stripes encode and decode in parallel. All numbers are little      */
+/* endian; the file is a header of LOSSLESS_HEADER_BYTES:             */
+/*                                                                    */
+/*   "PLOC"  u8 version  u8 format (2 PGM, 3 PPM)  u8 flags  u8 zero  */
+/*   u32 width  u32 height  u32 maxGrayValue  u32 stripeRows          */
+/*   u32 stripes                                                      */
+/*                                                                    */
+/* then stripes + 1 u64 file offsets (the last is the end of the      */
+/* file), then the bit streams of the stripes, most significant bit   */
+/* first.                                                             */
+/*--------------------------------------------------------------------*/
+
+// the container header
+# define LOSSLESS_MAGIC "PLOC"
+# define LOSSLESS_VERSION 1
+# define LOSSLESS_HEADER_BYTES 28
+
+// the header flag set when the colour transform was applied
+# define LOSSLESS_COLOUR_TRANSFORM 1
+
+// the rows coded by one thread
+# define LOSSLESS_STRIPE_ROWS 64
+
+/*---------------------------------------------------------------*/
+/* WRITES AN IMAGE LOSSLESSLY CODED TO AN OPEN FILE              */
+/* (colourTransform codes a PPM as Y, U, V rather than R, G, B)  */
+/*---------------------------------------------------------------*/
+int write_PGM_Image_Lossless(struct PGM_Image * pgmImage,
+                             FILE * imageFilePointer);
+int write_PPM_Image_Lossless(struct PPM_Image * ppmImage,
+                             FILE * imageFilePointer, bool colourTransform);
+
+/*---------------------------------------------------------------*/
+/* SAVES AN IMAGE LOSSLESSLY CODED TO FILE                       */
+/*---------------------------------------------------------------*/
+int save_PGM_Image_Lossless(struct PGM_Image * pgmImage, char * fileName);
+int save_PPM_Image_Lossless(struct PPM_Image * ppmImage, char * fileName,
+                            bool colourTransform);
+
+/*---------------------------------------------------------------*/
+/* THE 'CONSTRUCTORS' WHICH LOAD A LOSSLESSLY CODED IMAGE        */
+/* (the stripes are decoded in parallel)                         */
+/*---------------------------------------------------------------*/
+int load_PGM_Image_Lossless(struct PGM_Image * pgmImage, char * fileName);
+int load_PPM_Image_Lossless(struct PPM_Image * ppmImage, char * fileName);
+#endif /*_PNM_LOSSLESS_H_*/
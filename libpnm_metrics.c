@@ -0,0 +1,319 @@
+#include <string.h>
+#include <math.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_metrics.h"
+#include "libpnm_thread.h"
+
+// the SSIM column sums kept per channel (a, b, a*a, b*b and a*b)
+# define SSIM_SUMS 5
+
+/*-----------------------------------------------*/
+/* A PAIR OF IMAGES BEING COMPARED               */
+/*-----------------------------------------------*/
+struct Metrics_Job
+{ // the rows of both images (PPM rows are RGB triples), and the geometry
+  unsigned char * * original; unsigned char * * reconstructed;
+  int width, height, channels;
+
+  // the size of an SSIM window, and the windows across and down
+  int windowWidth, windowHeight, windowsAcross, windowsDown;
+
+  // the SSIM constants
+  double c1, c2;
+
+  // per band and channel, the sum of the squared errors, the largest
+  // error and the sum of the SSIM of the windows
+  unsigned long long * squares; int * maxErrors; double * ssimSums;
+
+  // set by a band that cannot get its scratch memory
+  int failed;
+};
+
+/*-----------------------------------------------*/
+/* SPLITS A ROW OF channels INTERLEAVED SAMPLES  */
+/* INTO ONE PLANE OF width SAMPLES PER CHANNEL   */
+/*-----------------------------------------------*/
+static void split_Row(const unsigned char * row, int width, int channels,
+                      unsigned char * planes)
+{ // for loop variables
+  int col, channel;
+
+  for(col = 0; col < width; col++)
+    for(channel = 0; channel < channels; channel++)
+      planes[(size_t)channel * width + col] =
+        row[(size_t)col * channels + channel];
+}
+
+/*-----------------------------------------------*/
+/* POINTS AT THE PLANES OF A ROW OF BOTH IMAGES  */
+/* (a gray row is its own plane, colour rows are */
+/* split into the scratch planes)                */
+/*-----------------------------------------------*/
+static void get_Planes(struct Metrics_Job * job, int row,
+                       unsigned char * scratch,
+                       const unsigned char * * a, const unsigned char * * b)
+{ // for loop variable
+  int channel;
+
+  if(job->channels == 1)
+  { a[0] = job->original[row];
+    b[0] = job->reconstructed[row];
+    return;
+  }
+
+  split_Row(job->original[row], job->width, job->channels, scratch);
+  split_Row(job->reconstructed[row], job->width, job->channels,
+            scratch + (size_t)job->channels * job->width);
+
+  for(channel = 0; channel < job->channels; channel++)
+  { a[channel] = scratch + (size_t)channel * job->width;
+    b[channel] = scratch + (size_t)(job->channels + channel) * job->width;
+  }
+}
+
+/*-----------------------------------------------*/
+/* ADDS UP THE ERRORS OF ONE BAND OF ROWS        */
+/*-----------------------------------------------*/
+static void error_Band(void * context, int band)
+{ struct Metrics_Job * job = (struct Metrics_Job *)context;
+
+  // the rows of the band
+  int row = band * METRICS_BAND_ROWS;
+  int last = (row + METRICS_BAND_ROWS < job->height) ?
+             row + METRICS_BAND_ROWS : job->height;
+
+  // the planes of a row, and for loop variable
+  const unsigned char * a[3], * b[3]; int channel;
+
+  unsigned char * scratch = (unsigned char *)
+                            malloc((size_t)2 * job->channels * job->width + 1);
+  if(scratch == NULL)
+  { job->failed = 1;
+    return;
+  }
+
+  for(; row < last; row++)
+  { get_Planes(job, row, scratch, a, b);
+    for(channel = 0; channel < job->channels; channel++)
+      error_Row(a[channel], b[channel], job->width,
+                &job->squares[band * job->channels + channel],
+                &job->maxErrors[band * job->channels + channel]);
+  }
+
+  free(scratch);
+}
+
+/*-----------------------------------------------*/
+/* GETS THE SSIM OF THE WINDOW AT col FROM THE   */
+/* COLUMN SUMS OF ITS ROWS                       */
+/*-----------------------------------------------*/
+static double window_SSIM(struct Metrics_Job * job, const unsigned int * sums,
+                          int col)
+{ // the window sums, and for loop variables
+  unsigned long long total[SSIM_SUMS] = {0}; int sum, x;
+
+  // the means, variances and covariance
+  double n = (double)job->windowWidth * job->windowHeight;
+  double meanA, meanB, varianceA, varianceB, covariance;
+
+  for(sum = 0; sum < SSIM_SUMS; sum++)
+    for(x = col; x < col + job->windowWidth; x++)
+      total[sum] += sums[(size_t)sum * job->width + x];
+
+  meanA = total[0] / n;
+  meanB = total[1] / n;
+  varianceA = total[2] / n - meanA * meanA;
+  varianceB = total[3] / n - meanB * meanB;
+  covariance = total[4] / n - meanA * meanB;
+
+  return ((2 * meanA * meanB + job->c1) * (2 * covariance + job->c2)) /
+         ((meanA * meanA + meanB * meanB + job->c1) *
+          (varianceA + varianceB + job->c2));
+}
+
+/*-----------------------------------------------*/
+/* ADDS UP THE SSIM OF ONE BAND OF WINDOW ROWS   */
+/*-----------------------------------------------*/
+static void ssim_Band(void * context, int band)
+{ struct Metrics_Job * job = (struct Metrics_Job *)context;
+
+  // the window rows of the band
+  int window = band * SSIM_BAND_WINDOWS;
+  int last = (window + SSIM_BAND_WINDOWS < job->windowsDown) ?
+             window + SSIM_BAND_WINDOWS : job->windowsDown;
+
+  // the planes of a row, and for loop variables
+  const unsigned char * a[3], * b[3]; int row, channel, across;
+
+  // the column sums of every channel
+  size_t sumCount = (size_t)job->channels * SSIM_SUMS * job->width;
+  unsigned int * sums = (unsigned int *)malloc(sumCount * sizeof(int) + 1);
+  unsigned char * scratch = (unsigned char *)
+                            malloc((size_t)2 * job->channels * job->width + 1);
+
+  if(sums == NULL || scratch == NULL)
+  { job->failed = 1;
+    free(sums);
+    free(scratch);
+    return;
+  }
+
+  for(; window < last; window++)
+  { // sum the columns of the rows of the window
+    memset(sums, 0, sumCount * sizeof(int));
+    for(row = window * SSIM_STEP; row < window * SSIM_STEP +
+        job->windowHeight; row++)
+    { get_Planes(job, row, scratch, a, b);
+      for(channel = 0; channel < job->channels; channel++)
+        accumulate_SSIM_Row(a[channel], b[channel], job->width,
+                            sums + (size_t)channel * SSIM_SUMS * job->width);
+    }
+
+    // then slide the window along them
+    for(channel = 0; channel < job->channels; channel++)
+      for(across = 0; across < job->windowsAcross; across++)
+        job->ssimSums[band * job->channels + channel] +=
+          window_SSIM(job, sums + (size_t)channel * SSIM_SUMS * job->width,
+                      across * SSIM_STEP);
+  }
+
+  free(sums);
+  free(scratch);
+}
+
+/*-----------------------------------------------*/
+/* COMPARES THE ROWS OF TWO IMAGES               */
+/*-----------------------------------------------*/
+static int compare_Rows(unsigned char * * original,
+                        unsigned char * * reconstructed, int width,
+                        int height, int channels, int maxGrayValue,
+                        struct PNM_Metrics * metrics)
+{ struct Metrics_Job job;
+
+  // the bands of each pass, and for loop variables
+  int errorBands = (height + METRICS_BAND_ROWS - 1) / METRICS_BAND_ROWS;
+  int ssimBands, band, channel;
+
+  // the totals of a channel
+  unsigned long long squares; double ssim, samples = (double)width * height;
+  double peak = (maxGrayValue > 0) ? maxGrayValue : MAX_GRAY_VALUE;
+
+  job.original = original;
+  job.reconstructed = reconstructed;
+  job.width = width;
+  job.height = height;
+  job.channels = channels;
+  job.windowWidth = (width < SSIM_WINDOW) ? width : SSIM_WINDOW;
+  job.windowHeight = (height < SSIM_WINDOW) ? height : SSIM_WINDOW;
+  job.windowsAcross = (width > 0) ?
+                      (width - job.windowWidth) / SSIM_STEP + 1 : 0;
+  job.windowsDown = (height > 0) ?
+                    (height - job.windowHeight) / SSIM_STEP + 1 : 0;
+  job.c1 = (0.01 * peak) * (0.01 * peak);
+  job.c2 = (0.03 * peak) * (0.03 * peak);
+  job.failed = 0;
+  ssimBands = (job.windowsDown + SSIM_BAND_WINDOWS - 1) / SSIM_BAND_WINDOWS;
+
+  // the bands keep their own totals, added up in order afterwards
+  job.squares = (unsigned long long *)
+                calloc((size_t)errorBands * channels + 1, sizeof(long long));
+  job.maxErrors = (int *)calloc((size_t)errorBands * channels + 1,
+                                sizeof(int));
+  job.ssimSums = (double *)calloc((size_t)ssimBands * channels + 1,
+                                  sizeof(double));
+
+  if(job.squares != NULL && job.maxErrors != NULL && job.ssimSums != NULL)
+  { run_Parallel(errorBands, error_Band, &job);
+    run_Parallel(ssimBands, ssim_Band, &job);
+  }
+  else job.failed = 1;
+
+  metrics->channels = channels;
+  metrics->mse[METRICS_ALL] = metrics->ssim[METRICS_ALL] = 0;
+  metrics->maxError[METRICS_ALL] = 0;
+
+  for(channel = 0; channel < channels && !job.failed; channel++)
+  { squares = 0; ssim = 0;
+    metrics->maxError[channel] = 0;
+    for(band = 0; band < errorBands; band++)
+    { squares += job.squares[band * channels + channel];
+      if(job.maxErrors[band * channels + channel] > metrics->maxError[channel])
+        metrics->maxError[channel] = job.maxErrors[band * channels + channel];
+    }
+    for(band = 0; band < ssimBands; band++)
+      ssim += job.ssimSums[band * channels + channel];
+
+    // an empty image is identical to its reconstruction
+    metrics->mse[channel] = (samples > 0) ? squares / samples : 0;
+    metrics->ssim[channel] = (job.windowsAcross * job.windowsDown > 0) ?
+      ssim / ((double)job.windowsAcross * job.windowsDown) : 1;
+    metrics->psnr[channel] = (metrics->mse[channel] > 0) ?
+      10 * log10(peak * peak / metrics->mse[channel]) : INFINITY;
+
+    metrics->mse[METRICS_ALL] += metrics->mse[channel] / channels;
+    metrics->ssim[METRICS_ALL] += metrics->ssim[channel] / channels;
+    if(metrics->maxError[channel] > metrics->maxError[METRICS_ALL])
+      metrics->maxError[METRICS_ALL] = metrics->maxError[channel];
+  }
+
+  metrics->psnr[METRICS_ALL] = (metrics->mse[METRICS_ALL] > 0) ?
+    10 * log10(peak * peak / metrics->mse[METRICS_ALL]) : INFINITY;
+
+  free(job.squares);
+  free(job.maxErrors);
+  free(job.ssimSums);
+
+  return job.failed ? - 1 : 0;
+}
+
+/*---------------------------------------------------------------*/
+/* COMPARES A RECONSTRUCTED PGM IMAGE WITH ITS ORIGINAL          */
+/*---------------------------------------------------------------*/
+int compare_PGM_Images(struct PGM_Image * original,
+                       struct PGM_Image * reconstructed,
+                       struct PNM_Metrics * metrics)
+{ if(original->width != reconstructed->width ||
+     original->height != reconstructed->height) return - 1;
+
+  return compare_Rows(original->image, reconstructed->image,
+                      original->width, original->height, 1,
+                      original->maxGrayValue, metrics);
+}
+
+/*---------------------------------------------------------------*/
+/* COMPARES A RECONSTRUCTED PPM IMAGE WITH ITS ORIGINAL          */
+/*---------------------------------------------------------------*/
+int compare_PPM_Images(struct PPM_Image * original,
+                       struct PPM_Image * reconstructed,
+                       struct PNM_Metrics * metrics)
+{ // the first sample of every row of both images
+  unsigned char * * originalRows, * * reconstructedRows;
+
+  // for loop variable, and the result
+  int row, status = - 1;
+
+  if(original->width != reconstructed->width ||
+     original->height != reconstructed->height) return - 1;
+
+  originalRows = (unsigned char * *)calloc(original->height + 1,
+                                           sizeof(char *));
+  reconstructedRows = (unsigned char * *)calloc(original->height + 1,
+                                                sizeof(char *));
+
+  if(originalRows != NULL && reconstructedRows != NULL)
+  { for(row = 0; row < original->height; row++)
+    { originalRows[row] = original->image[row][0];
+      reconstructedRows[row] = reconstructed->image[row][0];
+    }
+
+    status = compare_Rows(originalRows, reconstructedRows, original->width,
+                          original->height, 3, original->maxGrayValue,
+                          metrics);
+  }
+
+  free(originalRows);
+  free(reconstructedRows);
+
+  return status;
+}
@@ -0,0 +1,59 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_METRICS_H_
+#define _PNM_METRICS_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* IMAGE QUALITY METRICS BETWEEN AN ORIGINAL AND A RECONSTRUCTION     */
+/*                                                                    */
+/* MSE is the mean squared difference of the samples, PSNR is         */
+/* 10 log10(L^2 / MSE) dB for the original's max gray value L         */
+/* (infinite for identical images) and max error the largest absolute */
+/* difference. SSIM is the mean structural similarity of square       */
+/* windows of SSIM_WINDOW samples placed every SSIM_STEP samples      */
+/* (shrunk to fit images smaller than a window), with the constants   */
+/* (0.01 L)^2 and (0.03 L)^2.                                         */
+/*                                                                    */
+/* The differences and the window sums are accumulated in integers by */
+/* the SIMD row kernels, over bands of rows on parallel threads; the  */
+/* results do not depend on the instruction set or thread count.      */
+/*--------------------------------------------------------------------*/
+
+// the SSIM windows
+# define SSIM_WINDOW 8
+# define SSIM_STEP 4
+
+// the rows of a band of the error pass, and the window rows of a band of
+// the SSIM pass
+# define METRICS_BAND_ROWS 64
+# define SSIM_BAND_WINDOWS 16
+
+// the entry of a result that covers all the channels
+# define METRICS_ALL 3
+
+/*---------------------------------------------------------------*/
+/* THE METRICS OF A PAIR OF IMAGES                               */
+/*---------------------------------------------------------------*/
+struct PNM_Metrics
+{ // the channels compared, 1 for PGM or 3 for PPM (RED, GREEN, BLUE)
+  int channels;
+
+  // indexed by channel, and at METRICS_ALL over every channel (the
+  // mean MSE and SSIM, the PSNR of the mean MSE, the largest error)
+  double mse[4], psnr[4], ssim[4]; int maxError[4];
+};
+
+/*---------------------------------------------------------------*/
+/* COMPARES A RECONSTRUCTED IMAGE WITH ITS ORIGINAL              */
+/* (returns -1 if the sizes differ)                              */
+/*---------------------------------------------------------------*/
+int compare_PGM_Images(struct PGM_Image * original,
+                       struct PGM_Image * reconstructed,
+                       struct PNM_Metrics * metrics);
+int compare_PPM_Images(struct PPM_Image * original,
+                       struct PPM_Image * reconstructed,
+                       struct PNM_Metrics * metrics);
+#endif /*_PNM_METRICS_H_*/
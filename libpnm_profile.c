@@ -0,0 +1,194 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include "libpnm_profile.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#endif
+
+// whether profiling is on
+static int profileEnabled = 0;
+
+// where the reports go
+static FILE * profileStream = NULL;
+
+// the counter file descriptors, -1 when not open
+static int counterFds[PROFILE_COUNTERS] = {-1, -1, -1, -1};
+
+// the number of counters open
+static int counterCount = 0;
+
+// the counter names for the report
+static const char * counterNames[PROFILE_COUNTERS] = 
+  {"cycles", "instructions", "cache-misses", "branch-misses"};
+
+/*---------------------------------------------------------------*/
+/* GETS THE WALL CLOCK IN SECONDS                                */
+/*---------------------------------------------------------------*/
+static double wall_Clock(void)
+{ struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+#if defined(__linux__)
+/*---------------------------------------------------------------*/
+/* OPENS ONE HARDWARE COUNTER FOR THIS THREAD AND THE THREADS IT */
+/* STARTS FROM NOW ON (an inherited counter cannot be read as a  */
+/* group, so every counter stands alone and is read by itself)   */
+/*---------------------------------------------------------------*/
+static int open_Counter(unsigned long long config)
+{ struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/*---------------------------------------------------------------*/
+/* TURNS PROFILING ON                                            */
+/*---------------------------------------------------------------*/
+int init_PNM_Profile(FILE * stream)
+{ // for loop variable
+  int counter;
+
+#if defined(__linux__)
+  // the perf configs, in Profile_Counter order
+  const unsigned long long configs[PROFILE_COUNTERS] = 
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+     PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+#endif
+
+  close_PNM_Profile();
+
+  profileStream = (stream == NULL) ? stderr : stream;
+  profileEnabled = 1;
+
+#if defined(__linux__)
+  // every counter the PMU allows
+  for(counter = 0; counter < PROFILE_COUNTERS; counter++)
+  { counterFds[counter] = open_Counter(configs[counter]);
+    if(counterFds[counter] == -1) continue;
+
+    counterCount++;
+    ioctl(counterFds[counter], PERF_EVENT_IOC_RESET, 0);
+    ioctl(counterFds[counter], PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+
+  if(counterCount == 0)
+  { fprintf(profileStream, 
+            "profile: hardware counters unavailable, timing only\n");
+    return 1;
+  }
+
+  fprintf(profileStream, "profile: counting");
+  for(counter = 0; counter < PROFILE_COUNTERS; counter++)
+    if(counterFds[counter] != -1) 
+      fprintf(profileStream, " %s", counterNames[counter]);
+  fprintf(profileStream, "\n");
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* TURNS PROFILING OFF AND CLOSES THE COUNTERS                   */
+/*---------------------------------------------------------------*/
+void close_PNM_Profile(void)
+{ // for loop variable
+  int counter;
+
+  for(counter = 0; counter < PROFILE_COUNTERS; counter++)
+  { if(counterFds[counter] != -1) close(counterFds[counter]);
+    counterFds[counter] = -1;
+  }
+
+  counterCount = 0;
+  profileEnabled = 0;
+}
+
+/*---------------------------------------------------------------*/
+/* READS THE COUNTERS INTO A SAMPLE                              */
+/*---------------------------------------------------------------*/
+static void read_Counters(struct PNM_Profile_Sample * sample)
+{ // for loop variable
+  int counter;
+
+  // a counter's value, summed over the threads that inherited it
+  unsigned long long value;
+
+  for(counter = 0; counter < PROFILE_COUNTERS; counter++)
+  { sample->counters[counter] = -1;
+    if(counterFds[counter] != -1 &&
+       read(counterFds[counter], &value, sizeof(value)) == 
+         (ssize_t)sizeof(value))
+      sample->counters[counter] = (long long)value;
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* TAKES THE SNAPSHOT BEFORE A CALL                              */
+/*---------------------------------------------------------------*/
+void begin_PNM_Profile(struct PNM_Profile_Sample * start)
+{ if(!profileEnabled) return;
+
+  start->seconds = wall_Clock();
+  read_Counters(start);
+}
+
+/*---------------------------------------------------------------*/
+/* MEASURES A CALL SINCE start AND REPORTS IT                    */
+/*---------------------------------------------------------------*/
+void end_PNM_Profile(struct PNM_Profile_Sample * start,
+                     const char * name, long long pixels)
+{ // the snapshot after the call
+  struct PNM_Profile_Sample end;
+
+  // the differences
+  long long delta[PROFILE_COUNTERS]; int counter;
+  double seconds;
+
+  if(!profileEnabled) return;
+
+  read_Counters(&end);
+  seconds = wall_Clock() - start->seconds;
+
+  for(counter = 0; counter < PROFILE_COUNTERS; counter++)
+    delta[counter] = (start->counters[counter] < 0 || 
+                      end.counters[counter] < 0) ? -1 :
+                     end.counters[counter] - start->counters[counter];
+
+  if(pixels < 1) pixels = 1;
+
+  fprintf(profileStream, "profile: %-28s %10lld px %10.3f ms",
+          name, pixels, seconds * 1e3);
+
+  if(delta[PROFILE_CYCLES] >= 0)
+    fprintf(profileStream, " %8.2f cycles/px",
+            (double)delta[PROFILE_CYCLES] / pixels);
+  if(delta[PROFILE_CYCLES] > 0 && delta[PROFILE_INSTRUCTIONS] >= 0)
+    fprintf(profileStream, " %5.2f IPC", 
+            (double)delta[PROFILE_INSTRUCTIONS] / delta[PROFILE_CYCLES]);
+  if(delta[PROFILE_CACHE_MISSES] >= 0)
+    fprintf(profileStream, " %10lld cache-misses",
+            delta[PROFILE_CACHE_MISSES]);
+  if(delta[PROFILE_BRANCH_MISSES] >= 0)
+    fprintf(profileStream, " %10lld branch-misses",
+            delta[PROFILE_BRANCH_MISSES]);
+  if(delta[PROFILE_CYCLES] < 0)
+    fprintf(profileStream, " %8.2f ns/px", seconds * 1e9 / pixels);
+
+  fprintf(profileStream, "\n");
+}
@@ -0,0 +1,73 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_PROFILE_H_
+#define _PNM_PROFILE_H_
+
+/*--------------------------------------------------------------------*/
+/* HARDWARE COUNTER PROFILING OF LIBPNM CALLS                         */
+/*                                                                    */
+/* Once init_PNM_Profile has been called, every call wrapped in       */
+/* PNM_PROFILE is measured with perf_event_open counters (cycles,     */
+/* instructions, cache misses, branch misses) and reported on the     */
+/* profile stream as cycles/pixel and IPC. The counters are inherited */
+/* by the threads started after init_PNM_Profile, so the workers of   */
+/* run_Parallel are counted with the calling thread. Without counters */
+/* (no permission, or a VM without a PMU) only the wall time is       */
+/* reported. Profiling is off by default and then costs a branch per  */
+/* call.                                                              */
+/*--------------------------------------------------------------------*/
+
+// the counters, in the order they are read
+enum Profile_Counter {PROFILE_CYCLES = 0, PROFILE_INSTRUCTIONS,
+                      PROFILE_CACHE_MISSES, PROFILE_BRANCH_MISSES,
+                      PROFILE_COUNTERS};
+
+/*-----------------------------------*/
+/* A SNAPSHOT TAKEN BEFORE A CALL    */
+/*-----------------------------------*/
+struct PNM_Profile_Sample
+{ // the counter values, -1 where a counter is not available
+  long long counters[PROFILE_COUNTERS];
+
+  // the wall clock in seconds
+  double seconds;
+};
+
+/*---------------------------------------------------------------*/
+/* TURNS PROFILING ON, REPORTING TO stream (stderr when NULL)    */
+/* (returns 0 with hardware counters, 1 with timing only)        */
+/*---------------------------------------------------------------*/
+int init_PNM_Profile(FILE * stream);
+
+/*---------------------------------------------------------------*/
+/* TURNS PROFILING OFF AND CLOSES THE COUNTERS                   */
+/*---------------------------------------------------------------*/
+void close_PNM_Profile(void);
+
+/*---------------------------------------------------------------*/
+/* TAKES THE SNAPSHOT BEFORE A CALL                              */
+/*---------------------------------------------------------------*/
+void begin_PNM_Profile(struct PNM_Profile_Sample * start);
+
+/*---------------------------------------------------------------*/
+/* MEASURES A CALL SINCE start AND REPORTS IT UNDER name, WITH   */
+/* pixels AS THE DENOMINATOR FOR cycles/pixel                    */
+/*---------------------------------------------------------------*/
+void end_PNM_Profile(struct PNM_Profile_Sample * start,
+                     const char * name, long long pixels);
+
+/*---------------------------------------------------------------*/
+/* WRAPS A CALL, e.g.                                            */
+/*   PNM_PROFILE("save_PGM_Image", w * h,                        */
+/*               e = save_PGM_Image(&image, name, raw));         */
+/* (pixels is evaluated after the call)                          */
+/*---------------------------------------------------------------*/
+# define PNM_PROFILE(name, pixels, call)                  \
+  do                                                      \
+  { struct PNM_Profile_Sample profileStart_;              \
+    begin_PNM_Profile(&profileStart_);                    \
+    call;                                                 \
+    end_PNM_Profile(&profileStart_, (name), (pixels));    \
+  } while(0)
+#endif /*_PNM_PROFILE_H_*/
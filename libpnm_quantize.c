@@ -0,0 +1,527 @@
+#include <string.h>
+#include "libpnm.h"
+#include "libpnm_quantize.h"
+#include "libpnm_thread.h"
+
+// the cells along each axis, and the bits of a sample below those of its cell
+# define CELLS_PER_AXIS (1 << QUANTIZE_CELL_BITS)
+# define CELL_SHIFT (8 - QUANTIZE_CELL_BITS)
+
+// the cell of a colour (samples scaled to 0..255), and of cell coordinates
+# define CELL_OF(red, green, blue) \
+  ((((red) >> CELL_SHIFT) << (2 * QUANTIZE_CELL_BITS)) | \
+   (((green) >> CELL_SHIFT) << QUANTIZE_CELL_BITS) | ((blue) >> CELL_SHIFT))
+# define CELL_AT(red, green, blue) \
+  (((red) << (2 * QUANTIZE_CELL_BITS)) | ((green) << QUANTIZE_CELL_BITS) | \
+   (blue))
+
+/*-----------------------------------------------*/
+/* THE PIXELS IN EACH CELL OF THE COLOUR CUBE    */
+/* AND THE SUMS OF THEIR COLOURS                 */
+/*-----------------------------------------------*/
+struct Colour_Cells
+{ unsigned long long count[QUANTIZE_CELLS], sum[QUANTIZE_CELLS][3];
+};
+
+/*-----------------------------------------------*/
+/* A BOX OF CELLS OF THE MEDIAN CUT, SHRUNK TO   */
+/* THE CELLS WITH PIXELS                         */
+/*-----------------------------------------------*/
+struct Colour_Box
+{ // the first and last cells along each axis, and the pixels inside
+  int low[3], high[3]; unsigned long long count;
+};
+
+/*-----------------------------------------------*/
+/* AN IMAGE BEING QUANTIZED                      */
+/*-----------------------------------------------*/
+struct Quantize_Job
+{ // the rows of the image, and its size
+  unsigned char * * * colourRows; int width, height;
+
+  // each sample scaled from the max gray value of the image to 0..255
+  unsigned char scale[MAX_GRAY_VALUE + 1];
+
+  // the stripes of rows, each counted into its own cells
+  int stripes; struct Colour_Cells * parts;
+
+  // the cells of the whole image (NULL when only mapping)
+  struct Colour_Cells * cells;
+
+  // the palette, and whether its table is made for the empty cells too
+  struct PNM_Palette * palette; bool everyCell;
+
+  // the rows of indices
+  unsigned char * * indexRows;
+};
+
+/*-----------------------------------------------*/
+/* FILLS THE TABLE SCALING THE SAMPLES OF AN     */
+/* IMAGE TO 0..255                               */
+/*-----------------------------------------------*/
+static void scale_Samples(struct Quantize_Job * job, int maxGrayValue)
+{ // for loop variable
+  int sample;
+
+  for(sample = 0; sample <= MAX_GRAY_VALUE; sample++)
+    job->scale[sample] = (sample >= maxGrayValue) ? MAX_GRAY_VALUE :
+      (unsigned char)((sample * MAX_GRAY_VALUE + maxGrayValue / 2) /
+                      maxGrayValue);
+}
+
+/*-----------------------------------------------*/
+/* COUNTS ONE STRIPE OF ROWS INTO ITS CELLS      */
+/*-----------------------------------------------*/
+static void count_Stripe(void * context, int index)
+{ struct Quantize_Job * job = (struct Quantize_Job *)context;
+  struct Colour_Cells * cells = &job->parts[index];
+
+  // the rows of the stripe
+  int row = (int)((long long)job->height * index / job->stripes);
+  int last = (int)((long long)job->height * (index + 1) / job->stripes);
+
+  // for loop variable, a pixel and its cell
+  int col; const unsigned char * pixel; int cell;
+
+  for(; row < last; row++)
+  { pixel = job->colourRows[row][0];
+    for(col = 0; col < job->width; col++, pixel += 3)
+    { cell = CELL_OF(job->scale[pixel[RED]], job->scale[pixel[GREEN]],
+                       job->scale[pixel[BLUE]]);
+      cells->count[cell]++;
+      cells->sum[cell][RED] += pixel[RED];
+      cells->sum[cell][GREEN] += pixel[GREEN];
+      cells->sum[cell][BLUE] += pixel[BLUE];
+    }
+  }
+}
+
+/*-----------------------------------------------*/
+/* GETS THE ROUNDED MEAN COLOUR OF SOME PIXELS   */
+/*-----------------------------------------------*/
+static void mean_Colour(const unsigned long long * sum,
+                        unsigned long long count, int * colour)
+{ // for loop variable
+  int channel;
+
+  for(channel = 0; channel < 3; channel++)
+    colour[channel] = (int)((sum[channel] + count / 2) / count);
+}
+
+/*-----------------------------------------------*/
+/* FINDS THE PALETTE ENTRY NEAREST A COLOUR      */
+/*-----------------------------------------------*/
+static int nearest_Entry(const struct PNM_Palette * palette,
+                         const int * colour)
+{ // for loop variable, the nearest entry and its squared distance
+  int entry, nearest = 0, best = 3 * 256 * 256;
+
+  // the distance of an entry along each channel, and in all
+  int red, green, blue, distance;
+
+  for(entry = 0; entry < palette->colours; entry++)
+  { red = colour[RED] - palette->entries[entry][RED];
+    green = colour[GREEN] - palette->entries[entry][GREEN];
+    blue = colour[BLUE] - palette->entries[entry][BLUE];
+    distance = red * red + green * green + blue * blue;
+
+    if(distance < best)
+    { best = distance;
+      nearest = entry;
+    }
+  }
+
+  return nearest;
+}
+
+/*-----------------------------------------------*/
+/* FILLS THE INVERSE COLOUR TABLE FOR THE CELLS  */
+/* OF ONE RED SLICE OF THE CUBE                  */
+/*-----------------------------------------------*/
+static void lookup_Slice(void * context, int red)
+{ struct Quantize_Job * job = (struct Quantize_Job *)context;
+
+  // for loop variables, a cell and the colour it stands for
+  int green, blue, cell, colour[3];
+
+  // the middle of a cell, and the max gray value of the entries
+  const int half = 1 << (CELL_SHIFT - 1);
+  const int maxGray = job->palette->maxGrayValue;
+
+  for(green = 0; green < CELLS_PER_AXIS; green++)
+    for(blue = 0; blue < CELLS_PER_AXIS; blue++)
+    { cell = CELL_AT(red, green, blue);
+
+      if(job->cells != NULL && job->cells->count[cell] > 0)
+        mean_Colour(job->cells->sum[cell], job->cells->count[cell], colour);
+      else if(job->everyCell)
+      { // the centre is scaled back to the range of the entries
+        colour[RED] = (((red << CELL_SHIFT) + half) * maxGray +
+                       MAX_GRAY_VALUE / 2) / MAX_GRAY_VALUE;
+        colour[GREEN] = (((green << CELL_SHIFT) + half) * maxGray +
+                         MAX_GRAY_VALUE / 2) / MAX_GRAY_VALUE;
+        colour[BLUE] = (((blue << CELL_SHIFT) + half) * maxGray +
+                        MAX_GRAY_VALUE / 2) / MAX_GRAY_VALUE;
+      }
+      else continue;
+
+      job->palette->lookup[cell] = (unsigned char)nearest_Entry(job->palette,
+                                                                colour);
+    }
+}
+
+/*-----------------------------------------------*/
+/* SHRINKS A BOX TO THE CELLS WITH PIXELS AND    */
+/* COUNTS THEM                                   */
+/*-----------------------------------------------*/
+static void shrink_Box(struct Colour_Cells * cells, struct Colour_Box * box)
+{ // for loop variables and a cell's coordinates
+  int red, green, blue, at[3], channel;
+
+  // the bounds of the cells with pixels
+  int low[3], high[3];
+
+  for(channel = 0; channel < 3; channel++)
+  { low[channel] = box->high[channel];
+    high[channel] = box->low[channel];
+  }
+  box->count = 0;
+
+  for(red = box->low[RED]; red <= box->high[RED]; red++)
+    for(green = box->low[GREEN]; green <= box->high[GREEN]; green++)
+      for(blue = box->low[BLUE]; blue <= box->high[BLUE]; blue++)
+      { if(cells->count[CELL_AT(red, green, blue)] == 0) continue;
+
+        box->count += cells->count[CELL_AT(red, green, blue)];
+        at[RED] = red; at[GREEN] = green; at[BLUE] = blue;
+        for(channel = 0; channel < 3; channel++)
+        { if(at[channel] < low[channel]) low[channel] = at[channel];
+          if(at[channel] > high[channel]) high[channel] = at[channel];
+        }
+      }
+
+  if(box->count == 0) return;
+
+  for(channel = 0; channel < 3; channel++)
+  { box->low[channel] = low[channel];
+    box->high[channel] = high[channel];
+  }
+}
+
+/*-----------------------------------------------*/
+/* GETS THE LONGEST SIDE OF A BOX (IN CELLS LESS */
+/* ONE), AND THE AXIS IT IS ALONG                */
+/*-----------------------------------------------*/
+static int longest_Side(const struct Colour_Box * box, int * axis)
+{ // for loop variable, and the longest side
+  int channel, longest = - 1;
+
+  for(channel = 0; channel < 3; channel++)
+    if(box->high[channel] - box->low[channel] > longest)
+    { longest = box->high[channel] - box->low[channel];
+      *axis = channel;
+    }
+
+  return longest;
+}
+
+/*-----------------------------------------------*/
+/* SPLITS A BOX AT THE MEDIAN OF ITS PIXELS      */
+/* ALONG ITS LONGEST SIDE, THE UPPER PART GOING  */
+/* INTO upper                                    */
+/*-----------------------------------------------*/
+static void split_Box(struct Colour_Cells * cells, struct Colour_Box * box,
+                      struct Colour_Box * upper)
+{ // the axis, the slice split after, and loop variables
+  int axis, split, red, green, blue, at[3];
+
+  // the pixels in each slice across the axis, and in those up to the split
+  unsigned long long slices[CELLS_PER_AXIS], below = 0;
+
+  longest_Side(box, &axis);
+
+  memset(slices, 0, sizeof(slices));
+  for(red = box->low[RED]; red <= box->high[RED]; red++)
+    for(green = box->low[GREEN]; green <= box->high[GREEN]; green++)
+      for(blue = box->low[BLUE]; blue <= box->high[BLUE]; blue++)
+      { at[RED] = red; at[GREEN] = green; at[BLUE] = blue;
+        slices[at[axis]] += cells->count[CELL_AT(red, green, blue)];
+      }
+
+  // the last slice is never reached, both parts keep a populated slice
+  for(split = box->low[axis]; split < box->high[axis] - 1; split++)
+  { below += slices[split];
+    if(2 * below >= box->count) break;
+  }
+
+  *upper = *box;
+  box->high[axis] = split;
+  upper->low[axis] = split + 1;
+  shrink_Box(cells, box);
+  shrink_Box(cells, upper);
+}
+
+/*-----------------------------------------------*/
+/* MAKES THE FIRST PALETTE BY MEDIAN CUT         */
+/*-----------------------------------------------*/
+static void median_Cut(struct Colour_Cells * cells,
+                       struct PNM_Palette * palette, int colours)
+{ // the boxes, and for loop variables
+  struct Colour_Box boxes[QUANTIZE_MAX_COLOURS]; int count = 1, box, axis;
+
+  // the box split next and its score (pixels times longest side)
+  int chosen; unsigned long long score, best;
+
+  // a box's pixels, the sums of their colours, and loop variables
+  unsigned long long pixels, sum[3]; int red, green, blue, channel, cell;
+  int colour[3];
+
+  for(channel = 0; channel < 3; channel++)
+  { boxes[0].low[channel] = 0;
+    boxes[0].high[channel] = CELLS_PER_AXIS - 1;
+  }
+  shrink_Box(cells, &boxes[0]);
+
+  while(count < colours)
+  { chosen = - 1;
+    best = 0;
+    for(box = 0; box < count; box++)
+    { score = boxes[box].count * longest_Side(&boxes[box], &axis);
+      if(score > best)
+      { best = score;
+        chosen = box;
+      }
+    }
+
+    // every box is a single cell
+    if(chosen < 0) break;
+
+    split_Box(cells, &boxes[chosen], &boxes[count++]);
+  }
+
+  palette->colours = count;
+  for(box = 0; box < count; box++)
+  { pixels = sum[RED] = sum[GREEN] = sum[BLUE] = 0;
+
+    for(red = boxes[box].low[RED]; red <= boxes[box].high[RED]; red++)
+      for(green = boxes[box].low[GREEN]; green <= boxes[box].high[GREEN];
+          green++)
+        for(blue = boxes[box].low[BLUE]; blue <= boxes[box].high[BLUE];
+            blue++)
+        { cell = CELL_AT(red, green, blue);
+          pixels += cells->count[cell];
+          for(channel = 0; channel < 3; channel++)
+            sum[channel] += cells->sum[cell][channel];
+        }
+
+    // an image without pixels gets a single black entry
+    if(pixels == 0) colour[RED] = colour[GREEN] = colour[BLUE] = 0;
+    else mean_Colour(sum, pixels, colour);
+
+    for(channel = 0; channel < 3; channel++)
+      palette->entries[box][channel] = (unsigned char)colour[channel];
+  }
+}
+
+/*-----------------------------------------------*/
+/* MOVES EVERY ENTRY TO THE MEAN OF THE CELLS    */
+/* NEAREST IT (returns 0 once nothing moves)     */
+/*-----------------------------------------------*/
+static int refine_Palette(struct Quantize_Job * job)
+{ // the pixels and the sums of the colours nearest each entry
+  unsigned long long count[QUANTIZE_MAX_COLOURS];
+  unsigned long long sum[QUANTIZE_MAX_COLOURS][3];
+
+  // for loop variables, the entry of a cell, and whether an entry moved
+  int cell, entry, channel, colour[3], moved = 0;
+
+  // only the cells with pixels are looked up
+  job->everyCell = false;
+  run_Parallel(CELLS_PER_AXIS, lookup_Slice, job);
+
+  memset(count, 0, sizeof(count));
+  memset(sum, 0, sizeof(sum));
+  for(cell = 0; cell < QUANTIZE_CELLS; cell++)
+  { if(job->cells->count[cell] == 0) continue;
+
+    entry = job->palette->lookup[cell];
+    count[entry] += job->cells->count[cell];
+    for(channel = 0; channel < 3; channel++)
+      sum[entry][channel] += job->cells->sum[cell][channel];
+  }
+
+  // an entry no cell is nearest stays where it is
+  for(entry = 0; entry < job->palette->colours; entry++)
+  { if(count[entry] == 0) continue;
+
+    mean_Colour(sum[entry], count[entry], colour);
+    for(channel = 0; channel < 3; channel++)
+      if(job->palette->entries[entry][channel] != colour[channel])
+      { job->palette->entries[entry][channel] = (unsigned char)colour[channel];
+        moved = 1;
+      }
+  }
+
+  return moved;
+}
+
+/*-----------------------------------------------*/
+/* MAPS ONE BAND OF ROWS TO INDICES              */
+/*-----------------------------------------------*/
+static void index_Band(void * context, int index)
+{ struct Quantize_Job * job = (struct Quantize_Job *)context;
+
+  // the rows of the band
+  int row = index * QUANTIZE_BAND_ROWS;
+  int last = (row + QUANTIZE_BAND_ROWS < job->height) ?
+             row + QUANTIZE_BAND_ROWS : job->height;
+
+  // for loop variable, and a pixel
+  int col; const unsigned char * pixel;
+
+  for(; row < last; row++)
+  { pixel = job->colourRows[row][0];
+    for(col = 0; col < job->width; col++, pixel += 3)
+      job->indexRows[row][col] =
+        job->palette->lookup[CELL_OF(job->scale[pixel[RED]],
+                                     job->scale[pixel[GREEN]],
+                                     job->scale[pixel[BLUE]])];
+  }
+}
+
+/*-----------------------------------------------*/
+/* FILLS THE WHOLE INVERSE COLOUR TABLE AND MAPS */
+/* THE IMAGE INTO A NEW PGM OF INDICES           */
+/*-----------------------------------------------*/
+static int index_Rows(struct Quantize_Job * job,
+                      struct PGM_Image * indexImage)
+{ // the last index, which cannot be 0 in a PGM
+  int maxValue = (job->palette->colours > 1) ? job->palette->colours - 1 : 1;
+
+  job->everyCell = true;
+  run_Parallel(CELLS_PER_AXIS, lookup_Slice, job);
+
+  if(create_PGM_Image(indexImage, job->width, job->height, maxValue) == -1)
+    return - 1;
+
+  job->indexRows = indexImage->image;
+  run_Parallel((job->height + QUANTIZE_BAND_ROWS - 1) / QUANTIZE_BAND_ROWS,
+               index_Band, job);
+
+  // success
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* QUANTIZES A PPM IMAGE INTO A PALETTE AND A NEW PGM OF INDICES */
+/*---------------------------------------------------------------*/
+int quantize_PPM_Image(struct PPM_Image * ppmImage,
+                       struct PNM_Palette * palette,
+                       struct PGM_Image * indexImage,
+                       int colours, int iterations)
+{ struct Quantize_Job job;
+
+  // for loop variables, and the result
+  int stripe, cell, channel, status;
+
+  if(colours < 1 || colours > QUANTIZE_MAX_COLOURS ||
+     ppmImage->maxGrayValue < 1)
+    return - 1;
+
+  job.colourRows = ppmImage->image;
+  job.width = ppmImage->width;
+  job.height = ppmImage->height;
+  job.palette = palette;
+  palette->maxGrayValue = ppmImage->maxGrayValue;
+  scale_Samples(&job, ppmImage->maxGrayValue);
+
+  // a stripe per thread, of at least a row
+  job.stripes = get_Thread_Count();
+  if(job.stripes > job.height) job.stripes = job.height;
+  if(job.stripes < 1) job.stripes = 1;
+
+  job.parts = (struct Colour_Cells *)calloc(job.stripes,
+                                            sizeof(struct Colour_Cells));
+  if(job.parts == NULL) return - 1;
+
+  run_Parallel(job.stripes, count_Stripe, &job);
+
+  // the stripes are added into the first
+  job.cells = &job.parts[0];
+  for(stripe = 1; stripe < job.stripes; stripe++)
+    for(cell = 0; cell < QUANTIZE_CELLS; cell++)
+    { job.cells->count[cell] += job.parts[stripe].count[cell];
+      for(channel = 0; channel < 3; channel++)
+        job.cells->sum[cell][channel] += job.parts[stripe].sum[cell][channel];
+    }
+
+  median_Cut(job.cells, palette, colours);
+  while(iterations-- > 0 && refine_Palette(&job));
+
+  status = index_Rows(&job, indexImage);
+
+  free(job.parts);
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* MAPS A PPM IMAGE THROUGH A PALETTE INTO A NEW PGM OF INDICES  */
+/*---------------------------------------------------------------*/
+int index_PPM_Image(struct PPM_Image * ppmImage,
+                    struct PNM_Palette * palette,
+                    struct PGM_Image * indexImage)
+{ struct Quantize_Job job;
+
+  // the last index
+  int maxValue = (palette->colours > 1) ? palette->colours - 1 : 1;
+
+  if(palette->colours < 1 || palette->colours > QUANTIZE_MAX_COLOURS ||
+     ppmImage->maxGrayValue < 1)
+    return - 1;
+
+  // the table is used as it is
+  if(create_PGM_Image(indexImage, ppmImage->width, ppmImage->height,
+                      maxValue) == -1)
+    return - 1;
+
+  job.colourRows = ppmImage->image;
+  job.width = ppmImage->width;
+  job.height = ppmImage->height;
+  job.cells = NULL;
+  job.palette = palette;
+  job.indexRows = indexImage->image;
+  scale_Samples(&job, ppmImage->maxGrayValue);
+  run_Parallel((job.height + QUANTIZE_BAND_ROWS - 1) / QUANTIZE_BAND_ROWS,
+               index_Band, &job);
+
+  // success
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* EXPANDS A PGM OF INDICES INTO A NEW PPM IMAGE                 */
+/*---------------------------------------------------------------*/
+int expand_Indexed_Image(struct PGM_Image * indexImage,
+                         struct PNM_Palette * palette,
+                         struct PPM_Image * ppmImage)
+{ // for loop variables, and an index
+  int row, col, index;
+
+  if(create_PPM_Image(ppmImage, indexImage->width, indexImage->height,
+                      palette->maxGrayValue) == -1)
+    return - 1;
+
+  for(row = 0; row < indexImage->height; row++)
+    for(col = 0; col < indexImage->width; col++)
+    { index = indexImage->image[row][col];
+      if(index >= palette->colours)
+      { free_PPM_Image(ppmImage);
+        return - 1;
+      }
+      memcpy(ppmImage->image[row][col], palette->entries[index], 3);
+    }
+
+  // success
+  return 0;
+}
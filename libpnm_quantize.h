@@ -0,0 +1,85 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_QUANTIZE_H_
+#define _PNM_QUANTIZE_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* COLOUR QUANTIZATION OF PPM IMAGES INTO A PALETTE AND INDICES       */
+/*                                                                    */
+/* A PPM is reduced to at most QUANTIZE_MAX_COLOURS colours, and      */
+/* stored as the palette plus a PGM of one index per pixel.           */
+/*                                                                    */
+/* The colour cube is cut into cells of QUANTIZE_CELL_BITS bits per   */
+/* channel. One pass over the image, in stripes of rows on parallel   */
+/* threads each with its own accumulators, counts the pixels of every */
+/* cell and sums their colours. The first palette is a median cut of  */
+/* the cells: the box holding the most pixels times its longest side  */
+/* is split at the median along that side until there are enough      */
+/* boxes, each giving the mean colour of its pixels. k-means then     */
+/* moves every entry to the mean of the cells nearest it (a cell      */
+/* goes to the entry nearest its mean colour) until nothing moves or  */
+/* the iterations run out.                                            */
+/*                                                                    */
+/* The palette keeps the entry nearest each cell (its mean colour, or */
+/* its centre if the image has no pixels in it) as a 3D inverse       */
+/* colour table, so a pixel is mapped with a single lookup rather     */
+/* than a search of the palette. The sums are integers, so the result */
+/* does not depend on the thread count.                               */
+/*                                                                    */
+/* Samples are scaled to 0..255 to pick their cell, whatever the max  */
+/* gray value of the image, while the entries keep the image's own    */
+/* range and the palette records its max gray value.                  */
+/*--------------------------------------------------------------------*/
+
+// the most colours of a palette (the indices are bytes)
+# define QUANTIZE_MAX_COLOURS 256
+
+// the bits of each channel that pick a cell, and the cells of the cube
+# define QUANTIZE_CELL_BITS 5
+# define QUANTIZE_CELLS (1 << (3 * QUANTIZE_CELL_BITS))
+
+// the rows mapped to indices by one task
+# define QUANTIZE_BAND_ROWS 16
+
+/*---------------------------------------------------------------*/
+/* A PALETTE, AND THE ENTRY NEAREST EACH CELL                    */
+/*---------------------------------------------------------------*/
+struct PNM_Palette
+{ // the number of colours and their RGB values, from 0 to maxGrayValue
+  int colours; unsigned char entries[QUANTIZE_MAX_COLOURS][3];
+  int maxGrayValue;
+
+  // the inverse colour table, indexed by the top bits of red, green, blue
+  unsigned char lookup[QUANTIZE_CELLS];
+};
+
+/*---------------------------------------------------------------*/
+/* QUANTIZES A PPM IMAGE TO AT MOST colours COLOURS, REFINED BY  */
+/* UP TO iterations ROUNDS OF k-means, INTO THE PALETTE AND A    */
+/* NEW PGM OF INDICES (its max gray value is the last index)     */
+/*---------------------------------------------------------------*/
+int quantize_PPM_Image(struct PPM_Image * ppmImage,
+                       struct PNM_Palette * palette,
+                       struct PGM_Image * indexImage,
+                       int colours, int iterations);
+
+/*---------------------------------------------------------------*/
+/* MAPS A PPM IMAGE THROUGH THE INVERSE COLOUR TABLE OF A        */
+/* PALETTE INTO A NEW PGM OF INDICES                             */
+/*---------------------------------------------------------------*/
+int index_PPM_Image(struct PPM_Image * ppmImage,
+                    struct PNM_Palette * palette,
+                    struct PGM_Image * indexImage);
+
+/*---------------------------------------------------------------*/
+/* EXPANDS A PGM OF INDICES INTO A NEW PPM IMAGE WITH THE MAX   */
+/* GRAY VALUE OF THE PALETTE                                     */
+/* (returns -1 if an index is beyond the palette)                */
+/*---------------------------------------------------------------*/
+int expand_Indexed_Image(struct PGM_Image * indexImage,
+                         struct PNM_Palette * palette,
+                         struct PPM_Image * ppmImage);
+#endif /*_PNM_QUANTIZE_H_*/
@@ -0,0 +1,338 @@
+#include <string.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_resample.h"
+#include "libpnm_thread.h"
+
+/*-----------------------------------------------*/
+/* THE INPUT PIXELS UNDER EACH OUTPUT PIXEL      */
+/* ALONG ONE AXIS                                */
+/*-----------------------------------------------*/
+struct Coverage
+{ // the first input pixel under each output pixel, and where its weights
+  // start (the weights of output pixel i end where those of i + 1 start)
+  int * first; int * offset;
+
+  // how much of each input pixel is covered
+  unsigned int * weights;
+};
+
+/*-----------------------------------------------*/
+/* AN IMAGE BEING RESAMPLED                      */
+/*-----------------------------------------------*/
+struct Resample_Job
+{ // the first sample of every row of the image and of the resampled image
+  unsigned char * * rows; unsigned char * * resampledRows;
+
+  // the sizes of the two images, and the samples per pixel
+  int width, height, newWidth, newHeight, channels;
+
+  // the coverage across and down (unused when halving)
+  struct Coverage across, down;
+
+  // set by a band that cannot get its scratch memory
+  int failed;
+};
+
+/*-----------------------------------------------*/
+/* WORKS OUT WHICH OF count INPUT PIXELS EACH OF */
+/* newCount OUTPUT PIXELS COVERS, AND HOW MUCH   */
+/*-----------------------------------------------*/
+static int cover_Axis(struct Coverage * coverage, int count, int newCount)
+{ // for loop variables
+  int i, input;
+
+  // the ends of an output pixel and of an input pixel, in units of
+  // 1 / newCount of an input pixel
+  long long start, end, inStart, inEnd;
+
+  // every input pixel starts a weight, and so may every output pixel
+  size_t most = (size_t)newCount + count;
+
+  coverage->first = (int *)malloc(newCount * sizeof(int));
+  coverage->offset = (int *)malloc((newCount + 1) * sizeof(int));
+  coverage->weights = (unsigned int *)malloc(most * sizeof(unsigned int));
+
+  if(coverage->first == NULL || coverage->offset == NULL ||
+     coverage->weights == NULL)
+    return - 1;
+
+  coverage->offset[0] = 0;
+  for(i = 0; i < newCount; i++)
+  { start = (long long)i * count;
+    end = start + count;
+    coverage->first[i] = (int)(start / newCount);
+    coverage->offset[i + 1] = coverage->offset[i];
+
+    for(input = coverage->first[i]; (long long)input * newCount < end;
+        input++)
+    { inStart = (long long)input * newCount;
+      inEnd = inStart + newCount;
+      coverage->weights[coverage->offset[i + 1]++] =
+        (unsigned int)((inEnd < end ? inEnd : end) -
+                       (inStart > start ? inStart : start));
+    }
+  }
+
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* FREES A COVERAGE                              */
+/*-----------------------------------------------*/
+static void free_Coverage(struct Coverage * coverage)
+{ free(coverage->first);
+  free(coverage->offset);
+  free(coverage->weights);
+}
+
+/*-----------------------------------------------*/
+/* RESAMPLES ONE ROW ACROSS, INTO SUMS WEIGHTED  */
+/* BY THE COVERAGE                               */
+/*-----------------------------------------------*/
+static void resample_Across(struct Resample_Job * job,
+                            const unsigned char * row, unsigned int * line)
+{ // for loop variables
+  int x, k, c;
+
+  // the first sample of an input pixel
+  size_t sample;
+
+  for(x = 0; x < job->newWidth; x++)
+  { for(c = 0; c < job->channels; c++) line[c] = 0;
+
+    sample = (size_t)job->across.first[x] * job->channels;
+    for(k = job->across.offset[x]; k < job->across.offset[x + 1]; k++)
+    { for(c = 0; c < job->channels; c++)
+        line[c] += row[sample + c] * job->across.weights[k];
+      sample += job->channels;
+    }
+
+    line += job->channels;
+  }
+}
+
+/*-----------------------------------------------*/
+/* RESAMPLES ONE BAND OF OUTPUT ROWS             */
+/*-----------------------------------------------*/
+static void resample_Band(void * context, int index)
+{ struct Resample_Job * job = (struct Resample_Job *)context;
+
+  // the rows of the band
+  int row = index * RESAMPLE_BAND_ROWS;
+  int last = (row + RESAMPLE_BAND_ROWS < job->newHeight) ?
+             row + RESAMPLE_BAND_ROWS : job->newHeight;
+
+  // the samples of an output row, and the weight of a whole output pixel
+  size_t samples = (size_t)job->newWidth * job->channels, s;
+  unsigned long long area = (unsigned long long)job->width * job->height;
+
+  // an input row under the output row, the one in line, and loop variable
+  int source, inLine = - 1, k;
+
+  // an input row resampled across, and the sums down the output row
+  unsigned int * line = (unsigned int *)malloc(samples * sizeof(int));
+  unsigned long long * sums = (unsigned long long *)
+                              malloc(samples * sizeof(unsigned long long));
+
+  if(line == NULL || sums == NULL)
+  { job->failed = 1;
+    free(line);
+    free(sums);
+    return;
+  }
+
+  for(; row < last; row++)
+  { memset(sums, 0, samples * sizeof(unsigned long long));
+
+    source = job->down.first[row];
+    for(k = job->down.offset[row]; k < job->down.offset[row + 1]; k++)
+    { // a growing image covers the same input row again
+      if(source != inLine)
+      { resample_Across(job, job->rows[source], line);
+        inLine = source;
+      }
+
+      for(s = 0; s < samples; s++)
+        sums[s] += (unsigned long long)line[s] * job->down.weights[k];
+      source++;
+    }
+
+    for(s = 0; s < samples; s++)
+      job->resampledRows[row][s] = (unsigned char)((sums[s] + area / 2) /
+                                                   area);
+  }
+
+  free(line);
+  free(sums);
+}
+
+/*-----------------------------------------------*/
+/* HALVES ONE BAND OF OUTPUT ROWS                */
+/*-----------------------------------------------*/
+static void downscale_Band(void * context, int index)
+{ struct Resample_Job * job = (struct Resample_Job *)context;
+
+  // the rows of the band
+  int row = index * RESAMPLE_BAND_ROWS;
+  int last = (row + RESAMPLE_BAND_ROWS < job->newHeight) ?
+             row + RESAMPLE_BAND_ROWS : job->newHeight;
+
+  for(; row < last; row++)
+    downscale_Row_2x(job->rows[2 * row], job->rows[2 * row + 1],
+                     job->resampledRows[row], job->newWidth, job->channels);
+}
+
+/*-----------------------------------------------*/
+/* RESAMPLES THE ROWS OF AN IMAGE, BAND BY BAND  */
+/* IN PARALLEL (halve DROPS AN ODD LAST ROW AND  */
+/* COLUMN AND TAKES THE 2x2 MEANS)               */
+/*-----------------------------------------------*/
+static int resample_Rows(struct Resample_Job * job, bool halve)
+{ // the bands of output rows
+  int bands = (job->newHeight + RESAMPLE_BAND_ROWS - 1) / RESAMPLE_BAND_ROWS;
+
+  job->failed = 0;
+
+  // halving an even size covers exactly 2x2 input pixels
+  if(halve ||
+     (job->width == 2 * job->newWidth && job->height == 2 * job->newHeight))
+  { run_Parallel(bands, downscale_Band, job);
+    return 0;
+  }
+
+  memset(&job->across, 0, sizeof(struct Coverage));
+  memset(&job->down, 0, sizeof(struct Coverage));
+
+  if(cover_Axis(&job->across, job->width, job->newWidth) == 0 &&
+     cover_Axis(&job->down, job->height, job->newHeight) == 0)
+    run_Parallel(bands, resample_Band, job);
+  else job->failed = 1;
+
+  free_Coverage(&job->across);
+  free_Coverage(&job->down);
+
+  return job->failed ? - 1 : 0;
+}
+
+/*-----------------------------------------------*/
+/* RESAMPLES A PGM IMAGE INTO AN IMAGE ALREADY   */
+/* CREATED AT THE NEW SIZE                       */
+/*-----------------------------------------------*/
+static int resample_Gray(struct PGM_Image * pgmImage,
+                         struct PGM_Image * resampledImage, bool halve)
+{ struct Resample_Job job;
+
+  job.rows = pgmImage->image;
+  job.resampledRows = resampledImage->image;
+  job.width = pgmImage->width;
+  job.height = pgmImage->height;
+  job.newWidth = resampledImage->width;
+  job.newHeight = resampledImage->height;
+  job.channels = 1;
+
+  if(resample_Rows(&job, halve) != 0)
+  { free_PGM_Image(resampledImage);
+    return - 1;
+  }
+
+  // success
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* RESAMPLES A PPM IMAGE INTO AN IMAGE ALREADY   */
+/* CREATED AT THE NEW SIZE                       */
+/*-----------------------------------------------*/
+static int resample_Colour(struct PPM_Image * ppmImage,
+                           struct PPM_Image * resampledImage, bool halve)
+{ struct Resample_Job job;
+
+  // for loop variable, and the result
+  int row, status = - 1;
+
+  // the RGB triples of each row follow each other
+  job.rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+  job.resampledRows = (unsigned char * *)calloc(resampledImage->height + 1,
+                                                sizeof(char *));
+
+  if(job.rows != NULL && job.resampledRows != NULL)
+  { for(row = 0; row < ppmImage->height; row++)
+      job.rows[row] = ppmImage->image[row][0];
+    for(row = 0; row < resampledImage->height; row++)
+      job.resampledRows[row] = resampledImage->image[row][0];
+
+    job.width = ppmImage->width;
+    job.height = ppmImage->height;
+    job.newWidth = resampledImage->width;
+    job.newHeight = resampledImage->height;
+    job.channels = 3;
+
+    status = resample_Rows(&job, halve);
+  }
+
+  free(job.rows);
+  free(job.resampledRows);
+
+  if(status != 0) free_PPM_Image(resampledImage);
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* HALVES A PGM IMAGE INTO A NEW IMAGE                           */
+/*---------------------------------------------------------------*/
+int downscale_PGM_Image_2x(struct PGM_Image * pgmImage,
+                           struct PGM_Image * smallImage)
+{ if(pgmImage->width < 2 || pgmImage->height < 2) return - 1;
+
+  if(create_PGM_Image(smallImage, pgmImage->width / 2, pgmImage->height / 2,
+                      pgmImage->maxGrayValue) == -1)
+    return - 1;
+
+  return resample_Gray(pgmImage, smallImage, true);
+}
+
+/*---------------------------------------------------------------*/
+/* HALVES A PPM IMAGE INTO A NEW IMAGE                           */
+/*---------------------------------------------------------------*/
+int downscale_PPM_Image_2x(struct PPM_Image * ppmImage,
+                           struct PPM_Image * smallImage)
+{ if(ppmImage->width < 2 || ppmImage->height < 2) return - 1;
+
+  if(create_PPM_Image(smallImage, ppmImage->width / 2, ppmImage->height / 2,
+                      ppmImage->maxGrayValue) == -1)
+    return - 1;
+
+  return resample_Colour(ppmImage, smallImage, true);
+}
+
+/*---------------------------------------------------------------*/
+/* RESAMPLES A PGM IMAGE INTO A NEW IMAGE                        */
+/*---------------------------------------------------------------*/
+int resample_PGM_Image(struct PGM_Image * pgmImage,
+                       struct PGM_Image * resampledImage,
+                       int width, int height)
+{ if(width < 1 || height < 1) return - 1;
+
+  if(create_PGM_Image(resampledImage, width, height,
+                      pgmImage->maxGrayValue) == -1)
+    return - 1;
+
+  return resample_Gray(pgmImage, resampledImage, false);
+}
+
+/*---------------------------------------------------------------*/
+/* RESAMPLES A PPM IMAGE INTO A NEW IMAGE                        */
+/*---------------------------------------------------------------*/
+int resample_PPM_Image(struct PPM_Image * ppmImage,
+                       struct PPM_Image * resampledImage,
+                       int width, int height)
+{ if(width < 1 || height < 1) return - 1;
+
+  if(create_PPM_Image(resampledImage, width, height,
+                      ppmImage->maxGrayValue) == -1)
+    return - 1;
+
+  return resample_Colour(ppmImage, resampledImage, false);
+}
@@ -0,0 +1,51 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_RESAMPLE_H_
+#define _PNM_RESAMPLE_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* RESAMPLING PGM AND PPM IMAGES TO OTHER SIZES                       */
+/*                                                                    */
+/* Halving takes the rounded mean of each 2x2 block of pixels with    */
+/* the SIMD kernel downscale_Row_2x (see libpnm_kernels.h); an odd    */
+/* last row or column is dropped. Chains of halvings build the levels */
+/* of a pyramid.                                                      */
+/*                                                                    */
+/* Any other size is an area resampling: an output pixel covers a     */
+/* rectangle of the input and is the mean of the input pixels under   */
+/* it, each weighted by how much of it is covered. Measured in units  */
+/* of 1 / (new width) of an input pixel across (and likewise down)    */
+/* the coverages are integers, so the means are exact and rounded     */
+/* once, and halving an even size gives the same image as the 2x2     */
+/* mean. Growing an image repeats each input pixel over the outputs   */
+/* it covers, blending where one straddles two.                       */
+/*                                                                    */
+/* Bands of RESAMPLE_BAND_ROWS output rows are resampled on parallel  */
+/* threads.                                                           */
+/*--------------------------------------------------------------------*/
+
+// the output rows resampled by one task
+# define RESAMPLE_BAND_ROWS 16
+
+/*---------------------------------------------------------------*/
+/* HALVES AN IMAGE INTO A NEW IMAGE OF width / 2 BY height / 2   */
+/* (returns -1 if the image is narrower or shorter than 2)       */
+/*---------------------------------------------------------------*/
+int downscale_PGM_Image_2x(struct PGM_Image * pgmImage,
+                           struct PGM_Image * smallImage);
+int downscale_PPM_Image_2x(struct PPM_Image * ppmImage,
+                           struct PPM_Image * smallImage);
+
+/*---------------------------------------------------------------*/
+/* RESAMPLES AN IMAGE INTO A NEW IMAGE OF width BY height        */
+/*---------------------------------------------------------------*/
+int resample_PGM_Image(struct PGM_Image * pgmImage,
+                       struct PGM_Image * resampledImage,
+                       int width, int height);
+int resample_PPM_Image(struct PPM_Image * ppmImage,
+                       struct PPM_Image * resampledImage,
+                       int width, int height);
+#endif /*_PNM_RESAMPLE_H_*/
@@ -0,0 +1,574 @@
+#include <string.h>
+#include <limits.h>
+#include "libpnm.h"
+#include "libpnm_rle.h"
+#include "libpnm_thread.h"
+
+/*-----------------------------------------------*/
+/* THE ROWS OF AN IMAGE BEING ENCODED OR DECODED */
+/*-----------------------------------------------*/
+struct RLE_Job
+{ // the rows (PPM rows are RGB triples), and the pixel geometry
+  unsigned char * * rows; int width, height, pixelBytes;
+
+  // the rows in a stripe, and the number of stripes
+  int stripeRows, stripes;
+
+  // the file offset of every row (relative to its stripe while encoding)
+  unsigned long long * offsets;
+
+  // encoding: the encoded bytes of every stripe and their length
+  unsigned char * * stripeData; size_t * stripeLength;
+
+  // decoding: the whole file and its length
+  const unsigned char * file; size_t fileLength;
+
+  // set by any stripe that fails
+  int failed;
+};
+
+/*---------------------------------------------------------------*/
+/* STORES AND LOADS LITTLE ENDIAN NUMBERS                        */
+/*---------------------------------------------------------------*/
+static void put_Little(unsigned char * bytes, unsigned long long value,
+                       int count)
+{ int byte;
+
+  for(byte = 0; byte < count; byte++) bytes[byte] = value >> (8 * byte);
+}
+
+static unsigned long long get_Little(const unsigned char * bytes, int count)
+{ unsigned long long value = 0; int byte;
+
+  for(byte = count - 1; byte >= 0; byte--) value = (value << 8) | bytes[byte];
+
+  return value;
+}
+
+/*---------------------------------------------------------------*/
+/* FILLS IN A HEADER FROM ITS RLE_HEADER_BYTES                   */
+/*---------------------------------------------------------------*/
+static int parse_RLE_Header(const unsigned char * bytes,
+                            struct RLE_Header * header)
+{ unsigned long long width, height, maxGrayValue, stripeRows;
+
+  if(memcmp(bytes, RLE_MAGIC, 4) != 0 || bytes[4] != RLE_VERSION) return - 1;
+  if(bytes[5] < PBM || bytes[5] > PPM) return - 1;
+
+  width = get_Little(bytes + 8, 4);
+  height = get_Little(bytes + 12, 4);
+  maxGrayValue = get_Little(bytes + 16, 4);
+  stripeRows = get_Little(bytes + 20, 4);
+
+  if(width > INT_MAX || height > INT_MAX || maxGrayValue > 255 ||
+     stripeRows == 0 || stripeRows > INT_MAX)
+    return - 1;
+
+  header->format = (enum Format)bytes[5];
+  header->width = (int)width;
+  header->height = (int)height;
+  header->maxGrayValue = (int)maxGrayValue;
+  header->stripeRows = (int)stripeRows;
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* READS A CONTAINER HEADER AT THE CURRENT POSITION              */
+/*---------------------------------------------------------------*/
+int read_RLE_Header(FILE * filePointer, struct RLE_Header * header)
+{ unsigned char bytes[RLE_HEADER_BYTES];
+
+  if(fread(bytes, 1, RLE_HEADER_BYTES, filePointer) != RLE_HEADER_BYTES)
+    return - 1;
+
+  return parse_RLE_Header(bytes, header);
+}
+
+/*---------------------------------------------------------------*/
+/* READS THE ROW INDEX THAT FOLLOWS THE HEADER                   */
+/*---------------------------------------------------------------*/
+int read_RLE_Offsets(FILE * filePointer, long * offsets, int height)
+{ unsigned char bytes[8]; int row;
+
+  for(row = 0; row < height; row++)
+  { if(fread(bytes, 1, 8, filePointer) != 8) return - 1;
+    offsets[row] = (long)get_Little(bytes, 8);
+  }
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* WRITES A TOKEN HEADER AS AN LEB128 VARINT                     */
+/*---------------------------------------------------------------*/
+static size_t put_Varint(unsigned char * encoded, size_t value)
+{ size_t length = 0;
+
+  while(value >= 0x80)
+  { encoded[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  encoded[length++] = value;
+
+  return length;
+}
+
+/*---------------------------------------------------------------*/
+/* ENCODES A ROW                                                 */
+/*---------------------------------------------------------------*/
+size_t encode_RLE_Row(const unsigned char * row, int width, int pixelBytes,
+                      unsigned char * encoded)
+{ // where the pending literals start, and the end of the current run
+  int literal = 0, col = 0, end;
+
+  // the bytes written
+  size_t length = 0;
+
+  while(col < width)
+  { // find the run starting at col
+    end = col + 1;
+    if(pixelBytes == 1)
+      while(end < width && row[end] == row[col]) end++;
+    else
+      while(end < width && row[3 * end] == row[3 * col] &&
+            row[3 * end + 1] == row[3 * col + 1] &&
+            row[3 * end + 2] == row[3 * col + 2]) end++;
+
+    // short runs stay in the literals
+    if(end - col >= RLE_MIN_RUN)
+    { if(literal < col)
+      { length += put_Varint(encoded + length, (size_t)(col - literal) << 1);
+        memcpy(encoded + length, row + (size_t)literal * pixelBytes,
+               (size_t)(col - literal) * pixelBytes);
+        length += (size_t)(col - literal) * pixelBytes;
+      }
+      length += put_Varint(encoded + length, ((size_t)(end - col) << 1) | 1);
+      memcpy(encoded + length, row + (size_t)col * pixelBytes, pixelBytes);
+      length += pixelBytes;
+      literal = end;
+    }
+
+    col = end;
+  }
+
+  // the literals left at the end of the row
+  if(literal < width)
+  { length += put_Varint(encoded + length, (size_t)(width - literal) << 1);
+    memcpy(encoded + length, row + (size_t)literal * pixelBytes,
+           (size_t)(width - literal) * pixelBytes);
+    length += (size_t)(width - literal) * pixelBytes;
+  }
+
+  return length;
+}
+
+/*---------------------------------------------------------------*/
+/* DECODES A ROW                                                 */
+/*---------------------------------------------------------------*/
+long decode_RLE_Row(const unsigned char * encoded, size_t length,
+                    unsigned char * row, int width, int pixelBytes)
+{ // the position in encoded, the pixels produced
+  size_t position = 0; int col = 0;
+
+  // a token header, its count, and a for loop variable
+  size_t value; int shift, count, pixel;
+
+  while(col < width)
+  { // read the varint
+    value = 0;
+    for(shift = 0; ; shift += 7)
+    { if(position >= length || shift > 35) return - 1;
+      value |= (size_t)(encoded[position] & 0x7F) << shift;
+      if((encoded[position++] & 0x80) == 0) break;
+    }
+
+    if((value >> 1) == 0 || (value >> 1) > (size_t)(width - col)) return - 1;
+    count = (int)(value >> 1);
+
+    // a run repeats one pixel
+    if(value & 1)
+    { if(length - position < (size_t)pixelBytes) return - 1;
+      if(pixelBytes == 1)
+        memset(row + col, encoded[position], count);
+      else
+        for(pixel = col; pixel < col + count; pixel++)
+          memcpy(row + (size_t)pixel * pixelBytes, encoded + position,
+                 pixelBytes);
+      position += pixelBytes;
+    }
+
+    // literals are copied
+    else
+    { if(length - position < (size_t)count * pixelBytes) return - 1;
+      memcpy(row + (size_t)col * pixelBytes, encoded + position,
+             (size_t)count * pixelBytes);
+      position += (size_t)count * pixelBytes;
+    }
+
+    col += count;
+  }
+
+  return (long)position;
+}
+
+/*---------------------------------------------------------------*/
+/* ENCODES ONE STRIPE OF ROWS                                    */
+/*---------------------------------------------------------------*/
+static void encode_Stripe(void * context, int stripe)
+{ struct RLE_Job * job = (struct RLE_Job *)context;
+
+  // the rows of the stripe
+  int first = stripe * job->stripeRows, row;
+  int last = (first + job->stripeRows < job->height) ?
+             first + job->stripeRows : job->height;
+
+  // the bytes written, and the encoding of the previous row
+  size_t length = 0, rowLength, previous = 0, previousLength = 0;
+
+  unsigned char * data = (unsigned char *)
+    malloc(RLE_ROW_BOUND(job->width, job->pixelBytes) * (last - first));
+  if(data == NULL)
+  { job->failed = 1;
+    return;
+  }
+
+  for(row = first; row < last; row++)
+  { rowLength = encode_RLE_Row(job->rows[row], job->width, job->pixelBytes,
+                               data + length);
+
+    // a row like the one before shares its data
+    if(row > first && rowLength == previousLength &&
+       memcmp(data + previous, data + length, rowLength) == 0)
+    { job->offsets[row] = previous;
+      continue;
+    }
+
+    job->offsets[row] = length;
+    previous = length;
+    previousLength = rowLength;
+    length += rowLength;
+  }
+
+  job->stripeData[stripe] = data;
+  job->stripeLength[stripe] = length;
+}
+
+/*---------------------------------------------------------------*/
+/* WRITES ROWS AS A CONTAINER TO AN OPEN FILE                    */
+/*---------------------------------------------------------------*/
+static int write_RLE(FILE * imageFilePointer, enum Format format,
+                     int width, int height, int maxGrayValue,
+                     unsigned char * * rows, int pixelBytes)
+{ struct RLE_Job job;
+
+  // the header and index, and where the next stripe starts
+  unsigned char * index; unsigned long long base;
+  unsigned char header[RLE_HEADER_BYTES] = {0};
+
+  // for loop variables, and the result
+  int stripe, row, status = 0;
+
+  memset(&job, 0, sizeof(job));
+  job.rows = rows;
+  job.width = width;
+  job.height = height;
+  job.pixelBytes = pixelBytes;
+  job.stripeRows = RLE_STRIPE_ROWS;
+  job.stripes = (height + RLE_STRIPE_ROWS - 1) / RLE_STRIPE_ROWS;
+
+  job.offsets = (unsigned long long *)
+                calloc(height + 1, sizeof(unsigned long long));
+  job.stripeData = (unsigned char * *)
+                   calloc(job.stripes + 1, sizeof(unsigned char *));
+  job.stripeLength = (size_t *)calloc(job.stripes + 1, sizeof(size_t));
+  index = (unsigned char *)malloc((size_t)height * 8 + 1);
+
+  if(job.offsets == NULL || job.stripeData == NULL ||
+     job.stripeLength == NULL || index == NULL)
+    status = - 1;
+
+  // encode the stripes
+  if(status == 0)
+  { run_Parallel(job.stripes, encode_Stripe, &job);
+    if(job.failed) status = - 1;
+  }
+
+  if(status == 0)
+  { // make the offsets absolute
+    base = RLE_HEADER_BYTES + (unsigned long long)height * 8;
+    for(stripe = 0; stripe < job.stripes; stripe++)
+    { for(row = stripe * job.stripeRows;
+          row < height && row < (stripe + 1) * job.stripeRows; row++)
+        put_Little(index + (size_t)row * 8, job.offsets[row] + base, 8);
+      base += job.stripeLength[stripe];
+    }
+
+    // write the header, the index and the stripes
+    memcpy(header, RLE_MAGIC, 4);
+    header[4] = RLE_VERSION;
+    header[5] = format;
+    put_Little(header + 8, width, 4);
+    put_Little(header + 12, height, 4);
+    put_Little(header + 16, maxGrayValue, 4);
+    put_Little(header + 20, job.stripeRows, 4);
+
+    fwrite(header, 1, RLE_HEADER_BYTES, imageFilePointer);
+    fwrite(index, 1, (size_t)height * 8, imageFilePointer);
+    for(stripe = 0; stripe < job.stripes; stripe++)
+      fwrite(job.stripeData[stripe], 1, job.stripeLength[stripe],
+             imageFilePointer);
+
+    if(ferror(imageFilePointer)) status = - 1;
+  }
+
+  if(job.stripeData != NULL)
+    for(stripe = 0; stripe < job.stripes; stripe++)
+      free(job.stripeData[stripe]);
+  free(job.stripeData);
+  free(job.stripeLength);
+  free(job.offsets);
+  free(index);
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* DECODES ONE STRIPE OF ROWS                                    */
+/*---------------------------------------------------------------*/
+static void decode_Stripe(void * context, int stripe)
+{ struct RLE_Job * job = (struct RLE_Job *)context;
+  int row = stripe * job->stripeRows, last = row + job->stripeRows;
+
+  for(; row < last && row < job->height; row++)
+    if(job->offsets[row] >= job->fileLength ||
+       decode_RLE_Row(job->file + job->offsets[row],
+                      job->fileLength - job->offsets[row],
+                      job->rows[row], job->width, job->pixelBytes) < 0)
+    { job->failed = 1;
+      return;
+    }
+}
+
+/*---------------------------------------------------------------*/
+/* READS A WHOLE CONTAINER FILE, CHECKS ITS FORMAT AND INDEX    */
+/* AND SETS UP THE JOB THAT DECODES IT                           */
+/*---------------------------------------------------------------*/
+static unsigned char * read_RLE_File(char * fileName, enum Format format,
+                                     struct RLE_Header * header,
+                                     struct RLE_Job * job)
+{ // the whole file
+  unsigned char * file = NULL; long length; int row;
+
+  FILE * imageFilePointer = fileOpener(READ, fileName);
+  if(imageFilePointer == NULL) return NULL;
+
+  if(fseek(imageFilePointer, 0, SEEK_END) == 0 &&
+     (length = ftell(imageFilePointer)) >= RLE_HEADER_BYTES &&
+     fseek(imageFilePointer, 0, SEEK_SET) == 0)
+  { file = (unsigned char *)malloc(length);
+    if(file != NULL &&
+       fread(file, 1, length, imageFilePointer) != (size_t)length)
+    { free(file);
+      file = NULL;
+    }
+  }
+  fclose(imageFilePointer);
+
+  if(file == NULL) return NULL;
+
+  // check the header and that the index fits
+  if(parse_RLE_Header(file, header) != 0 || header->format != format ||
+     (unsigned long long)(length - RLE_HEADER_BYTES) / 8 <
+     (unsigned long long)header->height)
+  { free(file);
+    return NULL;
+  }
+
+  memset(job, 0, sizeof(*job));
+  job->width = header->width;
+  job->height = header->height;
+  job->pixelBytes = (format == PPM) ? 3 : 1;
+  job->stripeRows = header->stripeRows;
+  job->stripes = (int)(((long long)header->height + header->stripeRows - 1) /
+                       header->stripeRows);
+  job->file = file;
+  job->fileLength = length;
+
+  job->offsets = (unsigned long long *)
+                 calloc(header->height + 1, sizeof(unsigned long long));
+  if(job->offsets == NULL)
+  { free(file);
+    return NULL;
+  }
+
+  for(row = 0; row < header->height; row++)
+    job->offsets[row] = get_Little(file + RLE_HEADER_BYTES + (size_t)row * 8, 8);
+
+  return file;
+}
+
+/*---------------------------------------------------------------*/
+/* DECODES THE ROWS OF A READ FILE IN PARALLEL AND RELEASES IT   */
+/*---------------------------------------------------------------*/
+static int decode_RLE_File(unsigned char * file, struct RLE_Job * job)
+{ run_Parallel(job->stripes, decode_Stripe, job);
+
+  free(job->offsets);
+  free(file);
+
+  return job->failed ? - 1 : 0;
+}
+
+/*---------------------------------------------------------------*/
+/* WRITES AN IMAGE AS A CONTAINER TO AN OPEN FILE                */
+/*---------------------------------------------------------------*/
+int write_PBM_Image_RLE(struct PBM_Image * pbmImage, FILE * imageFilePointer)
+{ return write_RLE(imageFilePointer, PBM, pbmImage->width, pbmImage->height,
+                   1, pbmImage->image, 1);
+}
+
+int write_PGM_Image_RLE(struct PGM_Image * pgmImage, FILE * imageFilePointer)
+{ return write_RLE(imageFilePointer, PGM, pgmImage->width, pgmImage->height,
+                   pgmImage->maxGrayValue, pgmImage->image, 1);
+}
+
+int write_PPM_Image_RLE(struct PPM_Image * ppmImage, FILE * imageFilePointer)
+{ // the RGB triples of each row follow each other
+  unsigned char * * rows; int row, status;
+
+  rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+  if(rows == (unsigned char * *)0) return - 1;
+
+  for(row = 0; row < ppmImage->height; row++)
+    rows[row] = ppmImage->image[row][0];
+
+  status = write_RLE(imageFilePointer, PPM, ppmImage->width, ppmImage->height,
+                     ppmImage->maxGrayValue, rows, 3);
+  free(rows);
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* SAVES AN IMAGE AS A CONTAINER FILE                            */
+/*---------------------------------------------------------------*/
+int save_PBM_Image_RLE(struct PBM_Image * pbmImage, char * fileName)
+{ int status;
+
+  FILE * imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PBM_Image_RLE(pbmImage, imageFilePointer);
+  if(fclose(imageFilePointer) != 0) status = - 1;
+
+  return status;
+}
+
+int save_PGM_Image_RLE(struct PGM_Image * pgmImage, char * fileName)
+{ int status;
+
+  FILE * imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PGM_Image_RLE(pgmImage, imageFilePointer);
+  if(fclose(imageFilePointer) != 0) status = - 1;
+
+  return status;
+}
+
+int save_PPM_Image_RLE(struct PPM_Image * ppmImage, char * fileName)
+{ int status;
+
+  FILE * imageFilePointer = fileOpener(WRITE, fileName);
+  if(imageFilePointer == NULL) return - 1;
+
+  status = write_PPM_Image_RLE(ppmImage, imageFilePointer);
+  if(fclose(imageFilePointer) != 0) status = - 1;
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* THE 'CONSTRUCTORS' WHICH LOAD AN IMAGE FROM A CONTAINER FILE  */
+/*---------------------------------------------------------------*/
+int load_PBM_Image_RLE(struct PBM_Image * pbmImage, char * fileName)
+{ struct RLE_Header header; struct RLE_Job job;
+  unsigned char * file = read_RLE_File(fileName, PBM, &header, &job);
+
+  if(file == NULL) return - 1;
+
+  if(create_PBM_Image(pbmImage, header.width, header.height) == -1)
+  { free(job.offsets);
+    free(file);
+    return - 1;
+  }
+
+  job.rows = pbmImage->image;
+  if(decode_RLE_File(file, &job) != 0)
+  { free_PBM_Image(pbmImage);
+    return - 1;
+  }
+
+  return 0;
+}
+
+int load_PGM_Image_RLE(struct PGM_Image * pgmImage, char * fileName)
+{ struct RLE_Header header; struct RLE_Job job;
+  unsigned char * file = read_RLE_File(fileName, PGM, &header, &job);
+
+  if(file == NULL) return - 1;
+
+  if(create_PGM_Image(pgmImage, header.width, header.height,
+                      header.maxGrayValue) == -1)
+  { free(job.offsets);
+    free(file);
+    return - 1;
+  }
+
+  job.rows = pgmImage->image;
+  if(decode_RLE_File(file, &job) != 0)
+  { free_PGM_Image(pgmImage);
+    return - 1;
+  }
+
+  return 0;
+}
+
+int load_PPM_Image_RLE(struct PPM_Image * ppmImage, char * fileName)
+{ struct RLE_Header header; struct RLE_Job job;
+  unsigned char * * rows; int row, status;
+  unsigned char * file = read_RLE_File(fileName, PPM, &header, &job);
+
+  if(file == NULL) return - 1;
+
+  if(create_PPM_Image(ppmImage, header.width, header.height,
+                      header.maxGrayValue) == -1)
+  { free(job.offsets);
+    free(file);
+    return - 1;
+  }
+
+  // decode straight into the RGB triples of each row
+  rows = (unsigned char * *)calloc(ppmImage->height + 1, sizeof(char *));
+  if(rows == (unsigned char * *)0)
+  { free(job.offsets);
+    free(file);
+    free_PPM_Image(ppmImage);
+    return - 1;
+  }
+
+  for(row = 0; row < ppmImage->height; row++)
+    rows[row] = ppmImage->image[row][0];
+
+  job.rows = rows;
+  status = decode_RLE_File(file, &job);
+  free(rows);
+
+  if(status != 0)
+  { free_PPM_Image(ppmImage);
+    return - 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_RLE_H_
+#define _PNM_RLE_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* A RUN LENGTH COMPRESSED CONTAINER FOR PBM, PGM AND PPM IMAGES      */
+/*                                                                    */
+/* All numbers are little endian. The file starts with a header of    */
+/* RLE_HEADER_BYTES:                                                  */
+/*                                                                    */
+/*   "PRLE"  u8 version  u8 format (1 PBM, 2 PGM, 3 PPM)  u16 zero    */
+/*   u32 width  u32 height  u32 maxGrayValue  u32 stripeRows          */
+/*                                                                    */
+/* followed by a u64 file offset for every row, then the row data.    */
+/* A row is a sequence of tokens until width pixels (a byte each for  */
+/* PBM and PGM, an RGB triple for PPM) have been produced; a token is */
+/* an LEB128 varint v holding n = v >> 1, followed by one pixel       */
+/* repeated n times when v is odd, or by n literal pixels when even.  */
+/*                                                                    */
+/* Every row decodes on its own, so any row can be read through the   */
+/* index. Rows are encoded in stripes of stripeRows rows on parallel  */
+/* threads; a row that encodes the same as the row before it in its  */
+/* stripe shares that row's data instead of repeating it.             */
+/*--------------------------------------------------------------------*/
+
+// the container header
+# define RLE_MAGIC "PRLE"
+# define RLE_VERSION 1
+# define RLE_HEADER_BYTES 24
+
+// the rows encoded by one thread
+# define RLE_STRIPE_ROWS 64
+
+// the shortest run written as a run, shorter ones go into literals
+# define RLE_MIN_RUN 3
+
+// the most bytes a row of width pixels of pixelBytes bytes encodes to
+# define RLE_ROW_BOUND(width, pixelBytes) \
+  (2 * (size_t)(width) * (pixelBytes) + 16)
+
+/*-----------------------------------*/
+/* THE FIELDS OF A CONTAINER HEADER  */
+/*-----------------------------------*/
+struct RLE_Header
+{ // PBM, PGM or PPM
+  enum Format format;
+
+  // the image dimensions and max gray value
+  int width, height, maxGrayValue;
+
+  // the rows in an encoding stripe
+  int stripeRows;
+};
+
+/*---------------------------------------------------------------*/
+/* READS A CONTAINER HEADER AND ROW INDEX AT THE CURRENT         */
+/* POSITION OF filePointer (offsets gets height entries)         */
+/*---------------------------------------------------------------*/
+int read_RLE_Header(FILE * filePointer, struct RLE_Header * header);
+int read_RLE_Offsets(FILE * filePointer, long * offsets, int height);
+
+/*---------------------------------------------------------------*/
+/* ENCODES A ROW, RETURNS THE NUMBER OF BYTES WRITTEN TO encoded */
+/* (at most RLE_ROW_BOUND)                                       */
+/*---------------------------------------------------------------*/
+size_t encode_RLE_Row(const unsigned char * row, int width, int pixelBytes,
+                      unsigned char * encoded);
+
+/*---------------------------------------------------------------*/
+/* DECODES A ROW FROM THE length BYTES AT encoded, RETURNS THE   */
+/* NUMBER OF BYTES USED OR -1 IF THE DATA IS CORRUPT             */
+/*---------------------------------------------------------------*/
+long decode_RLE_Row(const unsigned char * encoded, size_t length,
+                    unsigned char * row, int width, int pixelBytes);
+
+/*---------------------------------------------------------------*/
+/* WRITES AN IMAGE AS A CONTAINER TO AN OPEN FILE                */
+/*---------------------------------------------------------------*/
+int write_PBM_Image_RLE(struct PBM_Image * pbmImage, FILE * imageFilePointer);
+int write_PGM_Image_RLE(struct PGM_Image * pgmImage, FILE * imageFilePointer);
+int write_PPM_Image_RLE(struct PPM_Image * ppmImage, FILE * imageFilePointer);
+
+/*---------------------------------------------------------------*/
+/* SAVES AN IMAGE AS A CONTAINER FILE                            */
+/*---------------------------------------------------------------*/
+int save_PBM_Image_RLE(struct PBM_Image * pbmImage, char * fileName);
+int save_PGM_Image_RLE(struct PGM_Image * pgmImage, char * fileName);
+int save_PPM_Image_RLE(struct PPM_Image * ppmImage, char * fileName);
+
+/*---------------------------------------------------------------*/
+/* THE 'CONSTRUCTORS' WHICH LOAD AN IMAGE FROM A CONTAINER FILE  */
+/* (the stripes are decoded in parallel)                         */
+/*---------------------------------------------------------------*/
+int load_PBM_Image_RLE(struct PBM_Image * pbmImage, char * fileName);
+int load_PGM_Image_RLE(struct PGM_Image * pgmImage, char * fileName);
+int load_PPM_Image_RLE(struct PPM_Image * ppmImage, char * fileName);
+#endif /*_PNM_RLE_H_*/
@@ -0,0 +1,295 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_shm.h"
+
+/*-----------------------------------------------*/
+/* WAITS ON OR WAKES THE GENERATION (shared      */
+/* between processes, so not FUTEX_PRIVATE)      */
+/*-----------------------------------------------*/
+static long futex_Call(unsigned int * word, int operation, unsigned int value,
+                       const struct timespec * timeout)
+{ return syscall(SYS_futex, word, operation, value, timeout, NULL, 0);
+}
+
+/*-----------------------------------------------*/
+/* POINTS THE ROWS OF THE MAPPED IMAGE AT THE    */
+/* BODY DESCRIBED BY THE HEADER                  */
+/*-----------------------------------------------*/
+static int set_Rows(struct PNM_Shared_Image * sharedImage)
+{ struct PNM_Mapped_Image * mappedImage = &sharedImage->mappedImage;
+  struct PNM_Shared_Header * header = sharedImage->header;
+
+  // for loop variable
+  int row;
+
+  mappedImage->width = header->width;
+  mappedImage->height = header->height;
+  mappedImage->maxGrayValue = header->maxGrayValue;
+  mappedImage->format = (enum Format)header->format;
+  mappedImage->rowBytes = (size_t)header->rowBytes;
+
+  mappedImage->rows = (unsigned char * *)calloc(header->height + 1,
+                                                sizeof(char *));
+  if(mappedImage->rows == (unsigned char * *)0) return - 1;
+
+  for(row = 0; row < header->height; row++)
+    mappedImage->rows[row] = mappedImage->map + header->bodyOffset +
+                             (size_t)row * mappedImage->rowBytes;
+
+  // success
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* MAPS THE WHOLE OBJECT READ AND WRITE          */
+/*-----------------------------------------------*/
+static int map_Object(struct PNM_Mapped_Image * mappedImage)
+{ mappedImage->map = (unsigned char *)mmap(NULL, mappedImage->length,
+                                           PROT_READ | PROT_WRITE,
+                                           MAP_SHARED, mappedImage->fd, 0);
+
+  return (mappedImage->map == (unsigned char *)MAP_FAILED) ? - 1 : 0;
+}
+
+/*---------------------------------------------------------------*/
+/* CREATES AND MAPS A SHARED IMAGE                               */
+/*---------------------------------------------------------------*/
+int create_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage,
+                            const char * name, enum Format format,
+                            int width, int height, int maxGrayValue)
+{ struct PNM_Mapped_Image * mappedImage = &sharedImage->mappedImage;
+  struct PNM_Shared_Header * header;
+
+  // the bytes in a row, and the body starts on the page after the header
+  size_t rowBytes, bodyOffset = (size_t)sysconf(_SC_PAGESIZE);
+
+  // the size of an object already there, and whether it is kept
+  struct stat info; bool reused = false;
+
+  if(width < 0 || height < 0 || format < PBM || format > PPM) return - 1;
+  if(maxGrayValue > 255) maxGrayValue = 255;
+
+  rowBytes = (format == PBM) ? (size_t)PBM_ROW_BYTES(width) :
+             (size_t)width * (format == PPM ? 3 : 1);
+  mappedImage->length = bodyOffset + rowBytes * height;
+
+  mappedImage->fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+  if(mappedImage->fd < 0) return - 1;
+
+  if(fstat(mappedImage->fd, &info) != 0)
+  { close(mappedImage->fd);
+    return - 1;
+  }
+
+  // an image of the same layout is kept, so the processes waiting on it
+  // see the next generation published
+  if((size_t)info.st_size == mappedImage->length &&
+     map_Object(mappedImage) == 0)
+  { header = (struct PNM_Shared_Header *)mappedImage->map;
+    reused = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) ==
+               SHARED_MAGIC &&
+             header->format == (int)format && header->width == width &&
+             header->height == height &&
+             header->maxGrayValue == maxGrayValue &&
+             header->rowBytes == rowBytes && header->bodyOffset == bodyOffset;
+    if(!reused) munmap(mappedImage->map, mappedImage->length);
+  }
+
+  // any other image is replaced rather than resized, so the processes
+  // that still have it mapped keep it whole (and must open the new one)
+  if(!reused && info.st_size != 0)
+  { close(mappedImage->fd);
+    shm_unlink(name);
+    mappedImage->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(mappedImage->fd < 0) return - 1;
+  }
+
+  if(!reused && (ftruncate(mappedImage->fd, mappedImage->length) != 0 ||
+                 map_Object(mappedImage) != 0))
+  { close(mappedImage->fd);
+    shm_unlink(name);
+    return - 1;
+  }
+
+  header = sharedImage->header = (struct PNM_Shared_Header *)mappedImage->map;
+  if(!reused)
+  { header->generation = 0;
+    header->format = format;
+    header->width = width;
+    header->height = height;
+    header->maxGrayValue = maxGrayValue;
+    header->rowBytes = rowBytes;
+    header->bodyOffset = bodyOffset;
+
+    // the magic goes last, an image is only opened once its header is whole
+    __atomic_store_n(&header->magic, SHARED_MAGIC, __ATOMIC_RELEASE);
+  }
+
+  if(set_Rows(sharedImage) != 0)
+  { munmap(mappedImage->map, mappedImage->length);
+    close(mappedImage->fd);
+    if(!reused) shm_unlink(name);
+    return - 1;
+  }
+
+  // success
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* MAPS A SHARED IMAGE CREATED BY ANOTHER PROCESS                */
+/*---------------------------------------------------------------*/
+int open_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage,
+                          const char * name)
+{ struct PNM_Mapped_Image * mappedImage = &sharedImage->mappedImage;
+  struct PNM_Shared_Header * header;
+
+  // the size of the object, and the bytes a row must have
+  struct stat info; unsigned long long rowBytes;
+
+  mappedImage->fd = shm_open(name, O_RDWR, 0);
+  if(mappedImage->fd < 0) return - 1;
+
+  if(fstat(mappedImage->fd, &info) != 0 ||
+     (size_t)info.st_size < sizeof(struct PNM_Shared_Header))
+  { close(mappedImage->fd);
+    return - 1;
+  }
+
+  mappedImage->length = (size_t)info.st_size;
+  mappedImage->map = (unsigned char *)mmap(NULL, mappedImage->length,
+                                           PROT_READ | PROT_WRITE,
+                                           MAP_SHARED, mappedImage->fd, 0);
+  if(mappedImage->map == (unsigned char *)MAP_FAILED)
+  { close(mappedImage->fd);
+    return - 1;
+  }
+
+  // the header must be whole and describe a body that fits the object
+  mappedImage->rows = NULL;
+  header = sharedImage->header = (struct PNM_Shared_Header *)mappedImage->map;
+  if(__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHARED_MAGIC ||
+     header->format < PBM || header->format > PPM ||
+     header->width < 0 || header->height < 0)
+  { close_PNM_Mapped_Image(mappedImage);
+    return - 1;
+  }
+
+  rowBytes = (unsigned long long)header->width;
+  if(header->format == PBM) rowBytes = PBM_ROW_BYTES(rowBytes);
+  if(header->format == PPM) rowBytes *= 3;
+  if(header->rowBytes != rowBytes ||
+     header->bodyOffset < sizeof(struct PNM_Shared_Header) ||
+     header->bodyOffset + rowBytes * header->height > mappedImage->length)
+  { close_PNM_Mapped_Image(mappedImage);
+    return - 1;
+  }
+
+  if(set_Rows(sharedImage) != 0)
+  { munmap(mappedImage->map, mappedImage->length);
+    close(mappedImage->fd);
+    return - 1;
+  }
+
+  // success
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* MARKS THE PIXELS AS BEING WRITTEN                             */
+/*---------------------------------------------------------------*/
+void begin_PNM_Shared_Write(struct PNM_Shared_Image * sharedImage)
+{ __atomic_fetch_or(&sharedImage->header->generation, 1u, __ATOMIC_ACQ_REL);
+
+  // no pixel may be written before the generation is seen to be odd
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/*---------------------------------------------------------------*/
+/* PUBLISHES THE PIXELS AND WAKES THE WAITING PROCESSES          */
+/*---------------------------------------------------------------*/
+unsigned int publish_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage)
+{ // the next even generation, never 0
+  unsigned int generation =
+    (__atomic_load_n(&sharedImage->header->generation, __ATOMIC_RELAXED) |
+     1u) + 1u;
+  if(generation == 0) generation = 2;
+
+  __atomic_store_n(&sharedImage->header->generation, generation,
+                   __ATOMIC_RELEASE);
+  futex_Call(&sharedImage->header->generation, FUTEX_WAKE, INT_MAX, NULL);
+
+  return generation;
+}
+
+/*---------------------------------------------------------------*/
+/* GETS THE CURRENT GENERATION                                   */
+/*---------------------------------------------------------------*/
+unsigned int get_PNM_Shared_Generation(struct PNM_Shared_Image * sharedImage)
+{ // reads of the pixels before this are done before it
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  return __atomic_load_n(&sharedImage->header->generation, __ATOMIC_ACQUIRE);
+}
+
+/*---------------------------------------------------------------*/
+/* WAITS FOR A NEWLY PUBLISHED GENERATION                        */
+/*---------------------------------------------------------------*/
+unsigned int wait_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage,
+                                   unsigned int seen, int timeout)
+{ // the generation, and when to give up and how long is left until then
+  unsigned int generation; struct timespec deadline, now, left;
+
+  if(timeout >= 0)
+  { clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+    if(deadline.tv_nsec >= 1000000000)
+    { deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+  }
+
+  for(;;)
+  { generation = __atomic_load_n(&sharedImage->header->generation,
+                                 __ATOMIC_ACQUIRE);
+    if(generation != 0 && generation % 2 == 0 && generation != seen)
+      return generation;
+
+    if(timeout < 0)
+    { futex_Call(&sharedImage->header->generation, FUTEX_WAIT, generation,
+                 NULL);
+      continue;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    left.tv_sec = deadline.tv_sec - now.tv_sec;
+    left.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+    if(left.tv_nsec < 0)
+    { left.tv_sec--;
+      left.tv_nsec += 1000000000;
+    }
+    if(left.tv_sec < 0) return 0;
+
+    // returns at once if the generation has already moved on
+    futex_Call(&sharedImage->header->generation, FUTEX_WAIT, generation,
+               &left);
+  }
+}
+
+/*---------------------------------------------------------------*/
+/* REMOVES THE NAME OF A SHARED IMAGE                            */
+/*---------------------------------------------------------------*/
+int unlink_PNM_Shared_Image(const char * name)
+{ return shm_unlink(name) == 0 ? 0 : - 1;
+}
@@ -0,0 +1,105 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_SHM_H_
+#define _PNM_SHM_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* IMAGES IN POSIX SHARED MEMORY, HANDED BETWEEN PROCESSES            */
+/*                                                                    */
+/* A shared image is a shm_open object holding a header and then, on  */
+/* the next page, the body of a raw image (packed bits for PBM, RGB   */
+/* triples for PPM). Every process that opens it by name maps the     */
+/* same pixels, so handing an image over copies nothing and neither   */
+/* encodes nor decodes it.                                            */
+/*                                                                    */
+/* The image is held as a PNM_Mapped_Image, so map_PGM_Image and the  */
+/* others give views of it and close_PNM_Mapped_Image unmaps it,      */
+/* exactly as for a mapped file.                                      */
+/*                                                                    */
+/* Readiness is signalled through the generation in the header, which */
+/* is also a futex. It is odd while the producer writes the pixels    */
+/* and becomes even when they are published, waking every process     */
+/* waiting for it; 0 means nothing has been published yet. A consumer */
+/* that reads while the producer may start the next image can check   */
+/* the generation has not changed once it is done.                    */
+/*--------------------------------------------------------------------*/
+
+// the first word of the header, "PNMS"
+# define SHARED_MAGIC 0x534d4e50u
+
+/*-----------------------------------------------------------------*/
+/* THE HEADER AT THE START OF A SHARED IMAGE                        */
+/*-----------------------------------------------------------------*/
+struct PNM_Shared_Header
+{ // SHARED_MAGIC once the header is complete, and the generation
+  unsigned int magic, generation;
+
+  // the format (enum Format), the image dimensions and max gray value
+  int format, width, height, maxGrayValue;
+
+  // the bytes in a row of the body, and the offset of the body
+  unsigned long long rowBytes, bodyOffset;
+};
+
+/*-----------------------------------------------------------------*/
+/* A SHARED IMAGE OPENED BY ONE PROCESS                             */
+/*-----------------------------------------------------------------*/
+struct PNM_Shared_Image
+{ // the whole object mapped, rows[row] pointing into its body
+  struct PNM_Mapped_Image mappedImage;
+
+  // the header at the start of the mapping
+  struct PNM_Shared_Header * header;
+};
+
+/*---------------------------------------------------------------*/
+/* CREATES THE SHARED IMAGE CALLED name, E.G. "/frames", READ    */
+/* AND WRITE FOR ITS OWNER ONLY, AND MAPS IT; THE PIXELS START   */
+/* AT ZERO. AN IMAGE OF THAT NAME WITH THE SAME FORMAT, SIZE AND */
+/* MAX GRAY VALUE IS KEPT, PIXELS AND GENERATION INCLUDED, SO    */
+/* THE PROCESSES WAITING ON IT CARRY ON; ANY OTHER IS REPLACED,  */
+/* AND THE PROCESSES THAT HAD IT OPEN MUST OPEN THE NEW ONE      */
+/*---------------------------------------------------------------*/
+int create_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage,
+                            const char * name, enum Format format,
+                            int width, int height, int maxGrayValue);
+
+/*---------------------------------------------------------------*/
+/* MAPS THE SHARED IMAGE CALLED name CREATED BY ANOTHER PROCESS  */
+/*---------------------------------------------------------------*/
+int open_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage,
+                          const char * name);
+
+/*---------------------------------------------------------------*/
+/* MARKS THE PIXELS AS BEING WRITTEN (the generation turns odd)  */
+/*---------------------------------------------------------------*/
+void begin_PNM_Shared_Write(struct PNM_Shared_Image * sharedImage);
+
+/*---------------------------------------------------------------*/
+/* PUBLISHES THE PIXELS AND WAKES THE WAITING PROCESSES          */
+/* (returns the new, even generation)                            */
+/*---------------------------------------------------------------*/
+unsigned int publish_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage);
+
+/*---------------------------------------------------------------*/
+/* GETS THE CURRENT GENERATION                                   */
+/*---------------------------------------------------------------*/
+unsigned int get_PNM_Shared_Generation(struct PNM_Shared_Image * sharedImage);
+
+/*---------------------------------------------------------------*/
+/* WAITS UP TO timeout MILLISECONDS (FOREVER IF NEGATIVE) FOR A  */
+/* PUBLISHED GENERATION OTHER THAN seen (returns it, or 0 if the */
+/* time runs out)                                                */
+/*---------------------------------------------------------------*/
+unsigned int wait_PNM_Shared_Image(struct PNM_Shared_Image * sharedImage,
+                                   unsigned int seen, int timeout);
+
+/*---------------------------------------------------------------*/
+/* REMOVES THE NAME OF A SHARED IMAGE (PROCESSES THAT HAVE IT    */
+/* OPEN KEEP IT UNTIL THEY CLOSE IT)                             */
+/*---------------------------------------------------------------*/
+int unlink_PNM_Shared_Image(const char * name);
+#endif /*_PNM_SHM_H_*/
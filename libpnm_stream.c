@@ -0,0 +1,496 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <unistd.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_stream.h"
+
+/*-----------------------------------------------*/
+/* STARTS A SEQUENCE ON A STREAM                 */
+/*-----------------------------------------------*/
+static int open_Stream(struct PNM_Stream * stream, FILE * file,
+                       bool ownsFile, bool writer)
+{ if(file == NULL) return - 1;
+
+  memset(stream, 0, sizeof(struct PNM_Stream));
+  stream->file = file;
+  stream->ownsFile = ownsFile;
+  stream->writer = writer;
+
+  // success
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* OPENS A stdio STREAM ON A DUPLICATE OF fd, SO */
+/* THAT fclose LEAVES fd ITSELF OPEN             */
+/*-----------------------------------------------*/
+static FILE * open_Duplicate(int fd, const char * mode)
+{ // the duplicate
+  int copy = dup(fd);
+  FILE * file;
+
+  if(copy < 0) return NULL;
+
+  file = fdopen(copy, mode);
+  if(file == NULL) close(copy);
+
+  return file;
+}
+
+/*-----------------------------------------------*/
+/* MAKES THE PACKED ROW HOLD AT LEAST bytes      */
+/*-----------------------------------------------*/
+static int fit_Packed(struct PNM_Stream * stream, size_t bytes)
+{ unsigned char * packed;
+
+  if(bytes <= stream->packedBytes && stream->packed != NULL) return 0;
+
+  packed = (unsigned char *)realloc(stream->packed, bytes + 1);
+  if(packed == (unsigned char *)0) return - 1;
+
+  stream->packed = packed;
+  stream->packedBytes = bytes;
+
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* GETS THE FIRST SAMPLE OF A ROW OF AN IMAGE    */
+/* OF THE FORMAT                                 */
+/*-----------------------------------------------*/
+static unsigned char * get_Row(enum Format format, void * image, int row)
+{ if(format == PBM) return ((struct PBM_Image *)image)->image[row];
+  if(format == PGM) return ((struct PGM_Image *)image)->image[row];
+
+  return ((struct PPM_Image *)image)->image[row][0];
+}
+
+/*-----------------------------------------------*/
+/* MAKES AN IMAGE OF THE FORMAT FIT THE HEADER,  */
+/* REUSING IT WHEN ITS DIMENSIONS ALREADY MATCH  */
+/*-----------------------------------------------*/
+static int fit_Image(enum Format format, void * image,
+                     struct PNM_Frame_Header * header)
+{ struct PBM_Image * pbmImage = (struct PBM_Image *)image;
+  struct PGM_Image * pgmImage = (struct PGM_Image *)image;
+  struct PPM_Image * ppmImage = (struct PPM_Image *)image;
+
+  if(format == PBM)
+  { if(pbmImage->image != NULL && pbmImage->width == header->width &&
+       pbmImage->height == header->height) return 0;
+
+    if(pbmImage->image != NULL) free_PBM_Image(pbmImage);
+    if(create_PBM_Image(pbmImage, header->width, header->height) == 0)
+      return 0;
+
+    pbmImage->image = NULL;
+    return - 1;
+  }
+
+  if(format == PGM)
+  { if(pgmImage->image != NULL && pgmImage->width == header->width &&
+       pgmImage->height == header->height)
+    { pgmImage->maxGrayValue = header->maxGrayValue;
+      return 0;
+    }
+
+    if(pgmImage->image != NULL) free_PGM_Image(pgmImage);
+    if(create_PGM_Image(pgmImage, header->width, header->height,
+                        header->maxGrayValue) == 0) return 0;
+
+    pgmImage->image = NULL;
+    return - 1;
+  }
+
+  if(ppmImage->image != NULL && ppmImage->width == header->width &&
+     ppmImage->height == header->height)
+  { ppmImage->maxGrayValue = header->maxGrayValue;
+    return 0;
+  }
+
+  if(ppmImage->image != NULL) free_PPM_Image(ppmImage);
+  if(create_PPM_Image(ppmImage, header->width, header->height,
+                      header->maxGrayValue) == 0) return 0;
+
+  ppmImage->image = NULL;
+  return - 1;
+}
+
+/*---------------------------------------------------------------*/
+/* READS THE HEADER OF THE NEXT FRAME                            */
+/*---------------------------------------------------------------*/
+int read_PNM_Frame_Header(FILE * file, struct PNM_Frame_Header * header)
+{ // a char of the stream
+  int c;
+
+  do
+  { c = getc(file);
+    if(c == '#')
+      while(c != '\n' && c != '\r' && c != EOF) c = getc(file);
+  } while(c == ' ' || c == '\t' || c == '\n' || c == '\r');
+
+  if(c == EOF) return 1;
+  if(c != 'P') return - 1;
+
+  // P1 to P3 are ASCII, P4 to P6 the same formats raw
+  c = getc(file);
+  if(c < '1' || c > '6') return - 1;
+
+  header->format = (enum Format)(PBM + (c - '1') % 3);
+  header->raw = (c >= '4');
+
+  // get the width, height and max gray value of the image
+  header->width = geti(file);
+  header->height = geti(file);
+  header->maxGrayValue = (header->format == PBM) ? 1 : geti(file);
+
+  if(header->width < 0 || header->height < 0 || header->maxGrayValue < 0 ||
+     header->maxGrayValue > MAX_GRAY_VALUE) return - 1;
+
+  // success
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* READS THE BODY OF THE FRAME WHOSE HEADER WAS  */
+/* JUST READ INTO AN IMAGE OF ITS FORMAT         */
+/*-----------------------------------------------*/
+static int read_Body(struct PNM_Stream * stream, void * image)
+{ struct PNM_Frame_Header * header = &stream->header;
+  FILE * file = stream->file;
+
+  // the samples of a row, and the bytes of a packed PBM row
+  size_t samples = (size_t)header->width * (header->format == PPM ? 3 : 1);
+  size_t packedBytes = PBM_ROW_BYTES((size_t)header->width);
+
+  // for loop variables, a row, and a sample or char of the stream
+  int row; size_t s; unsigned char * pixels; int value;
+
+  if(fit_Image(header->format, image, header) != 0) return - 1;
+  if(header->raw && header->format == PBM &&
+     fit_Packed(stream, packedBytes) != 0) return - 1;
+
+  for(row = 0; row < header->height; row++)
+  { pixels = get_Row(header->format, image, row);
+
+    /*------------*/
+    /* RAW FORMAT */
+    /*------------*/
+    if(header->raw && header->format == PBM)
+    { if(fread(stream->packed, 1, packedBytes, file) != packedBytes)
+        return - 1;
+      unpack_PBM_Row(stream->packed, pixels, header->width);
+    }
+    else if(header->raw)
+    { if(fread(pixels, 1, samples, file) != samples) return - 1;
+    }
+
+    /*--------------*/
+    /* ASCII FORMAT */
+    /*--------------*/
+    else if(header->format == PBM)
+      for(s = 0; s < samples; s++)
+      { do value = getc(file);
+        while(value == ' ' || value == '\t' || value == '\n' || value == '\r');
+        if(value != '0' && value != '1') return - 1;
+        pixels[s] = (unsigned char)(value - '0');
+      }
+    else
+      for(s = 0; s < samples; s++)
+      { value = geti(file);
+        if(value < 0) return - 1;
+        pixels[s] = (unsigned char)value;
+      }
+  }
+
+  // success
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* GETS THE IMAGE A FRAME OF THE FORMAT IS READ  */
+/* AHEAD INTO                                    */
+/*-----------------------------------------------*/
+static void * get_Spare(struct PNM_Stream * stream, enum Format format)
+{ if(format == PBM) return &stream->bits;
+  if(format == PGM) return &stream->gray;
+
+  return &stream->colour;
+}
+
+/*-----------------------------------------------*/
+/* READS THE NEXT FRAME INTO THE SPARE IMAGE OF  */
+/* ITS FORMAT (the body of the read ahead)       */
+/*-----------------------------------------------*/
+static void * read_Ahead(void * argument)
+{ struct PNM_Stream * stream = (struct PNM_Stream *)argument;
+
+  stream->status = read_PNM_Frame_Header(stream->file, &stream->header);
+  if(stream->status == 0)
+    stream->status = read_Body(stream, get_Spare(stream,
+                                                 stream->header.format));
+
+  return NULL;
+}
+
+/*-----------------------------------------------*/
+/* READS THE NEXT FRAME. WITHOUT PREFETCH IT IS  */
+/* READ STRAIGHT INTO THE IMAGE; WITH IT, ONCE   */
+/* THE READ AHEAD IS DONE, IT IS LEFT IN THE     */
+/* SPARE IMAGE FOR THE CALLER TO SWAP IN         */
+/*-----------------------------------------------*/
+static int read_Frame(struct PNM_Stream * stream, enum Format format,
+                      void * image)
+{ // the result
+  int status;
+
+  if(stream->writer) return - 1;
+
+  if(!stream->prefetch)
+  { status = read_PNM_Frame_Header(stream->file, &stream->header);
+    if(status != 0) return status;
+    if(stream->header.format != format) return - 1;
+
+    status = read_Body(stream, image);
+    if(status == 0) stream->frames++;
+
+    return status;
+  }
+
+  // the first frame (or one after a failed start) is read on this thread
+  if(stream->pending)
+  { pthread_join(stream->thread, NULL);
+    stream->pending = false;
+  }
+  else read_Ahead(stream);
+
+  if(stream->status != 0) return stream->status;
+  if(stream->header.format != format) return - 1;
+
+  stream->frames++;
+
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* STARTS READING THE FRAME AFTER THE ONE JUST   */
+/* SWAPPED IN ON A BACKGROUND THREAD (if none    */
+/* can be started it is read on the next call)   */
+/*-----------------------------------------------*/
+static void start_Read_Ahead(struct PNM_Stream * stream)
+{ if(pthread_create(&stream->thread, NULL, read_Ahead, stream) == 0)
+    stream->pending = true;
+}
+
+/*-----------------------------------------------*/
+/* WRITES A RAW FRAME: THE HEADER, THEN EVERY    */
+/* ROW WITH ONE fwrite (PACKED FIRST FOR PBM)    */
+/*-----------------------------------------------*/
+static int write_Raw_Frame(struct PNM_Stream * stream, enum Format format,
+                           void * image, int width, int height,
+                           int maxGrayValue)
+{ FILE * file = stream->file;
+
+  // the samples of a row, and the bytes of a packed PBM row
+  size_t samples = (size_t)width * (format == PPM ? 3 : 1);
+  size_t packedBytes = PBM_ROW_BYTES((size_t)width);
+
+  // for loop variable, and the header
+  int row, length;
+
+  if(format == PBM)
+    length = fprintf(file, "P4\n%d %d\n", width, height);
+  else
+    length = fprintf(file, "P%c\n%d %d\n%d\n", format == PGM ? '5' : '6',
+                     width, height, maxGrayValue);
+  if(length < 0) return - 1;
+
+  if(format == PBM && fit_Packed(stream, packedBytes) != 0) return - 1;
+
+  for(row = 0; row < height; row++)
+    if(format == PBM)
+    { pack_PBM_Row(get_Row(format, image, row), stream->packed, width);
+      if(fwrite(stream->packed, 1, packedBytes, file) != packedBytes)
+        return - 1;
+    }
+    else if(fwrite(get_Row(format, image, row), 1, samples, file) != samples)
+      return - 1;
+
+  // success
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR READING FROM AN OPEN FILE                */
+/*---------------------------------------------------------------*/
+int open_PNM_Reader(struct PNM_Stream * stream, FILE * file, bool prefetch)
+{ if(open_Stream(stream, file, false, false) != 0) return - 1;
+
+  stream->prefetch = prefetch;
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR READING FROM A FILE DESCRIPTOR           */
+/*---------------------------------------------------------------*/
+int open_PNM_Reader_fd(struct PNM_Stream * stream, int fd, bool prefetch)
+{ FILE * file = open_Duplicate(fd, "rb");
+
+  if(open_Stream(stream, file, true, false) != 0) return - 1;
+
+  stream->prefetch = prefetch;
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR WRITING TO AN OPEN FILE                  */
+/*---------------------------------------------------------------*/
+int open_PNM_Writer(struct PNM_Stream * stream, FILE * file, bool raw)
+{ if(open_Stream(stream, file, false, true) != 0) return - 1;
+
+  stream->raw = raw;
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR WRITING TO A FILE DESCRIPTOR             */
+/*---------------------------------------------------------------*/
+int open_PNM_Writer_fd(struct PNM_Stream * stream, int fd, bool raw)
+{ FILE * file = open_Duplicate(fd, "wb");
+
+  if(open_Stream(stream, file, true, true) != 0) return - 1;
+
+  stream->raw = raw;
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* READS THE NEXT PBM FRAME                                      */
+/*---------------------------------------------------------------*/
+int read_PBM_Frame(struct PNM_Stream * stream, struct PBM_Image * pbmImage)
+{ // the image swapped with the one read ahead, and the result
+  struct PBM_Image swap; int status = read_Frame(stream, PBM, pbmImage);
+
+  if(status != 0 || !stream->prefetch) return status;
+
+  swap = *pbmImage;
+  *pbmImage = stream->bits;
+  stream->bits = swap;
+  start_Read_Ahead(stream);
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* READS THE NEXT PGM FRAME                                      */
+/*---------------------------------------------------------------*/
+int read_PGM_Frame(struct PNM_Stream * stream, struct PGM_Image * pgmImage)
+{ // the image swapped with the one read ahead, and the result
+  struct PGM_Image swap; int status = read_Frame(stream, PGM, pgmImage);
+
+  if(status != 0 || !stream->prefetch) return status;
+
+  swap = *pgmImage;
+  *pgmImage = stream->gray;
+  stream->gray = swap;
+  start_Read_Ahead(stream);
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* READS THE NEXT PPM FRAME                                      */
+/*---------------------------------------------------------------*/
+int read_PPM_Frame(struct PNM_Stream * stream, struct PPM_Image * ppmImage)
+{ // the image swapped with the one read ahead, and the result
+  struct PPM_Image swap; int status = read_Frame(stream, PPM, ppmImage);
+
+  if(status != 0 || !stream->prefetch) return status;
+
+  swap = *ppmImage;
+  *ppmImage = stream->colour;
+  stream->colour = swap;
+  start_Read_Ahead(stream);
+
+  return 0;
+}
+
+/*---------------------------------------------------------------*/
+/* APPENDS A PBM FRAME                                           */
+/*---------------------------------------------------------------*/
+int write_PBM_Frame(struct PNM_Stream * stream, struct PBM_Image * pbmImage)
+{ // the result
+  int status;
+
+  if(!stream->writer) return - 1;
+
+  status = stream->raw ?
+           write_Raw_Frame(stream, PBM, pbmImage, pbmImage->width,
+                           pbmImage->height, 1) :
+           write_PBM_Image(pbmImage, stream->file, false);
+  if(status == 0) stream->frames++;
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* APPENDS A PGM FRAME                                           */
+/*---------------------------------------------------------------*/
+int write_PGM_Frame(struct PNM_Stream * stream, struct PGM_Image * pgmImage)
+{ // the result
+  int status;
+
+  if(!stream->writer) return - 1;
+
+  status = stream->raw ?
+           write_Raw_Frame(stream, PGM, pgmImage, pgmImage->width,
+                           pgmImage->height, pgmImage->maxGrayValue) :
+           write_PGM_Image(pgmImage, stream->file, false);
+  if(status == 0) stream->frames++;
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* APPENDS A PPM FRAME                                           */
+/*---------------------------------------------------------------*/
+int write_PPM_Frame(struct PNM_Stream * stream, struct PPM_Image * ppmImage)
+{ // the result
+  int status;
+
+  if(!stream->writer) return - 1;
+
+  status = stream->raw ?
+           write_Raw_Frame(stream, PPM, ppmImage, ppmImage->width,
+                           ppmImage->height, ppmImage->maxGrayValue) :
+           write_PPM_Image(ppmImage, stream->file, false);
+  if(status == 0) stream->frames++;
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* CLOSES A SEQUENCE                                             */
+/*---------------------------------------------------------------*/
+int close_PNM_Stream(struct PNM_Stream * stream)
+{ // the result
+  int status = 0;
+
+  if(stream->pending) pthread_join(stream->thread, NULL);
+  stream->pending = false;
+
+  if(stream->bits.image != NULL) free_PBM_Image(&stream->bits);
+  if(stream->gray.image != NULL) free_PGM_Image(&stream->gray);
+  if(stream->colour.image != NULL) free_PPM_Image(&stream->colour);
+  free(stream->packed);
+
+  if(stream->ownsFile) status = fclose(stream->file);
+  else if(stream->writer) status = fflush(stream->file);
+
+  return status == 0 ? 0 : - 1;
+}
@@ -0,0 +1,118 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_STREAM_H_
+#define _PNM_STREAM_H_
+
+#include <pthread.h>
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* SEQUENCES OF IMAGES IN ONE STREAM                                  */
+/*                                                                    */
+/* Netpbm lets several images follow each other in one file or pipe.  */
+/* A PNM_Stream reads or writes such a sequence a frame at a time     */
+/* from one open FILE (or a file descriptor), so a stream of video    */
+/* like frames is never reopened between them.                        */
+/*                                                                    */
+/* A frame is read into the image passed in, which is reused as it is */
+/* when the frame has the same dimensions as the last one, and only   */
+/* recreated when they change. The image must be zeroed (image NULL)  */
+/* or hold an earlier frame, and is freed as usual once done with.    */
+/*                                                                    */
+/* A reader opened with prefetch reads the next frame on a background */
+/* thread while the caller works on the current one. The frame read   */
+/* ahead is swapped into the caller's image, whose buffers the next   */
+/* read ahead then fills, so nothing is copied; the pixels of a frame */
+/* must not be used after the next read. The reader takes one frame   */
+/* more from the stream than has been returned.                       */
+/*--------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------*/
+/* THE HEADER OF A FRAME                                            */
+/*-----------------------------------------------------------------*/
+struct PNM_Frame_Header
+{ // the format, and whether the body is raw
+  enum Format format; bool raw;
+
+  // the image dimensions and max gray value (1 for PBM)
+  int width, height, maxGrayValue;
+};
+
+/*-----------------------------------------------------------------*/
+/* A SEQUENCE OF FRAMES BEING READ OR WRITTEN                       */
+/*-----------------------------------------------------------------*/
+struct PNM_Stream
+{ // the stream, and whether closing the sequence closes it
+  FILE * file; bool ownsFile;
+
+  // whether the sequence is written, whether its frames are written raw,
+  // and the frames read or written
+  bool writer, raw; long frames;
+
+  // a packed row of a raw PBM, kept between frames
+  unsigned char * packed; size_t packedBytes;
+
+  // whether frames are read ahead, and whether a read ahead is running
+  bool prefetch, pending; pthread_t thread;
+
+  // the result of the last read ahead (0, 1 at the end of the stream or
+  // -1) and the header of the frame it read
+  int status; struct PNM_Frame_Header header;
+
+  // the frame read ahead, in the image of its format
+  struct PBM_Image bits; struct PGM_Image gray; struct PPM_Image colour;
+};
+
+/*---------------------------------------------------------------*/
+/* READS THE HEADER OF THE NEXT FRAME OF A STREAM, SKIPPING THE  */
+/* WHITE SPACE AND COMMENTS BEFORE IT (returns 1 if the stream   */
+/* ends first, -1 if the header is broken)                       */
+/*---------------------------------------------------------------*/
+int read_PNM_Frame_Header(FILE * file, struct PNM_Frame_Header * header);
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR READING FROM AN OPEN FILE (LEFT OPEN     */
+/* WHEN THE SEQUENCE IS CLOSED)                                  */
+/*---------------------------------------------------------------*/
+int open_PNM_Reader(struct PNM_Stream * stream, FILE * file, bool prefetch);
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR READING FROM A FILE DESCRIPTOR, THROUGH  */
+/* A DUPLICATE OF IT (fd STAYS OPEN, ITS OFFSET MOVES ON)        */
+/*---------------------------------------------------------------*/
+int open_PNM_Reader_fd(struct PNM_Stream * stream, int fd, bool prefetch);
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR WRITING raw OR ASCII FRAMES TO AN OPEN   */
+/* FILE (LEFT OPEN WHEN THE SEQUENCE IS CLOSED)                  */
+/*---------------------------------------------------------------*/
+int open_PNM_Writer(struct PNM_Stream * stream, FILE * file, bool raw);
+
+/*---------------------------------------------------------------*/
+/* OPENS A SEQUENCE FOR WRITING raw OR ASCII FRAMES TO A FILE    */
+/* DESCRIPTOR, THROUGH A DUPLICATE OF IT                         */
+/*---------------------------------------------------------------*/
+int open_PNM_Writer_fd(struct PNM_Stream * stream, int fd, bool raw);
+
+/*---------------------------------------------------------------*/
+/* READS THE NEXT FRAME INTO AN IMAGE (returns 1 at the end of   */
+/* the stream, -1 if the frame is of another format or broken)   */
+/*---------------------------------------------------------------*/
+int read_PBM_Frame(struct PNM_Stream * stream, struct PBM_Image * pbmImage);
+int read_PGM_Frame(struct PNM_Stream * stream, struct PGM_Image * pgmImage);
+int read_PPM_Frame(struct PNM_Stream * stream, struct PPM_Image * ppmImage);
+
+/*---------------------------------------------------------------*/
+/* APPENDS AN IMAGE TO THE SEQUENCE AS ITS NEXT FRAME            */
+/*---------------------------------------------------------------*/
+int write_PBM_Frame(struct PNM_Stream * stream, struct PBM_Image * pbmImage);
+int write_PGM_Frame(struct PNM_Stream * stream, struct PGM_Image * pgmImage);
+int write_PPM_Frame(struct PNM_Stream * stream, struct PPM_Image * ppmImage);
+
+/*---------------------------------------------------------------*/
+/* CLOSES A SEQUENCE, FLUSHING THE FRAMES WRITTEN (the images    */
+/* read into are the caller's to free)                           */
+/*---------------------------------------------------------------*/
+int close_PNM_Stream(struct PNM_Stream * stream);
+#endif /*_PNM_STREAM_H_*/
@@ -0,0 +1,78 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <pthread.h>
+#include "libpnm_thread.h"
+
+// the most threads a loop is spread over
+# define MAX_THREADS 64
+
+/*-----------------------------------*/
+/* A LOOP SHARED BY ITS THREADS      */
+/*-----------------------------------*/
+struct Parallel_Loop
+{ // the body of the loop and its argument
+  void (*task)(void * context, int index); void * context;
+
+  // the number of pieces, and the next one to hand out
+  int count, next;
+};
+
+// set on a thread while it runs the pieces of a loop, so that a loop
+// started by a piece runs on that thread alone
+static __thread int inLoop;
+
+/*---------------------------------------------------------------*/
+/* GETS THE NUMBER OF THREADS PARALLEL WORK IS SPREAD OVER       */
+/*---------------------------------------------------------------*/
+int get_Thread_Count(void)
+{ // the override, or the number of CPUs
+  const char * setting = getenv("PNM_THREADS");
+  long threads = (setting != NULL) ? atol(setting) : 
+                                     sysconf(_SC_NPROCESSORS_ONLN);
+
+  if(threads < 1) threads = 1;
+  if(threads > MAX_THREADS) threads = MAX_THREADS;
+
+  return (int)threads;
+}
+
+/*---------------------------------------------------------------*/
+/* RUNS PIECES OF A LOOP UNTIL NONE ARE LEFT                     */
+/*---------------------------------------------------------------*/
+static void * run_Pieces(void * argument)
+{ struct Parallel_Loop * loop = (struct Parallel_Loop *)argument;
+  int index, outer = inLoop;
+
+  inLoop = 1;
+  while((index = __atomic_fetch_add(&loop->next, 1, __ATOMIC_RELAXED)) 
+        < loop->count)
+    loop->task(loop->context, index);
+  inLoop = outer;
+
+  return NULL;
+}
+
+/*---------------------------------------------------------------*/
+/* RUNS task(context, index) FOR EVERY index FROM 0 TO count - 1 */
+/*---------------------------------------------------------------*/
+void run_Parallel(int count, void (*task)(void * context, int index),
+                  void * context)
+{ struct Parallel_Loop loop = {task, context, count, 0};
+  pthread_t threads[MAX_THREADS];
+
+  // the helpers, and how many of them started
+  int helpers = get_Thread_Count() - 1, started;
+
+  if(helpers > count - 1) helpers = count - 1;
+
+  // every CPU is already busy with the pieces of the outer loop
+  if(inLoop) helpers = 0;
+
+  // a helper that cannot be started just leaves more for the others
+  for(started = 0; started < helpers; started++)
+    if(pthread_create(&threads[started], NULL, run_Pieces, &loop) != 0) break;
+
+  run_Pieces(&loop);
+
+  while(started > 0) pthread_join(threads[--started], NULL);
+}
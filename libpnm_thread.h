@@ -0,0 +1,29 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_THREAD_H_
+#define _PNM_THREAD_H_
+
+/*--------------------------------------------------------------------*/
+/* DATA PARALLEL LOOPS FOR LIBPNM                                     */
+/*                                                                    */
+/* Work that splits into independent pieces (stripes of rows) is      */
+/* handed to run_Parallel, which runs the pieces on one thread per    */
+/* CPU. The PNM_THREADS environment variable overrides the count      */
+/* (PNM_THREADS=1 runs everything on the calling thread). A loop      */
+/* started from a piece of another runs on that piece's thread.       */
+/*--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------*/
+/* GETS THE NUMBER OF THREADS PARALLEL WORK IS SPREAD OVER       */
+/*---------------------------------------------------------------*/
+int get_Thread_Count(void);
+
+/*---------------------------------------------------------------*/
+/* RUNS task(context, index) FOR EVERY index FROM 0 TO count - 1 */
+/* AND RETURNS ONCE ALL OF THEM HAVE FINISHED (the calling       */
+/* thread takes a share of the pieces)                           */
+/*---------------------------------------------------------------*/
+void run_Parallel(int count, void (*task)(void * context, int index),
+                  void * context);
+#endif /*_PNM_THREAD_H_*/
@@ -0,0 +1,471 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <pthread.h>
+#include "libpnm.h"
+#include "libpnm_kernels.h"
+#include "libpnm_stream.h"
+#include "libpnm_transcode.h"
+
+// the most chars of an ASCII sample ("255 ")
+# define TRANSCODE_SAMPLE_CHARS 4
+
+/*-----------------------------------------------*/
+/* A BLOCK OF ROWS PASSED BETWEEN THE STAGES     */
+/*-----------------------------------------------*/
+struct Transcode_Block
+{ // the header of the frame the rows belong to, and whether they are
+  // its first (a frame without rows still sends one empty block)
+  struct PNM_Frame_Header header; bool first;
+
+  // the rows held, and 0, or 1 if the stream has ended or -1 if it failed
+  int rows, end;
+
+  // the samples of the rows (a byte per pixel for PBM) and room for them
+  unsigned char * samples; size_t capacity;
+};
+
+/*-----------------------------------------------*/
+/* A QUEUE OF BLOCKS (it can hold every block,   */
+/* so adding one never waits)                    */
+/*-----------------------------------------------*/
+struct Block_Queue
+{ // the blocks, the first of them and how many there are
+  struct Transcode_Block * blocks[TRANSCODE_BLOCKS]; int head, count;
+
+  pthread_mutex_t lock; pthread_cond_t notEmpty;
+};
+
+/*-----------------------------------------------*/
+/* A STREAM BEING TRANSCODED                     */
+/*-----------------------------------------------*/
+struct Transcoder
+{ // the streams, the output encoding and max gray value (0 to keep it)
+  FILE * input, * output; bool raw; int maxGrayValue;
+
+  // the empty blocks, those decoded and those converted
+  struct Block_Queue empty, decoded, converted;
+  struct Transcode_Block blocks[TRANSCODE_BLOCKS];
+
+  // the ASCII text of every sample value, "v ", and its length
+  char text[MAX_GRAY_VALUE + 1][TRANSCODE_SAMPLE_CHARS];
+  int length[MAX_GRAY_VALUE + 1];
+
+  // set once the encoder fails, so the decoder stops early
+  int stop;
+};
+
+/*-----------------------------------------------*/
+/* INITIALIZES A QUEUE                           */
+/*-----------------------------------------------*/
+static void init_Queue(struct Block_Queue * queue)
+{ queue->head = queue->count = 0;
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->notEmpty, NULL);
+}
+
+/*-----------------------------------------------*/
+/* DESTROYS A QUEUE                              */
+/*-----------------------------------------------*/
+static void destroy_Queue(struct Block_Queue * queue)
+{ pthread_mutex_destroy(&queue->lock);
+  pthread_cond_destroy(&queue->notEmpty);
+}
+
+/*-----------------------------------------------*/
+/* ADDS A BLOCK TO THE END OF A QUEUE            */
+/*-----------------------------------------------*/
+static void push_Block(struct Block_Queue * queue,
+                       struct Transcode_Block * block)
+{ pthread_mutex_lock(&queue->lock);
+  queue->blocks[(queue->head + queue->count) % TRANSCODE_BLOCKS] = block;
+  queue->count++;
+  pthread_cond_signal(&queue->notEmpty);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/*-----------------------------------------------*/
+/* TAKES THE BLOCK AT THE HEAD OF A QUEUE,       */
+/* WAITING FOR ONE IF IT IS EMPTY                */
+/*-----------------------------------------------*/
+static struct Transcode_Block * pop_Block(struct Block_Queue * queue)
+{ struct Transcode_Block * block;
+
+  pthread_mutex_lock(&queue->lock);
+  while(queue->count == 0) pthread_cond_wait(&queue->notEmpty, &queue->lock);
+  block = queue->blocks[queue->head];
+  queue->head = (queue->head + 1) % TRANSCODE_BLOCKS;
+  queue->count--;
+  pthread_mutex_unlock(&queue->lock);
+
+  return block;
+}
+
+/*-----------------------------------------------*/
+/* GETS AN ASCII SAMPLE, SKIPPING WHITE SPACE    */
+/* AND COMMENTS (-1 IF THERE IS NONE)            */
+/*-----------------------------------------------*/
+static int get_Sample(FILE * input)
+{ // a char of the stream, and the value
+  int c, value;
+
+  do
+  { c = getc_unlocked(input);
+    if(c == '#')
+      while(c != '\n' && c != '\r' && c != EOF) c = getc_unlocked(input);
+  } while(c == ' ' || c == '\t' || c == '\n' || c == '\r');
+
+  if(c < '0' || c > '9') return - 1;
+
+  // the char after the digits goes, as with geti
+  for(value = 0; c >= '0' && c <= '9'; c = getc_unlocked(input))
+    if(value <= MAX_GRAY_VALUE) value = value * 10 + (c - '0');
+
+  return value > MAX_GRAY_VALUE ? MAX_GRAY_VALUE : value;
+}
+
+/*-----------------------------------------------*/
+/* DECODES THE NEXT rows ROWS OF A FRAME         */
+/*-----------------------------------------------*/
+static int decode_Rows(FILE * input, struct PNM_Frame_Header * header,
+                       unsigned char * samples, int rows, size_t rowSamples,
+                       unsigned char * packed)
+{ // the bytes of a packed PBM row, and loop variables
+  size_t packedBytes = PBM_ROW_BYTES((size_t)header->width), s;
+  size_t total = rowSamples * rows; int row, value;
+
+  /*------------*/
+  /* RAW FORMAT */
+  /*------------*/
+  if(header->raw && header->format == PBM)
+  { for(row = 0; row < rows; row++)
+    { if(fread(packed, 1, packedBytes, input) != packedBytes) return - 1;
+      unpack_PBM_Row(packed, samples + row * rowSamples, header->width);
+    }
+    return 0;
+  }
+
+  if(header->raw)
+    return fread(samples, 1, total, input) == total ? 0 : - 1;
+
+  /*--------------*/
+  /* ASCII FORMAT */
+  /*--------------*/
+  for(s = 0; s < total; s++)
+  { if(header->format == PBM)
+    { do value = getc_unlocked(input);
+      while(value == ' ' || value == '\t' || value == '\n' || value == '\r');
+      if(value != '0' && value != '1') return - 1;
+      value -= '0';
+    }
+    else if((value = get_Sample(input)) < 0) return - 1;
+
+    samples[s] = (unsigned char)value;
+  }
+
+  return 0;
+}
+
+/*-----------------------------------------------*/
+/* THE DECODE STAGE: PARSES EVERY FRAME INTO     */
+/* BLOCKS OF ROWS, THEN SENDS THE END            */
+/*-----------------------------------------------*/
+static void * decode_Stage(void * argument)
+{ struct Transcoder * transcoder = (struct Transcoder *)argument;
+  struct PNM_Frame_Header header; struct Transcode_Block * block;
+
+  // the result, the rows of each block and the first row of the next one
+  int status, blockRows, row, rows;
+
+  // the samples of a row, a packed PBM row and the room in it
+  size_t rowSamples, packedBytes = 0; unsigned char * packed = NULL, * grown;
+
+  while((status = read_PNM_Frame_Header(transcoder->input, &header)) == 0)
+  { rowSamples = (size_t)header.width * (header.format == PPM ? 3 : 1);
+    blockRows = (rowSamples == 0) ? header.height :
+                (int)(TRANSCODE_BLOCK_SAMPLES / rowSamples);
+    if(blockRows < 1) blockRows = 1;
+
+    if(header.raw && header.format == PBM &&
+       PBM_ROW_BYTES((size_t)header.width) >= packedBytes)
+    { packedBytes = PBM_ROW_BYTES((size_t)header.width) + 1;
+      grown = (unsigned char *)realloc(packed, packedBytes);
+      if(grown == NULL) status = - 1;
+      else packed = grown;
+    }
+
+    for(row = 0; status == 0 && (row == 0 || row < header.height);
+        row += rows)
+    { rows = (header.height - row < blockRows) ? header.height - row :
+                                                 blockRows;
+
+      block = pop_Block(&transcoder->empty);
+      if(block->samples == NULL || block->capacity < rowSamples * rows)
+      { grown = (unsigned char *)realloc(block->samples,
+                                         rowSamples * rows + 1);
+        if(grown == NULL) status = - 1;
+        else
+        { block->samples = grown;
+          block->capacity = rowSamples * rows;
+        }
+      }
+
+      if(status == 0 && __atomic_load_n(&transcoder->stop, __ATOMIC_RELAXED))
+        status = - 1;
+      if(status == 0)
+        status = decode_Rows(transcoder->input, &header, block->samples, rows,
+                             rowSamples, packed);
+
+      // a block that failed goes back for the end to be sent in
+      if(status != 0)
+      { push_Block(&transcoder->empty, block);
+        break;
+      }
+
+      block->header = header;
+      block->first = (row == 0);
+      block->rows = rows;
+      block->end = 0;
+      push_Block(&transcoder->decoded, block);
+
+      // a frame without rows is done once its header is sent
+      if(rows == 0) break;
+    }
+
+    if(status != 0) break;
+  }
+
+  free(packed);
+
+  block = pop_Block(&transcoder->empty);
+  block->rows = 0;
+  block->end = (status == 1) ? 1 : - 1;
+  push_Block(&transcoder->decoded, block);
+
+  return NULL;
+}
+
+/*-----------------------------------------------*/
+/* THE CONVERT STAGE: RESCALES THE SAMPLES OF    */
+/* EVERY BLOCK TO THE NEW MAX GRAY VALUE         */
+/*-----------------------------------------------*/
+static void * convert_Stage(void * argument)
+{ struct Transcoder * transcoder = (struct Transcoder *)argument;
+  struct Transcode_Block * block;
+
+  // the new value of every sample, the max gray value it maps from, the
+  // new one, and loop variables
+  unsigned char table[MAX_GRAY_VALUE + 1]; int from = - 1, value, end;
+  int to = transcoder->maxGrayValue; size_t s, count;
+
+  do
+  { block = pop_Block(&transcoder->decoded);
+    end = block->end;
+
+    if(end == 0 && to > 0 && block->header.format != PBM)
+    { if(block->header.maxGrayValue != from)
+      { from = block->header.maxGrayValue;
+        for(value = 0; value <= MAX_GRAY_VALUE; value++)
+          table[value] = (unsigned char)((from == 0) ? 0 :
+                         (value >= from) ? to : (value * to + from / 2) / from);
+      }
+
+      count = (size_t)block->rows * block->header.width *
+              (block->header.format == PPM ? 3 : 1);
+      if(from != to)
+        for(s = 0; s < count; s++)
+          block->samples[s] = table[block->samples[s]];
+
+      block->header.maxGrayValue = to;
+    }
+
+    push_Block(&transcoder->converted, block);
+  } while(end == 0);
+
+  return NULL;
+}
+
+/*-----------------------------------------------*/
+/* ENCODES ONE BLOCK, AFTER THE HEADER IF IT IS  */
+/* THE FIRST OF ITS FRAME                        */
+/*-----------------------------------------------*/
+static int encode_Block(struct Transcoder * transcoder,
+                        struct Transcode_Block * block,
+                        char * * text, size_t * room)
+{ struct PNM_Frame_Header * header = &block->header;
+  FILE * output = transcoder->output;
+
+  // the samples of the block, the bytes of a packed PBM row, and the
+  // bytes the output of the block takes
+  size_t rowSamples = (size_t)header->width * (header->format == PPM ? 3 : 1);
+  size_t total = rowSamples * block->rows, s, length = 0;
+  size_t packedBytes = PBM_ROW_BYTES((size_t)header->width);
+
+  // the magic number, a row and a sample
+  char magic = '0' + header->format + (transcoder->raw ? 3 : 0);
+  int row; unsigned char sample; char * grown;
+
+  if(block->first &&
+     (header->format == PBM ?
+      fprintf(output, "P%c\n%d %d\n", magic, header->width, header->height) :
+      fprintf(output, "P%c\n%d %d\n%d\n", magic, header->width,
+              header->height, header->maxGrayValue)) < 0) return - 1;
+
+  // raw samples other than bits are written as they are
+  if(transcoder->raw && header->format != PBM)
+    return fwrite(block->samples, 1, total, output) == total ? 0 : - 1;
+
+  // the packed rows, or the text (with slack, as every sample copies all
+  // of its chars)
+  length = transcoder->raw ? packedBytes * block->rows :
+                             total * TRANSCODE_SAMPLE_CHARS + 4;
+  if(*room < length)
+  { grown = (char *)realloc(*text, length);
+    if(grown == NULL) return - 1;
+    *text = grown;
+    *room = length;
+  }
+
+  if(transcoder->raw)
+    for(row = 0; row < block->rows; row++)
+      pack_PBM_Row(block->samples + row * rowSamples,
+                   (unsigned char *)*text + row * packedBytes, header->width);
+  else
+    for(s = 0, length = 0; s < total; s++)
+    { sample = block->samples[s];
+      memcpy(*text + length, transcoder->text[sample],
+             TRANSCODE_SAMPLE_CHARS);
+      length += transcoder->length[sample];
+    }
+
+  return fwrite(*text, 1, length, output) == length ? 0 : - 1;
+}
+
+/*-----------------------------------------------*/
+/* THE ENCODE STAGE: WRITES EVERY BLOCK AND      */
+/* HANDS IT BACK TO THE DECODER                  */
+/*-----------------------------------------------*/
+static int encode_Stage(struct Transcoder * transcoder)
+{ struct Transcode_Block * block;
+
+  // the result, how the stream ended and the frames written
+  int status = 0, end, frames = 0;
+
+  // the text of a block, and the room in it
+  char * text = NULL; size_t room = 0;
+
+  do
+  { block = pop_Block(&transcoder->converted);
+    end = block->end;
+
+    if(end == 0 && status == 0)
+    { if(block->first) frames++;
+      status = encode_Block(transcoder, block, &text, &room);
+
+      // the decoder stops, and the blocks it already sent are drained
+      if(status != 0)
+        __atomic_store_n(&transcoder->stop, 1, __ATOMIC_RELAXED);
+    }
+    if(end < 0) status = - 1;
+
+    push_Block(&transcoder->empty, block);
+  } while(end == 0);
+
+  free(text);
+
+  // a stream without any frame is not an image
+  return (status == 0 && frames > 0) ? 0 : - 1;
+}
+
+/*---------------------------------------------------------------*/
+/* TRANSCODES EVERY FRAME OF A STREAM                            */
+/*---------------------------------------------------------------*/
+int transcode_PNM_Stream(FILE * input, FILE * output, bool raw,
+                         int maxGrayValue)
+{ struct Transcoder * transcoder; struct Transcode_Block * block;
+  pthread_t decoder, converter;
+
+  // the result, whether the decoder started, the text of a sample and
+  // for loop variable
+  int status; bool decoding; char sample[8]; int index;
+
+  if(maxGrayValue < 0 || maxGrayValue > MAX_GRAY_VALUE) return - 1;
+
+  // the text table makes the state too big for the stack of a thread
+  transcoder = (struct Transcoder *)calloc(1, sizeof(struct Transcoder));
+  if(transcoder == NULL) return - 1;
+
+  transcoder->input = input;
+  transcoder->output = output;
+  transcoder->raw = raw;
+  transcoder->maxGrayValue = maxGrayValue;
+
+  for(index = 0; index <= MAX_GRAY_VALUE; index++)
+  { transcoder->length[index] = snprintf(sample, sizeof(sample), "%d ",
+                                         index);
+    memcpy(transcoder->text[index], sample, TRANSCODE_SAMPLE_CHARS);
+  }
+
+  init_Queue(&transcoder->empty);
+  init_Queue(&transcoder->decoded);
+  init_Queue(&transcoder->converted);
+  for(index = 0; index < TRANSCODE_BLOCKS; index++)
+    push_Block(&transcoder->empty, &transcoder->blocks[index]);
+
+  // the converter is started first, so that an end can always reach the
+  // encoder through it
+  status = - 1;
+  if(pthread_create(&converter, NULL, convert_Stage, transcoder) == 0)
+  { decoding = (pthread_create(&decoder, NULL, decode_Stage,
+                               transcoder) == 0);
+    if(!decoding)
+    { block = pop_Block(&transcoder->empty);
+      block->rows = 0;
+      block->end = - 1;
+      push_Block(&transcoder->decoded, block);
+    }
+
+    // the encoder runs on this thread
+    status = encode_Stage(transcoder);
+
+    if(decoding) pthread_join(decoder, NULL);
+    pthread_join(converter, NULL);
+  }
+
+  if(fflush(output) != 0) status = - 1;
+
+  for(index = 0; index < TRANSCODE_BLOCKS; index++)
+    free(transcoder->blocks[index].samples);
+  destroy_Queue(&transcoder->empty);
+  destroy_Queue(&transcoder->decoded);
+  destroy_Queue(&transcoder->converted);
+  free(transcoder);
+
+  return status;
+}
+
+/*---------------------------------------------------------------*/
+/* TRANSCODES A FILE INTO ANOTHER                                */
+/*---------------------------------------------------------------*/
+int transcode_PNM_File(char * inFileName, char * outFileName, bool raw,
+                       int maxGrayValue)
+{ // the streams, and the result
+  FILE * input, * output; int status;
+
+  input = (strcmp(inFileName, "-") == 0) ? stdin :
+                                           fileOpener(READ, inFileName);
+  if(input == NULL) return - 1;
+
+  output = (strcmp(outFileName, "-") == 0) ? stdout :
+                                             fileOpener(WRITE, outFileName);
+  if(output == NULL)
+  { if(input != stdin) fclose(input);
+    return - 1;
+  }
+
+  status = transcode_PNM_Stream(input, output, raw, maxGrayValue);
+
+  if(input != stdin) fclose(input);
+  if(output != stdout && fclose(output) != 0) status = - 1;
+
+  return status;
+}
@@ -0,0 +1,43 @@
+# include <stdio.h>
+# include <stdlib.h>
+
+#ifndef _PNM_TRANSCODE_H_
+#define _PNM_TRANSCODE_H_
+
+#include "libpnm.h"
+
+/*--------------------------------------------------------------------*/
+/* STREAMING RAW <-> ASCII TRANSCODING                                */
+/*                                                                    */
+/* Every frame of a stream (see libpnm_stream.h) is rewritten raw or  */
+/* ASCII, optionally rescaled to another max gray value, without the  */
+/* image ever being loaded whole. The rows flow in blocks of about    */
+/* TRANSCODE_BLOCK_SAMPLES samples (never less than a row) through    */
+/* three stages, each on its own thread: decode reads and parses the  */
+/* input, convert rescales the samples through a table, and encode    */
+/* formats and writes the output.                                     */
+/*                                                                    */
+/* The stages hand blocks on through queues, and the decoder takes    */
+/* empty blocks back from the encoder. Only TRANSCODE_BLOCKS blocks   */
+/* exist, so memory stays constant whatever the image size and the    */
+/* pipeline runs at the speed of its slowest stage.                   */
+/*--------------------------------------------------------------------*/
+
+// the samples of a block, and the blocks in flight between the stages
+# define TRANSCODE_BLOCK_SAMPLES (1 << 16)
+# define TRANSCODE_BLOCKS 4
+
+/*---------------------------------------------------------------*/
+/* TRANSCODES EVERY FRAME OF A STREAM INTO raw OR ASCII FRAMES,  */
+/* WITH SAMPLES RESCALED TO maxGrayValue UNLESS IT IS 0 (PBM     */
+/* FRAMES ARE NEVER RESCALED)                                    */
+/*---------------------------------------------------------------*/
+int transcode_PNM_Stream(FILE * input, FILE * output, bool raw,
+                         int maxGrayValue);
+
+/*---------------------------------------------------------------*/
+/* TRANSCODES A FILE INTO ANOTHER (- FOR stdin OR stdout)        */
+/*---------------------------------------------------------------*/
+int transcode_PNM_File(char * inFileName, char * outFileName, bool raw,
+                       int maxGrayValue);
+#endif /*_PNM_TRANSCODE_H_*/
@@ -0,0 +1,542 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "libpnm.h"
+#include "libpnm_rle.h"
+#include "generate.h"
+#include "cache.h"
+#include "server.h"
+
+// the number of accepted connections waiting for a worker
+#define QUEUE_LENGTH 256
+
+// the longest request line
+#define REQUEST_LENGTH 1100
+
+/**
+ * The images and output buffer a worker keeps warm between requests, so a
+ * repeated request for the same size neither allocates nor faults in pages.
+ */
+struct Worker_Buffers
+{
+    struct PBM_Image pbmImage;
+    struct PGM_Image pgmImage;
+    struct PPM_Image ppmImage;
+    int hasPbm, hasPgm, hasPpm;
+
+    char *out;
+    size_t outCapacity;
+};
+
+/**
+ * The connections waiting for a worker.
+ */
+static struct
+{
+    int fds[QUEUE_LENGTH];
+    int head, count;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty, notFull;
+} queue = { {0}, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+/**
+ * @brief      { push_client } adds an accepted connection to the queue, waiting while it is full
+ *
+ * @param[in]  fd    The connection
+ */
+
+static void push_client( int fd )
+{
+    pthread_mutex_lock( &queue.lock );
+    while ( queue.count == QUEUE_LENGTH )
+    {
+        pthread_cond_wait( &queue.notFull, &queue.lock );
+    }
+    queue.fds[(queue.head + queue.count) % QUEUE_LENGTH] = fd;
+    queue.count++;
+    pthread_cond_signal( &queue.notEmpty );
+    pthread_mutex_unlock( &queue.lock );
+}
+
+/**
+ * @brief      { pop_client } takes the oldest connection off the queue, waiting while it is empty
+ *
+ * @return     { the connection }
+ */
+
+static int pop_client( void )
+{
+    int fd;
+
+    pthread_mutex_lock( &queue.lock );
+    while ( queue.count == 0 )
+    {
+        pthread_cond_wait( &queue.notEmpty, &queue.lock );
+    }
+    fd = queue.fds[queue.head];
+    queue.head = (queue.head + 1) % QUEUE_LENGTH;
+    queue.count--;
+    pthread_cond_signal( &queue.notFull );
+    pthread_mutex_unlock( &queue.lock );
+
+    return fd;
+}
+
+/**
+ * @brief      { write_all } writes a whole buffer to a socket
+ *
+ * @return     { 0 on success, -1 if the client went away }
+ */
+
+static int write_all( int fd, const char *buffer, size_t length )
+{
+    while ( length > 0 )
+    {
+        ssize_t written = write( fd, buffer, length );
+        if ( written < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            return -1;
+        }
+        buffer += written;
+        length -= written;
+    }
+    return 0;
+}
+
+/**
+ * @brief      { reply } sends a one line answer
+ */
+
+static int reply( int fd, const char *line )
+{
+    return write_all( fd, line, strlen( line ) );
+}
+
+/**
+ * @brief      { draw_request } draws the requested pattern into the worker's warm image of that type,
+ *             recreating it only when the size changes
+ *
+ * @return     { 0 on success, -1 if the image could not be allocated }
+ */
+
+static int draw_request( struct Worker_Buffers *buffers, int type, int width, int height )
+{
+    switch ( type )
+    {
+    case 1:
+        if ( buffers->hasPbm && (buffers->pbmImage.width != width || buffers->pbmImage.height != height) )
+        {
+            free_PBM_Image( &buffers->pbmImage );
+            buffers->hasPbm = 0;
+        }
+        if ( !buffers->hasPbm )
+        {
+            if ( create_PBM_Image( &buffers->pbmImage, width, height ) != 0 )
+            {
+                return -1;
+            }
+            buffers->hasPbm = 1;
+        }
+        draw_pbm( &buffers->pbmImage );
+        break;
+    case 2:
+        if ( buffers->hasPgm && (buffers->pgmImage.width != width || buffers->pgmImage.height != height) )
+        {
+            free_PGM_Image( &buffers->pgmImage );
+            buffers->hasPgm = 0;
+        }
+        if ( !buffers->hasPgm )
+        {
+            if ( create_PGM_Image( &buffers->pgmImage, width, height, MAX_GRAY ) != 0 )
+            {
+                return -1;
+            }
+            buffers->hasPgm = 1;
+        }
+        draw_pgm( &buffers->pgmImage );
+        break;
+    case 3:
+        if ( buffers->hasPpm && (buffers->ppmImage.width != width || buffers->ppmImage.height != height) )
+        {
+            free_PPM_Image( &buffers->ppmImage );
+            buffers->hasPpm = 0;
+        }
+        if ( !buffers->hasPpm )
+        {
+            if ( create_PPM_Image( &buffers->ppmImage, width, height, MAX_GRAY ) != 0 )
+            {
+                return -1;
+            }
+            buffers->hasPpm = 1;
+        }
+        draw_ppm( &buffers->ppmImage );
+        break;
+    }
+    return 0;
+}
+
+/**
+ * @brief      { write_request } writes the drawn image of the requested type to a stream
+ */
+
+static int write_request( struct Worker_Buffers *buffers, int type, FILE *stream, int format )
+{
+    if ( format == RLE_FORMAT )
+    {
+        switch ( type )
+        {
+        case 1:
+            return write_PBM_Image_RLE( &buffers->pbmImage, stream );
+        case 2:
+            return write_PGM_Image_RLE( &buffers->pgmImage, stream );
+        default:
+            return write_PPM_Image_RLE( &buffers->ppmImage, stream );
+        }
+    }
+
+    switch ( type )
+    {
+    case 1:
+        return write_PBM_Image( &buffers->pbmImage, stream, format );
+    case 2:
+        return write_PGM_Image( &buffers->pgmImage, stream, format );
+    default:
+        return write_PPM_Image( &buffers->ppmImage, stream, format );
+    }
+}
+
+/**
+ * @brief      { serve_cached } answers a request from the output cache
+ *
+ * @return     { 0 or -1 as serve_request on a hit, 1 on a miss }
+ */
+
+static int serve_cached( int fd, const struct Cache_Key *key, char *out_filename )
+{
+    char answer[64];
+    off_t length;
+    int entry, result;
+
+    if ( out_filename != NULL )
+    {
+        return cache_fetch( key, out_filename ) == 0 ? reply( fd, "OK 0\n" ) : 1;
+    }
+
+    entry = cache_open( key, &length );
+    if ( entry < 0 )
+    {
+        return 1;
+    }
+    snprintf( answer, sizeof(answer), "OK %lld\n", (long long) length );
+    result = reply( fd, answer );
+    if ( result == 0 )
+    {
+        result = cache_send( entry, fd, length );
+    }
+    close( entry );
+    return result;
+}
+
+/**
+ * @brief      { serve_request } answers one request line
+ *
+ * @return     { 0 to keep the connection, -1 to drop it }
+ */
+
+static int serve_request( int fd, struct Worker_Buffers *buffers, char *line )
+{
+    int type, width, height, format, fields;
+    char out_filename[1024];
+    char answer[1100];
+    FILE *stream;
+    int stream_failed = 0;
+    long length;
+    int result;
+
+    fields = sscanf( line, "%d %d %d %d %1023s", &type, &width, &height, &format, out_filename );
+    if ( fields < 4 )
+    {
+        return reply( fd, "ERR expected: type width height format [out_filename]\n" );
+    }
+
+    // Validate without printing, the reason goes back to the client
+    const char *error = args_error( type, width, height, format );
+    if ( error == NULL && (size_t) width * (size_t) height > SERVER_MAX_PIXELS )
+    {
+        error = "image too large";
+    }
+    if ( error != NULL )
+    {
+        snprintf( answer, sizeof(answer), "ERR %s\n", error );
+        return reply( fd, answer );
+    }
+
+    struct Cache_Key key = { type, width, height, format, 0 };
+    result = serve_cached( fd, &key, fields == 5 ? out_filename : NULL );
+    if ( result != 1 )
+    {
+        return result;
+    }
+
+    if ( draw_request( buffers, type, width, height ) != 0 )
+    {
+        return reply( fd, "ERR out of memory\n" );
+    }
+
+    // Save to the requested path
+    if ( fields == 5 )
+    {
+        // fileOpener replaces an output with other links rather than writing through it
+        stream = fileOpener( WRITE, out_filename );
+        if ( stream != NULL )
+        {
+            // The stream is closed whether or not the image went out
+            int written = write_request( buffers, type, stream, format );
+            stream_failed = fclose( stream ) != 0 || written != 0;
+        }
+        if ( stream == NULL || stream_failed )
+        {
+            snprintf( answer, sizeof(answer), "ERR cannot write %s\n", out_filename );
+            return reply( fd, answer );
+        }
+        if ( cache_enabled() )
+        {
+            cache_store( &key, out_filename );
+        }
+        return reply( fd, "OK 0\n" );
+    }
+
+    // Or encode into the warm output buffer, sized for the widest ascii sample ("255 ") plus the header
+    size_t bound = 64 + (size_t) width * (size_t) height * 3 * 4;
+    if ( bound > buffers->outCapacity )
+    {
+        char *grown = realloc( buffers->out, bound );
+        if ( grown == NULL )
+        {
+            return reply( fd, "ERR out of memory\n" );
+        }
+        buffers->out = grown;
+        buffers->outCapacity = bound;
+    }
+
+    stream = fmemopen( buffers->out, buffers->outCapacity, "w" );
+    if ( stream == NULL )
+    {
+        return reply( fd, "ERR cannot encode\n" );
+    }
+    stream_failed = write_request( buffers, type, stream, format ) != 0 || fflush( stream ) != 0;
+    length = ftell( stream );
+    stream_failed = fclose( stream ) != 0 || stream_failed;
+
+    // A partial encoding is neither cached nor sent
+    if ( stream_failed )
+    {
+        return reply( fd, "ERR cannot encode\n" );
+    }
+
+    if ( cache_enabled() )
+    {
+        cache_store_buffer( &key, buffers->out, length );
+    }
+
+    snprintf( answer, sizeof(answer), "OK %ld\n", length );
+    if ( reply( fd, answer ) != 0 )
+    {
+        return -1;
+    }
+    return write_all( fd, buffers->out, length );
+}
+
+/**
+ * @brief      { serve_client } answers requests on a connection until the client closes it
+ */
+
+static void serve_client( int fd, struct Worker_Buffers *buffers )
+{
+    char line[REQUEST_LENGTH];
+    FILE *requests = fdopen( dup( fd ), "r" );
+
+    if ( requests != NULL )
+    {
+        while ( fgets( line, sizeof(line), requests ) != NULL )
+        {
+            if ( serve_request( fd, buffers, line ) != 0 )
+            {
+                break;
+            }
+        }
+        fclose( requests );
+    }
+    close( fd );
+}
+
+/**
+ * @brief      { worker } serves connections off the queue for the life of the daemon
+ */
+
+static void *worker( void *unused )
+{
+    struct Worker_Buffers buffers;
+
+    memset( &buffers, 0, sizeof(buffers) );
+
+    for ( ;; )
+    {
+        serve_client( pop_client(), &buffers );
+    }
+
+    return unused;
+}
+
+/**
+ * @brief      { run_server }
+ *
+ * @param      socketPath  The unix socket to listen on, replaced if it exists
+ * @param[in]  workers     The number of worker threads, 0 for one per CPU
+ *
+ * @return     { -1 if the socket cannot be set up, otherwise it never returns }
+ */
+
+int run_server( const char *socketPath, int workers )
+{
+    struct sockaddr_un address;
+    pthread_t thread;
+    int listener, client;
+
+    if ( workers <= 0 )
+    {
+        workers = (int) sysconf( _SC_NPROCESSORS_ONLN );
+        if ( workers <= 0 )
+        {
+            workers = 1;
+        }
+    }
+
+    // A client that hangs up mid-reply must not take the daemon down
+    signal( SIGPIPE, SIG_IGN );
+
+    if ( strlen( socketPath ) >= sizeof(address.sun_path) )
+    {
+        puts("Error: socket path is too long");
+        return -1;
+    }
+
+    memset( &address, 0, sizeof(address) );
+    address.sun_family = AF_UNIX;
+    strcpy( address.sun_path, socketPath );
+
+    listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+    unlink( socketPath );
+    if ( listener < 0 || bind( listener, (struct sockaddr *) &address, sizeof(address) ) != 0 || listen( listener, QUEUE_LENGTH ) != 0 )
+    {
+        perror("Error: cannot listen on the socket");
+        return -1;
+    }
+
+    for ( int i = 0; i < workers; i++ )
+    {
+        if ( pthread_create( &thread, NULL, worker, NULL ) != 0 )
+        {
+            perror("Error: cannot start a worker");
+            return -1;
+        }
+        pthread_detach( thread );
+    }
+
+    printf("Serving on %s with %d workers\n", socketPath, workers);
+    fflush( stdout );
+
+    for ( ;; )
+    {
+        client = accept( listener, NULL, NULL );
+        if ( client < 0 )
+        {
+            continue;
+        }
+        push_client( client );
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      { send_request } sends one request line to a running daemon and copies the image it
+ *             answers with to stdout
+ *
+ * @param      socketPath  The unix socket the daemon listens on
+ * @param      request     The request, type width height format [out_filename]
+ *
+ * @return     { 0 on OK, 1 on ERR (the answer goes to stderr), -1 if the daemon cannot be reached }
+ */
+
+int send_request( const char *socketPath, const char *request )
+{
+    struct sockaddr_un address;
+    char line[REQUEST_LENGTH], buffer[65536];
+    long long length;
+    size_t got;
+    FILE *answers;
+    int fd;
+
+    if ( strlen( socketPath ) >= sizeof(address.sun_path) || strlen( request ) + 2 > sizeof(line) )
+    {
+        return -1;
+    }
+
+    memset( &address, 0, sizeof(address) );
+    address.sun_family = AF_UNIX;
+    strcpy( address.sun_path, socketPath );
+
+    fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 || connect( fd, (struct sockaddr *) &address, sizeof(address) ) != 0 )
+    {
+        perror("Error: cannot reach the daemon");
+        if ( fd >= 0 )
+        {
+            close( fd );
+        }
+        return -1;
+    }
+
+    snprintf( line, sizeof(line), "%s\n", request );
+    answers = fdopen( fd, "r" );
+    if ( answers == NULL )
+    {
+        close( fd );
+        return -1;
+    }
+    if ( write_all( fd, line, strlen( line ) ) != 0 || fgets( line, sizeof(line), answers ) == NULL )
+    {
+        fclose( answers );
+        return -1;
+    }
+
+    if ( sscanf( line, "OK %lld", &length ) != 1 )
+    {
+        fputs( line, stderr );
+        fclose( answers );
+        return 1;
+    }
+
+    // The image follows the answer line
+    while ( length > 0 && (got = fread( buffer, 1, length < (long long) sizeof(buffer) ? (size_t) length : sizeof(buffer), answers )) > 0 )
+    {
+        fwrite( buffer, 1, got, stdout );
+        length -= got;
+    }
+    fclose( answers );
+    fflush( stdout );
+
+    return length == 0 ? 0 : -1;
+}
@@ -0,0 +1,34 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+/*
+ * The generation daemon.
+ *
+ * Clients connect to a unix socket and send one request per line:
+ *
+ *     type width height format [out_filename]
+ *
+ * with the same meaning as the command line of main. Each request is
+ * answered with "OK <length>\n" followed by <length> bytes of the encoded
+ * image, or with "OK 0\n" once the image has been saved to out_filename,
+ * or with "ERR <reason>\n". A connection may send any number of requests.
+ * Requests for more than SERVER_MAX_PIXELS pixels are refused, which bounds
+ * the memory a single request can take.
+ *
+ * With PNM_CACHE_DIR set, requests are answered from the output cache
+ * (see cache.h) when they can be.
+ */
+
+// the most pixels a request may ask for
+#define SERVER_MAX_PIXELS ((size_t) 4096 * 4096)
+
+// runs the daemon on socketPath with the given number of workers (0 for one
+// per CPU); only returns if the socket cannot be set up
+int run_server( const char *socketPath, int workers );
+
+// sends one request line to the daemon on socketPath and copies the image it
+// answers with to stdout; returns 0 on OK, 1 on ERR and -1 if it cannot be
+// reached
+int send_request( const char *socketPath, const char *request );
+
+#endif /*_SERVER_H_*/
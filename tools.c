@@ -0,0 +1,765 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libpnm.h"
+#include "libpnm_lossless.h"
+#include "libpnm_histogram.h"
+#include "libpnm_dither.h"
+#include "libpnm_filter.h"
+#include "libpnm_quantize.h"
+#include "libpnm_shm.h"
+#include "libpnm_stream.h"
+#include "libpnm_ingest.h"
+#include "tools.h"
+
+/*--------------------------------------------------------*/
+/* A TOOL: ITS OPTION, THE ARGUMENTS IT CANNOT DO WITHOUT */
+/* AND THE USAGE OF ALL OF THEM                           */
+/*--------------------------------------------------------*/
+struct Tool
+{
+    const char *name;
+    int required;
+    int (*run)( int count, char **arguments );
+    const char *usage;
+};
+
+// how long --shm-receive waits for an image to be published, in milliseconds
+#define SHM_RECEIVE_TIMEOUT 10000
+
+/*-----------------------------------------------------------*/
+/* GETS THE OPTIONAL ARGUMENT index AS A NUMBER, OR fallback */
+/* WHEN IT WAS NOT GIVEN                                     */
+/*-----------------------------------------------------------*/
+static int optional( int count, char **arguments, int index, int fallback )
+{
+    return index < count ? atoi( arguments[index] ) : fallback;
+}
+
+/*---------------------------------------------------------*/
+/* SAVES THE REGION OF A PGM OR PPM GIVEN, AS A VIEW OF IT */
+/*---------------------------------------------------------*/
+static int run_crop( int count, char **arguments )
+{
+    struct PGM_Image pgmImage, pgmView;
+    struct PPM_Image ppmImage, ppmView;
+    int left = atoi( arguments[2] ), top = atoi( arguments[3] );
+    int width = atoi( arguments[4] ), height = atoi( arguments[5] );
+    int raw = optional( count, arguments, 6, 1 ) != 0;
+    int status = -1;
+
+    if ( load_PGM_Image( &pgmImage, arguments[0] ) == 0 )
+    {
+        if ( create_PGM_View( &pgmImage, &pgmView, left, top, width, height ) == 0 )
+        {
+            status = save_PGM_Image( &pgmView, arguments[1], raw );
+            free_PGM_Image( &pgmView );
+        }
+        free_PGM_Image( &pgmImage );
+    }
+    else if ( load_PPM_Image( &ppmImage, arguments[0] ) == 0 )
+    {
+        if ( create_PPM_View( &ppmImage, &ppmView, left, top, width, height ) == 0 )
+        {
+            status = save_PPM_Image( &ppmView, arguments[1], raw );
+            free_PPM_Image( &ppmView );
+        }
+        free_PPM_Image( &ppmImage );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot crop %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* WRITES A PGM OR PPM INTO A RAW IMAGE OF THE SAME FORMAT   */
+/* AT (left, top), IN PLACE: THE ROWS OF THE SOURCE ARE READ */
+/* LAZILY, AND ONLY THE ROWS IT COVERS ARE WRITTEN BACK      */
+/*-----------------------------------------------------------*/
+static int run_paste( int count, char **arguments )
+{
+    struct PNM_Lazy_Image source, destination;
+    int left = atoi( arguments[2] ), top = atoi( arguments[3] );
+    unsigned char *from, *to;
+    int status = -1;
+
+    if ( open_PNM_Lazy_Image( &source, arguments[0] ) == 0 )
+    {
+        if ( open_PNM_Lazy_Image_for_Update( &destination, arguments[1] ) == 0 )
+        {
+            if ( source.format == destination.format && source.maxGrayValue == destination.maxGrayValue &&
+                 left >= 0 && top >= 0 && left + source.width <= destination.width &&
+                 top + source.height <= destination.height )
+            {
+                status = 0;
+            }
+
+            for ( int row = 0; status == 0 && row < source.height; row++ )
+            {
+                from = get_PNM_Lazy_Row( &source, row );
+                to = get_PNM_Lazy_Row( &destination, top + row );
+                if ( from == NULL || to == NULL )
+                {
+                    status = -1;
+                    break;
+                }
+                memcpy( to + (size_t) left * source.channels, from, (size_t) source.width * source.channels );
+                status = mark_PNM_Lazy_Row_Dirty( &destination, top + row );
+            }
+
+            if ( status == 0 )
+            {
+                status = flush_PNM_Lazy_Image( &destination );
+            }
+            close_PNM_Lazy_Image( &destination );
+        }
+        close_PNM_Lazy_Image( &source );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot paste %s into %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* CODES A PGM OR PPM LOSSLESSLY, A PPM AS Y, U, V WHEN THE  */
+/* COLOUR TRANSFORM IS ASKED FOR                             */
+/*-----------------------------------------------------------*/
+static int run_encode( int count, char **arguments )
+{
+    struct PGM_Image pgmImage;
+    struct PPM_Image ppmImage;
+    int transform = optional( count, arguments, 2, 0 ) != 0;
+    int status = -1;
+
+    if ( load_PGM_Image( &pgmImage, arguments[0] ) == 0 )
+    {
+        status = save_PGM_Image_Lossless( &pgmImage, arguments[1] );
+        free_PGM_Image( &pgmImage );
+    }
+    else if ( load_PPM_Image( &ppmImage, arguments[0] ) == 0 )
+    {
+        status = save_PPM_Image_Lossless( &ppmImage, arguments[1], transform );
+        free_PPM_Image( &ppmImage );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot encode %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* DECODES A LOSSLESSLY CODED IMAGE BACK INTO A PGM OR PPM   */
+/*-----------------------------------------------------------*/
+static int run_decode( int count, char **arguments )
+{
+    struct PGM_Image pgmImage;
+    struct PPM_Image ppmImage;
+    int raw = optional( count, arguments, 2, 1 ) != 0;
+    int status = -1;
+
+    if ( load_PGM_Image_Lossless( &pgmImage, arguments[0] ) == 0 )
+    {
+        status = save_PGM_Image( &pgmImage, arguments[1], raw );
+        free_PGM_Image( &pgmImage );
+    }
+    else if ( load_PPM_Image_Lossless( &ppmImage, arguments[0] ) == 0 )
+    {
+        status = save_PPM_Image( &ppmImage, arguments[1], raw );
+        free_PPM_Image( &ppmImage );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot decode %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* PRINTS THE STATISTICS OF EVERY CHANNEL OF A HISTOGRAM,    */
+/* EACH FOLLOWED BY THE COUNT OF EVERY VALUE THAT OCCURS     */
+/*-----------------------------------------------------------*/
+static void print_histogram( struct PNM_Histogram *histogram )
+{
+    static const char *grayChannels[] = { "gray" };
+    static const char *colourChannels[] = { "red", "green", "blue" };
+    const char **names = histogram->channels == 1 ? grayChannels : colourChannels;
+
+    for ( int channel = 0; channel < histogram->channels; channel++ )
+    {
+        printf( "%s samples %llu min %d max %d mean %.6f variance %.6f\n",
+                names[channel], histogram->samples, histogram->min[channel],
+                histogram->max[channel], histogram->mean[channel], histogram->variance[channel] );
+        for ( int value = 0; value < 256; value++ )
+        {
+            if ( histogram->counts[channel][value] != 0 )
+            {
+                printf( "%s %d %llu\n", names[channel], value, histogram->counts[channel][value] );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+/* PRINTS THE HISTOGRAM OF A PGM OR PPM, COUNTED AFTER IT IS */
+/* LOADED OR, IF while_loading IS 1, AS IT IS DECODED        */
+/*-----------------------------------------------------------*/
+static int run_histogram( int count, char **arguments )
+{
+    struct PGM_Image pgmImage;
+    struct PPM_Image ppmImage;
+    struct PNM_Histogram *histogram;
+    int whileLoading = optional( count, arguments, 1, 0 ) != 0;
+    int status = -1;
+
+    // the banks make a histogram too large for the stack
+    histogram = malloc( sizeof(*histogram) );
+    if ( histogram == NULL )
+    {
+        fprintf( stderr, "Cannot count %s\n", arguments[0] );
+        return -1;
+    }
+
+    if ( whileLoading ? load_PGM_Image_With_Histogram( &pgmImage, arguments[0], histogram ) == 0 :
+                        load_PGM_Image( &pgmImage, arguments[0] ) == 0 )
+    {
+        status = whileLoading ? 0 : compute_PGM_Histogram( &pgmImage, histogram );
+        free_PGM_Image( &pgmImage );
+    }
+    else if ( whileLoading ? load_PPM_Image_With_Histogram( &ppmImage, arguments[0], histogram ) == 0 :
+                             load_PPM_Image( &ppmImage, arguments[0] ) == 0 )
+    {
+        status = whileLoading ? 0 : compute_PPM_Histogram( &ppmImage, histogram );
+        free_PPM_Image( &ppmImage );
+    }
+
+    if ( status == 0 )
+    {
+        print_histogram( histogram );
+    }
+    else
+    {
+        fprintf( stderr, "Cannot count %s\n", arguments[0] );
+    }
+    free( histogram );
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* DITHERS A PGM INTO A PBM, STRAIGHT INTO PACKED ROWS WHEN  */
+/* IT IS SAVED RAW                                           */
+/*-----------------------------------------------------------*/
+static int run_dither( int count, char **arguments )
+{
+    struct PGM_Image pgmImage;
+    struct PBM_Image pbmImage;
+    struct PBM_Packed_Image packedImage;
+    int mode = atoi( arguments[2] );
+    int raw = optional( count, arguments, 3, 1 ) != 0;
+    int status = -1;
+
+    if ( mode >= DITHER_THRESHOLD && mode <= DITHER_ATKINSON && load_PGM_Image( &pgmImage, arguments[0] ) == 0 )
+    {
+        if ( raw && dither_PGM_to_PBM_Packed( &pgmImage, &packedImage, mode ) == 0 )
+        {
+            status = save_PBM_Packed_Image( &packedImage, arguments[1], true );
+            free_PBM_Packed_Image( &packedImage );
+        }
+        else if ( !raw && dither_PGM_to_PBM( &pgmImage, &pbmImage, mode ) == 0 )
+        {
+            status = save_PBM_Image( &pbmImage, arguments[1], false );
+            free_PBM_Image( &pbmImage );
+        }
+        free_PGM_Image( &pgmImage );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot dither %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* FILTERS A PGM OR PPM WITH THE SAME BOX (size IS THE       */
+/* RADIUS) OR GAUSSIAN (size IS SIGMA) KERNEL ALONG THE ROWS */
+/* AND DOWN THE COLUMNS                                      */
+/*-----------------------------------------------------------*/
+static int run_filter( int count, char **arguments )
+{
+    struct PGM_Image pgmImage, pgmFiltered;
+    struct PPM_Image ppmImage, ppmFiltered;
+    struct PNM_Filter_Kernel kernel;
+    int border = atoi( arguments[4] );
+    int raw = optional( count, arguments, 5, 1 ) != 0;
+    int status = -1;
+
+    if ( strcmp( arguments[2], "box" ) == 0 )
+    {
+        status = make_Box_Kernel( &kernel, atoi( arguments[3] ) );
+    }
+    else if ( strcmp( arguments[2], "gaussian" ) == 0 )
+    {
+        status = make_Gaussian_Kernel( &kernel, atof( arguments[3] ) );
+    }
+    if ( border < BORDER_CLAMP || border > BORDER_ZERO )
+    {
+        status = -1;
+    }
+
+    if ( status == 0 && load_PGM_Image( &pgmImage, arguments[0] ) == 0 )
+    {
+        status = filter_PGM_Image( &pgmImage, &pgmFiltered, &kernel, &kernel, border );
+        if ( status == 0 )
+        {
+            status = save_PGM_Image( &pgmFiltered, arguments[1], raw );
+            free_PGM_Image( &pgmFiltered );
+        }
+        free_PGM_Image( &pgmImage );
+    }
+    else if ( status == 0 && load_PPM_Image( &ppmImage, arguments[0] ) == 0 )
+    {
+        status = filter_PPM_Image( &ppmImage, &ppmFiltered, &kernel, &kernel, border );
+        if ( status == 0 )
+        {
+            status = save_PPM_Image( &ppmFiltered, arguments[1], raw );
+            free_PPM_Image( &ppmFiltered );
+        }
+        free_PPM_Image( &ppmImage );
+    }
+    else
+    {
+        status = -1;
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot filter %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* QUANTIZES A PPM TO AT MOST colours COLOURS, REFINED BY UP */
+/* TO iterations ROUNDS OF k-means, AND SAVES IT EXPANDED    */
+/* BACK FROM THE PALETTE                                     */
+/*-----------------------------------------------------------*/
+static int run_quantize( int count, char **arguments )
+{
+    struct PPM_Image ppmImage, ppmQuantized;
+    struct PGM_Image indexImage;
+    struct PNM_Palette palette;
+    int colours = atoi( arguments[2] ), iterations = atoi( arguments[3] );
+    int raw = optional( count, arguments, 4, 1 ) != 0;
+    int status = -1;
+
+    if ( load_PPM_Image( &ppmImage, arguments[0] ) == 0 )
+    {
+        if ( quantize_PPM_Image( &ppmImage, &palette, &indexImage, colours, iterations ) == 0 )
+        {
+            if ( expand_Indexed_Image( &indexImage, &palette, &ppmQuantized ) == 0 )
+            {
+                status = save_PPM_Image( &ppmQuantized, arguments[1], raw );
+                free_PPM_Image( &ppmQuantized );
+            }
+            free_PGM_Image( &indexImage );
+        }
+        free_PPM_Image( &ppmImage );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot quantize %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* PUBLISHES A PGM OR PPM AS THE SHARED IMAGE CALLED name,   */
+/* ITS ROWS READ LAZILY STRAIGHT INTO THE SHARED BODY        */
+/*-----------------------------------------------------------*/
+static int run_shm_send( int count, char **arguments )
+{
+    struct PNM_Lazy_Image source;
+    struct PNM_Shared_Image sharedImage;
+    unsigned char *row;
+    int status = -1;
+
+    if ( open_PNM_Lazy_Image( &source, arguments[0] ) == 0 )
+    {
+        if ( create_PNM_Shared_Image( &sharedImage, arguments[1], source.format, source.width,
+                                      source.height, source.maxGrayValue ) == 0 )
+        {
+            status = 0;
+            begin_PNM_Shared_Write( &sharedImage );
+            for ( int i = 0; i < source.height; i++ )
+            {
+                row = get_PNM_Lazy_Row( &source, i );
+                if ( row == NULL )
+                {
+                    status = -1;
+                    break;
+                }
+                memcpy( sharedImage.mappedImage.rows[i], row, sharedImage.mappedImage.rowBytes );
+            }
+
+            // a short source is not published, its waiting processes time out
+            if ( status == 0 )
+            {
+                publish_PNM_Shared_Image( &sharedImage );
+            }
+            close_PNM_Mapped_Image( &sharedImage.mappedImage );
+        }
+        close_PNM_Lazy_Image( &source );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot send %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* WAITS FOR THE SHARED IMAGE CALLED name TO BE PUBLISHED,   */
+/* SAVES IT FROM A VIEW OF ITS BODY AND REMOVES THE NAME     */
+/* (fails if the image changes while it is saved)            */
+/*-----------------------------------------------------------*/
+static int run_shm_receive( int count, char **arguments )
+{
+    struct PNM_Shared_Image sharedImage;
+    struct PGM_Image pgmView;
+    struct PPM_Image ppmView;
+    int raw = optional( count, arguments, 2, 1 ) != 0;
+    unsigned int generation;
+    int status = -1;
+
+    if ( open_PNM_Shared_Image( &sharedImage, arguments[0] ) == 0 )
+    {
+        generation = wait_PNM_Shared_Image( &sharedImage, 0, SHM_RECEIVE_TIMEOUT );
+
+        if ( generation != 0 && sharedImage.mappedImage.format == PGM &&
+             map_PGM_Image( &sharedImage.mappedImage, &pgmView ) == 0 )
+        {
+            status = save_PGM_Image( &pgmView, arguments[1], raw );
+            free_PGM_Image( &pgmView );
+        }
+        else if ( generation != 0 && sharedImage.mappedImage.format == PPM &&
+                  map_PPM_Image( &sharedImage.mappedImage, &ppmView ) == 0 )
+        {
+            status = save_PPM_Image( &ppmView, arguments[1], raw );
+            free_PPM_Image( &ppmView );
+        }
+
+        if ( status == 0 && get_PNM_Shared_Generation( &sharedImage ) != generation )
+        {
+            status = -1;
+        }
+        if ( status == 0 )
+        {
+            status = unlink_PNM_Shared_Image( arguments[0] );
+        }
+        close_PNM_Mapped_Image( &sharedImage.mappedImage );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot receive %s to %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* WRITES PBM, PGM OR PPM FILES ONE AFTER ANOTHER AS THE     */
+/* FRAMES OF ONE STREAM                                      */
+/*-----------------------------------------------------------*/
+static int run_frames( int count, char **arguments )
+{
+    struct PNM_Stream stream;
+    struct PBM_Image pbmImage;
+    struct PGM_Image pgmImage;
+    struct PPM_Image ppmImage;
+    int raw = atoi( arguments[1] ) != 0;
+    FILE *file;
+    int status = -1;
+
+    file = fileOpener( WRITE, arguments[0] );
+    if ( file != NULL )
+    {
+        if ( open_PNM_Writer( &stream, file, raw ) == 0 )
+        {
+            status = 0;
+            for ( int i = 2; status == 0 && i < count; i++ )
+            {
+                if ( load_PGM_Image( &pgmImage, arguments[i] ) == 0 )
+                {
+                    status = write_PGM_Frame( &stream, &pgmImage );
+                    free_PGM_Image( &pgmImage );
+                }
+                else if ( load_PPM_Image( &ppmImage, arguments[i] ) == 0 )
+                {
+                    status = write_PPM_Frame( &stream, &ppmImage );
+                    free_PPM_Image( &ppmImage );
+                }
+                else if ( load_PBM_Image( &pbmImage, arguments[i] ) == 0 )
+                {
+                    status = write_PBM_Frame( &stream, &pbmImage );
+                    free_PBM_Image( &pbmImage );
+                }
+                else
+                {
+                    status = -1;
+                }
+            }
+
+            if ( close_PNM_Stream( &stream ) != 0 )
+            {
+                status = -1;
+            }
+        }
+        if ( fclose( file ) != 0 )
+        {
+            status = -1;
+        }
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot write the frames to %s\n", arguments[0] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* SAVES EVERY FRAME OF A STREAM AS out_prefix_N.pbm (OR     */
+/* .pgm OR .ppm), N COUNTING FROM 0; THE FRAMES ALL HAVE THE */
+/* FORMAT OF THE FIRST, AND ARE READ AHEAD WITH prefetch     */
+/*-----------------------------------------------------------*/
+static int run_split( int count, char **arguments )
+{
+    static const char *extensions[] = { "", "pbm", "pgm", "ppm" };
+    struct PNM_Frame_Header header;
+    struct PNM_Stream stream;
+    struct PBM_Image pbmFrame = { 0 };
+    struct PGM_Image pgmFrame = { 0 };
+    struct PPM_Image ppmFrame = { 0 };
+    bool prefetch = optional( count, arguments, 2, 0 ) != 0;
+    int raw = optional( count, arguments, 3, 1 ) != 0;
+    char filename[1024];
+    FILE *file;
+    int frames = 0, result = -1, status = -1;
+
+    file = fileOpener( READ, arguments[0] );
+    if ( file != NULL )
+    {
+        if ( read_PNM_Frame_Header( file, &header ) == 0 && fseek( file, 0, SEEK_SET ) == 0 &&
+             open_PNM_Reader( &stream, file, prefetch ) == 0 )
+        {
+            do
+            {
+                snprintf( filename, sizeof(filename), "%s_%d.%s", arguments[1], frames++,
+                          extensions[header.format] );
+
+                if ( header.format == PBM && ( result = read_PBM_Frame( &stream, &pbmFrame ) ) == 0 )
+                {
+                    result = save_PBM_Image( &pbmFrame, filename, raw );
+                }
+                else if ( header.format == PGM && ( result = read_PGM_Frame( &stream, &pgmFrame ) ) == 0 )
+                {
+                    result = save_PGM_Image( &pgmFrame, filename, raw );
+                }
+                else if ( header.format == PPM && ( result = read_PPM_Frame( &stream, &ppmFrame ) ) == 0 )
+                {
+                    result = save_PPM_Image( &ppmFrame, filename, raw );
+                }
+            } while ( result == 0 );
+
+            // the stream must end after a whole frame
+            if ( close_PNM_Stream( &stream ) == 0 && result == 1 )
+            {
+                status = 0;
+            }
+        }
+        fclose( file );
+    }
+
+    if ( pbmFrame.image != NULL )
+    {
+        free_PBM_Image( &pbmFrame );
+    }
+    if ( pgmFrame.image != NULL )
+    {
+        free_PGM_Image( &pgmFrame );
+    }
+    if ( ppmFrame.image != NULL )
+    {
+        free_PPM_Image( &ppmFrame );
+    }
+
+    if ( status != 0 )
+    {
+        fprintf( stderr, "Cannot split %s into %s\n", arguments[0], arguments[1] );
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+/* PRINTS AN IMAGE INGESTED FROM THE LIST: ITS FORMAT, SIZE, */
+/* MAX GRAY VALUE AND THE SUM OF ITS SAMPLES, THEN FREES IT  */
+/*-----------------------------------------------------------*/
+static void print_ingested( void *context, struct PNM_Ingested_Image *image )
+{
+    static const char *formats[] = { "", "PBM", "PGM", "PPM" };
+    unsigned long long sum = 0;
+    int width = 0, height = 0, maxGrayValue = 1;
+
+    if ( image->status != 0 )
+    {
+        printf( "%s cannot be loaded\n", image->fileName );
+        return;
+    }
+
+    if ( image->format == PBM )
+    {
+        width = image->pbmImage.width;
+        height = image->pbmImage.height;
+        for ( int row = 0; row < height; row++ )
+        {
+            for ( int col = 0; col < width; col++ )
+            {
+                sum += image->pbmImage.image[row][col];
+            }
+        }
+        free_PBM_Image( &image->pbmImage );
+    }
+    else if ( image->format == PGM )
+    {
+        width = image->pgmImage.width;
+        height = image->pgmImage.height;
+        maxGrayValue = image->pgmImage.maxGrayValue;
+        for ( int row = 0; row < height; row++ )
+        {
+            for ( int col = 0; col < width; col++ )
+            {
+                sum += image->pgmImage.image[row][col];
+            }
+        }
+        free_PGM_Image( &image->pgmImage );
+    }
+    else
+    {
+        width = image->ppmImage.width;
+        height = image->ppmImage.height;
+        maxGrayValue = image->ppmImage.maxGrayValue;
+        for ( int row = 0; row < height; row++ )
+        {
+            for ( int sample = 0; sample < 3 * width; sample++ )
+            {
+                sum += image->ppmImage.image[row][0][sample];
+            }
+        }
+        free_PPM_Image( &image->ppmImage );
+    }
+
+    printf( "%s %s %d %d %d sum %llu\n", image->fileName, formats[image->format], width, height,
+            maxGrayValue, sum );
+}
+
+/*-----------------------------------------------------------*/
+/* LOADS A LIST OF PBM, PGM OR PPM FILES ON EVERY CPU AND    */
+/* PRINTS A LINE FOR EACH, IN THE ORDER OF THE LIST (fails   */
+/* if any file could not be loaded)                          */
+/*-----------------------------------------------------------*/
+static int run_ingest( int count, char **arguments )
+{
+    int failed = ingest_PNM_Files( arguments, count, true, print_ingested, NULL );
+
+    if ( failed != 0 )
+    {
+        fprintf( stderr, "Cannot load %d of the files\n", failed < 0 ? count : failed );
+    }
+    return failed == 0 ? 0 : -1;
+}
+
+/*----------------------------------------*/
+/* THE TOOLS, IN THE ORDER OF THEIR USAGE */
+/*----------------------------------------*/
+static const struct Tool tools[] =
+{
+    { "--crop", 6, run_crop, "in_filename out_filename left top width height [format]" },
+    { "--paste", 4, run_paste, "in_filename raw_filename left top" },
+    { "--encode", 2, run_encode, "in_filename out_filename [transform]" },
+    { "--decode", 2, run_decode, "in_filename out_filename [format]" },
+    { "--histogram", 1, run_histogram, "in_filename [while_loading]" },
+    { "--dither", 3, run_dither, "in_filename out_filename mode [format]" },
+    { "--filter", 5, run_filter, "in_filename out_filename box|gaussian size border [format]" },
+    { "--quantize", 4, run_quantize, "in_filename out_filename colours iterations [format]" },
+    { "--shm-send", 2, run_shm_send, "in_filename name" },
+    { "--shm-receive", 2, run_shm_receive, "name out_filename [format]" },
+    { "--frames", 3, run_frames, "out_filename format in_filename..." },
+    { "--split", 2, run_split, "in_filename out_prefix [prefetch] [format]" },
+    { "--ingest", 1, run_ingest, "in_filename..." },
+};
+
+/*------------------------------------------------------*/
+/* FINDS THE TOOL CALLED name (returns NULL if none is) */
+/*------------------------------------------------------*/
+static const struct Tool *find_tool( const char *name )
+{
+    for ( size_t i = 0; i < sizeof(tools) / sizeof(tools[0]); i++ )
+    {
+        if ( strcmp( tools[i].name, name ) == 0 )
+        {
+            return &tools[i];
+        }
+    }
+    return NULL;
+}
+
+/*-----------------------------------------*/
+/* CHECKS WHETHER name IS ONE OF THE TOOLS */
+/*-----------------------------------------*/
+int is_tool( const char *name )
+{
+    return find_tool( name ) != NULL;
+}
+
+/*------------------------------------------------------*/
+/* RUNS THE TOOL NAMED BY arguments[0] ON THE ARGUMENTS */
+/* AFTER IT (returns the exit status, 1 on any failure) */
+/*------------------------------------------------------*/
+int run_tool( int count, char **arguments )
+{
+    const struct Tool *tool = find_tool( arguments[0] );
+
+    if ( tool == NULL )
+    {
+        return 1;
+    }
+    if ( count - 1 < tool->required )
+    {
+        printf( "Usage: ./main %s %s\n", tool->name, tool->usage );
+        return 1;
+    }
+
+    return tool->run( count - 1, arguments + 1 ) == 0 ? 0 : 1;
+}
+
+/*-------------------------------------*/
+/* PRINTS THE USAGE LINE OF EVERY TOOL */
+/*-------------------------------------*/
+void print_tool_usage( void )
+{
+    for ( size_t i = 0; i < sizeof(tools) / sizeof(tools[0]); i++ )
+    {
+        printf( "       ./main %s %s\n", tools[i].name, tools[i].usage );
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef _TOOLS_H_
+#define _TOOLS_H_
+
+/*
+ * The image tools.
+ *
+ * Small commands over existing image files that put the library to work
+ * from the command line (and from the tests):
+ *
+ *     --crop in_filename out_filename left top width height [format]
+ *         saves the width by height region at (left, top) of a PGM or PPM,
+ *         taken as a view of the image (see create_PGM_View)
+ *
+ *     --paste in_filename raw_filename left top
+ *         writes a PGM or PPM into a raw image of the same format and max gray
+ *         value at (left, top), in place: the rows of in_filename are read
+ *         lazily and only the rows it covers are rewritten (see
+ *         open_PNM_Lazy_Image_for_Update)
+ *
+ *     --encode in_filename out_filename [transform]
+ *     --decode in_filename out_filename [format]
+ *         codes a PGM or PPM losslessly (see libpnm_lossless.h), a PPM as
+ *         Y, U, V when transform is 1, and decodes it back
+ *
+ *     --histogram in_filename [while_loading]
+ *         prints the samples, min, max, mean and variance of every channel of
+ *         a PGM or PPM, each followed by "channel value count" for every value
+ *         that occurs, counted after loading or, with while_loading 1, as the
+ *         image is decoded (see libpnm_histogram.h)
+ *
+ *     --dither in_filename out_filename mode [format]
+ *         dithers a PGM into a PBM by threshold (mode 0), Floyd-Steinberg (1)
+ *         or Atkinson (2) error diffusion (see libpnm_dither.h); raw output
+ *         is dithered straight into packed rows
+ *
+ *     --filter in_filename out_filename box|gaussian size border [format]
+ *         filters a PGM or PPM with a box kernel of radius size or a Gaussian
+ *         of sigma size along the rows and down the columns, with clamp (0),
+ *         mirror (1), wrap (2) or zero (3) borders (see libpnm_filter.h)
+ *
+ *     --quantize in_filename out_filename colours iterations [format]
+ *         quantizes a PPM to at most colours colours, refined by up to
+ *         iterations rounds of k-means (see libpnm_quantize.h), and saves it
+ *         expanded back from the palette
+ *
+ *     --shm-send in_filename name
+ *     --shm-receive name out_filename [format]
+ *         publishes a PGM or PPM as the shared image called name, such as
+ *         "/frames" (see libpnm_shm.h), and in another process waits for it,
+ *         saves it and removes the name
+ *
+ *     --frames out_filename format in_filename...
+ *     --split in_filename out_prefix [prefetch] [format]
+ *         writes PBM, PGM or PPM files as the frames of one stream, and saves
+ *         the frames of a stream, all of the format of the first, as
+ *         out_prefix_N.pbm (or .pgm or .ppm), N counting from 0, reading the
+ *         next frame ahead with prefetch 1 (see libpnm_stream.h)
+ *
+ *     --ingest in_filename...
+ *         loads PBM, PGM or PPM files on every CPU (see libpnm_ingest.h) and
+ *         prints, in the order given, "in_filename format width height
+ *         max_gray_value sum N" for each, N being the sum of its samples, or
+ *         "in_filename cannot be loaded"
+ *
+ * format is 0 for ASCII or 1 for raw (the default). A tool prints why it
+ * failed on stderr.
+ */
+
+// returns 1 if name (such as "--crop") is one of the tools
+int is_tool( const char *name );
+
+// runs the tool named by arguments[0] on the arguments after it, returns
+// the exit status: 0 on success, 1 on failure or when arguments are missing
+int run_tool( int count, char **arguments );
+
+// prints the usage line of every tool
+void print_tool_usage( void );
+
+#endif /*_TOOLS_H_*/